@@ -0,0 +1,581 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file bench.c
+ * @brief Microbenchmarks of the conversion, bit and hexdump functions
+ *
+ * The working set is filled once per distribution and size class, and all
+ * kernels then walk it from where the previous one stopped.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bit_operations.h"
+#include "cpu_dispatch.h"
+#include "bench.h"
+
+#define BENCH_HEXDUMP_STR 8192      // Holds a dump of BENCH_HEXDUMP_BYTES
+
+typedef struct {
+    const char *name;
+    size_t elem_bytes;      // Input bytes of one op
+    // Runs n ops on the input at in, returns the characters written
+    size_t (*run)(const uint8_t *in, size_t n);
+} bench_kernel_t;
+
+static const char *dist_names[] = { "random", "small", "mixed" };
+static const char *size_names[] = { "L1", "DRAM" };
+
+// Keeps the results of the kernels alive
+static volatile uint64_t bench_sink;
+
+
+// ************************ Kernels  ************************************
+
+static size_t run_uint_to_binstr(const uint8_t *in, size_t n) {
+    const uint32_t *nums = (const uint32_t *)in;
+    size_t i, chars = 0;
+    char str[40];
+    int len;
+
+    for (i = 0; i < n; i++) {
+        len = uint_to_binstr(str, sizeof(str), nums[i], 32);
+        chars += len > 0 ? (size_t)len : 0;
+    }
+    bench_sink += (uint8_t)str[2];
+    return chars;
+}
+
+static size_t run_int_to_binstr(const uint8_t *in, size_t n) {
+    const uint32_t *nums = (const uint32_t *)in;
+    size_t i, chars = 0;
+    char str[40];
+    int len;
+
+    for (i = 0; i < n; i++) {
+        len = int_to_binstr(str, sizeof(str), (int32_t)nums[i], 32);
+        chars += len > 0 ? (size_t)len : 0;
+    }
+    bench_sink += (uint8_t)str[2];
+    return chars;
+}
+
+static size_t run_uint_to_hexstr(const uint8_t *in, size_t n) {
+    const uint32_t *nums = (const uint32_t *)in;
+    size_t i, chars = 0;
+    char str[16];
+    int len;
+
+    for (i = 0; i < n; i++) {
+        len = uint_to_hexstr(str, sizeof(str), nums[i], 32);
+        chars += len > 0 ? (size_t)len : 0;
+    }
+    bench_sink += (uint8_t)str[0];
+    return chars;
+}
+
+static size_t run_twiggle_bit(const uint8_t *in, size_t n) {
+    const uint32_t *nums = (const uint32_t *)in;
+    uint32_t acc = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        acc ^= twiggle_bit(nums[i], (int)(nums[i] & 31), (operation_t)((nums[i] >> 5) % 3));
+    bench_sink += acc;
+    return 0;
+}
+
+static size_t run_grab_three_bits(const uint8_t *in, size_t n) {
+    const uint32_t *nums = (const uint32_t *)in;
+    uint32_t acc = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        acc += grab_three_bits(nums[i], (int)(nums[i] % 30));
+    bench_sink += acc;
+    return 0;
+}
+
+static size_t run_hexdump(const uint8_t *in, size_t n) {
+    static char str[BENCH_HEXDUMP_STR];
+    size_t i, chars = 0;
+
+    for (i = 0; i < n; i++) {
+        hexdump(str, sizeof(str), in + i * BENCH_HEXDUMP_BYTES, BENCH_HEXDUMP_BYTES);
+        chars += (BENCH_HEXDUMP_BYTES / HEXDUMP_BYTES_PER_LINE)
+                 * (hexdump_line_length(hexdump_offset_digits(BENCH_HEXDUMP_BYTES)) + 1) - 1;
+    }
+    bench_sink += (uint8_t)str[7];
+    return chars;
+}
+
+static const bench_kernel_t kernels[] = {
+    { "uint_to_binstr", 4, run_uint_to_binstr },
+    { "int_to_binstr", 4, run_int_to_binstr },
+    { "uint_to_hexstr", 4, run_uint_to_hexstr },
+    { "twiggle_bit", 4, run_twiggle_bit },
+    { "grab_three_bits", 4, run_grab_three_bits },
+    { "hexdump", BENCH_HEXDUMP_BYTES, run_hexdump },
+};
+
+#define NUM_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+
+// ************************ Measurement  ************************************
+
+static double now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ *   @brief  Fills words 32 bit values of a distribution
+ */
+static void fill_input(uint32_t *words, size_t count, int dist) {
+    uint32_t seed = 41u + (uint32_t)dist, width;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        seed = seed * 1103515245u + 12345u;
+        words[i] = (seed >> 16) | (seed << 16);
+        if (dist == 1)
+            words[i] &= 0xFF;
+        else if (dist == 2) {
+            width = 1 + (seed >> 27);
+            words[i] &= 0xFFFFFFFFu >> (32 - width);
+        }
+    }
+}
+
+/**
+ *   @brief  Runs n ops of a kernel from element *pos of the working set,
+ *           wrapping around at its end
+ *
+ *   @return size_t : Characters written
+ */
+static size_t advance(const bench_kernel_t *k, const uint8_t *in, size_t count,
+                      size_t *pos, size_t n) {
+    size_t chunk, chars = 0;
+
+    while (n > 0) {
+        chunk = count - *pos < n ? count - *pos : n;
+        chars += k->run(in + *pos * k->elem_bytes, chunk);
+        *pos = (*pos + chunk) % count;
+        n -= chunk;
+    }
+    return chars;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ *   @brief  Nearest rank percentile of n sorted samples
+ */
+static double percentile(const double *sorted, int n, int pct) {
+    int rank = (pct * n + 99) / 100;
+
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ *   @brief  Times one kernel on a filled working set
+ */
+static void measure(const bench_config_t *cfg, const bench_kernel_t *k, const uint8_t *in,
+                    size_t ws, size_t *pos, perf_counters_t *pc, bench_result_t *res) {
+    double samples[BENCH_MAX_REPS], target = cfg->rep_ms * 1e6, start, elapsed;
+    size_t count = ws / k->elem_bytes, ops = 16, chars = 0;
+    uint64_t counts[PERF_COUNTER_COUNT];
+    int r, i;
+
+    // Calibration, which also warms up
+    for (;;) {
+        start = now_ns();
+        advance(k, in, count, pos, ops);
+        elapsed = now_ns() - start;
+        if (elapsed >= target / 4 || ops >= ((size_t)1 << 40))
+            break;
+        ops *= 2;
+    }
+    ops = (size_t)((double)ops * target / (elapsed > 1 ? elapsed : 1));
+    ops = ops > 0 ? ops : 1;
+    advance(k, in, count, pos, ops);
+
+    // Counted over all the timed repetitions
+    if (pc != NULL)
+        perf_counters_start(pc);
+    for (r = 0; r < cfg->reps; r++) {
+        start = now_ns();
+        chars = advance(k, in, count, pos, ops);
+        samples[r] = (now_ns() - start) / (double)ops;
+    }
+    if (pc != NULL) {
+        res->counters = perf_counters_stop(pc, counts);
+        for (i = 0; i < PERF_COUNTER_COUNT; i++)
+            res->per_op[i] = (double)counts[i] / ((double)ops * cfg->reps);
+        if (counts[PERF_CYCLES] > 0 && (res->counters & (1u << PERF_INSTRUCTIONS)))
+            res->ipc = (double)counts[PERF_INSTRUCTIONS] / (double)counts[PERF_CYCLES];
+    }
+    qsort(samples, (size_t)cfg->reps, sizeof(double), compare_double);
+
+    res->kernel = k->name;
+    res->working_set = count * k->elem_bytes;
+    res->ops_per_rep = ops;
+    res->reps = cfg->reps;
+    res->min = samples[0];
+    res->p10 = percentile(samples, cfg->reps, 10);
+    res->median = percentile(samples, cfg->reps, 50);
+    res->p90 = percentile(samples, cfg->reps, 90);
+    res->max = samples[cfg->reps - 1];
+    res->bytes_per_op = (double)k->elem_bytes;
+    res->chars_per_op = (double)chars / (double)ops;
+    res->bytes_per_s = res->median > 0 ? res->bytes_per_op * 1e9 / res->median : 0;
+}
+
+
+// ************************ Reports  ************************************
+
+static void json_begin(FILE *f, const bench_config_t *cfg, const perf_counters_t *pc) {
+    int i, first = 0;
+#ifdef __OPTIMIZE__
+    const int optimized = 1;
+#else
+    const int optimized = 0;
+#endif
+
+    fprintf(f, "{\n  \"schema\": 1,\n  \"timestamp\": %lld,\n", (long long)time(NULL));
+    fprintf(f, "  \"compiler\": \"%s\",\n  \"optimized\": %s,\n",
+#ifdef __VERSION__
+            __VERSION__,
+#else
+            "unknown",
+#endif
+            optimized ? "true" : "false");
+    fprintf(f, "  \"reps\": %d,\n  \"rep_ms\": %.3f,\n", cfg->reps, cfg->rep_ms);
+    fprintf(f, "  \"cpu\": ");
+    cpu_dispatch_json(f);
+    fprintf(f, ",\n");
+    fprintf(f, "  \"counters_available\": [");
+    for (i = 0; pc != NULL && i < PERF_COUNTER_COUNT; i++)
+        if (pc->fd[i] >= 0)
+            fprintf(f, "%s\"%s\"", first++ ? ", " : "", perf_counter_name((perf_counter_t)i));
+    fprintf(f, "],\n  \"cases\": [");
+}
+
+static void json_case(FILE *f, const bench_result_t *res, int first) {
+    int i, n = 0;
+
+    fprintf(f, "%s\n    {\"kernel\": \"%s\", \"distribution\": \"%s\", \"size\": \"%s\", "
+            "\"working_set_bytes\": %zu, \"ops_per_rep\": %zu, \"reps\": %d,\n"
+            "     \"ns_per_op\": {\"min\": %.3f, \"p10\": %.3f, \"median\": %.3f, "
+            "\"p90\": %.3f, \"max\": %.3f},\n"
+            "     \"bytes_per_op\": %.1f, \"chars_per_op\": %.2f, \"bytes_per_s\": %.0f,\n"
+            "     \"counters\": ",
+            first ? "" : ",", res->kernel, res->distribution, res->size_class,
+            res->working_set, res->ops_per_rep, res->reps, res->min, res->p10, res->median,
+            res->p90, res->max, res->bytes_per_op, res->chars_per_op, res->bytes_per_s);
+
+    if (res->counters == 0) {
+        fprintf(f, "null}");
+        return;
+    }
+    fprintf(f, "{");
+    for (i = 0; i < PERF_COUNTER_COUNT; i++)
+        if (res->counters & (1u << i))
+            fprintf(f, "%s\"%s\": {\"per_op\": %.4f, \"per_byte\": %.4f}", n++ ? ", " : "",
+                    perf_counter_name((perf_counter_t)i), res->per_op[i],
+                    res->per_op[i] / res->bytes_per_op);
+    if (res->ipc > 0)
+        fprintf(f, ", \"ipc\": %.3f", res->ipc);
+    fprintf(f, "}}");
+}
+
+/**
+ *   @brief  Prints the counters of a case under its row of the table
+ */
+static void print_counters(const bench_result_t *res) {
+    int i;
+
+    if (res->counters == 0)
+        return;
+    printf("    per op :");
+    for (i = 0; i < PERF_COUNTER_COUNT; i++)
+        if (res->counters & (1u << i))
+            printf(" %s %.3f", perf_counter_name((perf_counter_t)i), res->per_op[i]);
+    if (res->ipc > 0)
+        printf(" ipc %.2f", res->ipc);
+    printf("\n");
+}
+
+
+/**
+ *   @brief  Fills in the configuration used by -B : 16 KB and 256 MB working
+ *           sets, 21 repetitions of 2 ms, every kernel
+ */
+void bench_default_config(bench_config_t *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->l1_bytes = 16 * 1024;
+    cfg->dram_bytes = 256 * 1024 * 1024;
+    cfg->rep_ms = 2.0;
+    cfg->reps = 21;
+}
+
+
+/**
+ *   @brief  Runs every selected case, prints a table and writes the JSON report
+ *
+ *   @param  cfg : Configuration
+ *   @param  results : Destination of up to max_results results, may be NULL
+ *   @param  max_results : Size of results
+ *
+ *   @return int : Number of cases run, -1 on an invalid configuration or out
+ *                 of memory
+ */
+int bench_run(const bench_config_t *cfg, bench_result_t *results, size_t max_results) {
+    size_t sizes[2], pos, k;
+    perf_counters_t pc;
+    bench_result_t res;
+    uint32_t *input;
+    int size, dist, opened = 0, cases = 0;
+
+    if (cfg == NULL || cfg->reps < 1 || cfg->reps > BENCH_MAX_REPS || cfg->rep_ms <= 0
+        || cfg->l1_bytes < BENCH_HEXDUMP_BYTES || cfg->dram_bytes < BENCH_HEXDUMP_BYTES)
+        return -1;
+    sizes[0] = cfg->l1_bytes;
+    sizes[1] = cfg->dram_bytes;
+    input = malloc(sizes[0] > sizes[1] ? sizes[0] : sizes[1]);
+    if (input == NULL)
+        return -1;
+
+    // Without permission the cases run as they do without counters
+    if (cfg->counters) {
+        opened = perf_counters_open(&pc);
+        if (!cfg->quiet)
+            printf("Performance counters : %d of %d permitted\n", opened, PERF_COUNTER_COUNT);
+    }
+
+    // Kernels measured, as BIT_OPS_CPU may have lowered the level
+    if (!cfg->quiet) {
+        cpu_dispatch_print(stdout);
+        printf("%-16s %-7s %-5s %10s %10s %10s %12s\n", "kernel", "input", "size",
+               "ns/op", "p10", "p90", "MB/s");
+    }
+    if (cfg->json != NULL)
+        json_begin(cfg->json, cfg, opened > 0 ? &pc : NULL);
+
+    for (size = 0; size < 2; size++) {
+        for (dist = 0; dist < 3; dist++) {
+            fill_input(input, sizes[size] / 4, dist);
+            pos = 0;
+            for (k = 0; k < NUM_KERNELS; k++) {
+                if (cfg->filter != NULL && strstr(kernels[k].name, cfg->filter) == NULL)
+                    continue;
+
+                // The kernels share one position in elements of 4 bytes
+                pos = pos * 4 / kernels[k].elem_bytes;
+                memset(&res, 0, sizeof(res));
+                measure(cfg, &kernels[k], (const uint8_t *)input, sizes[size], &pos,
+                        opened > 0 ? &pc : NULL, &res);
+                pos = pos * kernels[k].elem_bytes / 4;
+                res.distribution = dist_names[dist];
+                res.size_class = size_names[size];
+
+                if (!cfg->quiet)
+                    printf("%-16s %-7s %-5s %10.2f %10.2f %10.2f %12.1f\n", res.kernel,
+                           res.distribution, res.size_class, res.median, res.p10, res.p90,
+                           res.bytes_per_s / 1e6);
+                if (!cfg->quiet)
+                    print_counters(&res);
+                if (cfg->json != NULL)
+                    json_case(cfg->json, &res, cases == 0);
+                if (results != NULL && (size_t)cases < max_results)
+                    results[cases] = res;
+                cases++;
+            }
+        }
+    }
+
+    if (cfg->json != NULL) {
+        fprintf(cfg->json, "\n  ]\n}\n");
+        fflush(cfg->json);
+    }
+    if (cfg->counters)
+        perf_counters_close(&pc);
+    free(input);
+    return cases;
+}
+
+
+/**
+ *   @brief  Runs the default benchmarks, the -B and -P (with counters)
+ *           options of bit_operations
+ *
+ *   @param  json_path : File for the JSON report, NULL for none
+ *   @param  filter : Only kernels with this in their name, NULL for all
+ *   @param  counters : Read the performance counters as well
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int bench_main(const char *json_path, const char *filter, int counters) {
+    bench_config_t cfg;
+    int cases;
+
+    bench_default_config(&cfg);
+    cfg.filter = filter;
+    cfg.counters = counters;
+    if (json_path != NULL) {
+        cfg.json = fopen(json_path, "w");
+        if (cfg.json == NULL) {
+            perror(json_path);
+            return -1;
+        }
+    }
+    cases = bench_run(&cfg, NULL, 0);
+    if (cfg.json != NULL)
+        fclose(cfg.json);
+    return cases > 0 ? 0 : -1;
+}
+
+
+/**
+ *   @brief  Checks a JSON report : balanced brackets and one object per case
+ */
+static int check_json(FILE *f, int cases) {
+    int depth = 0, objects = 0, status = 1;
+    char *text = NULL;
+    const char *p;
+    long len;
+
+    if (f == NULL)
+        return 0;
+    len = ftell(f);
+    text = len > 0 ? calloc((size_t)len + 1, 1) : NULL;
+    rewind(f);
+    if (text == NULL || fread(text, 1, (size_t)len, f) != (size_t)len)
+        status = 0;
+    fclose(f);
+
+    for (p = text; status && *p != '\0'; p++) {
+        depth += (*p == '{' || *p == '[') - (*p == '}' || *p == ']');
+        if (depth < 0)
+            status = 0;
+    }
+    for (p = text; status && (p = strstr(p, "\"kernel\"")) != NULL; p++)
+        objects++;
+    if (status && (text[0] != '{' || depth != 0 || objects != cases
+                   || strstr(text, "\"cpu\": {\"level\"") == NULL))
+        status = 0;
+    free(text);
+    return status;
+}
+
+
+/**
+ *   @brief  Test function to test the bench_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every kernel, distribution and size class is run
+ *   - Percentiles are in order and bytes per op are as expected
+ *   - The JSON report has one object per case, the CPU level and balanced
+ *     brackets
+ *   - Counters, with or without permission to open them
+ *   - Filters and invalid configurations
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_bench(int debug) {
+    bench_result_t results[NUM_KERNELS * 6];
+    bench_config_t cfg;
+    int cases, i, status = 1;
+    unsigned opened = 0;
+    perf_counters_t pc;
+
+    if(debug)
+        printf("\n Test Results for the benchmarks ");
+
+    bench_default_config(&cfg);
+    cfg.l1_bytes = 4096;
+    cfg.dram_bytes = 1 << 20;
+    cfg.rep_ms = 0.05;
+    cfg.reps = 5;
+    cfg.quiet = 1;
+    cfg.json = tmpfile();
+
+    cases = bench_run(&cfg, results, NUM_KERNELS * 6);
+    if (cases != (int)NUM_KERNELS * 6)
+        status = 0;
+    for (i = 0; status && i < cases; i++) {
+        if (!(results[i].min <= results[i].p10 && results[i].p10 <= results[i].median
+              && results[i].median <= results[i].p90 && results[i].p90 <= results[i].max
+              && results[i].median > 0 && results[i].bytes_per_s > 0 && results[i].counters == 0))
+            status = 0;
+        // "0b" and 32 digits, or nothing for a rejected value
+        if (strstr(results[i].kernel, "binstr") != NULL
+            && (results[i].chars_per_op <= 0 || results[i].chars_per_op > 34))
+            status = 0;
+        if (strstr(results[i].kernel, "bit") != NULL && results[i].chars_per_op != 0)
+            status = 0;
+        if (strcmp(results[i].kernel, "hexdump") == 0
+            && (results[i].bytes_per_op != BENCH_HEXDUMP_BYTES || results[i].chars_per_op <= 0))
+            status = 0;
+    }
+    if (!check_json(cfg.json, cases))
+        status = 0;
+    if(debug)
+        printf("\nCases: %d, Result: %d", cases, status);
+
+    // Counters, only those which could be opened
+    perf_counters_open(&pc);
+    for (i = 0; i < PERF_COUNTER_COUNT; i++)
+        opened |= pc.fd[i] >= 0 ? 1u << i : 0;
+    perf_counters_close(&pc);
+    cfg.counters = 1;
+    cfg.filter = "hexdump";
+    cfg.json = tmpfile();
+    cases = bench_run(&cfg, results, NUM_KERNELS * 6);
+    if (cases != 6 || strcmp(results[5].kernel, "hexdump") != 0 || !check_json(cfg.json, cases))
+        status = 0;
+    for (i = 0; status && i < cases; i++) {
+        if ((results[i].counters & ~opened) != 0 || results[i].ipc < 0)
+            status = 0;
+        if ((results[i].counters & (1u << PERF_INSTRUCTIONS))
+            && results[i].per_op[PERF_INSTRUCTIONS] <= 0)
+            status = 0;
+    }
+    if(debug)
+        printf("\nCounters: mask %#x of %#x, IPC %.2f, Result: %d", cases > 0 ? results[0].counters : 0,
+               opened, cases > 0 ? results[0].ipc : 0, status);
+
+    // Invalid configurations
+    cfg.json = NULL;
+    cfg.reps = 0;
+    if (bench_run(&cfg, NULL, 0) != -1 || bench_run(NULL, NULL, 0) != -1)
+        status = 0;
+    if(debug)
+        printf("\nInvalid configurations, Result: %d", status);
+
+    return status;
+}
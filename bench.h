@@ -0,0 +1,127 @@
+#ifndef BENCH_
+#define BENCH_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "perf_counters.h"
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file bench.h
+ * @brief Microbenchmarks of the conversion, bit and hexdump functions
+ *
+ * Every kernel (uint_to_binstr, int_to_binstr, uint_to_hexstr, twiggle_bit,
+ * grab_three_bits, hexdump) runs on every input distribution
+ *   - random : uniform 32 bit values
+ *   - small  : values below 256
+ *   - mixed  : values of a random bit width, 1 to 32
+ * with a working set which stays in L1 and one well past the last level
+ * cache. An op is one call, except for hexdump where it is one dump of
+ * BENCH_HEXDUMP_BYTES bytes.
+ *
+ * A case is timed in repetitions of a fixed number of ops, calibrated to
+ * about rep_ms each, after one untimed warm-up repetition. The DRAM
+ * working set is walked forward and never revisited, so every repetition
+ * reads memory which is no longer cached. The report gives min, p10,
+ * median, p90 and max of ns/op over the repetitions, and bytes/s of input.
+ * With counters set, the permitted perf_counters are read around the timed
+ * repetitions and reported per op and per input byte, with the IPC.
+ *
+ * make bench builds with optimisation and writes bench.json. The CPU level
+ * and the kernel of every cpu_dispatch.h point are printed and reported too.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#define BENCH_HEXDUMP_BYTES 256     // Bytes of one hexdump op
+#define BENCH_MAX_REPS 1000
+
+typedef struct {
+    size_t l1_bytes;        // Working set of the L1 cases
+    size_t dram_bytes;      // Working set of the DRAM cases
+    double rep_ms;          // Target time of one repetition
+    int reps;               // Timed repetitions, up to BENCH_MAX_REPS
+    const char *filter;     // Only kernels with this in their name, NULL for all
+    FILE *json;             // Destination of the JSON report, NULL for none
+    int quiet;              // No table on stdout
+    int counters;           // Read the performance counters as well
+} bench_config_t;
+
+typedef struct {
+    const char *kernel;
+    const char *distribution;
+    const char *size_class;     // "L1" or "DRAM"
+    size_t working_set;         // Bytes
+    size_t ops_per_rep;
+    int reps;
+    double min, p10, median, p90, max;  // ns/op
+    double bytes_per_op;        // Input bytes
+    double chars_per_op;        // Characters written, 0 for the bit functions
+    double bytes_per_s;         // Input bytes at the median
+    unsigned counters;          // Bit mask of the counters in per_op
+    double per_op[PERF_COUNTER_COUNT];  // Counts per op over the repetitions
+    double ipc;                 // Instructions per cycle, 0 if not counted
+} bench_result_t;
+
+/**
+ *   @brief  Fills in the configuration used by -B : 16 KB and 256 MB working
+ *           sets, 21 repetitions of 2 ms, every kernel
+ */
+void bench_default_config(bench_config_t *cfg);
+
+/**
+ *   @brief  Runs every selected case, prints a table and writes the JSON report
+ *
+ *   @param  cfg : Configuration
+ *   @param  results : Destination of up to max_results results, may be NULL
+ *   @param  max_results : Size of results
+ *
+ *   @return int : Number of cases run, -1 on an invalid configuration or out
+ *                 of memory
+ */
+int bench_run(const bench_config_t *cfg, bench_result_t *results, size_t max_results);
+
+/**
+ *   @brief  Runs the default benchmarks, the -B and -P (with counters)
+ *           options of bit_operations
+ *
+ *   @param  json_path : File for the JSON report, NULL for none
+ *   @param  filter : Only kernels with this in their name, NULL for all
+ *   @param  counters : Read the performance counters as well
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int bench_main(const char *json_path, const char *filter, int counters);
+
+/**
+ *   @brief  Test function to test the bench_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every kernel, distribution and size class is run
+ *   - Percentiles are in order and bytes per op are as expected
+ *   - The JSON report has one object per case, the CPU level and balanced
+ *     brackets
+ *   - Counters, with or without permission to open them
+ *   - Filters and invalid configurations
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_bench(int debug);
+
+#endif /* BENCH_ */
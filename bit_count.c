@@ -0,0 +1,389 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file bit_count.c
+ * @brief Population count of arrays
+ *
+ * With AVX2, 16 vectors at a time are reduced by a Harley-Seal tree of carry
+ * save adders into ones, twos, fours, eights and sixteens, so only one vector
+ * in 16 has to be counted (with a PSHUFB nibble lookup). AVX-512 runs the same
+ * tree on 64 byte vectors, each adder one VPTERNLOG pair. Without AVX2 the
+ * count runs 8 bytes at a time with POPCNT, or with the SWAR word count.
+ * cpu_dispatch.h picks the kernel.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BIT_COUNT_X86
+#endif
+
+#include "bit_operations.h"
+#include "cpu_dispatch.h"
+#include "bit_count.h"
+#include "work_pool.h"
+
+
+/**
+ *   @brief  Counts 8 bytes at a time with the inline word function
+ */
+static uint64_t popcount_words(const uint8_t *pc, size_t nbytes) {
+    uint64_t total = 0, w;
+    size_t i;
+
+    for (i = 0; i + 8 <= nbytes; i += 8) {
+        memcpy(&w, pc + i, 8);
+        total += (uint64_t)bit_popcount64(w);
+    }
+    for (; i < nbytes; i++)
+        total += (uint64_t)bit_popcount32(pc[i]);
+    return total;
+}
+
+#ifdef BIT_COUNT_X86
+/**
+ *   @brief  Counts 8 bytes at a time with the POPCNT instruction
+ */
+__attribute__((target("popcnt")))
+static uint64_t popcount_popcnt(const uint8_t *pc, size_t nbytes) {
+    uint64_t total = 0, w;
+    size_t i;
+
+    for (i = 0; i + 8 <= nbytes; i += 8) {
+        memcpy(&w, pc + i, 8);
+        total += (uint64_t)__builtin_popcountll(w);
+    }
+    for (; i < nbytes; i++)
+        total += (uint64_t)__builtin_popcount(pc[i]);
+    return total;
+}
+
+/**
+ *   @brief  Bits set in each 64 bit lane of v
+ */
+__attribute__((target("avx2")))
+static inline __m256i popcount_lanes(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i lo = _mm256_and_si256(v, low);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                    _mm256_shuffle_epi8(lookup, hi));
+
+    return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+}
+
+/**
+ *   @brief  Carry save adder, a + b + c = 2 * high + low in every bit
+ */
+__attribute__((target("avx2")))
+static inline void csa(__m256i *high, __m256i *low, __m256i a, __m256i b, __m256i c) {
+    __m256i u = _mm256_xor_si256(a, b);
+
+    *high = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+    *low = _mm256_xor_si256(u, c);
+}
+
+/**
+ *   @brief  Harley-Seal population count, 512 bytes per step
+ */
+__attribute__((target("avx2")))
+static uint64_t popcount_avx2(const uint8_t *pc, size_t nbytes) {
+    const __m256i *d = (const __m256i *)pc;
+    __m256i total = _mm256_setzero_si256();
+    __m256i ones = _mm256_setzero_si256(), twos = _mm256_setzero_si256();
+    __m256i fours = _mm256_setzero_si256(), eights = _mm256_setzero_si256();
+    __m256i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+    __m256i v[16];
+    size_t vectors = nbytes / 32, i, j;
+    uint64_t lanes[4];
+
+    for (i = 0; i + 16 <= vectors; i += 16) {
+        for (j = 0; j < 16; j++)
+            v[j] = _mm256_loadu_si256(d + i + j);
+
+        csa(&twos_a, &ones, ones, v[0], v[1]);
+        csa(&twos_b, &ones, ones, v[2], v[3]);
+        csa(&fours_a, &twos, twos, twos_a, twos_b);
+        csa(&twos_a, &ones, ones, v[4], v[5]);
+        csa(&twos_b, &ones, ones, v[6], v[7]);
+        csa(&fours_b, &twos, twos, twos_a, twos_b);
+        csa(&eights_a, &fours, fours, fours_a, fours_b);
+        csa(&twos_a, &ones, ones, v[8], v[9]);
+        csa(&twos_b, &ones, ones, v[10], v[11]);
+        csa(&fours_a, &twos, twos, twos_a, twos_b);
+        csa(&twos_a, &ones, ones, v[12], v[13]);
+        csa(&twos_b, &ones, ones, v[14], v[15]);
+        csa(&fours_b, &twos, twos, twos_a, twos_b);
+        csa(&eights_b, &fours, fours, fours_a, fours_b);
+        csa(&sixteens, &eights, eights, eights_a, eights_b);
+
+        total = _mm256_add_epi64(total, popcount_lanes(sixteens));
+    }
+
+    // Weigh what is left in the tree
+    total = _mm256_slli_epi64(total, 4);
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_lanes(eights), 3));
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_lanes(fours), 2));
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_lanes(twos), 1));
+    total = _mm256_add_epi64(total, popcount_lanes(ones));
+
+    for (; i < vectors; i++)
+        total = _mm256_add_epi64(total, popcount_lanes(_mm256_loadu_si256(d + i)));
+
+    _mm256_storeu_si256((__m256i *)lanes, total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3]
+           + popcount_popcnt(pc + vectors * 32, nbytes - vectors * 32);
+}
+
+/**
+ *   @brief  Bits set in each 64 bit lane of v, AVX-512BW
+ */
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i popcount_lanes512(__m512i v) {
+    const __m512i lookup = _mm512_broadcast_i32x4(
+        _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+    const __m512i low = _mm512_set1_epi8(0x0F);
+    __m512i lo = _mm512_and_si512(v, low);
+    __m512i hi = _mm512_and_si512(_mm512_srli_epi16(v, 4), low);
+    __m512i bytes = _mm512_add_epi8(_mm512_shuffle_epi8(lookup, lo),
+                                    _mm512_shuffle_epi8(lookup, hi));
+
+    return _mm512_sad_epu8(bytes, _mm512_setzero_si512());
+}
+
+/**
+ *   @brief  Carry save adder, majority and parity of the three inputs
+ */
+__attribute__((target("avx512f")))
+static inline void csa512(__m512i *high, __m512i *low, __m512i a, __m512i b, __m512i c) {
+    *high = _mm512_ternarylogic_epi64(a, b, c, 0xE8);
+    *low = _mm512_ternarylogic_epi64(a, b, c, 0x96);
+}
+
+/**
+ *   @brief  Harley-Seal population count, 1024 bytes per step
+ */
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static uint64_t popcount_avx512(const uint8_t *pc, size_t nbytes) {
+    __m512i total = _mm512_setzero_si512();
+    __m512i ones = _mm512_setzero_si512(), twos = _mm512_setzero_si512();
+    __m512i fours = _mm512_setzero_si512(), eights = _mm512_setzero_si512();
+    __m512i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+    __m512i v[16];
+    size_t vectors = nbytes / 64, i, j;
+
+    for (i = 0; i + 16 <= vectors; i += 16) {
+        for (j = 0; j < 16; j++)
+            v[j] = _mm512_loadu_si512(pc + (i + j) * 64);
+
+        csa512(&twos_a, &ones, ones, v[0], v[1]);
+        csa512(&twos_b, &ones, ones, v[2], v[3]);
+        csa512(&fours_a, &twos, twos, twos_a, twos_b);
+        csa512(&twos_a, &ones, ones, v[4], v[5]);
+        csa512(&twos_b, &ones, ones, v[6], v[7]);
+        csa512(&fours_b, &twos, twos, twos_a, twos_b);
+        csa512(&eights_a, &fours, fours, fours_a, fours_b);
+        csa512(&twos_a, &ones, ones, v[8], v[9]);
+        csa512(&twos_b, &ones, ones, v[10], v[11]);
+        csa512(&fours_a, &twos, twos, twos_a, twos_b);
+        csa512(&twos_a, &ones, ones, v[12], v[13]);
+        csa512(&twos_b, &ones, ones, v[14], v[15]);
+        csa512(&fours_b, &twos, twos, twos_a, twos_b);
+        csa512(&eights_b, &fours, fours, fours_a, fours_b);
+        csa512(&sixteens, &eights, eights, eights_a, eights_b);
+
+        total = _mm512_add_epi64(total, popcount_lanes512(sixteens));
+    }
+
+    total = _mm512_slli_epi64(total, 4);
+    total = _mm512_add_epi64(total, _mm512_slli_epi64(popcount_lanes512(eights), 3));
+    total = _mm512_add_epi64(total, _mm512_slli_epi64(popcount_lanes512(fours), 2));
+    total = _mm512_add_epi64(total, _mm512_slli_epi64(popcount_lanes512(twos), 1));
+    total = _mm512_add_epi64(total, popcount_lanes512(ones));
+
+    for (; i < vectors; i++)
+        total = _mm512_add_epi64(total, popcount_lanes512(_mm512_loadu_si512(pc + i * 64)));
+
+    return (uint64_t)_mm512_reduce_add_epi64(total)
+           + popcount_popcnt(pc + vectors * 64, nbytes - vectors * 64);
+}
+#endif
+
+typedef uint64_t (*popcount_fn)(const uint8_t *pc, size_t nbytes);
+
+static cpu_point_t popcount_point = CPU_POINT("bit_popcount_array", popcount_words,
+                                              CPU_X86(popcount_popcnt), CPU_X86(popcount_avx2),
+                                              CPU_X86(popcount_avx512));
+CPU_DISPATCH_REGISTER(popcount_point)
+
+
+typedef struct {
+    popcount_fn fn;
+    const uint8_t *pc;
+    _Atomic uint64_t count;
+} popcount_job_t;
+
+static void popcount_task(void *ctx, size_t begin, size_t end) {
+    popcount_job_t *job = ctx;
+
+    atomic_fetch_add_explicit(&job->count, job->fn(job->pc + begin, end - begin),
+                              memory_order_relaxed);
+}
+
+
+/**
+ *   @brief  Number of bits set in an array
+ *
+ *   Large arrays are counted on the work pool.
+ *
+ *   @param  loc : First byte of the array, no alignment needed
+ *   @param  nbytes : Number of bytes at loc
+ *
+ *   @return uint64_t
+ */
+uint64_t bit_popcount_array(const void *loc, size_t nbytes) {
+    popcount_job_t job = { (popcount_fn)cpu_resolve(&popcount_point), (const uint8_t *)loc, 0 };
+
+    if (nbytes <= work_pool_grain(1))
+        return job.fn(job.pc, nbytes);
+    work_pool_run(popcount_task, &job, nbytes, work_pool_grain(1));
+    return atomic_load(&job.count);
+}
+
+
+/**
+ *   @brief  Parity of all the bits of an array
+ *
+ *   @param  loc : First byte of the array, no alignment needed
+ *   @param  nbytes : Number of bytes at loc
+ *
+ *   @return int : 1 if an odd number of bits are set, else 0
+ */
+int bit_parity_array(const void *loc, size_t nbytes) {
+    return (int)(bit_popcount_array(loc, nbytes) & 1);
+}
+
+
+/**
+ *   @brief  Test function to test the bit_*() counting functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Single word functions against bit by bit loops, 0 and all ones included
+ *   - Array population count of every kernel against the word function, odd
+ *     lengths and start addresses
+ *   - Array parity
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_bit_count(int debug) {
+    const size_t lengths[] = { 0, 1, 31, 32, 511, 512, 513, 1600, 4999 };
+    uint32_t words[64], x;
+    uint8_t *data = malloc(5008);
+    uint64_t expected, ret;
+    uint32_t seed = 2020;
+    int i, b, count, clz, ctz, high, status = 1;
+    size_t l, off;
+
+    if(debug)
+        printf("\n Test Results for bit counting ");
+
+    if (data == NULL)
+        return 0;
+
+    // Single words, 0, all ones, single bits and random values
+    words[0] = 0;
+    words[1] = UINT32_MAX;
+    for (i = 2; i < 34; i++)
+        words[i] = 1u << (i - 2);
+    for (; i < 64; i++) {
+        seed = seed * 1103515245u + 12345u;
+        words[i] = seed >> (seed % 17);
+    }
+
+    for (i = 0; i < 64; i++) {
+        x = words[i];
+        count = 0;
+        clz = 32;
+        ctz = 32;
+        for (b = 0; b < 32; b++) {
+            if (x & (1u << b)) {
+                count++;
+                clz = 31 - b;
+                if (ctz == 32)
+                    ctz = b;
+            }
+        }
+        high = 31 - clz;
+        if (bit_popcount32(x) != count || bit_parity32(x) != (count & 1)
+            || bit_clz32(x) != clz || bit_ctz32(x) != ctz
+            || bit_width32(x) != 32 - clz || bit_highest_set32(x) != high
+            || bit_popcount64(((uint64_t)x << 32) | x) != 2 * count) {
+            if(debug)
+                printf("\nWord: 0x%08X, Count: %d, Clz: %d, Ctz: %d", x, count, clz, ctz);
+            status = 0;
+        }
+    }
+        if(debug)
+            printf("\nWords: %d, Result: %d", 64, status);
+
+    // Arrays, every kernel which the CPU can run
+    for (l = 0; l < 5008; l++) {
+        seed = seed * 1103515245u + 12345u;
+        data[l] = (uint8_t)(seed >> 16);
+    }
+    for (l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        for (off = 0; off < 4; off += 3) {
+            expected = 0;
+            for (i = 0; i < (int)lengths[l]; i++)
+                expected += (uint64_t)bit_popcount32(data[off + (size_t)i]);
+
+            ret = bit_popcount_array(data + off, lengths[l]);
+            if (ret != expected || popcount_words(data + off, lengths[l]) != expected
+                || bit_parity_array(data + off, lengths[l]) != (int)(expected & 1))
+                status = 0;
+#ifdef BIT_COUNT_X86
+            if (__builtin_cpu_supports("popcnt")
+                && popcount_popcnt(data + off, lengths[l]) != expected)
+                status = 0;
+            if (__builtin_cpu_supports("avx2")
+                && popcount_avx2(data + off, lengths[l]) != expected)
+                status = 0;
+            if (cpu_detected_level() >= CPU_AVX512
+                && popcount_avx512(data + off, lengths[l]) != expected)
+                status = 0;
+#endif
+            if(debug)
+                printf("\nBytes: %zu, Offset: %zu, Count: %llu, Expected: %llu", lengths[l],
+                       off, (unsigned long long)ret, (unsigned long long)expected);
+        }
+    }
+
+    // All ones, the tree carries into every level
+    memset(data, 0xFF, 5008);
+        if(bit_popcount_array(data, 5008) != 5008 * 8)
+            status = 0;
+
+    free(data);
+    return status;
+}
@@ -0,0 +1,153 @@
+#ifndef BIT_COUNT_
+#define BIT_COUNT_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file bit_count.h
+ * @brief Population count, parity, leading / trailing zeros and bit width
+ *
+ * The single word functions are inline and defined for every input, 0
+ * included. When the compiler targets POPCNT, LZCNT or BMI1 (-mpopcnt,
+ * -mlzcnt, -mbmi or a -march which has them) they are one instruction each,
+ * otherwise they fall back to SWAR code or to a builtin guarded against 0.
+ * The array functions pick their kernel at run time and use AVX2 when the
+ * CPU has it, whatever the compiler flags.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#if defined(__POPCNT__) || defined(__LZCNT__) || defined(__BMI__)
+#include <immintrin.h>
+#endif
+
+#define BIT_COUNT_INLINE static inline __attribute__((always_inline))
+
+/**
+ *   @brief  Number of bits set in x
+ */
+BIT_COUNT_INLINE int bit_popcount32(uint32_t x) {
+#ifdef __POPCNT__
+    return _mm_popcnt_u32(x);
+#else
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+    return (int)((x * 0x01010101u) >> 24);
+#endif
+}
+
+/**
+ *   @brief  Number of bits set in x
+ */
+BIT_COUNT_INLINE int bit_popcount64(uint64_t x) {
+#if defined(__POPCNT__) && defined(__x86_64__)
+    return (int)_mm_popcnt_u64(x);
+#else
+    return bit_popcount32((uint32_t)x) + bit_popcount32((uint32_t)(x >> 32));
+#endif
+}
+
+/**
+ *   @brief  1 if an odd number of bits of x are set, else 0
+ */
+BIT_COUNT_INLINE int bit_parity32(uint32_t x) {
+#ifdef __POPCNT__
+    return _mm_popcnt_u32(x) & 1;
+#else
+    x ^= x >> 16;
+    x ^= x >> 8;
+    x ^= x >> 4;
+    return (0x6996 >> (x & 0xF)) & 1;
+#endif
+}
+
+/**
+ *   @brief  Number of leading zero bits of x, 32 for 0
+ */
+BIT_COUNT_INLINE int bit_clz32(uint32_t x) {
+#ifdef __LZCNT__
+    return (int)_lzcnt_u32(x);
+#else
+    return x ? __builtin_clz(x) : 32;
+#endif
+}
+
+/**
+ *   @brief  Number of trailing zero bits of x, 32 for 0
+ */
+BIT_COUNT_INLINE int bit_ctz32(uint32_t x) {
+#ifdef __BMI__
+    return (int)_tzcnt_u32(x);
+#else
+    return x ? __builtin_ctz(x) : 32;
+#endif
+}
+
+/**
+ *   @brief  Number of bits needed to write x, 0 for 0
+ *
+ *   This is the number of binary digits of x, and (bit_width32(x) + k - 1) / k
+ *   is the number of digits in base 2^k.
+ */
+BIT_COUNT_INLINE int bit_width32(uint32_t x) {
+    return 32 - bit_clz32(x);
+}
+
+/**
+ *   @brief  Position of the highest bit set in x, -1 for 0
+ */
+BIT_COUNT_INLINE int bit_highest_set32(uint32_t x) {
+    return 31 - bit_clz32(x);
+}
+
+/**
+ *   @brief  Number of bits set in an array
+ *
+ *   @param  loc : First byte of the array, no alignment needed
+ *   @param  nbytes : Number of bytes at loc
+ *
+ *   @return uint64_t
+ */
+uint64_t bit_popcount_array(const void *loc, size_t nbytes);
+
+/**
+ *   @brief  Parity of all the bits of an array
+ *
+ *   @param  loc : First byte of the array, no alignment needed
+ *   @param  nbytes : Number of bytes at loc
+ *
+ *   @return int : 1 if an odd number of bits are set, else 0
+ */
+int bit_parity_array(const void *loc, size_t nbytes);
+
+/**
+ *   @brief  Test function to test the bit_*() counting functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Single word functions against bit by bit loops, 0 and all ones included
+ *   - Array population count of every kernel against the word function, odd
+ *     lengths and start addresses
+ *   - Array parity
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_bit_count(int debug);
+
+#endif /* BIT_COUNT_ */
@@ -31,7 +31,34 @@
 
 */
 
+#include <stdlib.h>
+#include <time.h>
+
 #include "bit_operations.h"
+#include "bit_count.h"
+#include "work_pool.h"
+#include "trace_log.h"
+#include "fmt_lazy.h"
+#include "fixed_str.h"
+#include "fmt_compiled.h"
+#include "fmt_arena.h"
+#include "cpu_dispatch.h"
+#include "hexdump_view.h"
+#include "hexdump_parse.h"
+#include "hexdump_layout.h"
+#include "hexdump_stream.h"
+#include "hexdump_file.h"
+#include "hexdump_proc.h"
+#include "hexdump_search.h"
+#include "bulk_convert.h"
+#include "radix_pow2.h"
+#include "bit_swap.h"
+#include "bit_transpose.h"
+#include "morton.h"
+#include "roaring.h"
+#include "bench.h"
+#include "perf_counters.h"
+#include "instrument.h"
 
 
 // ************************ Helper Functions  ************************************
@@ -124,7 +151,7 @@ int toggle_bit(uint32_t input, int bit)  {
  *   @param nbits : Number of bits upto which string pointer would be manipulated in memory 
  *   @param base : Base for conversionDecimal -2 , Hexadecimal - 16
  * 
-​ * ​ ​ @return​ ​ Integer ( 1 = Success, 0 = Failure )
+​ * ​ ​ @return​ ​ Integer ( 0 = Success, -1 = Failure )
 ​ */
 int check_legality(char *str, size_t size, uint32_t num, uint8_t nbits, 
                    int base) {
@@ -133,6 +160,7 @@ int check_legality(char *str, size_t size, uint32_t num, uint8_t nbits,
     // of bits  
 
     int len = 0;
+    int bits_per_digit = bit_ctz32((uint32_t)base);
 
     if (size <=0) {
         str[0] = '\0';
@@ -150,22 +178,23 @@ int check_legality(char *str, size_t size, uint32_t num, uint8_t nbits,
         return -1;
     }
 
-    int temp = num;
-    while (temp>0) { // Returns the modulo as binary of specified base
-        temp /= base;
-        len++;
-    }
-
-    if (len == 0) {
+    // Numbers which are not positive as an int (0 and 2^31 and above) have
+    // no digits
+    if ((int32_t)num <= 0) {
         str[0] = '\0';
         return -1;
     }
-    
+
+    // Digits in the base (a power of two) from the bit width, no division loop
+    len = (bit_width32(num) + bits_per_digit - 1) / bits_per_digit;
+
     // Seg Fault Check
     if (len > nbits) {
         str[0] = '\0';
         return -1;
-    }    
+    }
+
+    return 0;
 }
 
 /**
@@ -183,28 +212,18 @@ int check_legality(char *str, size_t size, uint32_t num, uint8_t nbits,
 ​ */
 void dec_to_bin(char *str, size_t size, uint32_t num, uint8_t nbits) {
 
-    int base = 2, i =0, len = 0;
-
     // To specify the 0bxxxxxx for the binary 
     str[0] = '0';  
     str[1] = 'b';
-    
-    // Instantiating string with '0's upto nbytes
-    for (i =2; i < nbits+2; i++) {
-        str[i] = '0';
-    }
-    //Demarkating End of string
-    str[i] = '\0';
 
-    // Need to be stored backwards for correctness
-    while (num>0) {
-        str[--i] = convert(num % base); // Returns the modulo as binary for base 2
-        num /= base;
-        len++;
-    }
+    // nbits digits, padded with '0's, one byte lane per bit
+    radix_pow2_write_bin(str + 2, num, nbits);
+
+    //Demarkating End of string
+    str[nbits + 2] = '\0';
 
     // To prevent Segmentation faults restricted to nbits 
-    if (len > nbits) {
+    if (radix_pow2_bits(num) > nbits) {
         str[0] = '\0';
     }
 }
@@ -224,7 +243,7 @@ void dec_to_bin(char *str, size_t size, uint32_t num, uint8_t nbits) {
 ​ *
 ​ * ​ ​ @return​ ​ int
 ​ */
-int uint_to_binstr(char *str, size_t size, uint32_t num, uint8_t nbits) {
+int INSTRUMENTED(uint_to_binstr)(char *str, size_t size, uint32_t num, uint8_t nbits) {
     int len = 0;
 
     // Illegal setup
@@ -359,7 +378,7 @@ int test_uint_to_binstr(int debug) {
 ​ *
 ​ * ​ ​ @return​ ​ int
 ​ */
-int int_to_binstr(char *str, size_t size, int32_t num, uint8_t nbits) {
+int INSTRUMENTED(int_to_binstr)(char *str, size_t size, int32_t num, uint8_t nbits) {
 
     // If Unsigned Integer uint_to_binstr() can be used
     if (num>0) 
@@ -369,38 +388,19 @@ int int_to_binstr(char *str, size_t size, int32_t num, uint8_t nbits) {
     if (check_legality(str, size, num*-1, nbits, 2) == -1)
         return -1;
 
-    num *= -1;
-    int i =0,  c = 1;
-
-    // Decimal to Binary Conversion
-    dec_to_bin(str, size, num, nbits);
-
-    // 1's compliment logic 
-    for(i =2; str[i]!='\0'; i++) {
-        if(str[i] == '1')
-            str[i] = '0';
-
-        else if(str[i] == '0')
-            str[i] = '1';
-    }
-    int k = i-1;
-
-    // 2's compliment logic 
-    for (i = k; i>=0; i--) {
-        if(str[i] == '1' && c == 1) {
-            str[i] = '0';
-        }
-        else if(str[i] == '0' && c == 1) {
-            str[i] = '1';
-            c = 0;
-        }
+    // Two's complement in nbits digits is the bit pattern of num, with
+    // the sign extended past 32 digits
+    str[0] = '0';
+    str[1] = 'b';
+    if (nbits > 32) {
+        memset(str + 2, '1', (size_t)nbits - 32);
+        radix_pow2_write_bin(str + 2 + nbits - 32, (uint32_t)num, 32);
     }
+    else
+        radix_pow2_write_bin(str + 2, (uint32_t)num, nbits);
+    str[nbits + 2] = '\0';
 
-    int len = 0;
-    for (int i =0; str[i]!='\0'; i++)
-        len++;
-
-    return (len);
+    return nbits + 2;
 }
 
 
@@ -572,9 +572,9 @@ int test_int_to_binstr(int debug) {
 ​ *
 ​ * ​ ​ @return​ ​ int
 ​ */
-int uint_to_hexstr(char *str, size_t size, uint32_t num, uint8_t nbits) {
+int INSTRUMENTED(uint_to_hexstr)(char *str, size_t size, uint32_t num, uint8_t nbits) {
 
-    int base = 16, len = 0, i =0;
+    int len = 0;
     int k = 2;
 
     //  Illegal Num size 
@@ -593,18 +593,15 @@ int uint_to_hexstr(char *str, size_t size, uint32_t num, uint8_t nbits) {
         return -1;
     } 
 
-    // Illegal Length of bit setup
-    int temp = num;
-    while (temp>0) { // Returns the modulo as binary for base 
-        temp /= base;
-        len++;
-    }
-
-    if (len == 0) {
+    // Illegal Length of bit setup, numbers which are not positive as an
+    // int (0 and 2^31 and above) are rejected
+    if ((int32_t)num <= 0) {
         str[0] = '\0';
         return -1;
     }
 
+    // Hex digits from count leading zeros
+    len = radix_pow2_digits(num, 4);
     if (len > nbits/4) {
         str[0] = '\0';
         return -1;
@@ -613,28 +610,14 @@ int uint_to_hexstr(char *str, size_t size, uint32_t num, uint8_t nbits) {
     str[0] = '0';
     str[1] = 'x';
 
-    // Initalizing with '0's for required nbits in hex
-    for (i=0; i < nbits/4; i++) {
-        str[k++] = '0';
-    }
+    // Conversion of Decimal to Hex, padded with '0's for required nbits
+    radix_pow2_write_hex(str + k, num, nbits/4);
+    k += nbits/4;
 
     // Marking Enf of string    
     str[k] = '\0';
 
-    // Conversion of Decimal to Hex 
-    while(num>0) {
-        str[--k] = convert(num % base);
-        num /= base;
-        len++;
-    }
-
-    // Length Calculation
-    len = 0;
-    for(i =0; str[i]!='\0'; i++) {
-        len++;
-    }
-
-    return len;
+    return k;
 }
 
 
@@ -720,6 +703,471 @@ int test_uint_to_hexstr(int debug) {
 }
 
 
+// "00" "01" ... "99", the two characters of every value below 100
+static const char decimal_pairs[201] =
+    "00010203040506070809" "10111213141516171819" "20212223242526272829"
+    "30313233343536373839" "40414243444546474849" "50515253545556575859"
+    "60616263646566676869" "70717273747576777879" "80818283848586878889"
+    "90919293949596979899";
+
+static const uint32_t powers_of_ten[10] = {
+    1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u,
+    100000000u, 1000000000u
+};
+
+/**
+ *   @brief  Number of decimal digits of num, 1 for 0
+ *
+ *   (bits * 1233) >> 12 is bits * log10(2) rounded down, which is the digit
+ *   count or one less ... a single compare with a power of ten settles it.
+ */
+static int decimal_digits(uint32_t num) {
+    uint32_t v = num | 1;
+    int t = ((32 - __builtin_clz(v)) * 1233) >> 12;
+
+    return t + (v >= powers_of_ten[t]);
+}
+
+/**
+ *   @brief  Writes the digits of num backwards, the last one at end[-1]
+ */
+static void write_decimal(char *end, uint32_t num) {
+    const char *pair;
+
+    while (num >= 100) {
+        pair = decimal_pairs + 2 * (num % 100);
+        num /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+    if (num >= 10) {
+        pair = decimal_pairs + 2 * num;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+    else
+        *--end = (char)('0' + num);
+}
+
+/**
+ *   @brief  Checks that an unsigned number fits in nbits
+ */
+static int fits_unsigned(uint32_t num, uint8_t nbits) {
+    return nbits > 0 && (nbits >= 32 || (num >> nbits) == 0);
+}
+
+
+/**
+ *   @brief  Returns the length of the decimal representation of an unsigned
+ *           uint32_t integer stored in str
+ *
+ *   The digit count comes from count leading zeros and the digits are written
+ *   two at a time from a table of digit pairs. There is no prefix and no
+ *   padding, 0 is written as "0".
+ *
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  num : Integer to be converted to decimal
+ *   @param  nbits : It is the number of bits of the input, num must fit in it
+ *
+ *   @return int : Length of the string, -1 if num does not fit in nbits or str
+ *                 is too small (str is then an empty string)
+ */
+int INSTRUMENTED(uint_to_decstr)(char *str, size_t size, uint32_t num, uint8_t nbits) {
+    int len;
+
+    if (size <= 0)
+        return -1;
+    str[0] = '\0';
+
+    if (!fits_unsigned(num, nbits))
+        return -1;
+
+    len = decimal_digits(num);
+    if ((size_t)len + 1 > size)
+        return -1;
+
+    str[len] = '\0';
+    write_decimal(str + len, num);
+    return len;
+}
+
+
+/**
+ *   @brief  Returns the length of the decimal representation of a signed
+ *           int32_t integer stored in str
+ *
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  num : Integer to be converted to decimal
+ *   @param  nbits : It is the number of bits of the input, num must fit in it
+ *                   as a two's complement number
+ *
+ *   @return int : Length of the string, -1 if num does not fit in nbits or str
+ *                 is too small (str is then an empty string)
+ */
+int INSTRUMENTED(int_to_decstr)(char *str, size_t size, int32_t num, uint8_t nbits) {
+    int64_t limit;
+    uint32_t magnitude;
+    int len;
+
+    if (size <= 0)
+        return -1;
+    str[0] = '\0';
+
+    if (nbits <= 0)
+        return -1;
+    if (nbits < 32) {
+        limit = (int64_t)1 << (nbits - 1);
+        if (num < -limit || num >= limit)
+            return -1;
+    }
+
+    if (num >= 0)
+        return uint_to_decstr(str, size, (uint32_t)num, 32);
+
+    // INT32_MIN has no positive int32_t, negate it as unsigned
+    magnitude = 0u - (uint32_t)num;
+    len = decimal_digits(magnitude) + 1;
+    if ((size_t)len + 1 > size)
+        return -1;
+
+    str[0] = '-';
+    str[len] = '\0';
+    write_decimal(str + len, magnitude);
+    return len;
+}
+
+
+// Batch split in tasks : the length of each task first, then its digits at
+// the offset the lengths add up to
+typedef struct {
+    char *str;
+    const uint32_t *nums;
+    size_t count;
+    size_t grain;
+    uint8_t nbits;
+    char sep;
+    size_t *len;            // Per task, separators included, SIZE_MAX if a number does not fit
+} decstr_batch_job_t;
+
+static void decstr_batch_lengths(void *ctx, size_t begin, size_t end) {
+    decstr_batch_job_t *job = ctx;
+    size_t len = 0, i;
+
+    // The range may hold several tasks when the pool runs it inline
+    for (i = begin; i < end; i++) {
+        if (len != SIZE_MAX && !fits_unsigned(job->nums[i], job->nbits))
+            len = SIZE_MAX;
+        else if (len != SIZE_MAX)
+            len += (size_t)decimal_digits(job->nums[i]) + (i + 1 < job->count);
+        if ((i + 1) % job->grain == 0 || i + 1 == end) {
+            job->len[i / job->grain] = len;
+            len = 0;
+        }
+    }
+}
+
+static void decstr_batch_write(void *ctx, size_t begin, size_t end) {
+    decstr_batch_job_t *job = ctx;
+    char *p = job->str + job->len[begin / job->grain];
+    size_t i;
+    int len;
+
+    for (i = begin; i < end; i++) {
+        len = decimal_digits(job->nums[i]);
+        write_decimal(p + len, job->nums[i]);
+        p += len;
+        if (i + 1 < job->count)
+            *p++ = job->sep;
+    }
+}
+
+/**
+ *   @brief  uint_to_decstr_batch() on the work pool
+ *
+ *   @return int : As uint_to_decstr_batch(), -2 if out of memory
+ */
+static int decstr_batch_pooled(char *str, size_t size, const uint32_t *nums,
+                               size_t count, uint8_t nbits, char sep, size_t grain) {
+    decstr_batch_job_t job = { str, nums, count, grain, nbits, sep, NULL };
+    size_t ntasks = (count - 1) / grain + 1, pos = 0, len, t;
+
+    job.len = malloc(ntasks * sizeof(size_t));
+    if (job.len == NULL)
+        return -2;
+
+    work_pool_run(decstr_batch_lengths, &job, count, grain);
+    for (t = 0; t < ntasks && job.len[t] != SIZE_MAX; t++) {
+        len = job.len[t];
+        job.len[t] = pos;
+        pos += len;
+    }
+    if (t < ntasks || pos + 1 > size || pos > INT32_MAX) {
+        free(job.len);
+        str[0] = '\0';
+        return -1;
+    }
+    work_pool_run(decstr_batch_write, &job, count, grain);
+    free(job.len);
+    str[pos] = '\0';
+    return (int)pos;
+}
+
+
+/**
+ *   @brief  Writes count unsigned integers in decimal, separated by sep
+ *
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  nums : Integers to be converted to decimal
+ *   @param  count : Number of integers at nums
+ *   @param  nbits : It is the number of bits of each input
+ *   @param  sep : Character written after every integer but the last
+ *
+ *   @return int : Length of the string, -1 if any integer does not fit in
+ *                 nbits or str is too small (str is then an empty string)
+ */
+int INSTRUMENTED(uint_to_decstr_batch)(char *str, size_t size, const uint32_t *nums,
+                                       size_t count, uint8_t nbits, char sep) {
+    size_t pos = 0, i, grain = work_pool_grain(sizeof(uint32_t) + DECSTR_MAX_DIGITS);
+    int len;
+
+    if (size <= 0)
+        return -1;
+
+    // Large batches on the work pool, two passes over the numbers
+    if (count > grain) {
+        len = decstr_batch_pooled(str, size, nums, count, nbits, sep, grain);
+        if (len != -2)
+            return len;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (!fits_unsigned(nums[i], nbits))
+            break;
+        len = decimal_digits(nums[i]);
+        if (pos + (size_t)len + 1 > size || pos + (size_t)len > INT32_MAX)
+            break;
+        write_decimal(str + pos + len, nums[i]);
+        pos += (size_t)len;
+        if (i + 1 < count)
+            str[pos++] = sep;
+    }
+
+    if (i < count) {
+        str[0] = '\0';
+        return -1;
+    }
+    str[pos] = '\0';
+    return (int)pos;
+}
+
+
+/**
+ *   @brief  Prints the time per conversion of uint_to_decstr(),
+ *           uint_to_decstr_batch() and snprintf()
+ *
+ *   @param  count : Number of integers converted by each method
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int decstr_bench(size_t count) {
+    const char *names[] = { "decstr", "batch", "snprintf" };
+    uint32_t *nums = malloc(count * sizeof(uint32_t));
+    char *text = malloc(count * DECSTR_MAX_DIGITS + 1);
+    struct timespec start, end;
+    uint32_t seed = 12345;
+    size_t i, pos, sink = 0;
+    double ns;
+    int method;
+
+    if (nums == NULL || text == NULL || count == 0) {
+        free(nums);
+        free(text);
+        return -1;
+    }
+
+    // Even mix of digit counts, as in a register report
+    for (i = 0; i < count; i++) {
+        seed = seed * 1103515245u + 12345u;
+        nums[i] = seed >> (seed % 32);
+    }
+
+    for (method = 0; method < 3; method++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        pos = 0;
+        if (method == 0) {
+            for (i = 0; i < count; i++)
+                pos += (size_t)uint_to_decstr(text + pos, DECSTR_MAX_DIGITS, nums[i], 32);
+        }
+        else if (method == 1)
+            pos = (size_t)uint_to_decstr_batch(text, count * DECSTR_MAX_DIGITS + 1,
+                                               nums, count, 32, ' ');
+        else {
+            for (i = 0; i < count; i++)
+                pos += (size_t)snprintf(text + pos, DECSTR_MAX_DIGITS, "%u", nums[i]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        sink += pos + (uint8_t)text[pos / 2];
+        ns = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+        printf("%-9s: %6.2f ns/integer, %zu characters\n", names[method],
+               ns / (double)count, pos);
+    }
+
+    free(nums);
+    free(text);
+    return sink == 0 ? -1 : 0;
+}
+
+
+/**
+ *   @brief  Test function to test uint_to_decstr() and uint_to_decstr_batch()
+ *           functions with test cases
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every digit count and the powers of ten around it, compared to snprintf
+ *   - Numbers which do not fit in nbits and strings which are too small
+ *   - Batch of integers, with one which does not fit
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_uint_to_decstr(int debug) {
+    const uint32_t batch[] = { 0, 7, 42, 65535, 100000, UINT32_MAX };
+    char str[128], expected[128];
+    uint32_t num;
+    int ret, i, d;
+
+    if(debug)
+        printf("\n Test Results for unsigned Integer to Decimal Conversion ");
+
+    // Valid Check Input, 10^d - 1, 10^d and 10^d + 1 for every digit count
+    for (d = 0; d < 10; d++) {
+        for (i = -1; i <= 1; i++) {
+            num = powers_of_ten[d] + (uint32_t)i;
+            ret = uint_to_decstr(str, sizeof(str), num, 32);
+            snprintf(expected, sizeof(expected), "%u", num);
+            if (ret != (int)strlen(expected) || strcmp(str, expected) != 0) {
+                if(debug)
+                    printf("\nNum: %u, String: %s, Length: %d", num, str, ret);
+                return 0;
+            }
+        }
+    }
+
+    ret = uint_to_decstr(str, sizeof(str), UINT32_MAX, 32);
+        if(debug)
+            printf("\nString Size: %ld, Num: %u, nbits: %d, String: %s", sizeof(str), UINT32_MAX, 32, str);
+        if(ret != 10 || strcmp(str, "4294967295") != 0)
+            return 0;
+
+    // Invalid Check Input, does not fit in nbits
+    ret = uint_to_decstr(str, sizeof(str), 256, 8);
+        if(debug)
+            printf("\nString Size: %ld, Num: %d, nbits: %d, Length: %d", sizeof(str), 256, 8, ret);
+        if(ret != -1 || str[0] != '\0')
+            return 0;
+
+    ret = uint_to_decstr(str, sizeof(str), 1, 0);
+        if(ret != -1)
+            return 0;
+
+    // Invalid Check Input, no room for the '\0'
+    ret = uint_to_decstr(str, 3, 255, 8);
+        if(debug)
+            printf("\nString Size: %d, Num: %d, nbits: %d, Length: %d", 3, 255, 8, ret);
+        if(ret != -1 || str[0] != '\0')
+            return 0;
+
+    ret = uint_to_decstr(str, 0, 255, 8);
+        if(ret != -1)
+            return 0;
+
+    // Batch
+    ret = uint_to_decstr_batch(str, sizeof(str), batch, 6, 32, ',');
+        if(debug)
+            printf("\nBatch: %s, Length: %d", str, ret);
+        if(ret != 30 || strcmp(str, "0,7,42,65535,100000,4294967295") != 0)
+            return 0;
+
+    ret = uint_to_decstr_batch(str, sizeof(str), batch, 6, 16, ',');
+        if(ret != -1 || str[0] != '\0')
+            return 0;
+
+    ret = uint_to_decstr_batch(str, 10, batch, 6, 32, ',');
+        if(ret != -1 || str[0] != '\0')
+            return 0;
+
+    return 1;
+}
+
+
+/**
+ *   @brief  Test function to test int_to_decstr() function with test cases
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Negative and positive numbers, INT32_MIN and INT32_MAX
+ *   - Two's complement range of nbits
+ *   - Strings which are too small
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_int_to_decstr(int debug) {
+    const int32_t nums[] = { 0, -1, 9, -10, 99, -100, 123456, INT32_MAX, INT32_MIN };
+    char str[64], expected[64];
+    int ret;
+    size_t i;
+
+    if(debug)
+        printf("\n Test Results for signed Integer to Decimal Conversion ");
+
+    // Valid Check Input
+    for (i = 0; i < sizeof(nums) / sizeof(nums[0]); i++) {
+        ret = int_to_decstr(str, sizeof(str), nums[i], 32);
+        snprintf(expected, sizeof(expected), "%d", nums[i]);
+            if(debug)
+                printf("\nString Size: %ld, Num: %d, nbits: %d, String: %s", sizeof(str), nums[i], 32, str);
+            if(ret != (int)strlen(expected) || strcmp(str, expected) != 0)
+                return 0;
+    }
+
+    // Two's complement range of 8 bits
+    ret = int_to_decstr(str, sizeof(str), INT8_MIN, 8);
+        if(ret != 4 || strcmp(str, "-128") != 0)
+            return 0;
+
+    ret = int_to_decstr(str, sizeof(str), INT8_MAX, 8);
+        if(ret != 3 || strcmp(str, "127") != 0)
+            return 0;
+
+    // Invalid Check Input
+    ret = int_to_decstr(str, sizeof(str), -129, 8);
+        if(debug)
+            printf("\nString Size: %ld, Num: %d, nbits: %d, Length: %d", sizeof(str), -129, 8, ret);
+        if(ret != -1 || str[0] != '\0')
+            return 0;
+
+    ret = int_to_decstr(str, sizeof(str), 128, 8);
+        if(ret != -1)
+            return 0;
+
+    ret = int_to_decstr(str, 4, -128, 8);
+        if(debug)
+            printf("\nString Size: %d, Num: %d, nbits: %d, Length: %d", 4, -128, 8, ret);
+        if(ret != -1 || str[0] != '\0')
+            return 0;
+
+    return 1;
+}
+
+
 /**
 ​ * ​ ​ @brief​ ​ Bit Manipulation to return three bits from the input value, shifted down. 
  *
@@ -728,7 +1176,7 @@ int test_uint_to_hexstr(int debug) {
 ​ *
 ​ * ​ ​ @return​ ​ uint32_t 
 ​ */
-uint32_t twiggle_bit(uint32_t input, int bit, operation_t operation) {
+uint32_t INSTRUMENTED(twiggle_bit)(uint32_t input, int bit, operation_t operation) {
 
     // Invalid bit check
     if ( bit <0 || bit > 31)
@@ -852,7 +1300,7 @@ int test_twiggle_bit(int debug) {
 ​ *
 ​ * ​ ​ @return​ ​ uint32_t 
 ​ */
-uint32_t grab_three_bits(uint32_t input, int start_bit) {
+uint32_t INSTRUMENTED(grab_three_bits)(uint32_t input, int start_bit) {
 
     uint32_t output;
     int num_elem = 3;
@@ -911,6 +1359,156 @@ int test_grab_three_bits(int debug) {
 }
 
 
+/**
+ *   @brief  Number of hex digits used for the offset column of a hexdump
+ *
+ *   The offset column is at least HEXDUMP_OFFSET_DIGITS wide and grows to fit
+ *   the offset of the last line, so every line of one dump has the same width.
+ *
+ *   @param  nbytes : Number of bytes in the dump
+ *
+ *   @return int
+ */
+int hexdump_offset_digits(size_t nbytes) {
+    int digits = HEXDUMP_OFFSET_DIGITS;
+    uint64_t last = 0;
+
+    if (nbytes > 0)
+        last = (uint64_t)(nbytes - 1) & ~(uint64_t)(HEXDUMP_BYTES_PER_LINE - 1);
+
+    while (digits < 16 && (last >> (4 * digits)) != 0)
+        digits++;
+
+    return digits;
+}
+
+/**
+ *   @brief  Length of one hexdump line, not including the '\n' or '\0'
+ *
+ *   "0x" + offset + 2 spaces + 3 characters ("XX ") for each of the 16 bytes
+ *
+ *   @param  offset_digits : Width of the offset column in hex digits
+ *
+ *   @return size_t
+ */
+size_t hexdump_line_length(int offset_digits) {
+    return 2 + (size_t)offset_digits + 2 + 3 * HEXDUMP_BYTES_PER_LINE;
+}
+
+/**
+ *   @brief  Formats a single hexdump line of up to 16 bytes
+ *
+ *   Writes the offset, the hex value of each byte and pads a short (last) line
+ *   with spaces so it has the same width as a full one. Neither a '\n' nor a
+ *   '\0' is written.
+ *
+ *   @param  str : Destination, at least hexdump_line_length(offset_digits) bytes
+ *   @param  offset : Offset printed in the offset column
+ *   @param  offset_digits : Width of the offset column in hex digits
+ *   @param  pc : Bytes of this line
+ *   @param  n : Number of bytes in this line (0 - 16)
+ *
+ *   @return int : Number of characters written
+ */
+int hexdump_line(char *str, uint64_t offset, int offset_digits,
+                 const uint8_t *pc, size_t n) {
+    static const char hex_table[] = "0123456789ABCDEF";
+    int k = 0, d;
+    size_t i;
+
+    // Output the offset.
+    str[k++] = '0';
+    str[k++] = 'x';
+    for (d = offset_digits - 1; d >= 0; d--)
+        str[k++] = hex_table[(offset >> (4 * d)) & 0xF];
+
+    // 2 Spaces between Address and Buffer Values
+    str[k++] = ' ';
+    str[k++] = ' ';
+
+    // Now the hex code for the specific character, followed by a space,
+    // a full line in one go
+    i = 0;
+    if (n == HEXDUMP_BYTES_PER_LINE) {
+        radix_pow2_hex_bytes(str + k, pc);
+        k += 3 * HEXDUMP_BYTES_PER_LINE;
+        i = n;
+    }
+    for (; i < n; i++) {
+        str[k++] = hex_table[pc[i] >> 4];
+        str[k++] = hex_table[pc[i] & 0xF];
+        str[k++] = ' ';
+    }
+
+    // Padding out last line if not exactly 16 characters.
+    for (; i < HEXDUMP_BYTES_PER_LINE; i++) {
+        str[k++] = ' ';
+        str[k++] = ' ';
+        str[k++] = ' ';
+    }
+
+    return k;
+}
+
+
+/**
+ *   @brief  Formats the ASCII gutter which may follow a hexdump line
+ *
+ *   Writes " |" followed by one character per byte ('.' for bytes which are
+ *   not printable), padded with spaces to 16 characters, and a closing "|".
+ *   Neither a '\n' nor a '\0' is written.
+ *
+ *   @param  str : Destination, at least HEXDUMP_GUTTER_LENGTH bytes
+ *   @param  pc : Bytes of this line
+ *   @param  n : Number of bytes in this line (0 - 16)
+ *
+ *   @return int : Number of characters written
+ */
+int hexdump_gutter(char *str, const uint8_t *pc, size_t n) {
+    int k = 0;
+    size_t i;
+
+    str[k++] = ' ';
+    str[k++] = '|';
+    for (i = 0; i < n; i++)
+        str[k++] = (pc[i] >= 0x20 && pc[i] < 0x7F) ? (char)pc[i] : '.';
+    for (; i < HEXDUMP_BYTES_PER_LINE; i++)
+        str[k++] = ' ';
+    str[k++] = '|';
+
+    return k;
+}
+
+
+// Lines of a hexdump have a fixed width, so a task of whole lines writes
+// them at known offsets
+typedef struct {
+    char *str;
+    const uint8_t *pc;
+    size_t nbytes;
+    size_t rows;
+    size_t line;            // hexdump_line_length() of digits
+    int digits;
+} hexdump_job_t;
+
+static void hexdump_rows(void *ctx, size_t begin, size_t end) {
+    const hexdump_job_t *job = ctx;
+    size_t r, n;
+    char *p;
+
+    for (r = begin; r < end; r++) {
+        p = job->str + r * (job->line + 1);
+        n = job->nbytes - r * HEXDUMP_BYTES_PER_LINE;
+        if (n > HEXDUMP_BYTES_PER_LINE)
+            n = HEXDUMP_BYTES_PER_LINE;
+        hexdump_line(p, r * HEXDUMP_BYTES_PER_LINE, job->digits, job->pc + r * HEXDUMP_BYTES_PER_LINE, n);
+        // Preventing newline after the last line
+        if (r + 1 < job->rows)
+            p[job->line] = '\n';
+    }
+}
+
+
 /**
 ​ * ​ ​ @brief​ ​ Hex Dump of a memory location upto a selected number of bytes at a specified memory 
  *           location
@@ -927,7 +1525,7 @@ int test_grab_three_bits(int debug) {
  * 
 ​ * ​ ​ @return​ ​ Character Pointer
 ​ */
-char *hexdump(char *str, size_t size, const void *loc, size_t nbytes) {
+char *INSTRUMENTED(hexdump)(char *str, size_t size, const void *loc, size_t nbytes) {
     
     // Segmentation Fault Check
     if (size <= 0) {
@@ -948,83 +1546,22 @@ char *hexdump(char *str, size_t size, const void *loc, size_t nbytes) {
         return str;
     }
 
-    int i, j;
-    char temp[3];  // Required to restrict compiler from using 2 bytes for special characters
-    uint8_t rem = 0, num;
-    unsigned char buff[17]; // String of 17 
-    const unsigned char * pc = (const unsigned char *)loc;
-    int k = 0;
-
-    for (i = 0; i < nbytes; i++) {
-        // Newline after 16 bytes check with necessary space/offset.
-
-        if ((i % 16) == 0) {
-            
-            // Preventing newline before "zeroth" line buffer.
-            if (i != 0) {
-                str[k++] = '\n';
-            }
-
-            // Output the offset.
-            str[k++] = '0';
-            str[k++] = 'x';
-
-            // 0x0_"0"_ requires an extra character zero 
-            if(i == 0)
-                str[k++] = '0';
-            
-            // Initial Delta from location Decimal to Hex Manipulation
-            num = i;
-            do 
-            { 
-                rem = num % 16; 
-                str[k++] = (rem > 9)? rem -10 + 'A' : rem + '0'; 
-                num = num/16; 
-            } while (num != 0);
-            
-            // 2 Spaces between Address and Buffer Values
-            for (int s =0; s<2; s++)
-                str[k++] = ' ';
-        }
+    int digits = hexdump_offset_digits(nbytes);
+    size_t rows = (nbytes + HEXDUMP_BYTES_PER_LINE - 1) / HEXDUMP_BYTES_PER_LINE;
+    hexdump_job_t job = { str, (const uint8_t *)loc, nbytes, rows, hexdump_line_length(digits), digits };
 
-        // Now the hex code for the specific character.
-        str[k++] = '0';
-        str[k++] = '0';
-
-        // Hexadecimal equivalent of buffer
-        num = pc[i];
-        for(j=0; temp[j]!='\0'; j++)
-            temp[j] = '0';
-        j = 0;
-        while (num != 0)
-        {   
-            rem = num % 16;
-            temp[j++] =  (rem > 9)? (rem-10) + 'A' : rem + '0' ; 
-            num = num/16; 
-        }
-
-        // Manipulation Reversing the hex string to get the right order
-        j = 0;
-        for(j = 0; j<=1; j++)
-            str[--k] = temp[j];
-        k+=2;
-
-        // Space after the hexdump of memory after every address read 
-        str[k++] = ' ';
-
-        if ((pc[i] > 0x20) || (pc[i] < 0x7e)) 
-            buff[i % 16] = '.';
-        else
-            buff[i % 16] = pc[i];
-        buff[(i % 16) + 1] = '\n';
+    // Every line has the same width, so the full dump (lines, newlines
+    // in between and the terminal '\0') must fit in str
+    if (rows * (job.line + 1) > size) {
+        str[0] = '\0';
+        return str;
     }
 
-    // Padding out last line if not exactly 16 characters.
-    while ((i % 16) != 0) {
-        str[k++] = ' ';
-        i++;
-    }
-    str[k] = '\0';
+    // Large dumps on the work pool, a few thousand lines per task
+    work_pool_run(hexdump_rows, &job, rows,
+                  work_pool_grain(HEXDUMP_BYTES_PER_LINE + job.line + 1));
+
+    str[rows * (job.line + 1) - 1] = '\0';
     return str;
 }
 
@@ -1076,10 +1613,94 @@ int test_hexdump(int debug) {
 
 }
 
+#ifdef BIT_INSTRUMENT
+// ************************ Instrumented wrappers  ************************************
+
+int uint_to_binstr(char *str, size_t size, uint32_t num, uint8_t nbits) {
+    uint64_t start = instr_now();
+    int ret = uint_to_binstr_uninstrumented(str, size, num, nbits);
+
+    instr_record(INSTR_UINT_TO_BINSTR, nbits, ret < 0, start);
+    return ret;
+}
+
+int int_to_binstr(char *str, size_t size, int32_t num, uint8_t nbits) {
+    uint64_t start = instr_now();
+    int ret = int_to_binstr_uninstrumented(str, size, num, nbits);
+
+    instr_record(INSTR_INT_TO_BINSTR, nbits, ret < 0, start);
+    return ret;
+}
+
+int uint_to_hexstr(char *str, size_t size, uint32_t num, uint8_t nbits) {
+    uint64_t start = instr_now();
+    int ret = uint_to_hexstr_uninstrumented(str, size, num, nbits);
+
+    instr_record(INSTR_UINT_TO_HEXSTR, nbits, ret < 0, start);
+    return ret;
+}
+
+int uint_to_decstr(char *str, size_t size, uint32_t num, uint8_t nbits) {
+    uint64_t start = instr_now();
+    int ret = uint_to_decstr_uninstrumented(str, size, num, nbits);
+
+    instr_record(INSTR_UINT_TO_DECSTR, nbits, ret < 0, start);
+    return ret;
+}
+
+int int_to_decstr(char *str, size_t size, int32_t num, uint8_t nbits) {
+    uint64_t start = instr_now();
+    int ret = int_to_decstr_uninstrumented(str, size, num, nbits);
+
+    instr_record(INSTR_INT_TO_DECSTR, nbits, ret < 0, start);
+    return ret;
+}
+
+int uint_to_decstr_batch(char *str, size_t size, const uint32_t *nums,
+                         size_t count, uint8_t nbits, char sep) {
+    uint64_t start = instr_now();
+    int ret = uint_to_decstr_batch_uninstrumented(str, size, nums, count, nbits, sep);
+
+    instr_record(INSTR_UINT_TO_DECSTR_BATCH, count, ret < 0, start);
+    return ret;
+}
+
+// 0xFFFFFFFF is also a valid result, the error is the argument check
+uint32_t twiggle_bit(uint32_t input, int bit, operation_t operation) {
+    uint64_t start = instr_now();
+    uint32_t ret = twiggle_bit_uninstrumented(input, bit, operation);
+    int error = bit < 0 || bit > 31
+                || (operation != CLEAR && operation != SET && operation != TOGGLE);
+
+    instr_record(INSTR_TWIGGLE_BIT, (uint64_t)(uint32_t)bit, error, start);
+    return ret;
+}
+
+uint32_t grab_three_bits(uint32_t input, int start_bit) {
+    uint64_t start = instr_now();
+    uint32_t ret = grab_three_bits_uninstrumented(input, start_bit);
+
+    instr_record(INSTR_GRAB_THREE_BITS, (uint64_t)(uint32_t)start_bit, ret == 0xFFFFFFFF, start);
+    return ret;
+}
+
+// An empty string for a non empty dump is an error
+char *hexdump(char *str, size_t size, const void *loc, size_t nbytes) {
+    uint64_t start = instr_now();
+    char *ret = hexdump_uninstrumented(str, size, loc, nbytes);
+
+    instr_record(INSTR_HEXDUMP, nbytes, nbytes > 0 && size > 0 && str[0] == '\0', start);
+    return ret;
+}
+#endif /* BIT_INSTRUMENT */
+
 // MAIN
+#define NUM_TESTS 32
+
 int main(int argc, char* argv[]) {
-    int status[6] = {0};
+    int status[NUM_TESTS] = {0};
     int debug=0;
+    int report=0;
 
     for (int i = 1; i < argc; i++) {
     if (argv[i][0] == '-') {
@@ -1088,6 +1709,43 @@ int main(int argc, char* argv[]) {
            debug = 1;
            printf("\n DEBUG Status : %d \n", debug);
        }
+       // Hexdump of a file to stdout : -f <file>
+       else if (argv[i][1] == 'f' && i + 1 < argc)
+           return hexdump_file_path(argv[i + 1], HEXDUMP_FILE_AUTO) < 0;
+       // Throughput of the file hexdump pipelines : -F <file>
+       else if (argv[i][1] == 'F' && i + 1 < argc)
+           return hexdump_file_bench(argv[i + 1]) < 0;
+       // Hexdump of the readable memory of a running process : -p <pid>
+       else if (argv[i][1] == 'p' && i + 1 < argc)
+           return hexdump_proc((pid_t)atoi(argv[i + 1]), stdout, 0, 0, NULL) < 0;
+       // Pattern search with context rows : -s <pattern> <file> [rows]
+       else if (argv[i][1] == 's' && i + 2 < argc)
+           return hexdump_search_file(argv[i + 2], argv[i + 1],
+                                      (i + 3 < argc) ? atoi(argv[i + 3]) : 2, stdout) < 0;
+       // Integers to binary / hex strings : -c <base> <nbits> [file]
+       else if (argv[i][1] == 'c' && i + 2 < argc)
+           return bulk_convert_path((i + 3 < argc) ? argv[i + 3] : NULL, atoi(argv[i + 1]),
+                                    (uint8_t)atoi(argv[i + 2])) < 0;
+       // Lines of a binary trace file : -T <file>
+       else if (argv[i][1] == 'T' && i + 1 < argc)
+           return trace_decode_path(argv[i + 1]) < 0;
+       // Pooled functions on 1, 2, 4 ... threads : -W [MB]
+       else if (argv[i][1] == 'W')
+           return work_pool_bench((i + 1 < argc) ? (size_t)atol(argv[i + 1]) : 64) < 0;
+       // Decimal formatting against snprintf : -D [count]
+       else if (argv[i][1] == 'D')
+           return decstr_bench((i + 1 < argc) ? (size_t)atol(argv[i + 1]) : 1000000) < 0;
+       // Morton keys against a bit by bit loop : -M [count]
+       else if (argv[i][1] == 'M')
+           return morton_bench((i + 1 < argc) ? (size_t)atol(argv[i + 1]) : 1000000) < 0;
+       // Call counters after the tests, in a make INSTRUMENT=1 build : -I
+       else if (argv[i][1] == 'I')
+           report = 1;
+       // Microbenchmarks with a JSON report : -B [json file] [kernel]
+       // -P is the same with performance counters
+       else if (argv[i][1] == 'B' || argv[i][1] == 'P')
+           return bench_main((i + 1 < argc) ? argv[i + 1] : NULL,
+                             (i + 2 < argc) ? argv[i + 2] : NULL, argv[i][1] == 'P') < 0;
     }
     }
 
@@ -1097,8 +1755,37 @@ int main(int argc, char* argv[]) {
     status[3] = test_twiggle_bit(debug);
     status[4] = test_grab_three_bits(debug);
     status[5] = test_hexdump(debug);
-
-    for(int i =0; i <6; i++)
+    status[6] = test_hexdump_view(debug);
+    status[7] = test_hexdump_parse(debug);
+    status[8] = test_hexdump_layout(debug);
+    status[9] = test_hexdump_stream(debug);
+    status[10] = test_hexdump_file(debug);
+    status[11] = test_hexdump_proc(debug);
+    status[12] = test_hexdump_search(debug);
+    status[13] = test_bulk_convert(debug);
+    status[14] = test_uint_to_decstr(debug);
+    status[15] = test_int_to_decstr(debug);
+    status[16] = test_radix_pow2(debug);
+    status[17] = test_bit_swap(debug);
+    status[18] = test_bit_count(debug);
+    status[19] = test_bit_transpose(debug);
+    status[20] = test_morton(debug);
+    status[21] = test_roaring(debug);
+    status[22] = test_bench(debug);
+    status[23] = test_perf_counters(debug);
+    // Counters of the tests above, test_instrument() resets them
+    if (report)
+        instr_print(stdout);
+    status[24] = test_instrument(debug);
+    status[25] = test_cpu_dispatch(debug);
+    status[26] = test_fmt_arena(debug);
+    status[27] = test_fmt_compiled(debug);
+    status[28] = test_fixed_str(debug);
+    status[29] = test_fmt_lazy(debug);
+    status[30] = test_trace_log(debug);
+    status[31] = test_work_pool(debug);
+
+    for(int i =0; i <NUM_TESTS; i++)
         printf("\nTest: %d, Result: %d\n", i, status[i]);
 
     return 0;
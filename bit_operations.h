@@ -141,6 +141,68 @@ int int_to_binstr(char *str, size_t size, int32_t num, uint8_t nbits);
 ​ */
 int uint_to_hexstr(char *str, size_t size, uint32_t num, uint8_t nbits);
 
+// Longest decimal string of a 32 bit integer, "-2147483648" or "4294967295"
+#define DECSTR_MAX_DIGITS 11
+
+/**
+ *   @brief  Returns the length of the decimal representation of an unsigned
+ *           uint32_t integer stored in str
+ *
+ *   The digit count comes from count leading zeros and the digits are written
+ *   two at a time from a table of digit pairs. There is no prefix and no
+ *   padding, 0 is written as "0".
+ *
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  num : Integer to be converted to decimal
+ *   @param  nbits : It is the number of bits of the input, num must fit in it
+ *
+ *   @return int : Length of the string, -1 if num does not fit in nbits or str
+ *                 is too small (str is then an empty string)
+ */
+int uint_to_decstr(char *str, size_t size, uint32_t num, uint8_t nbits);
+
+/**
+ *   @brief  Returns the length of the decimal representation of a signed
+ *           int32_t integer stored in str
+ *
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  num : Integer to be converted to decimal
+ *   @param  nbits : It is the number of bits of the input, num must fit in it
+ *                   as a two's complement number
+ *
+ *   @return int : Length of the string, -1 if num does not fit in nbits or str
+ *                 is too small (str is then an empty string)
+ */
+int int_to_decstr(char *str, size_t size, int32_t num, uint8_t nbits);
+
+/**
+ *   @brief  Writes count unsigned integers in decimal, separated by sep
+ *
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  nums : Integers to be converted to decimal
+ *   @param  count : Number of integers at nums
+ *   @param  nbits : It is the number of bits of each input
+ *   @param  sep : Character written after every integer but the last
+ *
+ *   @return int : Length of the string, -1 if any integer does not fit in
+ *                 nbits or str is too small (str is then an empty string)
+ */
+int uint_to_decstr_batch(char *str, size_t size, const uint32_t *nums,
+                         size_t count, uint8_t nbits, char sep);
+
+/**
+ *   @brief  Prints the time per conversion of uint_to_decstr(),
+ *           uint_to_decstr_batch() and snprintf()
+ *
+ *   @param  count : Number of integers converted by each method
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int decstr_bench(size_t count);
+
 /**
 ​ * ​ ​ @brief​ ​ Bit Manipulation to set/clear/toggle a but at a specified bit location
 ​ *
@@ -189,6 +251,67 @@ uint32_t grab_three_bits(uint32_t input, int start_bit);
 ​ */
 char *hexdump(char *str, size_t size, const void *loc, size_t nbytes);
 
+// Layout of a hexdump line : "0x<offset>  XX XX ... XX "
+#define HEXDUMP_BYTES_PER_LINE 16
+#define HEXDUMP_OFFSET_DIGITS 4   // Minimum width of the offset column
+
+/**
+ *   @brief  Number of hex digits used for the offset column of a hexdump
+ *
+ *   The offset column is at least HEXDUMP_OFFSET_DIGITS wide and grows to fit
+ *   the offset of the last line, so every line of one dump has the same width.
+ *
+ *   @param  nbytes : Number of bytes in the dump
+ *
+ *   @return int
+ */
+int hexdump_offset_digits(size_t nbytes);
+
+/**
+ *   @brief  Length of one hexdump line, not including the '\n' or '\0'
+ *
+ *   @param  offset_digits : Width of the offset column in hex digits
+ *
+ *   @return size_t
+ */
+size_t hexdump_line_length(int offset_digits);
+
+/**
+ *   @brief  Formats a single hexdump line of up to 16 bytes
+ *
+ *   Writes the offset, the hex value of each byte and pads a short (last) line
+ *   with spaces so it has the same width as a full one. Neither a '\n' nor a
+ *   '\0' is written.
+ *
+ *   @param  str : Destination, at least hexdump_line_length(offset_digits) bytes
+ *   @param  offset : Offset printed in the offset column
+ *   @param  offset_digits : Width of the offset column in hex digits
+ *   @param  pc : Bytes of this line
+ *   @param  n : Number of bytes in this line (0 - 16)
+ *
+ *   @return int : Number of characters written
+ */
+int hexdump_line(char *str, uint64_t offset, int offset_digits,
+                 const uint8_t *pc, size_t n);
+
+// Optional ASCII gutter after the hex columns : " |................|"
+#define HEXDUMP_GUTTER_LENGTH (2 + HEXDUMP_BYTES_PER_LINE + 1)
+
+/**
+ *   @brief  Formats the ASCII gutter which may follow a hexdump line
+ *
+ *   Writes " |" followed by one character per byte ('.' for bytes which are
+ *   not printable), padded with spaces to 16 characters, and a closing "|".
+ *   Neither a '\n' nor a '\0' is written.
+ *
+ *   @param  str : Destination, at least HEXDUMP_GUTTER_LENGTH bytes
+ *   @param  pc : Bytes of this line
+ *   @param  n : Number of bytes in this line (0 - 16)
+ *
+ *   @return int : Number of characters written
+ */
+int hexdump_gutter(char *str, const uint8_t *pc, size_t n);
+
 
 /**
 ​ * ​ ​ @brief​ ​ Helper Function to check or prevent illegal access to memory out of scope 
@@ -202,7 +325,7 @@ char *hexdump(char *str, size_t size, const void *loc, size_t nbytes);
  *   @param nbits : Number of bits upto which string pointer would be manipulated in memory 
  *   @param base : Base for conversionDecimal -2 , Hexadecimal - 16
  * 
-​ * ​ ​ @return​ ​ Integer ( 1 = Success, 0 = Failure )
+​ * ​ ​ @return​ ​ Integer ( 0 = Success, -1 = Failure )
 ​ */
 int check_legality(char *str, size_t size, uint32_t num, uint8_t nbits, int base);
 
@@ -280,6 +403,37 @@ int test_uint_to_hexstr(int debug);
 ​ */
 int test_twiggle_bit(int debug);
 
+/**
+ *   @brief  Test function to test uint_to_decstr() and uint_to_decstr_batch()
+ *           functions with test cases
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every digit count and the powers of ten around it, compared to snprintf
+ *   - Numbers which do not fit in nbits and strings which are too small
+ *   - Batch of integers, with one which does not fit
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_uint_to_decstr(int debug);
+
+/**
+ *   @brief  Test function to test int_to_decstr() function with test cases
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Negative and positive numbers, INT32_MIN and INT32_MAX
+ *   - Two's complement range of nbits
+ *   - Strings which are too small
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_int_to_decstr(int debug);
+
 /**
 ​ * ​ ​ @brief​ ​ Test function to test grab_three_bits() function with test cases  
 ​ *
@@ -0,0 +1,513 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file bit_swap.c
+ * @brief Byte swap, bit reversal and nibble swap over arrays
+ *
+ * A transform is described by where each of 16 bytes comes from and by what
+ * happens to every byte afterwards (nothing, bit reversal or nibble swap).
+ * The vector kernels apply the description as is; the scalar kernel uses the
+ * byte swap builtins and a bit reversal table. cpu_dispatch.h picks how much
+ * runs in vectors, the scalar kernel finishes the array.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BIT_SWAP_X86
+#endif
+
+#include "bit_operations.h"
+#include "cpu_dispatch.h"
+#include "bit_swap.h"
+#include "hexdump_stream.h"
+#include "work_pool.h"
+
+// Bytes transformed per vector kernel call by hexdump_swapped()
+#define BIT_SWAP_CHUNK (16 * HEXDUMP_BYTES_PER_LINE)
+
+enum { BYTE_KEEP, BYTE_REVERSE, BYTE_NIBBLES };
+
+typedef struct {
+    size_t unit;
+    int byte_op;
+    uint8_t shuffle[16];    // Source of each byte of a 16 byte block
+} swap_desc_t;
+
+#define IDENTITY { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 }
+#define REVERSE32 { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 }
+
+static const swap_desc_t swap_desc[BIT_SWAP_COUNT] = {
+    [BIT_SWAP_NONE]    = { 1, BYTE_KEEP, IDENTITY },
+    [BIT_SWAP_BYTES16] = { 2, BYTE_KEEP, { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 } },
+    [BIT_SWAP_BYTES32] = { 4, BYTE_KEEP, REVERSE32 },
+    [BIT_SWAP_BYTES64] = { 8, BYTE_KEEP, { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 } },
+    [BIT_SWAP_BITS8]   = { 1, BYTE_REVERSE, IDENTITY },
+    [BIT_SWAP_BITS32]  = { 4, BYTE_REVERSE, REVERSE32 },
+    [BIT_SWAP_NIBBLES] = { 1, BYTE_NIBBLES, IDENTITY },
+};
+
+// Bit reversed value of every byte
+#define R2(n) n, n + 2 * 64, n + 1 * 64, n + 3 * 64
+#define R4(n) R2(n), R2(n + 2 * 16), R2(n + 1 * 16), R2(n + 3 * 16)
+#define R6(n) R4(n), R4(n + 2 * 4), R4(n + 1 * 4), R4(n + 3 * 4)
+static const uint8_t reverse_byte[256] = { R6(0), R6(2), R6(1), R6(3) };
+
+// Bit reversed value of every nibble, in the low and in the high nibble
+static const uint8_t reverse_nibble_lo[16] = {
+    0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF
+};
+static const uint8_t reverse_nibble_hi[16] = {
+    0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0,
+    0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0
+};
+
+
+/**
+ *   @brief  Size in bytes of the unit a transform works on
+ *
+ *   @param  swap : Transform
+ *
+ *   @return size_t : 1, 2, 4 or 8
+ */
+size_t bit_swap_unit(bit_swap_t swap) {
+    return (swap >= 0 && swap < BIT_SWAP_COUNT) ? swap_desc[swap].unit : 1;
+}
+
+
+/**
+ *   @brief  Transforms the whole units of nbytes with the builtins and the
+ *           bit reversal table
+ */
+static void swap_scalar(bit_swap_t swap, uint8_t *dst, const uint8_t *src,
+                        size_t nbytes) {
+    uint16_t w16;
+    uint32_t w32;
+    uint64_t w64;
+    size_t i;
+
+    switch (swap) {
+    case BIT_SWAP_BYTES16:
+        for (i = 0; i + 2 <= nbytes; i += 2) {
+            memcpy(&w16, src + i, 2);
+            w16 = __builtin_bswap16(w16);
+            memcpy(dst + i, &w16, 2);
+        }
+        break;
+    case BIT_SWAP_BYTES32:
+        for (i = 0; i + 4 <= nbytes; i += 4) {
+            memcpy(&w32, src + i, 4);
+            w32 = __builtin_bswap32(w32);
+            memcpy(dst + i, &w32, 4);
+        }
+        break;
+    case BIT_SWAP_BYTES64:
+        for (i = 0; i + 8 <= nbytes; i += 8) {
+            memcpy(&w64, src + i, 8);
+            w64 = __builtin_bswap64(w64);
+            memcpy(dst + i, &w64, 8);
+        }
+        break;
+    case BIT_SWAP_BITS8:
+        for (i = 0; i < nbytes; i++)
+            dst[i] = reverse_byte[src[i]];
+        break;
+    case BIT_SWAP_BITS32:
+        for (i = 0; i + 4 <= nbytes; i += 4) {
+            memcpy(&w32, src + i, 4);
+            w32 = __builtin_bswap32(w32);
+            memcpy(dst + i, &w32, 4);
+            dst[i] = reverse_byte[dst[i]];
+            dst[i + 1] = reverse_byte[dst[i + 1]];
+            dst[i + 2] = reverse_byte[dst[i + 2]];
+            dst[i + 3] = reverse_byte[dst[i + 3]];
+        }
+        break;
+    case BIT_SWAP_NIBBLES:
+        for (i = 0; i < nbytes; i++)
+            dst[i] = (uint8_t)((src[i] << 4) | (src[i] >> 4));
+        break;
+    default:
+        if (dst != src)
+            memmove(dst, src, nbytes);
+        break;
+    }
+}
+
+#ifdef BIT_SWAP_X86
+/**
+ *   @brief  Moves the bytes of 16 byte blocks then applies the byte operation
+ */
+__attribute__((target("ssse3")))
+static __m128i swap_block_ssse3(__m128i v, __m128i shuffle, int byte_op) {
+    __m128i low = _mm_set1_epi8(0x0F), lo, hi;
+
+    v = _mm_shuffle_epi8(v, shuffle);
+    if (byte_op == BYTE_KEEP)
+        return v;
+
+    // Nibbles are below 16, so a 16 bit shift never carries into the next byte
+    lo = _mm_and_si128(v, low);
+    hi = _mm_and_si128(_mm_srli_epi16(v, 4), low);
+    if (byte_op == BYTE_NIBBLES)
+        return _mm_or_si128(_mm_slli_epi16(lo, 4), hi);
+    return _mm_or_si128(
+            _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)reverse_nibble_hi), lo),
+            _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)reverse_nibble_lo), hi));
+}
+
+/**
+ *   @brief  Transforms 16 bytes per step, returns the bytes done
+ */
+__attribute__((target("ssse3")))
+static size_t swap_ssse3(bit_swap_t swap, uint8_t *dst, const uint8_t *src,
+                         size_t nbytes) {
+    const swap_desc_t *d = &swap_desc[swap];
+    __m128i shuffle = _mm_loadu_si128((const __m128i *)d->shuffle);
+    size_t i;
+
+    for (i = 0; i + 16 <= nbytes; i += 16)
+        _mm_storeu_si128((__m128i *)(dst + i),
+                swap_block_ssse3(_mm_loadu_si128((const __m128i *)(src + i)),
+                                 shuffle, d->byte_op));
+    return i;
+}
+
+/**
+ *   @brief  Transforms 32 bytes per step, returns the bytes done
+ *
+ *   VPSHUFB shuffles inside each 16 byte lane, which is all a unit of at most
+ *   8 bytes needs.
+ */
+__attribute__((target("avx2")))
+static size_t swap_avx2(bit_swap_t swap, uint8_t *dst, const uint8_t *src,
+                        size_t nbytes) {
+    const swap_desc_t *d = &swap_desc[swap];
+    __m256i shuffle = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)d->shuffle));
+    __m256i rev_lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)reverse_nibble_lo));
+    __m256i rev_hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)reverse_nibble_hi));
+    __m256i low = _mm256_set1_epi8(0x0F), v, lo, hi;
+    size_t i;
+
+    for (i = 0; i + 32 <= nbytes; i += 32) {
+        v = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(src + i)), shuffle);
+        if (d->byte_op != BYTE_KEEP) {
+            lo = _mm256_and_si256(v, low);
+            hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+            if (d->byte_op == BYTE_NIBBLES)
+                v = _mm256_or_si256(_mm256_slli_epi16(lo, 4), hi);
+            else
+                v = _mm256_or_si256(_mm256_shuffle_epi8(rev_hi, lo),
+                                    _mm256_shuffle_epi8(rev_lo, hi));
+        }
+        _mm256_storeu_si256((__m256i *)(dst + i), v);
+    }
+    return i;
+}
+
+/**
+ *   @brief  32 bytes per step, then 16, returns the bytes done
+ */
+static size_t swap_vectors_avx2(bit_swap_t swap, uint8_t *dst, const uint8_t *src,
+                                size_t nbytes) {
+    size_t done = swap_avx2(swap, dst, src, nbytes);
+
+    return done + swap_ssse3(swap, dst + done, src + done, nbytes - done);
+}
+#endif
+
+/**
+ *   @brief  No vector kernel, the scalar one does everything
+ */
+static size_t swap_vectors_none(bit_swap_t swap, uint8_t *dst, const uint8_t *src,
+                                size_t nbytes) {
+    (void)swap;
+    (void)dst;
+    (void)src;
+    (void)nbytes;
+    return 0;
+}
+
+typedef size_t (*swap_vectors_fn)(bit_swap_t swap, uint8_t *dst, const uint8_t *src,
+                                  size_t nbytes);
+
+static cpu_point_t swap_point = CPU_POINT("bit_swap", swap_vectors_none, CPU_X86(swap_ssse3),
+                                          CPU_X86(swap_vectors_avx2), NULL);
+CPU_DISPATCH_REGISTER(swap_point)
+
+
+/**
+ *   @brief  bit_swap() of a valid transform on one thread
+ */
+static void swap_range(bit_swap_t swap, uint8_t *d, const uint8_t *s, size_t nbytes) {
+    size_t done = 0, whole;
+
+    if (swap != BIT_SWAP_NONE)
+        done = ((swap_vectors_fn)cpu_resolve(&swap_point))(swap, d, s, nbytes);
+
+    whole = (nbytes / swap_desc[swap].unit) * swap_desc[swap].unit;
+    swap_scalar(swap, d + done, s + done, whole - done);
+    if (d != s && whole < nbytes)
+        memmove(d + whole, s + whole, nbytes - whole);
+}
+
+typedef struct {
+    bit_swap_t swap;
+    uint8_t *dst;
+    const uint8_t *src;
+} swap_job_t;
+
+// Tasks are a multiple of every unit, only the last one has a partial unit
+static void swap_task(void *ctx, size_t begin, size_t end) {
+    const swap_job_t *job = ctx;
+
+    swap_range(job->swap, job->dst + begin, job->src + begin, end - begin);
+}
+
+
+/**
+ *   @brief  Applies a transform to an array
+ *
+ *   Bytes past the last whole unit are copied unchanged. Large arrays are
+ *   split over the work pool, unless dst and src partly overlap.
+ *
+ *   @param  swap : Transform
+ *   @param  dst : Destination, may be the same as src
+ *   @param  src : Bytes to be transformed
+ *   @param  nbytes : Number of bytes at src
+ *
+ *   @return int ( 0 = Success, -1 = Invalid transform )
+ */
+int bit_swap(bit_swap_t swap, void *dst, const void *src, size_t nbytes) {
+    swap_job_t job = { swap, (uint8_t *)dst, (const uint8_t *)src };
+
+    if (swap < 0 || swap >= BIT_SWAP_COUNT)
+        return -1;
+
+    if (job.dst == job.src || job.dst + nbytes <= job.src || job.src + nbytes <= job.dst)
+        work_pool_run(swap_task, &job, nbytes, work_pool_grain(2));
+    else
+        swap_range(swap, job.dst, job.src, nbytes);
+    return 0;
+}
+
+
+/**
+ *   @brief  Hex Dump of memory as it reads after a transform
+ *
+ *   Same layout as hexdump(). Each line is transformed on the way into the
+ *   formatter, the memory at loc is not modified nor copied as a whole.
+ *
+ *   @param  str : Pointer to a char data set where the hex dump would be stored
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  loc : Address in memory from where hex dump would be recorded
+ *   @param  nbytes : Number of bytes upto which the hex values would be stored
+ *   @param  swap : Transform applied before the bytes are printed
+ *
+ *   @return Character Pointer
+ */
+char *hexdump_swapped(char *str, size_t size, const void *loc, size_t nbytes,
+                      bit_swap_t swap) {
+    const uint8_t *pc = (const uint8_t *)loc;
+    uint8_t chunk[BIT_SWAP_CHUNK];
+    size_t rows, i, j, n, k = 0, take;
+    int digits;
+
+    if (size <= 0)
+        return str;
+    str[0] = '\0';
+
+    if (nbytes <= 0 || swap < 0 || swap >= BIT_SWAP_COUNT)
+        return str;
+
+    digits = hexdump_offset_digits(nbytes);
+    rows = (nbytes + HEXDUMP_BYTES_PER_LINE - 1) / HEXDUMP_BYTES_PER_LINE;
+    if (rows * (hexdump_line_length(digits) + 1) > size)
+        return str;
+
+    // A chunk holds whole lines, and so whole units
+    for (i = 0; i < nbytes; i += take) {
+        take = nbytes - i < BIT_SWAP_CHUNK ? nbytes - i : BIT_SWAP_CHUNK;
+        bit_swap(swap, chunk, pc + i, take);
+
+        for (j = 0; j < take; j += HEXDUMP_BYTES_PER_LINE) {
+            if (i + j != 0)
+                str[k++] = '\n';
+            n = take - j < HEXDUMP_BYTES_PER_LINE ? take - j : HEXDUMP_BYTES_PER_LINE;
+            k += (size_t)hexdump_line(str + k, i + j, digits, chunk + j, n);
+        }
+    }
+
+    str[k] = '\0';
+    return str;
+}
+
+
+/**
+ *   @brief  Reference transform, one bit at a time
+ */
+static void swap_reference(bit_swap_t swap, uint8_t *dst, const uint8_t *src,
+                           size_t nbytes) {
+    size_t unit = swap_desc[swap].unit, u, b, bits;
+    size_t whole = (nbytes / unit) * unit, from;
+
+    memcpy(dst, src, nbytes);
+    memset(dst, 0, whole);
+    for (u = 0; u < whole; u += unit) {
+        bits = unit * 8;
+        for (b = 0; b < bits; b++) {
+            switch (swap) {
+            case BIT_SWAP_BITS8:
+            case BIT_SWAP_BITS32:
+                // Bit b of the unit, taken as a little endian number
+                from = bits - 1 - b;
+                break;
+            case BIT_SWAP_NIBBLES:
+                from = b ^ 4;
+                break;
+            default:
+                // Byte b/8 comes from byte unit-1-b/8, bits stay in place
+                from = (unit - 1 - b / 8) * 8 + b % 8;
+                if (swap == BIT_SWAP_NONE)
+                    from = b;
+                break;
+            }
+            if (src[u + from / 8] & (1u << (from % 8)))
+                dst[u + b / 8] |= (uint8_t)(1u << (b % 8));
+        }
+    }
+}
+
+
+/**
+ *   @brief  Test function to test bit_swap() and hexdump_swapped()
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every transform against a bit by bit reference, odd lengths and offsets
+ *   - Vector and scalar kernels agree, in place and out of place
+ *   - Byte swapped hexdump matches the dump of a swapped copy
+ *   - Byte swapped stream split inside a line
+ *   - Invalid transform
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_bit_swap(int debug) {
+    const size_t lengths[] = { 0, 1, 7, 16, 31, 33, 100, 1027 };
+    size_t size = 32768, i, l;
+    uint8_t src[1040], dst[1040], expected[1040], scalar[1040];
+    char *str = malloc(size), *ref = malloc(size);
+    uint32_t seed = 99;
+    int swap, status = 1;
+
+    if(debug)
+        printf("\n Test Results for byte and bit swapping ");
+
+    if (str == NULL || ref == NULL)
+        status = 0;
+    for (i = 0; i < sizeof(src); i++) {
+        seed = seed * 1103515245u + 12345u;
+        src[i] = (uint8_t)(seed >> 16);
+    }
+
+    for (swap = 0; status && swap < BIT_SWAP_COUNT; swap++) {
+        for (l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            // Odd start address for the unaligned loads
+            swap_reference(swap, expected, src + 3, lengths[l]);
+            bit_swap(swap, dst, src + 3, lengths[l]);
+            swap_scalar(swap, scalar, src + 3, lengths[l]);
+            memcpy(scalar + (lengths[l] / swap_desc[swap].unit) * swap_desc[swap].unit,
+                   src + 3 + (lengths[l] / swap_desc[swap].unit) * swap_desc[swap].unit,
+                   lengths[l] % swap_desc[swap].unit);
+            if (memcmp(dst, expected, lengths[l]) != 0 || memcmp(scalar, expected, lengths[l]) != 0)
+                status = 0;
+
+            // In place
+            memcpy(dst, src + 3, lengths[l]);
+            bit_swap(swap, dst, dst, lengths[l]);
+            if (memcmp(dst, expected, lengths[l]) != 0)
+                status = 0;
+        }
+        if(debug)
+            printf("\nTransform: %d, Unit: %zu, Result: %d", swap, bit_swap_unit(swap), status);
+    }
+
+    // Spot values
+    {
+        uint8_t word[4] = { 0x01, 0x02, 0x03, 0x80 }, out[4];
+        uint8_t bits32[4] = { 0x01, 0xC0, 0x40, 0x80 };
+
+        bit_swap(BIT_SWAP_BITS32, out, bits32, 4);
+        if (out[0] != 0x01 || out[1] != 0x02 || out[2] != 0x03 || out[3] != 0x80)
+            status = 0;
+        bit_swap(BIT_SWAP_NIBBLES, out, word, 4);
+        if (out[0] != 0x10 || out[3] != 0x08)
+            status = 0;
+    }
+
+    // Byte swapped hexdump, more than one chunk and a short last line
+    if (status) {
+        bit_swap(BIT_SWAP_BYTES32, dst, src, 1027);
+        hexdump(ref, size, dst, 1027);
+        hexdump_swapped(str, size, src, 1027, BIT_SWAP_BYTES32);
+            if(debug)
+                printf("\nSwapped hexdump:\n%.160s", str);
+            if(strcmp(str, ref) != 0)
+                status = 0;
+
+        hexdump_swapped(str, size, src, 40, BIT_SWAP_NONE);
+        hexdump(ref, size, src, 40);
+            if(strcmp(str, ref) != 0)
+                status = 0;
+
+        // Segmentation Faults Check
+        hexdump_swapped(str, 10, src, 40, BIT_SWAP_BYTES16);
+            if(str[0] != '\0')
+                status = 0;
+    }
+
+    // Streamed in two pieces which split a line
+    if (status) {
+        hexdump_ctx_t ctx;
+        size_t consumed, k;
+
+        hexdump_ctx_init(&ctx, 0, 0, 0);
+        ctx.swap = BIT_SWAP_BYTES16;
+        k = (size_t)hexdump_ctx_feed(&ctx, str, size, src, 21, &consumed);
+        k += (size_t)hexdump_ctx_feed(&ctx, str + k, size - k, src + 21, 43, &consumed);
+        k += (size_t)hexdump_ctx_finish(&ctx, str + k, size - k);
+        hexdump_swapped(ref, size, src, 64, BIT_SWAP_BYTES16);
+        strcat(ref, "\n");
+            if(debug)
+                printf("\nStreamed:\n%s", str);
+            if(strcmp(str, ref) != 0)
+                status = 0;
+    }
+
+    // Invalid transform
+    if (bit_swap(BIT_SWAP_COUNT, dst, src, 16) != -1)
+        status = 0;
+        if(debug)
+            printf("\nInvalid transform, Result: %d", status);
+
+    free(str);
+    free(ref);
+    return status;
+}
@@ -0,0 +1,99 @@
+#ifndef BIT_SWAP_
+#define BIT_SWAP_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file bit_swap.h
+ * @brief Byte swap, bit reversal and nibble swap over arrays
+ *
+ * Every transform is a fixed byte permutation inside 16 bytes followed by the
+ * same operation on each byte, so one PSHUFB moves the bytes and two more
+ * look up the reversed nibbles. 32 bytes are done per step with AVX2, 16 with
+ * SSSE3, and a scalar loop with a 256 entry table is used otherwise.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+typedef enum {
+    BIT_SWAP_NONE,
+    BIT_SWAP_BYTES16,       // Byte order of every 16 bit word
+    BIT_SWAP_BYTES32,       // Byte order of every 32 bit word
+    BIT_SWAP_BYTES64,       // Byte order of every 64 bit word
+    BIT_SWAP_BITS8,         // Bit order inside every byte
+    BIT_SWAP_BITS32,        // Bit order of every 32 bit word
+    BIT_SWAP_NIBBLES,       // High and low nibble of every byte
+    BIT_SWAP_COUNT
+} bit_swap_t;
+
+/**
+ *   @brief  Size in bytes of the unit a transform works on
+ *
+ *   @param  swap : Transform
+ *
+ *   @return size_t : 1, 2, 4 or 8
+ */
+size_t bit_swap_unit(bit_swap_t swap);
+
+/**
+ *   @brief  Applies a transform to an array
+ *
+ *   Bytes past the last whole unit are copied unchanged.
+ *
+ *   @param  swap : Transform
+ *   @param  dst : Destination, may be the same as src
+ *   @param  src : Bytes to be transformed
+ *   @param  nbytes : Number of bytes at src
+ *
+ *   @return int ( 0 = Success, -1 = Invalid transform )
+ */
+int bit_swap(bit_swap_t swap, void *dst, const void *src, size_t nbytes);
+
+/**
+ *   @brief  Hex Dump of memory as it reads after a transform
+ *
+ *   Same layout as hexdump(). Each line is transformed on the way into the
+ *   formatter, the memory at loc is not modified nor copied as a whole.
+ *
+ *   @param  str : Pointer to a char data set where the hex dump would be stored
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  loc : Address in memory from where hex dump would be recorded
+ *   @param  nbytes : Number of bytes upto which the hex values would be stored
+ *   @param  swap : Transform applied before the bytes are printed
+ *
+ *   @return Character Pointer
+ */
+char *hexdump_swapped(char *str, size_t size, const void *loc, size_t nbytes,
+                      bit_swap_t swap);
+
+/**
+ *   @brief  Test function to test bit_swap() and hexdump_swapped()
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every transform against a bit by bit reference, odd lengths and offsets
+ *   - Vector and scalar kernels agree, in place and out of place
+ *   - Byte swapped hexdump matches the dump of a swapped copy
+ *   - Byte swapped stream split inside a line
+ *   - Invalid transform
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_bit_swap(int debug);
+
+#endif /* BIT_SWAP_ */
@@ -0,0 +1,334 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file bit_transpose.c
+ * @brief Bit matrix transposes and conversion between words and bit planes
+ *
+ * The scalar transposes swap the top right and bottom left blocks of the
+ * matrix, then of each quarter and so on, log2(n) passes of n / 2 swaps.
+ * With AVX2, 32 records are split into bit planes with PMOVMSKB : the bytes
+ * of the records are regrouped so one vector holds byte b of all 32 records,
+ * then each movemask takes one bit of all 32 bytes and a byte add moves the
+ * next bit up. cpu_dispatch.h picks the kernel.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BIT_TRANSPOSE_X86
+#endif
+
+#include "bit_operations.h"
+#include "cpu_dispatch.h"
+#include "bit_transpose.h"
+
+
+/**
+ *   @brief  Transposes an 8x8 bit matrix, byte i of x is row i
+ *
+ *   @param  x : Matrix to be transposed
+ *
+ *   @return uint64_t : Transposed matrix
+ */
+uint64_t bit_transpose8x8(uint64_t x) {
+    uint64_t t;
+
+    // Swap the 1x1, then 2x2, then 4x4 off diagonal blocks
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+
+/**
+ *   @brief  Transposes a 32x32 bit matrix in place, by swapping blocks of
+ *           16, 8, 4, 2 and 1 bits
+ *
+ *   @param  rows : The 32 rows of the matrix
+ */
+void bit_transpose32(uint32_t rows[32]) {
+    uint32_t m = 0x0000FFFFu, t;
+    int j, k;
+
+    for (j = 16; j != 0; j >>= 1, m ^= m << j) {
+        // k runs over the rows of every top block, k + j is the row below
+        for (k = 0; k < 32; k = ((k | j) + 1) & ~j) {
+            t = ((rows[k] >> j) ^ rows[k + j]) & m;
+            rows[k + j] ^= t;
+            rows[k] ^= t << j;
+        }
+    }
+}
+
+
+/**
+ *   @brief  Transposes a 64x64 bit matrix in place, by swapping blocks of
+ *           32, 16, 8, 4, 2 and 1 bits
+ *
+ *   @param  rows : The 64 rows of the matrix
+ */
+void bit_transpose64(uint64_t rows[64]) {
+    uint64_t m = 0x00000000FFFFFFFFULL, t;
+    int j, k;
+
+    for (j = 32; j != 0; j >>= 1, m ^= m << j) {
+        for (k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            t = ((rows[k] >> j) ^ rows[k + j]) & m;
+            rows[k + j] ^= t;
+            rows[k] ^= t << j;
+        }
+    }
+}
+
+
+/**
+ *   @brief  Bit planes of 32 records with the scalar transpose
+ */
+static void planes_scalar(uint32_t out[32], const uint32_t in[32]) {
+    memcpy(out, in, 32 * sizeof(uint32_t));
+    bit_transpose32(out);
+}
+
+#ifdef BIT_TRANSPOSE_X86
+/**
+ *   @brief  Bit planes of 32 records with PMOVMSKB
+ */
+__attribute__((target("avx2")))
+static void planes_avx2(uint32_t out[32], const uint32_t in[32]) {
+    // Per lane : byte 0 of 4 records, then byte 1, 2 and 3
+    const __m256i by_byte = _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+                                             0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    // Per vector : byte 0 of 8 records in the first 64 bits, then byte 1, 2, 3
+    const __m256i by_qword = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    __m256i v[4], lo01, hi01, lo23, hi23, bytes[4];
+    int i, b, bit;
+
+    for (i = 0; i < 4; i++) {
+        v[i] = _mm256_loadu_si256((const __m256i *)(in + 8 * i));
+        v[i] = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v[i], by_byte), by_qword);
+    }
+
+    // 4x4 transpose of the 64 bit groups, records stay in order
+    lo01 = _mm256_unpacklo_epi64(v[0], v[1]);
+    hi01 = _mm256_unpackhi_epi64(v[0], v[1]);
+    lo23 = _mm256_unpacklo_epi64(v[2], v[3]);
+    hi23 = _mm256_unpackhi_epi64(v[2], v[3]);
+    bytes[0] = _mm256_permute2x128_si256(lo01, lo23, 0x20);
+    bytes[1] = _mm256_permute2x128_si256(hi01, hi23, 0x20);
+    bytes[2] = _mm256_permute2x128_si256(lo01, lo23, 0x31);
+    bytes[3] = _mm256_permute2x128_si256(hi01, hi23, 0x31);
+
+    // The top bit of every byte, from bit 7 of the byte down to bit 0
+    for (b = 0; b < 4; b++) {
+        for (bit = 7; bit >= 0; bit--) {
+            out[8 * b + bit] = (uint32_t)_mm256_movemask_epi8(bytes[b]);
+            bytes[b] = _mm256_add_epi8(bytes[b], bytes[b]);
+        }
+    }
+}
+#endif
+
+typedef void (*planes_fn)(uint32_t out[32], const uint32_t in[32]);
+
+static cpu_point_t planes_point = CPU_POINT("bit_planes_from_words", planes_scalar, NULL,
+                                            CPU_X86(planes_avx2), NULL);
+CPU_DISPATCH_REGISTER(planes_point)
+
+
+/**
+ *   @brief  Splits records into their 32 bit planes
+ *
+ *   The last block of 32 records is padded with zero records.
+ *
+ *   @param  planes : Destination of 32 * BIT_PLANE_WORDS(nwords) words
+ *   @param  words : Records
+ *   @param  nwords : Number of records
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pointer )
+ */
+int bit_planes_from_words(uint32_t *planes, const uint32_t *words, size_t nwords) {
+    planes_fn kernel;
+    size_t per_plane = BIT_PLANE_WORDS(nwords), w, n;
+    uint32_t block[32], out[32];
+    const uint32_t *in;
+    int k;
+
+    if (planes == NULL || (words == NULL && nwords > 0))
+        return -1;
+
+    kernel = (planes_fn)cpu_resolve(&planes_point);
+
+    for (w = 0; w < per_plane; w++) {
+        in = words + 32 * w;
+        n = nwords - 32 * w;
+        if (n < 32) {
+            memset(block, 0, sizeof(block));
+            memcpy(block, in, n * sizeof(uint32_t));
+            in = block;
+        }
+        kernel(out, in);
+        for (k = 0; k < 32; k++)
+            planes[(size_t)k * per_plane + w] = out[k];
+    }
+    return 0;
+}
+
+
+/**
+ *   @brief  Rebuilds records from their 32 bit planes
+ *
+ *   @param  words : Destination of nwords records
+ *   @param  planes : 32 * BIT_PLANE_WORDS(nwords) words of planes
+ *   @param  nwords : Number of records
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pointer )
+ */
+int bit_planes_to_words(uint32_t *words, const uint32_t *planes, size_t nwords) {
+    size_t per_plane = BIT_PLANE_WORDS(nwords), w, n;
+    uint32_t block[32];
+    int k;
+
+    if (planes == NULL || (words == NULL && nwords > 0))
+        return -1;
+
+    for (w = 0; w < per_plane; w++) {
+        for (k = 0; k < 32; k++)
+            block[k] = planes[(size_t)k * per_plane + w];
+        bit_transpose32(block);
+        n = nwords - 32 * w < 32 ? nwords - 32 * w : 32;
+        memcpy(words + 32 * w, block, n * sizeof(uint32_t));
+    }
+    return 0;
+}
+
+
+/**
+ *   @brief  Test function to test the bit_transpose*() and bit_planes_*()
+ *           functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - 8x8, 32x32 and 64x64 transposes against a bit by bit reference
+ *   - A transpose applied twice gives back the matrix
+ *   - Planes of a number of records which is not a multiple of 32, vector and
+ *     scalar kernels agree, round trip back to the records
+ *   - Invalid pointers
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_bit_transpose(int debug) {
+    const size_t nwords = 100;
+    uint64_t x, t, rows64[64], copy64[64];
+    uint32_t rows32[32], copy32[32], out[32];
+    uint32_t words[100], back[100], planes[32 * BIT_PLANE_WORDS(100)];
+    uint32_t seed = 38;
+    int i, j, status = 1;
+    size_t r;
+
+    if(debug)
+        printf("\n Test Results for bit matrix transposes ");
+
+    // 8x8
+    x = 0;
+    for (i = 0; i < 2; i++) {
+        seed = seed * 1103515245u + 12345u;
+        x = (x << 32) | seed;
+    }
+    t = bit_transpose8x8(x);
+    for (i = 0; i < 8; i++)
+        for (j = 0; j < 8; j++)
+            if (((t >> (8 * j + i)) & 1) != ((x >> (8 * i + j)) & 1))
+                status = 0;
+    if (bit_transpose8x8(t) != x || bit_transpose8x8(0x0102040810204080ULL) != 0x0102040810204080ULL)
+        status = 0;
+        if(debug)
+            printf("\n8x8: 0x%016llX -> 0x%016llX, Result: %d", (unsigned long long)x,
+                   (unsigned long long)t, status);
+
+    // 32x32
+    for (i = 0; i < 32; i++) {
+        seed = seed * 1103515245u + 12345u;
+        rows32[i] = copy32[i] = seed;
+    }
+    bit_transpose32(rows32);
+    for (i = 0; i < 32; i++)
+        for (j = 0; j < 32; j++)
+            if (((rows32[j] >> i) & 1) != ((copy32[i] >> j) & 1))
+                status = 0;
+    bit_transpose32(rows32);
+    if (memcmp(rows32, copy32, sizeof(rows32)) != 0)
+        status = 0;
+
+    // Vector and scalar plane kernels
+    planes_scalar(out, copy32);
+#ifdef BIT_TRANSPOSE_X86
+    if (__builtin_cpu_supports("avx2")) {
+        planes_avx2(rows32, copy32);
+        if (memcmp(rows32, out, sizeof(out)) != 0)
+            status = 0;
+    }
+#endif
+        if(debug)
+            printf("\n32x32, Result: %d", status);
+
+    // 64x64
+    for (i = 0; i < 64; i++) {
+        seed = seed * 1103515245u + 12345u;
+        rows64[i] = copy64[i] = ((uint64_t)seed << 29) ^ seed;
+    }
+    bit_transpose64(rows64);
+    for (i = 0; i < 64; i++)
+        for (j = 0; j < 64; j++)
+            if (((rows64[j] >> i) & 1) != ((copy64[i] >> j) & 1))
+                status = 0;
+    bit_transpose64(rows64);
+    if (memcmp(rows64, copy64, sizeof(rows64)) != 0)
+        status = 0;
+        if(debug)
+            printf("\n64x64, Result: %d", status);
+
+    // Planes of 100 records
+    for (r = 0; r < nwords; r++) {
+        seed = seed * 1103515245u + 12345u;
+        words[r] = seed;
+    }
+    if (bit_planes_from_words(planes, words, nwords) != 0)
+        status = 0;
+    for (i = 0; i < 32; i++)
+        for (r = 0; r < 32 * BIT_PLANE_WORDS(nwords); r++)
+            if (((planes[(size_t)i * BIT_PLANE_WORDS(nwords) + r / 32] >> (r % 32)) & 1)
+                != (r < nwords ? (words[r] >> i) & 1 : 0))
+                status = 0;
+    if (bit_planes_to_words(back, planes, nwords) != 0 || memcmp(back, words, sizeof(words)) != 0)
+        status = 0;
+        if(debug)
+            printf("\nPlanes of %zu records, Result: %d", nwords, status);
+
+    // Invalid pointers
+    if (bit_planes_from_words(NULL, words, nwords) != -1
+        || bit_planes_to_words(back, NULL, nwords) != -1)
+        status = 0;
+
+    return status;
+}
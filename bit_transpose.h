@@ -0,0 +1,104 @@
+#ifndef BIT_TRANSPOSE_
+#define BIT_TRANSPOSE_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file bit_transpose.h
+ * @brief Bit matrix transposes and conversion between words and bit planes
+ *
+ * A bit matrix has one row per word and bit j of a row is column j. The
+ * transpose moves bit j of row i to bit i of row j. Transposing the 32 bit
+ * words of 32 records gives their 32 bit planes : word k holds bit k of
+ * every record.
+ *
+ *   Layout of the planes of nwords records :
+ *   planes[k * BIT_PLANE_WORDS(nwords) + w] bit i = bit k of words[32 * w + i]
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+// Words in each bit plane of nwords records
+#define BIT_PLANE_WORDS(nwords) (((nwords) + 31) / 32)
+
+/**
+ *   @brief  Transposes an 8x8 bit matrix, byte i of x is row i
+ *
+ *   @param  x : Matrix to be transposed
+ *
+ *   @return uint64_t : Transposed matrix
+ */
+uint64_t bit_transpose8x8(uint64_t x);
+
+/**
+ *   @brief  Transposes a 32x32 bit matrix in place, by swapping blocks of
+ *           16, 8, 4, 2 and 1 bits
+ *
+ *   @param  rows : The 32 rows of the matrix
+ */
+void bit_transpose32(uint32_t rows[32]);
+
+/**
+ *   @brief  Transposes a 64x64 bit matrix in place, by swapping blocks of
+ *           32, 16, 8, 4, 2 and 1 bits
+ *
+ *   @param  rows : The 64 rows of the matrix
+ */
+void bit_transpose64(uint64_t rows[64]);
+
+/**
+ *   @brief  Splits records into their 32 bit planes
+ *
+ *   The last block of 32 records is padded with zero records.
+ *
+ *   @param  planes : Destination of 32 * BIT_PLANE_WORDS(nwords) words
+ *   @param  words : Records
+ *   @param  nwords : Number of records
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pointer )
+ */
+int bit_planes_from_words(uint32_t *planes, const uint32_t *words, size_t nwords);
+
+/**
+ *   @brief  Rebuilds records from their 32 bit planes
+ *
+ *   @param  words : Destination of nwords records
+ *   @param  planes : 32 * BIT_PLANE_WORDS(nwords) words of planes
+ *   @param  nwords : Number of records
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pointer )
+ */
+int bit_planes_to_words(uint32_t *words, const uint32_t *planes, size_t nwords);
+
+/**
+ *   @brief  Test function to test the bit_transpose*() and bit_planes_*()
+ *           functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - 8x8, 32x32 and 64x64 transposes against a bit by bit reference
+ *   - A transpose applied twice gives back the matrix
+ *   - Planes of a number of records which is not a multiple of 32, vector and
+ *     scalar kernels agree, round trip back to the records
+ *   - Invalid pointers
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_bit_transpose(int debug);
+
+#endif /* BIT_TRANSPOSE_ */
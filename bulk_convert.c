@@ -0,0 +1,431 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file bulk_convert.c
+ * @brief Streaming conversion of text integers to binary or hex strings
+ *
+ * Input is read BULK_CONVERT_BLOCK bytes at a time and a number split by the
+ * end of a block is moved to the front before the next read. Digits are
+ * checked and combined eight at a time in a 64 bit word (SWAR), without a
+ * branch per digit. Converted strings are written straight into one large
+ * output buffer which is flushed only when it is full.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bit_operations.h"
+#include "bulk_convert.h"
+
+// Room needed for one converted value : "0b" + 255 bits + '\n' + '\0'
+#define BULK_CONVERT_LINE_MAX (2 + 255 + 2)
+
+// Separators between numbers
+static const uint8_t is_space[256] = {
+    [' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\r'] = 1, ['\v'] = 1, ['\f'] = 1, [','] = 1,
+};
+
+
+// ************************ Helper Functions  ************************************
+
+/**
+ *   @brief  Value of 8 ASCII digits loaded little endian (first digit in the
+ *           lowest byte)
+ *
+ *   Pairs, then groups of four, then the two halves are combined with three
+ *   multiplies instead of eight multiply-adds.
+ */
+static uint32_t parse_eight_digits(uint64_t v) {
+    v -= 0x3030303030303030ULL;
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+         + (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return (uint32_t)v;
+}
+
+/**
+ *   @brief  Checks that all 8 bytes of v are ASCII digits
+ *
+ *   A byte below '0' borrows in v - '0', a byte above '9' carries into bit 7
+ *   of v + (0x7F - '9'), both set the top bit of their byte.
+ */
+static int all_digits(uint64_t v) {
+    return (((v - 0x3030303030303030ULL) | (v + 0x4646464646464646ULL))
+            & 0x8080808080808080ULL) == 0;
+}
+
+/**
+ *   @brief  Parses a signed decimal integer of up to 10 digits
+ *
+ *   @param  p : First character of the number
+ *   @param  len : Characters in the number
+ *   @param  value : Set to the value
+ *
+ *   @return int ( 0 = Success, -1 = Not a number or out of 32 bit range )
+ */
+static int parse_decimal(const char *p, size_t len, int64_t *value) {
+    uint64_t lo, hi = 0, word = 0x3030303030303030ULL;
+    size_t digits, head;
+    int negative = 0;
+
+    if (len > 0 && (p[0] == '-' || p[0] == '+')) {
+        negative = (p[0] == '-');
+        p++;
+        len--;
+    }
+    if (len == 0 || len > 10)
+        return -1;
+
+    // Last (up to) 8 digits, right aligned on a word of '0's
+    digits = len < 8 ? len : 8;
+    head = len - digits;
+    memcpy((char *)&word + (8 - digits), p + head, digits);
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    if (!all_digits(word))
+        return -1;
+    lo = parse_eight_digits(word);
+
+    // 9th and 10th digits from the end
+    for (digits = 0; digits < head; digits++) {
+        if (p[digits] < '0' || p[digits] > '9')
+            return -1;
+        hi = hi * 10 + (uint64_t)(p[digits] - '0');
+    }
+
+    lo += hi * 100000000ULL;
+    if (lo > (negative ? 2147483648ULL : 4294967295ULL))
+        return -1;
+
+    *value = negative ? -(int64_t)lo : (int64_t)lo;
+    return 0;
+}
+
+static int write_full(int fd, const char *buf, size_t len) {
+    ssize_t n;
+
+    while (len > 0) {
+        n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ *   @brief  Converts one number into str and ends the line
+ *
+ *   @return size_t : Characters written including the '\n'
+ */
+static size_t convert_token(char *str, size_t size, const char *p, size_t len,
+                            int base, uint8_t nbits) {
+    int64_t value;
+    int ret = -1;
+
+    if (parse_decimal(p, len, &value) == 0) {
+        if (base == 2 && value < 0)
+            ret = int_to_binstr(str, size, (int32_t)value, nbits);
+        else if (base == 2)
+            ret = uint_to_binstr(str, size, (uint32_t)value, nbits);
+        else if (value >= 0)
+            ret = uint_to_hexstr(str, size, (uint32_t)value, nbits);
+    }
+
+    if (ret < 0)
+        ret = 0;
+    str[ret] = '\n';
+    return (size_t)ret + 1;
+}
+
+
+/**
+ *   @brief  Converts every integer read from in_fd and writes one line per
+ *           integer to out_fd
+ *
+ *   Base 2 uses uint_to_binstr() for values >= 0 and int_to_binstr() for
+ *   negative values, base 16 uses uint_to_hexstr().
+ *
+ *   @param  in_fd : Text of decimal integers
+ *   @param  out_fd : Where the lines are written
+ *   @param  base : 2 or 16
+ *   @param  nbits : It is the number of bits of the output
+ *
+ *   @return long : Number of integers read, -1 on failure
+ */
+long bulk_convert(int in_fd, int out_fd, int base, uint8_t nbits) {
+    char *in, *out;
+    size_t carry = 0, avail, pos, start, out_len = 0;
+    ssize_t n;
+    long count = 0;
+    int eof = 0;
+
+    if ((base != 2 && base != 16) || in_fd < 0 || out_fd < 0)
+        return -1;
+
+    in = malloc(BULK_CONVERT_BLOCK);
+    out = malloc(BULK_CONVERT_BLOCK);
+    if (in == NULL || out == NULL) {
+        free(in);
+        free(out);
+        return -1;
+    }
+
+    while (!eof && count >= 0) {
+        n = read(in_fd, in + carry, BULK_CONVERT_BLOCK - carry);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            count = -1;
+            break;
+        }
+        eof = (n == 0);
+        avail = carry + (size_t)n;
+        carry = 0;
+
+        for (pos = 0; pos < avail; ) {
+            while (pos < avail && is_space[(uint8_t)in[pos]])
+                pos++;
+            if (pos == avail)
+                break;
+
+            start = pos;
+            while (pos < avail && !is_space[(uint8_t)in[pos]])
+                pos++;
+
+            // Number cut by the end of the read, finish it after the next
+            // read unless it already fills the whole block
+            if (pos == avail && !eof && avail - start < BULK_CONVERT_BLOCK) {
+                carry = avail - start;
+                memmove(in, in + start, carry);
+                break;
+            }
+
+            if (out_len + BULK_CONVERT_LINE_MAX > BULK_CONVERT_BLOCK) {
+                if (write_full(out_fd, out, out_len) < 0) {
+                    count = -1;
+                    break;
+                }
+                out_len = 0;
+            }
+            out_len += convert_token(out + out_len, BULK_CONVERT_LINE_MAX,
+                                     in + start, pos - start, base, nbits);
+            count++;
+        }
+    }
+
+    if (count >= 0 && write_full(out_fd, out, out_len) < 0)
+        count = -1;
+
+    free(in);
+    free(out);
+    return count;
+}
+
+
+/**
+ *   @brief  Converts the integers in the file at path, or the standard input
+ *           if path is NULL, to the standard output
+ *
+ *   @return long : Number of integers read, -1 on failure
+ */
+long bulk_convert_path(const char *path, int base, uint8_t nbits) {
+    int fd = (path == NULL) ? STDIN_FILENO : open(path, O_RDONLY);
+    long ret;
+
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    ret = bulk_convert(fd, STDOUT_FILENO, base, nbits);
+    if (path != NULL)
+        close(fd);
+    return ret;
+}
+
+
+/**
+ *   @brief  Writes "12", then "34\n" in a second write, to a pipe
+ *
+ *   @return 1 if both writes were complete, else 0
+ */
+static void *split_writer(void *arg) {
+    int fd = *(int *)arg;
+    intptr_t ok;
+
+    ok = write(fd, "12", 2) == 2 && usleep(100000) == 0 && write(fd, "34\n", 3) == 3;
+    close(fd);
+    return (void *)ok;
+}
+
+
+/**
+ *   @brief  Test function to test bulk_convert() function with test cases
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Decimal parser on signed values, 1 - 10 digits, overflow and junk
+ *   - Every line matches the library function called on its own
+ *   - Input larger than one block, numbers split between two reads
+ *   - Invalid base
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_bulk_convert(int debug) {
+    const char *valid[] = { "0", "7", "-7", "+42", "12345678", "123456789",
+                            "4294967295", "-2147483648" };
+    const int64_t values[] = { 0, 7, -7, 42, 12345678, 123456789,
+                               4294967295LL, -2147483648LL };
+    const char *invalid[] = { "", "-", "12a", "4294967296", "-2147483649",
+                              "12345678901", "1-2", "9/" };
+    char in_path[] = "/tmp/bulk_convert_in_XXXXXX";
+    char out_path[] = "/tmp/bulk_convert_out_XXXXXX";
+    const int bases[] = { 2, 16 };
+    size_t count = 300000, i, j, in_len, exp_len;
+    char *input = malloc(count * 12);
+    char *expected = malloc(count * 40);
+    char *text = malloc(count * 40);
+    char token[16];
+    int in_fd = mkstemp(in_path), out_fd = mkstemp(out_path);
+    int64_t value;
+    uint32_t seed = 777;
+    long ret;
+    ssize_t n;
+    pthread_t writer;
+    void *written;
+    int pipe_fd[2];
+    int b, status = 1;
+
+    if(debug)
+        printf("\n Test Results for bulk integer conversion ");
+
+    if (input == NULL || expected == NULL || text == NULL || in_fd < 0 || out_fd < 0)
+        status = 0;
+
+    // Decimal parser
+    for (i = 0; status && i < sizeof(valid) / sizeof(valid[0]); i++) {
+        if (parse_decimal(valid[i], strlen(valid[i]), &value) != 0 || value != values[i])
+            status = 0;
+        if(debug)
+            printf("\nParse: \"%s\", Value: %lld", valid[i], (long long)value);
+    }
+    for (i = 0; status && i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        if (parse_decimal(invalid[i], strlen(invalid[i]), &value) != -1)
+            status = 0;
+        if(debug)
+            printf("\nParse: \"%s\", Rejected: %d", invalid[i], status);
+    }
+
+    // Input of mixed values and junk, well over one block
+    in_len = 0;
+    for (i = 0; status && i < count; i++) {
+        seed = seed * 1103515245u + 12345u;
+        if (i % 97 == 0)
+            in_len += (size_t)sprintf(input + in_len, "x%u", seed % 100);
+        else
+            in_len += (size_t)sprintf(input + in_len, "%ld", (long)(seed >> 12) % 70000 - 300);
+        input[in_len++] = (i % 5 == 0) ? '\n' : ' ';
+    }
+    if (status && write(in_fd, input, in_len) != (ssize_t)in_len)
+        status = 0;
+
+    for (b = 0; status && b < 2; b++) {
+        // Reference : the library function called once per number
+        exp_len = 0;
+        for (i = 0; i < in_len; ) {
+            for (j = 0; input[i + j] != ' ' && input[i + j] != '\n'; j++)
+                token[j] = input[i + j];
+            token[j] = '\0';
+            exp_len += convert_token(expected + exp_len, BULK_CONVERT_LINE_MAX,
+                                     token, j, bases[b], 16);
+            i += j + 1;
+        }
+
+        lseek(in_fd, 0, SEEK_SET);
+        lseek(out_fd, 0, SEEK_SET);
+        if (ftruncate(out_fd, 0) < 0)
+            status = 0;
+        ret = bulk_convert(in_fd, out_fd, bases[b], 16);
+        lseek(out_fd, 0, SEEK_SET);
+        n = read(out_fd, text, count * 40);
+        if(debug)
+            printf("\nBase: %d, Numbers: %ld, Characters: %ld", bases[b], ret, (long)n);
+        if (ret != (long)count || n != (ssize_t)exp_len || memcmp(text, expected, exp_len) != 0)
+            status = 0;
+    }
+
+    // Spot check of the text itself
+    if (status) {
+        convert_token(text, BULK_CONVERT_LINE_MAX, "-3", 2, 2, 8);
+        convert_token(text + 20, BULK_CONVERT_LINE_MAX, "255", 3, 16, 8);
+        if (strncmp(text, "0b11111101\n", 11) != 0 || strncmp(text + 20, "0xFF\n", 5) != 0)
+            status = 0;
+    }
+
+    // A number split over two reads of a pipe
+    if (status && pipe(pipe_fd) == 0) {
+        if (pthread_create(&writer, NULL, split_writer, &pipe_fd[1]) != 0) {
+            close(pipe_fd[1]);
+            status = 0;
+        }
+        else {
+            lseek(out_fd, 0, SEEK_SET);
+            if (ftruncate(out_fd, 0) < 0)
+                status = 0;
+            ret = bulk_convert(pipe_fd[0], out_fd, 16, 32);
+            pthread_join(writer, &written);
+            if (written == NULL)
+                status = 0;
+            lseek(out_fd, 0, SEEK_SET);
+            n = read(out_fd, text, count * 40);
+            if (ret != 1 || n != 11 || strncmp(text, "0x000004D2\n", 11) != 0)
+                status = 0;
+        }
+        close(pipe_fd[0]);
+    }
+    if(debug)
+        printf("\nNumber split over two reads, Result: %d", status);
+
+    // Invalid base
+    ret = bulk_convert(in_fd, out_fd, 10, 16);
+        if(debug)
+            printf("\nBase: %d, Result: %ld", 10, ret);
+        if(ret != -1)
+            status = 0;
+
+    if (in_fd >= 0) {
+        close(in_fd);
+        unlink(in_path);
+    }
+    if (out_fd >= 0) {
+        close(out_fd);
+        unlink(out_path);
+    }
+    free(input);
+    free(expected);
+    free(text);
+    return status;
+}
@@ -0,0 +1,74 @@
+#ifndef BULK_CONVERT_
+#define BULK_CONVERT_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file bulk_convert.h
+ * @brief Streaming conversion of text integers to binary or hex strings
+ *
+ * Decimal integers separated by white space are read in large blocks and
+ * each one is written on its own line as uint_to_binstr(), int_to_binstr()
+ * or uint_to_hexstr() would format it. A value the converter rejects gives
+ * an empty line, the same empty string the function would leave in str.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+// Bytes read and written per system call
+#define BULK_CONVERT_BLOCK (1024 * 1024)
+
+/**
+ *   @brief  Converts every integer read from in_fd and writes one line per
+ *           integer to out_fd
+ *
+ *   Base 2 uses uint_to_binstr() for values >= 0 and int_to_binstr() for
+ *   negative values, base 16 uses uint_to_hexstr().
+ *
+ *   @param  in_fd : Text of decimal integers
+ *   @param  out_fd : Where the lines are written
+ *   @param  base : 2 or 16
+ *   @param  nbits : It is the number of bits of the output
+ *
+ *   @return long : Number of integers read, -1 on failure
+ */
+long bulk_convert(int in_fd, int out_fd, int base, uint8_t nbits);
+
+/**
+ *   @brief  Converts the integers in the file at path, or the standard input
+ *           if path is NULL, to the standard output
+ *
+ *   @return long : Number of integers read, -1 on failure
+ */
+long bulk_convert_path(const char *path, int base, uint8_t nbits);
+
+/**
+ *   @brief  Test function to test bulk_convert() function with test cases
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Decimal parser on signed values, 1 - 10 digits, overflow and junk
+ *   - Every line matches the library function called on its own
+ *   - Input larger than one block, numbers split between two reads
+ *   - Invalid base
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_bulk_convert(int debug);
+
+#endif /* BULK_CONVERT_ */
@@ -0,0 +1,423 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file cpu_dispatch.c
+ * @brief Run time choice of the SIMD kernels by CPU feature level
+ *
+ * Binding takes a lock, calls after it only compare two generation numbers
+ * and make an indirect call. GCC ifunc resolvers would save the compare, but
+ * run before main() and once per process, so BIT_OPS_CPU could not be read
+ * with getenv() nor the level changed by the tests.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "bit_operations.h"
+#include "bit_count.h"
+#include "bit_swap.h"
+#include "bit_transpose.h"
+#include "hexdump_parse.h"
+#include "hexdump_search.h"
+#include "morton.h"
+#include "roaring.h"
+#include "cpu_dispatch.h"
+
+unsigned cpu_dispatch_generation;
+
+static pthread_mutex_t dispatch_lock = PTHREAD_MUTEX_INITIALIZER;
+static cpu_point_t *dispatch_points;
+static cpu_level_t detected_level, current_level;
+
+static const char *const level_names[CPU_LEVEL_COUNT] = { "scalar", "sse4", "avx2", "avx512" };
+
+
+/**
+ *   @brief  Highest level whose every feature the CPU has
+ */
+static cpu_level_t detect(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("ssse3") || !__builtin_cpu_supports("sse4.2")
+        || !__builtin_cpu_supports("popcnt"))
+        return CPU_SCALAR;
+    if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("bmi")
+        || !__builtin_cpu_supports("bmi2") || !__builtin_cpu_supports("lzcnt"))
+        return CPU_SSE4;
+    if (!__builtin_cpu_supports("avx512f") || !__builtin_cpu_supports("avx512bw")
+        || !__builtin_cpu_supports("avx512cd") || !__builtin_cpu_supports("avx512dq")
+        || !__builtin_cpu_supports("avx512vl"))
+        return CPU_AVX2;
+    return CPU_AVX512;
+#else
+    return CPU_SCALAR;
+#endif
+}
+
+
+/**
+ *   @brief  Detects the level once, dispatch_lock held
+ */
+static void detect_locked(void) {
+    const char *env;
+    int level;
+
+    if (cpu_dispatch_generation != 0)
+        return;
+    detected_level = current_level = detect();
+    env = getenv("BIT_OPS_CPU");
+    if (env != NULL && env[0] != '\0') {
+        level = cpu_level_parse(env);
+        if (level < 0)
+            fprintf(stderr, "BIT_OPS_CPU: unknown level \"%s\", using %s\n", env,
+                    level_names[current_level]);
+        else if ((cpu_level_t)level < current_level)
+            current_level = (cpu_level_t)level;
+    }
+    __atomic_store_n(&cpu_dispatch_generation, 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ *   @brief  Binds a point to the kernel of the current level
+ *
+ *   @return cpu_fn_t : The kernel, to be cast to the type of the point
+ */
+cpu_fn_t cpu_bind(cpu_point_t *point) {
+    cpu_fn_t fn;
+    int level;
+
+    pthread_mutex_lock(&dispatch_lock);
+    detect_locked();
+    for (level = current_level; level > CPU_SCALAR && point->impl[level] == NULL; level--)
+        ;
+    point->bound = point->impl[level];
+    point->bound_level = (cpu_level_t)level;
+    __atomic_store_n(&point->generation, cpu_dispatch_generation, __ATOMIC_RELEASE);
+    fn = point->bound;
+    pthread_mutex_unlock(&dispatch_lock);
+    return fn;
+}
+
+
+/**
+ *   @brief  Adds a point to the list printed by cpu_dispatch_print()
+ */
+void cpu_dispatch_register(cpu_point_t *point) {
+    cpu_point_t **p;
+
+    pthread_mutex_lock(&dispatch_lock);
+    for (p = &dispatch_points; *p != NULL && *p != point; p = &(*p)->next)
+        ;
+    if (*p == NULL)
+        *p = point;
+    pthread_mutex_unlock(&dispatch_lock);
+}
+
+
+/**
+ *   @brief  Level of the CPU / level in use, after BIT_OPS_CPU and
+ *           cpu_set_level()
+ */
+cpu_level_t cpu_detected_level(void) {
+    cpu_level_t level;
+
+    pthread_mutex_lock(&dispatch_lock);
+    detect_locked();
+    level = detected_level;
+    pthread_mutex_unlock(&dispatch_lock);
+    return level;
+}
+
+cpu_level_t cpu_level(void) {
+    cpu_level_t level;
+
+    pthread_mutex_lock(&dispatch_lock);
+    detect_locked();
+    level = current_level;
+    pthread_mutex_unlock(&dispatch_lock);
+    return level;
+}
+
+
+/**
+ *   @brief  Changes the level in use, and rebinds every point on its next call
+ *
+ *   Calls already running on other threads finish with their old kernel.
+ *
+ *   @param  level : New level, lowered to the detected one if above it
+ *
+ *   @return cpu_level_t : Level now in use
+ */
+cpu_level_t cpu_set_level(cpu_level_t level) {
+    unsigned generation;
+
+    pthread_mutex_lock(&dispatch_lock);
+    detect_locked();
+    if (level < CPU_SCALAR)
+        level = CPU_SCALAR;
+    current_level = level < detected_level ? level : detected_level;
+
+    // 0 means not detected, skip it on wrap around
+    generation = cpu_dispatch_generation + 1;
+    if (generation == 0)
+        generation = 1;
+    __atomic_store_n(&cpu_dispatch_generation, generation, __ATOMIC_RELEASE);
+    level = current_level;
+    pthread_mutex_unlock(&dispatch_lock);
+    return level;
+}
+
+
+/**
+ *   @brief  Name of a level / level of a name ("scalar", "sse4", "avx2",
+ *           "avx512"), -1 for an unknown name
+ */
+const char *cpu_level_name(cpu_level_t level) {
+    if (level < 0 || level >= CPU_LEVEL_COUNT)
+        return "";
+    return level_names[level];
+}
+
+int cpu_level_parse(const char *name) {
+    int level;
+
+    for (level = 0; name != NULL && level < CPU_LEVEL_COUNT; level++)
+        if (strcmp(name, level_names[level]) == 0)
+            return level;
+    return -1;
+}
+
+
+/**
+ *   @brief  Level a point is bound to, binding it if needed
+ */
+static cpu_level_t point_level(cpu_point_t *point) {
+    cpu_resolve(point);
+    return point->bound_level;
+}
+
+
+/**
+ *   @brief  Prints the detected level, the level in use and the kernel level
+ *           of every point, as text or as a JSON object
+ */
+void cpu_dispatch_print(FILE *f) {
+    cpu_point_t *point;
+
+    fprintf(f, "CPU level: %s (detected %s)\n", cpu_level_name(cpu_level()),
+            cpu_level_name(cpu_detected_level()));
+    for (point = dispatch_points; point != NULL; point = point->next)
+        fprintf(f, "  %-28s %s\n", point->name, cpu_level_name(point_level(point)));
+}
+
+void cpu_dispatch_json(FILE *f) {
+    cpu_point_t *point;
+
+    fprintf(f, "{\"level\": \"%s\", \"detected\": \"%s\", \"kernels\": {",
+            cpu_level_name(cpu_level()), cpu_level_name(cpu_detected_level()));
+    for (point = dispatch_points; point != NULL; point = point->next)
+        fprintf(f, "%s\"%s\": \"%s\"", point == dispatch_points ? "" : ", ", point->name,
+                cpu_level_name(point_level(point)));
+    fprintf(f, "}}");
+}
+
+
+/**
+ *   @brief  FNV-1a hash of a buffer, chained from h
+ */
+static uint64_t hash_bytes(uint64_t h, const void *buf, size_t n) {
+    const uint8_t *p = (const uint8_t *)buf;
+
+    while (n-- > 0)
+        h = (h ^ *p++) * 0x100000001B3ULL;
+    return h;
+}
+
+
+/**
+ *   @brief  Hash of the results of the public functions with SIMD kernels,
+ *           the same at every level when the kernels agree
+ */
+static uint64_t fingerprint(const uint8_t *data, size_t n) {
+    static char str[8192];
+    static uint8_t bytes[4096];
+    static uint32_t words[1024], planes[1024], xs[256], ys[256];
+    static uint64_t keys[256];
+    uint64_t h = 0xCBF29CE484222325ULL, v;
+    hexdump_parser_t parser;
+    hexdump_pattern_t pattern;
+    roaring_t a, b, c;
+    size_t i, k, used, made;
+    int swap;
+
+    for (i = 0; i < 64; i++) {
+        uint32_t num = (uint32_t)data[i] * 0x01010101u ^ (uint32_t)i << 23;
+
+        uint_to_binstr(str, sizeof(str), num, (uint8_t)(1 + i % 32));
+        h = hash_bytes(h, str, strlen(str) + 1);
+        int_to_binstr(str, sizeof(str), (int32_t)num, (uint8_t)(8 + i % 25));
+        h = hash_bytes(h, str, strlen(str) + 1);
+        uint_to_hexstr(str, sizeof(str), num, (uint8_t)(4 << (i % 4)));
+        h = hash_bytes(h, str, strlen(str) + 1);
+    }
+
+    // Lines of every length, then a round trip through the parser
+    for (i = 0; i < 40; i++) {
+        hexdump(str, sizeof(str), data + i, i);
+        h = hash_bytes(h, str, strlen(str) + 1);
+    }
+    hexdump(str, sizeof(str), data, 1000);
+    h = hash_bytes(h, str, strlen(str) + 1);
+    hexdump_parse_init(&parser);
+    made = 0;
+    if (hexdump_parse(&parser, str, strlen(str), &used, bytes, sizeof(bytes), &made) == 0
+        && hexdump_parse_finish(&parser, bytes + made, sizeof(bytes) - made, &k) == 0)
+        made += k;
+    h = hash_bytes(h, &made, sizeof(made));
+    h = hash_bytes(h, bytes, made);
+
+    for (i = 0; i < 64; i++) {
+        v = bit_popcount_array(data + i, n - 2 * i);
+        h = hash_bytes(h, &v, sizeof(v));
+    }
+    for (swap = 0; swap < BIT_SWAP_COUNT; swap++) {
+        bit_swap((bit_swap_t)swap, bytes, data + 3, 1001);
+        h = hash_bytes(h, bytes, 1001);
+    }
+
+    memcpy(words, data, sizeof(words));
+    bit_planes_from_words(planes, words, 1000);
+    h = hash_bytes(h, planes, sizeof(planes));
+    bit_planes_to_words(words, planes, 1000);
+    h = hash_bytes(h, words, sizeof(words));
+
+    hexdump_search_compile(&pattern, "?? 0f");
+    for (k = 0; k < n; k++) {
+        k = hexdump_search_find(&pattern, data, n, k);
+        h = hash_bytes(h, &k, sizeof(k));
+    }
+
+    for (i = 0; i < 256; i++) {
+        xs[i] = words[i];
+        ys[i] = words[i + 256];
+    }
+    morton2_encode64_array(keys, xs, ys, 256);
+    h = hash_bytes(h, keys, sizeof(keys));
+    morton2_decode64_array(xs, ys, keys, 256);
+    h = hash_bytes(h, xs, sizeof(xs));
+    h = hash_bytes(h, ys, sizeof(ys));
+    morton3_encode64_array(keys, xs, ys, words, 256);
+    h = hash_bytes(h, keys, sizeof(keys));
+
+    // Dense chunks, so the bitmap containers are combined
+    roaring_init(&a);
+    roaring_init(&b);
+    roaring_init(&c);
+    for (i = 0; i < 1024; i++) {
+        for (k = 0; k < 8; k++) {
+            roaring_set(&a, words[i] >> 14);
+            roaring_set(&b, (words[i] >> 15) + (uint32_t)k * 97);
+        }
+    }
+    roaring_or(&c, &a, &b);
+    v = roaring_cardinality(&c);
+    roaring_and(&c, &a, &b);
+    v = v * 31 + roaring_cardinality(&c);
+    roaring_andnot(&c, &a, &b);
+    v = v * 31 + roaring_cardinality(&c);
+    h = hash_bytes(h, &v, sizeof(v));
+    roaring_free(&a);
+    roaring_free(&b);
+    roaring_free(&c);
+    return h;
+}
+
+
+/**
+ *   @brief  Test function to test the cpu_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Level names, parsing and the BIT_OPS_CPU rules
+ *   - Every point binds to a kernel at or below each level
+ *   - Public functions give the same results at every level the CPU has
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_cpu_dispatch(int debug) {
+    static uint8_t data[4096];
+    cpu_level_t saved, detected;
+    cpu_point_t *point;
+    uint64_t expected = 0, h;
+    uint32_t seed = 12345;
+    int level, status = 1;
+    size_t i;
+
+    if(debug)
+        printf("\n Test Results for CPU dispatch ");
+
+    for (level = 0; level < CPU_LEVEL_COUNT; level++)
+        if (cpu_level_parse(cpu_level_name((cpu_level_t)level)) != level)
+            status = 0;
+    if (cpu_level_parse("avx") != -1 || cpu_level_parse("") != -1 || cpu_level_parse(NULL) != -1
+        || cpu_level_name(CPU_LEVEL_COUNT)[0] != '\0')
+        status = 0;
+
+    saved = cpu_level();
+    detected = cpu_detected_level();
+    if (saved > detected)
+        status = 0;
+    // Raising above the CPU is refused
+    if (cpu_set_level(CPU_AVX512) != detected)
+        status = 0;
+
+    for (i = 0; i < sizeof(data); i++) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+
+    for (level = CPU_SCALAR; level <= (int)detected; level++) {
+        if (cpu_set_level((cpu_level_t)level) != (cpu_level_t)level)
+            status = 0;
+        for (point = dispatch_points; point != NULL; point = point->next) {
+            if (cpu_bind(point) != point->impl[point->bound_level] || point->bound == NULL
+                || point->bound_level > (cpu_level_t)level)
+                status = 0;
+        }
+        h = fingerprint(data, sizeof(data));
+        if (level == CPU_SCALAR)
+            expected = h;
+        else if (h != expected)
+            status = 0;
+        if(debug)
+            printf("\nLevel %s: %016llx", cpu_level_name((cpu_level_t)level), (unsigned long long)h);
+    }
+
+    cpu_set_level(saved);
+    if (cpu_level() != saved)
+        status = 0;
+    if(debug) {
+        printf("\n");
+        cpu_dispatch_print(stdout);
+        printf("Result: %d", status);
+    }
+
+    return status;
+}
@@ -0,0 +1,151 @@
+#ifndef CPU_DISPATCH_
+#define CPU_DISPATCH_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file cpu_dispatch.h
+ * @brief Run time choice of the SIMD kernels by CPU feature level
+ *
+ * The CPU is detected once (cpuid, through __builtin_cpu_supports) and put
+ * on one of the x86-64 levels
+ *   - scalar : no SIMD kernel
+ *   - sse4   : SSSE3, SSE4.2 and POPCNT (x86-64-v2)
+ *   - avx2   : AVX2, BMI1 / BMI2 and LZCNT (x86-64-v3)
+ *   - avx512 : AVX-512 F, BW, CD, DQ and VL (x86-64-v4)
+ * The environment variable BIT_OPS_CPU (scalar, sse4, avx2 or avx512) lowers
+ * the level, e.g. to test the fallbacks on a new machine. It cannot raise it.
+ *
+ * Every function with SIMD kernels has a dispatch point listing its kernel
+ * for each level. The point binds to the kernel of the highest level not
+ * above the current one on its first call, and again after cpu_set_level().
+ * Points register themselves at start up, so cpu_dispatch_print() lists all
+ * of them.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+typedef enum {
+    CPU_SCALAR,
+    CPU_SSE4,
+    CPU_AVX2,
+    CPU_AVX512,
+    CPU_LEVEL_COUNT
+} cpu_level_t;
+
+typedef void (*cpu_fn_t)(void);
+
+typedef struct cpu_point {
+    const char *name;
+    cpu_fn_t impl[CPU_LEVEL_COUNT];     // Kernel of each level, NULL for none
+    cpu_fn_t bound;
+    cpu_level_t bound_level;
+    unsigned generation;                // cpu_dispatch_generation when bound
+    struct cpu_point *next;
+} cpu_point_t;
+
+// Kernels of a point, a scalar one is required
+#define CPU_POINT(name, scalar, sse4, avx2, avx512) \
+    { (name), { (cpu_fn_t)(scalar), (cpu_fn_t)(sse4), (cpu_fn_t)(avx2), (cpu_fn_t)(avx512) }, \
+      NULL, CPU_SCALAR, 0, NULL }
+
+// A kernel which only exists in x86 builds
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_X86(kernel) kernel
+#else
+#define CPU_X86(kernel) NULL
+#endif
+
+// Registers a point at start up
+#define CPU_DISPATCH_REGISTER(point) \
+    __attribute__((constructor)) static void point##_register(void) { \
+        cpu_dispatch_register(&(point)); \
+    }
+
+// Changes whenever the level does, 0 before detection
+extern unsigned cpu_dispatch_generation;
+
+/**
+ *   @brief  Binds a point to the kernel of the current level
+ *
+ *   @return cpu_fn_t : The kernel, to be cast to the type of the point
+ */
+cpu_fn_t cpu_bind(cpu_point_t *point);
+
+/**
+ *   @brief  Kernel of a point for the current level, bound on first use
+ */
+static inline cpu_fn_t cpu_resolve(cpu_point_t *point) {
+    unsigned generation = __atomic_load_n(&cpu_dispatch_generation, __ATOMIC_ACQUIRE);
+
+    if (__builtin_expect(generation != 0
+                         && __atomic_load_n(&point->generation, __ATOMIC_ACQUIRE) == generation, 1))
+        return point->bound;
+    return cpu_bind(point);
+}
+
+/**
+ *   @brief  Adds a point to the list printed by cpu_dispatch_print()
+ */
+void cpu_dispatch_register(cpu_point_t *point);
+
+/**
+ *   @brief  Level of the CPU / level in use, after BIT_OPS_CPU and
+ *           cpu_set_level()
+ */
+cpu_level_t cpu_detected_level(void);
+cpu_level_t cpu_level(void);
+
+/**
+ *   @brief  Changes the level in use, and rebinds every point on its next call
+ *
+ *   @param  level : New level, lowered to the detected one if above it
+ *
+ *   @return cpu_level_t : Level now in use
+ */
+cpu_level_t cpu_set_level(cpu_level_t level);
+
+/**
+ *   @brief  Name of a level / level of a name ("scalar", "sse4", "avx2",
+ *           "avx512"), -1 for an unknown name
+ */
+const char *cpu_level_name(cpu_level_t level);
+int cpu_level_parse(const char *name);
+
+/**
+ *   @brief  Prints the detected level, the level in use and the kernel level
+ *           of every point, as text or as a JSON object
+ */
+void cpu_dispatch_print(FILE *f);
+void cpu_dispatch_json(FILE *f);
+
+/**
+ *   @brief  Test function to test the cpu_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Level names, parsing and the BIT_OPS_CPU rules
+ *   - Every point binds to a kernel at or below each level
+ *   - Public functions give the same results at every level the CPU has
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_cpu_dispatch(int debug);
+
+#endif /* CPU_DISPATCH_ */
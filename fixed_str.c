@@ -0,0 +1,219 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file fixed_str.c
+ * @brief Conversions returning their string by value, in a struct holding
+ *        the longest string of its kind
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bit_operations.h"
+#include "fixed_str.h"
+
+// An empty string for a refused conversion, whatever the function left
+#define FIXED_STR_RESULT(s, ret) \
+    do { \
+        (s).len = (ret); \
+        if ((s).len < 0) { \
+            (s).len = -1; \
+            (s).str[0] = '\0'; \
+        } \
+    } while (0)
+
+
+/**
+ *   @brief  uint_to_binstr(), int_to_binstr(), uint_to_hexstr(),
+ *           uint_to_decstr() and int_to_decstr() by value
+ *
+ *   @param  num : Integer to be converted
+ *   @param  nbits : It is the number of bits of the input, at most 32
+ *
+ *   @return The string, len -1 if the function rejects num or nbits
+ */
+binstr_t to_binstr(uint32_t num, uint8_t nbits) {
+    binstr_t s;
+
+    FIXED_STR_RESULT(s, nbits <= FIXED_STR_MAX_BITS
+                        ? uint_to_binstr(s.str, sizeof(s.str), num, nbits) : -1);
+    return s;
+}
+
+binstr_t to_int_binstr(int32_t num, uint8_t nbits) {
+    binstr_t s;
+
+    FIXED_STR_RESULT(s, nbits <= FIXED_STR_MAX_BITS
+                        ? int_to_binstr(s.str, sizeof(s.str), num, nbits) : -1);
+    return s;
+}
+
+hexstr_t to_hexstr(uint32_t num, uint8_t nbits) {
+    hexstr_t s;
+
+    FIXED_STR_RESULT(s, nbits <= FIXED_STR_MAX_BITS
+                        ? uint_to_hexstr(s.str, sizeof(s.str), num, nbits) : -1);
+    return s;
+}
+
+decstr_t to_decstr(uint32_t num, uint8_t nbits) {
+    decstr_t s;
+
+    FIXED_STR_RESULT(s, nbits <= FIXED_STR_MAX_BITS
+                        ? uint_to_decstr(s.str, sizeof(s.str), num, nbits) : -1);
+    return s;
+}
+
+decstr_t to_int_decstr(int32_t num, uint8_t nbits) {
+    decstr_t s;
+
+    FIXED_STR_RESULT(s, nbits <= FIXED_STR_MAX_BITS
+                        ? int_to_decstr(s.str, sizeof(s.str), num, nbits) : -1);
+    return s;
+}
+
+
+/**
+ *   @brief  hexdump_line() by value, with its '\0'
+ *
+ *   @param  offset : Offset printed in the offset column
+ *   @param  offset_digits : Width of the offset column, 1 to 16 hex digits
+ *   @param  pc : Bytes of this line
+ *   @param  n : Number of bytes in this line (0 - 16)
+ *
+ *   @return The line, len -1 for an invalid width or n
+ */
+hexline_t to_hexline(uint64_t offset, int offset_digits, const uint8_t *pc, size_t n) {
+    hexline_t s;
+
+    if (offset_digits < 1 || offset_digits > 16 || n > HEXDUMP_BYTES_PER_LINE
+        || (pc == NULL && n > 0)) {
+        s.len = -1;
+        s.str[0] = '\0';
+        return s;
+    }
+    s.len = hexdump_line(s.str, offset, offset_digits, pc, n);
+    s.str[s.len] = '\0';
+    return s;
+}
+
+
+/**
+ *   @brief  Whether a to_*() result is what its function gave, or refused
+ *           for nbits above FIXED_STR_MAX_BITS
+ */
+static int same_result(int len, const char *fixed, int ret, const char *str, int nbits) {
+    if (nbits > FIXED_STR_MAX_BITS)
+        return len == -1 && fixed[0] == '\0';
+    return len == ret && (ret < 0 ? fixed[0] == '\0' : strcmp(fixed, str) == 0);
+}
+
+
+/**
+ *   @brief  Test function to test the to_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every width from 0 to 33 against the library functions
+ *   - Longest strings fill the capacity exactly
+ *   - Hexdump lines against hexdump(), invalid widths and lengths
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_fixed_str(int debug) {
+    const uint32_t values[] = { 0, 1, 2, 15, 16, 255, 256, 0xFFFF, 0x12345678, 0x7FFFFFFF,
+                                0x80000000u, 0xFFFFFFFFu, (uint32_t)-1000 };
+    char str[1024], dump[1024];
+    uint8_t bytes[40];
+    binstr_t b;
+    hexstr_t h;
+    decstr_t d;
+    hexline_t l;
+    const char *line;
+    size_t i, n;
+    int nbits, ret, status = 1;
+
+    if(debug)
+        printf("\n Test Results for strings by value ");
+
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        for (nbits = 0; nbits <= FIXED_STR_MAX_BITS + 1; nbits++) {
+            ret = uint_to_binstr(str, sizeof(str), values[i], (uint8_t)nbits);
+            b = to_binstr(values[i], (uint8_t)nbits);
+            if (!same_result(b.len, b.str, ret, str, nbits))
+                status = 0;
+
+            ret = int_to_binstr(str, sizeof(str), (int32_t)values[i], (uint8_t)nbits);
+            b = to_int_binstr((int32_t)values[i], (uint8_t)nbits);
+            if (!same_result(b.len, b.str, ret, str, nbits))
+                status = 0;
+
+            ret = uint_to_hexstr(str, sizeof(str), values[i], (uint8_t)nbits);
+            h = to_hexstr(values[i], (uint8_t)nbits);
+            if (!same_result(h.len, h.str, ret, str, nbits))
+                status = 0;
+
+            ret = uint_to_decstr(str, sizeof(str), values[i], (uint8_t)nbits);
+            d = to_decstr(values[i], (uint8_t)nbits);
+            if (!same_result(d.len, d.str, ret, str, nbits))
+                status = 0;
+
+            ret = int_to_decstr(str, sizeof(str), (int32_t)values[i], (uint8_t)nbits);
+            d = to_int_decstr((int32_t)values[i], (uint8_t)nbits);
+            if (!same_result(d.len, d.str, ret, str, nbits))
+                status = 0;
+        }
+    }
+    if(debug)
+        printf("\nConversions, Result: %d", status);
+
+    // The longest strings use every byte
+    if (to_binstr(1, 32).len != (int)sizeof(b.str) - 1
+        || to_int_binstr(-1, 32).len != (int)sizeof(b.str) - 1 || to_hexstr(1, 32).len != (int)sizeof(h.str) - 1
+        || to_int_decstr(INT32_MIN, 32).len != (int)sizeof(d.str) - 1)
+        status = 0;
+    b = to_int_binstr(-2, 4);
+    if (strcmp(b.str, "0b1110") != 0)
+        status = 0;
+    if(debug)
+        printf("\n%s %s %s, Result: %d", b.str, to_hexstr(0xBEEF, 16).str,
+               to_int_decstr(-42, 8).str, status);
+
+    // Lines of hexdump()
+    for (i = 0; i < sizeof(bytes); i++)
+        bytes[i] = (uint8_t)(i * 29 + 1);
+    hexdump(dump, sizeof(dump), bytes, sizeof(bytes));
+    for (i = 0; i < sizeof(bytes); i += HEXDUMP_BYTES_PER_LINE) {
+        n = sizeof(bytes) - i < HEXDUMP_BYTES_PER_LINE ? sizeof(bytes) - i : HEXDUMP_BYTES_PER_LINE;
+        l = to_hexline(i, hexdump_offset_digits(sizeof(bytes)), bytes + i, n);
+        line = dump + (i / HEXDUMP_BYTES_PER_LINE) * ((size_t)l.len + 1);
+        if (l.len != (int)hexdump_line_length(HEXDUMP_OFFSET_DIGITS)
+            || strncmp(line, l.str, (size_t)l.len) != 0)
+            status = 0;
+    }
+    l = to_hexline(UINT64_MAX - 15, 16, bytes, 16);
+    if (l.len != (int)sizeof(l.str) - 1 || strncmp(l.str, "0xFFFFFFFFFFFFFFF0  ", 20) != 0)
+        status = 0;
+    if (to_hexline(0, 0, bytes, 16).len != -1 || to_hexline(0, 17, bytes, 16).len != -1
+        || to_hexline(0, 4, bytes, 17).len != -1 || to_hexline(0, 4, NULL, 1).len != -1
+        || to_hexline(0, 4, NULL, 0).len != (int)hexdump_line_length(4))
+        status = 0;
+    if(debug)
+        printf("\nHexdump lines, Result: %d", status);
+
+    return status;
+}
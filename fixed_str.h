@@ -0,0 +1,106 @@
+#ifndef FIXED_STR_
+#define FIXED_STR_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bit_operations.h"
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file fixed_str.h
+ * @brief Conversions returning their string by value, in a struct holding
+ *        the longest string of its kind
+ *
+ *     binstr_t b = to_binstr(reg, 8);
+ *     if (b.len >= 0)
+ *         puts(b.str);
+ *
+ * No buffer nor size is passed : the capacity of each type is the longest
+ * string a 32 bit value gives, so only the value and nbits are checked.
+ * The structs are a few dozen bytes, returned in the caller's frame, and
+ * never use the heap. nbits above 32 is refused (len -1), as the string
+ * would not fit; the library functions still accept it.
+ *
+ * A failed conversion gives len -1 and an empty str, as the library
+ * functions leave str.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#define FIXED_STR_MAX_BITS 32
+
+typedef struct {
+    int len;
+    char str[2 + FIXED_STR_MAX_BITS + 1];           // "0b", digits, '\0'
+} binstr_t;
+
+typedef struct {
+    int len;
+    char str[2 + FIXED_STR_MAX_BITS / 4 + 1];       // "0x", digits, '\0'
+} hexstr_t;
+
+typedef struct {
+    int len;
+    char str[12];                                   // "-2147483648", '\0'
+} decstr_t;
+
+typedef struct {
+    int len;
+    char str[2 + 16 + 2 + 3 * HEXDUMP_BYTES_PER_LINE + 1];  // 64 bit offset
+} hexline_t;
+
+/**
+ *   @brief  uint_to_binstr(), int_to_binstr(), uint_to_hexstr(),
+ *           uint_to_decstr() and int_to_decstr() by value
+ *
+ *   @param  num : Integer to be converted
+ *   @param  nbits : It is the number of bits of the input, at most 32
+ *
+ *   @return The string, len -1 if the function rejects num or nbits
+ */
+binstr_t to_binstr(uint32_t num, uint8_t nbits);
+binstr_t to_int_binstr(int32_t num, uint8_t nbits);
+hexstr_t to_hexstr(uint32_t num, uint8_t nbits);
+decstr_t to_decstr(uint32_t num, uint8_t nbits);
+decstr_t to_int_decstr(int32_t num, uint8_t nbits);
+
+/**
+ *   @brief  hexdump_line() by value, with its '\0'
+ *
+ *   @param  offset : Offset printed in the offset column
+ *   @param  offset_digits : Width of the offset column, 1 to 16 hex digits
+ *   @param  pc : Bytes of this line
+ *   @param  n : Number of bytes in this line (0 - 16)
+ *
+ *   @return The line, len -1 for an invalid width or n
+ */
+hexline_t to_hexline(uint64_t offset, int offset_digits, const uint8_t *pc, size_t n);
+
+/**
+ *   @brief  Test function to test the to_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every width from 0 to 33 against the library functions
+ *   - Longest strings fill the capacity exactly
+ *   - Hexdump lines against hexdump(), invalid widths and lengths
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_fixed_str(int debug);
+
+#endif /* FIXED_STR_ */
@@ -0,0 +1,520 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file fmt_arena.c
+ * @brief Append only arena which the formatters write into directly
+ *
+ * The pool keeps freed chunks in one list per power of two size, up to
+ * FMT_POOL_KEEP of each; a chunk only goes back to malloc() beyond that.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_operations.h"
+#include "fmt_arena.h"
+
+#define FMT_POOL_KEEP 16        // Free chunks kept per size class
+
+struct fmt_chunk {
+    fmt_chunk_t *next;
+    size_t size;                // Bytes at data
+    int cls;                    // Size class, size is FMT_ARENA_CHUNK << cls
+    char data[];
+};
+
+static fmt_chunk_t *pool[FMT_ARENA_CLASSES];
+static int pool_count[FMT_ARENA_CLASSES];
+static size_t pool_allocations;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ *   @brief  Chunk of at least n bytes, from the pool if it has one
+ */
+static fmt_chunk_t *chunk_get(size_t n) {
+    fmt_chunk_t *chunk;
+    int cls = 0;
+
+    while (cls < FMT_ARENA_CLASSES && ((size_t)FMT_ARENA_CHUNK << cls) < n)
+        cls++;
+    if (cls == FMT_ARENA_CLASSES)
+        return NULL;
+
+    pthread_mutex_lock(&pool_lock);
+    chunk = pool[cls];
+    if (chunk != NULL) {
+        pool[cls] = chunk->next;
+        pool_count[cls]--;
+    }
+    else
+        pool_allocations++;
+    pthread_mutex_unlock(&pool_lock);
+
+    if (chunk == NULL) {
+        chunk = malloc(sizeof(fmt_chunk_t) + ((size_t)FMT_ARENA_CHUNK << cls));
+        if (chunk == NULL)
+            return NULL;
+        chunk->size = (size_t)FMT_ARENA_CHUNK << cls;
+        chunk->cls = cls;
+    }
+    chunk->next = NULL;
+    return chunk;
+}
+
+static void chunk_put(fmt_chunk_t *chunk) {
+    pthread_mutex_lock(&pool_lock);
+    if (pool_count[chunk->cls] < FMT_POOL_KEEP) {
+        chunk->next = pool[chunk->cls];
+        pool[chunk->cls] = chunk;
+        pool_count[chunk->cls]++;
+        chunk = NULL;
+    }
+    pthread_mutex_unlock(&pool_lock);
+    free(chunk);
+}
+
+
+/**
+ *   @brief  Prepares an empty arena, no memory is taken until the first append
+ */
+void fmt_arena_init(fmt_arena_t *arena) {
+    memset(arena, 0, sizeof(*arena));
+}
+
+
+/**
+ *   @brief  Gives the chunks of an arena back to the pool
+ */
+void fmt_arena_free(fmt_arena_t *arena) {
+    fmt_chunk_t *chunk, *next;
+
+    for (chunk = arena->head; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        chunk_put(chunk);
+    }
+    fmt_arena_init(arena);
+}
+
+
+/**
+ *   @brief  Empties an arena and keeps its chunks, invalidating every slice
+ */
+void fmt_arena_reset(fmt_arena_t *arena) {
+    arena->cur = arena->head;
+    arena->pos = 0;
+    arena->record = 0;
+    arena->in_record = 0;
+    arena->last.data = NULL;
+    arena->last.len = 0;
+}
+
+
+/**
+ *   @brief  Room for n characters at the end of the arena
+ *
+ *   A full chunk is left as it is, so slices into it stay valid. The next
+ *   chunk is the following one of a reset arena if it is large enough, else
+ *   a new one twice the size of the current one.
+ *
+ *   @param  arena : Arena
+ *   @param  n : Characters needed
+ *
+ *   @return char * : Where to write them, NULL if out of memory
+ */
+char *fmt_arena_reserve(fmt_arena_t *arena, size_t n) {
+    fmt_chunk_t *cur = arena->cur, *chunk;
+    size_t keep, need, size;
+
+    if (cur != NULL && n <= cur->size - arena->pos)
+        return cur->data + arena->pos;
+
+    // An open record moves with the end of the arena
+    keep = arena->in_record ? arena->pos - arena->record : 0;
+    need = keep + n;
+    if (need < n)
+        return NULL;
+
+    if (cur != NULL && cur->next != NULL && cur->next->size >= need) {
+        chunk = cur->next;
+    }
+    else {
+        size = (cur != NULL) ? 2 * cur->size : FMT_ARENA_CHUNK;
+        chunk = chunk_get(size > need ? size : need);
+        if (chunk == NULL)
+            return NULL;
+        if (cur == NULL) {
+            chunk->next = arena->head;
+            arena->head = chunk;
+        }
+        else {
+            chunk->next = cur->next;
+            cur->next = chunk;
+        }
+    }
+
+    if (keep > 0) {
+        memcpy(chunk->data, cur->data + arena->record, keep);
+        if (arena->last.data >= cur->data + arena->record
+            && arena->last.data < cur->data + arena->pos)
+            arena->last.data = chunk->data + (arena->last.data - (cur->data + arena->record));
+    }
+    arena->cur = chunk;
+    arena->record = 0;
+    arena->pos = keep;
+    return chunk->data + keep;
+}
+
+
+/**
+ *   @brief  Appends the first n characters written at the last reservation
+ */
+void fmt_arena_commit(fmt_arena_t *arena, size_t n) {
+    arena->last.data = arena->cur->data + arena->pos;
+    arena->last.len = n;
+    arena->pos += n;
+}
+
+
+/**
+ *   @brief  Appends n characters copied from str
+ *
+ *   @return int : Characters appended, -1 if out of memory
+ */
+int fmt_arena_append(fmt_arena_t *arena, const char *str, size_t n) {
+    char *p = fmt_arena_reserve(arena, n);
+
+    if (p == NULL || n > INT32_MAX)
+        return -1;
+    memcpy(p, str, n);
+    fmt_arena_commit(arena, n);
+    return (int)n;
+}
+
+
+/**
+ *   @brief  Commits the result of a conversion written at the reservation
+ */
+static int commit_result(fmt_arena_t *arena, int len) {
+    if (len < 0)
+        return -1;
+    fmt_arena_commit(arena, (size_t)len);
+    return len;
+}
+
+
+/**
+ *   @brief  Appends a number as uint_to_binstr(), int_to_binstr(),
+ *           uint_to_hexstr(), uint_to_decstr() or int_to_decstr() writes it
+ *
+ *   The room reserved is the longest string of nbits, and its '\0'.
+ *
+ *   @param  arena : Arena
+ *   @param  num : Integer to be converted
+ *   @param  nbits : It is the number of bits of the input
+ *
+ *   @return int : Characters appended, -1 (and nothing appended) if the
+ *                 function rejects num or nbits, or out of memory
+ */
+int fmt_arena_binstr(fmt_arena_t *arena, uint32_t num, uint8_t nbits) {
+    size_t size = (size_t)nbits + 3;
+    char *p = fmt_arena_reserve(arena, size);
+
+    return p == NULL ? -1 : commit_result(arena, uint_to_binstr(p, size, num, nbits));
+}
+
+int fmt_arena_int_binstr(fmt_arena_t *arena, int32_t num, uint8_t nbits) {
+    size_t size = (size_t)nbits + 3;
+    char *p = fmt_arena_reserve(arena, size);
+
+    return p == NULL ? -1 : commit_result(arena, int_to_binstr(p, size, num, nbits));
+}
+
+int fmt_arena_hexstr(fmt_arena_t *arena, uint32_t num, uint8_t nbits) {
+    size_t size = (size_t)nbits / 4 + 3;
+    char *p = fmt_arena_reserve(arena, size);
+
+    return p == NULL ? -1 : commit_result(arena, uint_to_hexstr(p, size, num, nbits));
+}
+
+int fmt_arena_decstr(fmt_arena_t *arena, uint32_t num, uint8_t nbits) {
+    char *p = fmt_arena_reserve(arena, 11);
+
+    return p == NULL ? -1 : commit_result(arena, uint_to_decstr(p, 11, num, nbits));
+}
+
+int fmt_arena_int_decstr(fmt_arena_t *arena, int32_t num, uint8_t nbits) {
+    char *p = fmt_arena_reserve(arena, 12);
+
+    return p == NULL ? -1 : commit_result(arena, int_to_decstr(p, 12, num, nbits));
+}
+
+
+/**
+ *   @brief  Appends the hexdump() of nbytes at loc
+ *
+ *   @return int : Characters appended (0 for 0 bytes), -1 if out of memory
+ */
+int fmt_arena_hexdump(fmt_arena_t *arena, const void *loc, size_t nbytes) {
+    size_t rows = (nbytes + HEXDUMP_BYTES_PER_LINE - 1) / HEXDUMP_BYTES_PER_LINE;
+    size_t size = rows * (hexdump_line_length(hexdump_offset_digits(nbytes)) + 1);
+    char *p;
+
+    if (nbytes == 0)
+        return fmt_arena_append(arena, "", 0);
+    if (size - 1 > INT32_MAX)
+        return -1;
+    p = fmt_arena_reserve(arena, size);
+    if (p == NULL)
+        return -1;
+
+    // Lines and the newlines in between, the last '\0' is not appended
+    hexdump(p, size, loc, nbytes);
+    fmt_arena_commit(arena, size - 1);
+    return (int)(size - 1);
+}
+
+
+/**
+ *   @brief  Slice of the last successful append
+ */
+fmt_slice_t fmt_arena_last(const fmt_arena_t *arena) {
+    return arena->last;
+}
+
+
+/**
+ *   @brief  Starts / ends a record, the appends in between as one slice
+ *           followed by a '\0' which is not counted in its length
+ *
+ *   @return fmt_slice_t : The record, data NULL if no record was open or out
+ *                         of memory
+ */
+void fmt_arena_begin(fmt_arena_t *arena) {
+    arena->record = arena->pos;
+    arena->in_record = 1;
+}
+
+fmt_slice_t fmt_arena_end(fmt_arena_t *arena) {
+    fmt_slice_t record = { NULL, 0 };
+    char *p;
+
+    if (!arena->in_record)
+        return record;
+    p = fmt_arena_reserve(arena, 1);
+    arena->in_record = 0;
+    if (p == NULL)
+        return record;
+
+    *p = '\0';
+    record.data = arena->cur->data + arena->record;
+    record.len = arena->pos - arena->record;
+    arena->pos++;
+    return record;
+}
+
+
+/**
+ *   @brief  Bytes of chunks held by an arena / chunks allocated with malloc()
+ *           by the pool since the program started
+ */
+size_t fmt_arena_capacity(const fmt_arena_t *arena) {
+    const fmt_chunk_t *chunk;
+    size_t bytes = 0;
+
+    for (chunk = arena->head; chunk != NULL; chunk = chunk->next)
+        bytes += chunk->size;
+    return bytes;
+}
+
+size_t fmt_arena_pool_allocations(void) {
+    size_t n;
+
+    pthread_mutex_lock(&pool_lock);
+    n = pool_allocations;
+    pthread_mutex_unlock(&pool_lock);
+    return n;
+}
+
+
+/**
+ *   @brief  Builds the same log record in an arena and, with the functions
+ *           and their own buffers, in expected
+ *
+ *   @return fmt_slice_t : The record in the arena
+ */
+static fmt_slice_t build_record(fmt_arena_t *arena, char *expected, size_t *len,
+                                const uint32_t *nums, size_t count, fmt_slice_t *first) {
+    char str[64];
+    size_t i, k = 0;
+    int ret;
+
+    fmt_arena_begin(arena);
+    for (i = 0; i < count; i++) {
+        fmt_arena_append(arena, "reg=", 4);
+        memcpy(expected + k, "reg=", 4);
+        k += 4;
+
+        ret = uint_to_hexstr(str, sizeof(str), nums[i], 32);
+        if (fmt_arena_hexstr(arena, nums[i], 32) != ret)
+            break;
+        if (ret > 0) {
+            memcpy(expected + k, str, (size_t)ret);
+            k += (size_t)ret;
+        }
+        if (i == 0)
+            *first = fmt_arena_last(arena);
+
+        fmt_arena_append(arena, " bits=", 6);
+        memcpy(expected + k, " bits=", 6);
+        k += 6;
+        ret = int_to_binstr(str, sizeof(str), (int32_t)(nums[i] << 1) >> 8, 32);
+        if (fmt_arena_int_binstr(arena, (int32_t)(nums[i] << 1) >> 8, 32) != ret)
+            break;
+        if (ret > 0) {
+            memcpy(expected + k, str, (size_t)ret);
+            k += (size_t)ret;
+        }
+        fmt_arena_append(arena, "\n", 1);
+        expected[k++] = '\n';
+    }
+    *len = (i == count) ? k : 0;
+    return fmt_arena_end(arena);
+}
+
+
+/**
+ *   @brief  Test function to test the fmt_arena_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every append matches the function writing into its own buffer
+ *   - Rejected values append nothing
+ *   - Records stay contiguous while the arena grows, slices stay valid
+ *   - Reset reuses the chunks, freed chunks are reused by the next arena
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_fmt_arena(int debug) {
+    const uint32_t values[] = { 0, 1, 5, 255, 256, 0xFFFF, 0x12345678, 0x7FFFFFFF,
+                                0x80000000u, 0xFFFFFFFFu, (uint32_t)-300 };
+    const uint8_t widths[] = { 1, 4, 8, 16, 31, 32, 40 };
+    static uint32_t nums[600];
+    static uint8_t bytes[1000];
+    static char expected[64 * 600], dump[8192];
+    fmt_arena_t arena;
+    fmt_slice_t slice, first, record;
+    char str[64];
+    size_t i, w, pos, len, capacity, allocations;
+    uint32_t seed = 99;
+    int ret, r, status = 1;
+
+    if(debug)
+        printf("\n Test Results for the formatting arena ");
+
+    // Each conversion against its function
+    fmt_arena_init(&arena);
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        for (w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+            for (r = 0; r < 5; r++) {
+                pos = arena.pos;
+                if (r == 0) {
+                    ret = uint_to_binstr(str, sizeof(str), values[i], widths[w]);
+                    if (fmt_arena_binstr(&arena, values[i], widths[w]) != ret)
+                        status = 0;
+                }
+                else if (r == 1) {
+                    ret = int_to_binstr(str, sizeof(str), (int32_t)values[i], widths[w]);
+                    if (fmt_arena_int_binstr(&arena, (int32_t)values[i], widths[w]) != ret)
+                        status = 0;
+                }
+                else if (r == 2) {
+                    ret = uint_to_hexstr(str, sizeof(str), values[i], widths[w]);
+                    if (fmt_arena_hexstr(&arena, values[i], widths[w]) != ret)
+                        status = 0;
+                }
+                else if (r == 3) {
+                    ret = uint_to_decstr(str, sizeof(str), values[i], widths[w]);
+                    if (fmt_arena_decstr(&arena, values[i], widths[w]) != ret)
+                        status = 0;
+                }
+                else {
+                    ret = int_to_decstr(str, sizeof(str), (int32_t)values[i], widths[w]);
+                    if (fmt_arena_int_decstr(&arena, (int32_t)values[i], widths[w]) != ret)
+                        status = 0;
+                }
+                slice = fmt_arena_last(&arena);
+                if (ret < 0 && arena.pos != pos)
+                    status = 0;
+                if (ret >= 0 && (slice.len != (size_t)ret || memcmp(slice.data, str, slice.len) != 0))
+                    status = 0;
+            }
+        }
+    }
+        if(debug)
+            printf("\nConversions: %zu bytes appended, Result: %d", arena.pos, status);
+
+    for (i = 0; i < sizeof(bytes); i++)
+        bytes[i] = (uint8_t)(i * 7 + 3);
+    for (len = 0; len <= sizeof(bytes); len += 111) {
+        hexdump(dump, sizeof(dump), bytes, len);
+        ret = fmt_arena_hexdump(&arena, bytes, len);
+        slice = fmt_arena_last(&arena);
+        if (ret != (int)strlen(dump) || slice.len != (size_t)ret || memcmp(slice.data, dump, slice.len) != 0)
+            status = 0;
+    }
+    fmt_arena_free(&arena);
+
+    // A record much larger than the first chunk, built twice
+    for (i = 0; i < 600; i++) {
+        seed = seed * 1103515245u + 12345u;
+        nums[i] = (seed >> 1) | 1;
+    }
+    record = build_record(&arena, expected, &len, nums, 600, &first);
+    if (record.data == NULL || len == 0 || record.len != len || memcmp(record.data, expected, len) != 0
+        || record.data[len] != '\0' || first.len != 10 || memcmp(first.data, expected + 4, 10) != 0
+        || fmt_arena_capacity(&arena) < len)
+        status = 0;
+    if(debug)
+        printf("\nRecord: %zu characters, arena %zu bytes, Result: %d", record.len,
+               fmt_arena_capacity(&arena), status);
+
+    // Reset keeps the chunks, and the same record needs no more
+    capacity = fmt_arena_capacity(&arena);
+    allocations = fmt_arena_pool_allocations();
+    fmt_arena_reset(&arena);
+    record = build_record(&arena, expected, &len, nums, 600, &first);
+    if (record.data == NULL || record.len != len || memcmp(record.data, expected, len) != 0
+        || fmt_arena_capacity(&arena) != capacity || fmt_arena_pool_allocations() != allocations)
+        status = 0;
+
+    // Freed chunks go to the next arena
+    fmt_arena_free(&arena);
+    if (fmt_arena_capacity(&arena) != 0 || fmt_arena_end(&arena).data != NULL)
+        status = 0;
+    record = build_record(&arena, expected, &len, nums, 600, &first);
+    if (record.data == NULL || record.len != len || memcmp(record.data, expected, len) != 0
+        || fmt_arena_pool_allocations() != allocations)
+        status = 0;
+    fmt_arena_free(&arena);
+    if(debug)
+        printf("\nReuse: %zu chunks allocated, Result: %d", fmt_arena_pool_allocations(), status);
+
+    return status;
+}
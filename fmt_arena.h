@@ -0,0 +1,161 @@
+#ifndef FMT_ARENA_
+#define FMT_ARENA_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file fmt_arena.h
+ * @brief Append only arena which the formatters write into directly
+ *
+ * Each append reserves the longest output of a conversion at the end of the
+ * arena and lets the conversion write there, so no buffer per conversion is
+ * needed and nothing is copied. An append gives a slice (pointer and length)
+ * which stays valid until the arena is reset.
+ *
+ * Appends between fmt_arena_begin() and fmt_arena_end() form a record, which
+ * is kept contiguous and ended with a '\0' : a log line built from several
+ * conversions is one slice. When the current chunk is full, the next one is
+ * twice as large, and an open record moves into it.
+ *
+ * Chunks come from a pool shared by all arenas and go back to it when an
+ * arena is freed. fmt_arena_reset() keeps the chunks and only rewinds, so an
+ * arena reset between records stops allocating once it has grown to the size
+ * of the largest record.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#define FMT_ARENA_CHUNK 4096    // Size of the first chunk of an arena
+#define FMT_ARENA_CLASSES 20    // Pooled chunk sizes, FMT_ARENA_CHUNK << 0 to 19
+
+typedef struct fmt_chunk fmt_chunk_t;
+
+typedef struct {
+    const char *data;
+    size_t len;
+} fmt_slice_t;
+
+typedef struct {
+    fmt_chunk_t *head;          // First chunk, where a reset arena starts
+    fmt_chunk_t *cur;           // Chunk being filled
+    size_t pos;                 // Bytes used in cur
+    size_t record;              // Start of the open record in cur
+    int in_record;
+    fmt_slice_t last;           // Result of the last append
+} fmt_arena_t;
+
+/**
+ *   @brief  Prepares an empty arena, no memory is taken until the first append
+ */
+void fmt_arena_init(fmt_arena_t *arena);
+
+/**
+ *   @brief  Gives the chunks of an arena back to the pool
+ */
+void fmt_arena_free(fmt_arena_t *arena);
+
+/**
+ *   @brief  Empties an arena and keeps its chunks, invalidating every slice
+ */
+void fmt_arena_reset(fmt_arena_t *arena);
+
+/**
+ *   @brief  Room for n characters at the end of the arena
+ *
+ *   Nothing is appended until fmt_arena_commit().
+ *
+ *   @param  arena : Arena
+ *   @param  n : Characters needed
+ *
+ *   @return char * : Where to write them, NULL if out of memory
+ */
+char *fmt_arena_reserve(fmt_arena_t *arena, size_t n);
+
+/**
+ *   @brief  Appends the first n characters written at the last reservation
+ */
+void fmt_arena_commit(fmt_arena_t *arena, size_t n);
+
+/**
+ *   @brief  Appends n characters copied from str
+ *
+ *   @return int : Characters appended, -1 if out of memory
+ */
+int fmt_arena_append(fmt_arena_t *arena, const char *str, size_t n);
+
+/**
+ *   @brief  Appends a number as uint_to_binstr(), int_to_binstr(),
+ *           uint_to_hexstr(), uint_to_decstr() or int_to_decstr() writes it
+ *
+ *   @param  arena : Arena
+ *   @param  num : Integer to be converted
+ *   @param  nbits : It is the number of bits of the input
+ *
+ *   @return int : Characters appended, -1 (and nothing appended) if the
+ *                 function rejects num or nbits, or out of memory
+ */
+int fmt_arena_binstr(fmt_arena_t *arena, uint32_t num, uint8_t nbits);
+int fmt_arena_int_binstr(fmt_arena_t *arena, int32_t num, uint8_t nbits);
+int fmt_arena_hexstr(fmt_arena_t *arena, uint32_t num, uint8_t nbits);
+int fmt_arena_decstr(fmt_arena_t *arena, uint32_t num, uint8_t nbits);
+int fmt_arena_int_decstr(fmt_arena_t *arena, int32_t num, uint8_t nbits);
+
+/**
+ *   @brief  Appends the hexdump() of nbytes at loc
+ *
+ *   @return int : Characters appended (0 for 0 bytes), -1 if out of memory
+ */
+int fmt_arena_hexdump(fmt_arena_t *arena, const void *loc, size_t nbytes);
+
+/**
+ *   @brief  Slice of the last successful append
+ */
+fmt_slice_t fmt_arena_last(const fmt_arena_t *arena);
+
+/**
+ *   @brief  Starts / ends a record, the appends in between as one slice
+ *           followed by a '\0' which is not counted in its length
+ *
+ *   @return fmt_slice_t : The record, data NULL if no record was open or out
+ *                         of memory
+ */
+void fmt_arena_begin(fmt_arena_t *arena);
+fmt_slice_t fmt_arena_end(fmt_arena_t *arena);
+
+/**
+ *   @brief  Bytes of chunks held by an arena / chunks allocated with malloc()
+ *           by the pool since the program started
+ */
+size_t fmt_arena_capacity(const fmt_arena_t *arena);
+size_t fmt_arena_pool_allocations(void);
+
+/**
+ *   @brief  Test function to test the fmt_arena_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every append matches the function writing into its own buffer
+ *   - Rejected values append nothing
+ *   - Records stay contiguous while the arena grows, slices stay valid
+ *   - Reset reuses the chunks, freed chunks are reused by the next arena
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_fmt_arena(int debug);
+
+#endif /* FMT_ARENA_ */
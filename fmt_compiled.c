@@ -0,0 +1,484 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file fmt_compiled.c
+ * @brief Format strings parsed once, then formatted with the binary, hex
+ *        and decimal kernels of the library
+ *
+ * A compiled format is the literal text, unescaped, and one field record
+ * per replacement field. Formatting copies the literals and calls the
+ * kernel of each field, with no parsing and, when the buffer holds
+ * fmt_max_size(), no bounds check per field.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bit_operations.h"
+#include "radix_pow2.h"
+#include "fmt_compiled.h"
+
+// Longest output of any compiled format
+#define FMT_MAX_OUTPUT (FMT_MAX_LITERAL + FMT_MAX_FIELDS * (255 + 2))
+
+
+/**
+ *   @brief  Parses a number of at most three digits, -1 if there is none
+ */
+static int parse_number(const char **p) {
+    int n = 0, digits = 0;
+
+    while (**p >= '0' && **p <= '9' && digits < 4) {
+        n = 10 * n + (**p - '0');
+        (*p)++;
+        digits++;
+    }
+    return (digits == 0 || digits > 3) ? -1 : n;
+}
+
+
+/**
+ *   @brief  Parses the inside of a replacement field, p after the '{'
+ *
+ *   @return int ( 0 = Success, -1 = Invalid field )
+ */
+static int parse_field(fmt_field_t *f, const char **p) {
+    int n;
+
+    f->conv = 'd';
+    if (**p == ':') {
+        (*p)++;
+        if (**p == '#') {
+            f->alt = 1;
+            (*p)++;
+        }
+        if (**p == '0') {
+            f->zero = 1;
+            (*p)++;
+        }
+        if (**p >= '1' && **p <= '9') {
+            n = parse_number(p);
+            if (n < 0 || n > FMT_MAX_WIDTH)
+                return -1;
+            f->width = (uint8_t)n;
+        }
+        if (**p == 'd' || **p == 'x' || **p == 'X' || **p == 'b') {
+            f->conv = **p;
+            (*p)++;
+        }
+        if (**p >= '0' && **p <= '9') {
+            n = parse_number(p);
+            if (n < 1 || n > 255 || f->conv == 'd' || f->width != 0 || f->zero)
+                return -1;
+            f->nbits = (uint8_t)n;
+        }
+    }
+    if (**p != '}' || (f->alt && f->conv == 'd'))
+        return -1;
+    (*p)++;
+
+    // Longest output : nbits digits, or every digit of 32 bits
+    if (f->nbits != 0)
+        n = (f->conv == 'b') ? f->nbits + 2 : f->nbits / 4 + 2;
+    else if (f->conv == 'd')
+        n = 11;
+    else
+        n = ((f->conv == 'b') ? 32 : 8) + (f->alt ? 2 : 0);
+    f->max_len = (uint16_t)(n > f->width ? n : f->width);
+    return 0;
+}
+
+
+/**
+ *   @brief  Parses and checks a format
+ *
+ *   @param  fmt : Destination of the compiled format
+ *   @param  format : Format, see the file description
+ *
+ *   @return int : Number of fields, -1 for an invalid format
+ */
+int fmt_compile(fmt_compiled_t *fmt, const char *format) {
+    const char *p = format;
+    fmt_field_t *f;
+    size_t t = 0;
+    int n = 0;
+
+    memset(fmt, 0, sizeof(*fmt));
+    if (format == NULL)
+        return -1;
+    f = &fmt->field[0];
+
+    while (*p != '\0') {
+        if ((p[0] == '{' && p[1] == '{') || (p[0] == '}' && p[1] == '}')) {
+            if (t == FMT_MAX_LITERAL)
+                return -1;
+            fmt->text[t++] = *p;
+            p += 2;
+            continue;
+        }
+        if (*p == '}')
+            return -1;
+        if (*p != '{') {
+            if (t == FMT_MAX_LITERAL)
+                return -1;
+            fmt->text[t++] = *p++;
+            continue;
+        }
+
+        // A field ends the literal text before it
+        p++;
+        if (n == FMT_MAX_FIELDS || parse_field(f, &p) < 0)
+            return -1;
+        f->literal_len = (uint16_t)(t - f->literal);
+        fmt->max_len += f->literal_len + f->max_len;
+        f = &fmt->field[++n];
+        f->literal = (uint16_t)t;
+    }
+
+    f->literal_len = (uint16_t)(t - f->literal);
+    fmt->max_len += f->literal_len;
+    fmt->nfields = n;
+    return n;
+}
+
+
+/**
+ *   @brief  Size of a buffer which holds any output of fmt, '\0' included
+ */
+size_t fmt_max_size(const fmt_compiled_t *fmt) {
+    return fmt->max_len + 1;
+}
+
+
+/**
+ *   @brief  Lower case hex digits, '0' - '9' are not changed by the bit
+ */
+static void to_lower(char *str, int len) {
+    int i;
+
+    for (i = 0; i < len; i++)
+        str[i] |= 0x20;
+}
+
+
+/**
+ *   @brief  Writes one field, room for its max_len and a '\0' at str
+ *
+ *   @return int : Characters written, -1 if its function rejects the value
+ */
+static int write_field(char *str, const fmt_field_t *f, fmt_arg_t arg) {
+    char dec[12];
+    uint32_t mag = arg.value;
+    int len, digits, body, pad, k = 0, neg = 0;
+
+    // Library strings, without their prefix unless '#'
+    if (f->nbits != 0) {
+        if (f->conv == 'b')
+            len = (arg.type == FMT_ARG_INT)
+                  ? int_to_binstr(str, (size_t)f->nbits + 3, (int32_t)arg.value, f->nbits)
+                  : uint_to_binstr(str, (size_t)f->nbits + 3, arg.value, f->nbits);
+        else
+            len = uint_to_hexstr(str, (size_t)f->nbits / 4 + 3, arg.value, f->nbits);
+        if (len < 2)
+            return -1;
+        if (!f->alt) {
+            len -= 2;
+            memmove(str, str + 2, (size_t)len);
+        }
+        if (f->conv == 'x')
+            to_lower(str + (f->alt ? 2 : 0), len - (f->alt ? 2 : 0));
+        return len;
+    }
+
+    if (f->conv == 'd') {
+        if (arg.type == FMT_ARG_INT && (int32_t)arg.value < 0) {
+            neg = 1;
+            mag = 0u - arg.value;
+        }
+        digits = uint_to_decstr(dec, sizeof(dec), mag, 32);
+    }
+    else
+        digits = radix_pow2_digits(mag, f->conv == 'b' ? 1 : 4);
+    if (digits < 1)
+        digits = 1;
+
+    body = neg + (f->alt ? 2 : 0) + digits;
+    pad = f->width > body ? f->width - body : 0;
+    if (!f->zero) {
+        memset(str, ' ', (size_t)pad);
+        k = pad;
+    }
+    if (neg)
+        str[k++] = '-';
+    if (f->alt) {
+        str[k++] = '0';
+        str[k++] = (f->conv == 'b') ? 'b' : (f->conv == 'X') ? 'X' : 'x';
+    }
+    if (f->zero) {
+        memset(str + k, '0', (size_t)pad);
+        k += pad;
+    }
+
+    if (f->conv == 'd')
+        memcpy(str + k, dec, (size_t)digits);
+    else if (f->conv == 'b')
+        radix_pow2_write_bin(str + k, mag, digits);
+    else {
+        radix_pow2_write_hex(str + k, mag, digits);
+        if (f->conv == 'x')
+            to_lower(str + k, digits);
+    }
+    return k + digits;
+}
+
+
+/**
+ *   @brief  Writes every literal and field, out holds max_len + 1
+ */
+static int render(const fmt_compiled_t *fmt, char *out, const fmt_arg_t *args) {
+    const fmt_field_t *f;
+    int i, k = 0, len;
+
+    for (i = 0; i <= fmt->nfields; i++) {
+        f = &fmt->field[i];
+        memcpy(out + k, fmt->text + f->literal, f->literal_len);
+        k += f->literal_len;
+        if (i == fmt->nfields)
+            break;
+        len = write_field(out + k, f, args[i]);
+        if (len < 0)
+            return -1;
+        k += len;
+    }
+    out[k] = '\0';
+    return k;
+}
+
+
+/**
+ *   @brief  Formats the arguments
+ *
+ *   A str of fmt_max_size() is written directly, a smaller one through a
+ *   buffer on the stack.
+ *
+ *   @param  fmt : Compiled format
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  args : Arguments, one per field
+ *   @param  nargs : Number of arguments
+ *
+ *   @return int : Length of the string, -1 if the arguments do not match the
+ *                 fields, a value is rejected by its nbits, or str is too small
+ *                 (str is then an empty string)
+ */
+int fmt_format(const fmt_compiled_t *fmt, char *str, size_t size,
+               const fmt_arg_t *args, size_t nargs) {
+    char tmp[FMT_MAX_OUTPUT + 1];
+    int i, len;
+
+    if (size <= 0)
+        return -1;
+    str[0] = '\0';
+    if (nargs != (size_t)fmt->nfields || (nargs > 0 && args == NULL))
+        return -1;
+    for (i = 0; i < fmt->nfields; i++) {
+        if (args[i].type != FMT_ARG_UINT && args[i].type != FMT_ARG_INT)
+            return -1;
+        if (args[i].type == FMT_ARG_INT && fmt->field[i].nbits != 0 && fmt->field[i].conv != 'b')
+            return -1;
+    }
+
+    if (size > fmt->max_len) {
+        len = render(fmt, str, args);
+        if (len < 0)
+            str[0] = '\0';
+        return len;
+    }
+
+    len = render(fmt, tmp, args);
+    if (len < 0 || (size_t)len + 1 > size)
+        return -1;
+    memcpy(str, tmp, (size_t)len + 1);
+    return len;
+}
+
+
+/**
+ *   @brief  Formats the arguments at the end of an arena
+ *
+ *   @return int : Characters appended, -1 (and nothing appended) as for
+ *                 fmt_format() or out of memory
+ */
+int fmt_format_arena(const fmt_compiled_t *fmt, fmt_arena_t *arena,
+                     const fmt_arg_t *args, size_t nargs) {
+    char *p = fmt_arena_reserve(arena, fmt_max_size(fmt));
+    int len;
+
+    if (p == NULL)
+        return -1;
+    len = fmt_format(fmt, p, fmt_max_size(fmt), args, nargs);
+    if (len >= 0)
+        fmt_arena_commit(arena, (size_t)len);
+    return len;
+}
+
+
+/**
+ *   @brief  Test function to test the fmt_compile() and fmt_format() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Fields against snprintf() and the library functions
+ *   - Widths, prefixes, padding, escaped braces
+ *   - Invalid formats, argument count and type mismatches
+ *   - Outputs never longer than fmt_max_size(), small buffers
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_fmt_compiled(int debug) {
+    const uint32_t values[] = { 0, 1, 9, 10, 255, 256, 0xBEEF, 0x12345678, 0x7FFFFFFF,
+                                0x80000000u, 0xFFFFFFFFu, (uint32_t)-42 };
+    const char *invalid[] = { "{", "}", "a}b", "{:q}", "{:#d}", "{:08b8}", "{:4x8}", "{:b0}",
+                              "{:b256}", "{:x1000}", "{:65x}", "{:d8}", "{0}", "{:x }",
+                              "{}{}{}{}{}{}{}{}{}{}{}{}{}{}{}{}{}" };
+    fmt_compiled_t fmt;
+    fmt_arena_t arena;
+    char str[512], expected[512], bin[40], small[16];
+    uint32_t u;
+    int32_t s;
+    size_t i, k;
+    int ret, len, b, status = 1;
+
+    if(debug)
+        printf("\n Test Results for compiled formats ");
+
+    // The report line of the file description
+    if (fmt_compile(&fmt, "reg={:#010x} flags={:#b8}") != 2 || fmt_max_size(&fmt) != 4 + 10 + 7 + 10 + 1)
+        status = 0;
+    ret = fmt_format(&fmt, str, sizeof(str), FMT_ARGS(FMT_ARG(0xBEEFu), FMT_ARG((uint8_t)0x5A)));
+    if (ret != 31 || strcmp(str, "reg=0x0000beef flags=0b01011010") != 0)
+        status = 0;
+    if(debug)
+        printf("\n%s, Length: %d, Result: %d", str, ret, status);
+
+    // Fields against snprintf()
+    if (fmt_compile(&fmt, "{} {:x} {:X} {:8x} {:08X} {:5} {:05} {{x}} {:d}") != 8)
+        status = 0;
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        u = values[i];
+        s = (int32_t)values[i];
+        ret = fmt_format(&fmt, str, sizeof(str), FMT_ARGS(FMT_ARG(u), FMT_ARG(u), FMT_ARG(u),
+                         FMT_ARG(u), FMT_ARG(u), FMT_ARG(s), FMT_ARG(s), FMT_ARG(s)));
+        len = snprintf(expected, sizeof(expected), "%u %x %X %8x %08X %5d %05d {x} %d",
+                       u, u, u, u, u, s, s, s);
+        if (ret != len || strcmp(str, expected) != 0 || (size_t)ret >= fmt_max_size(&fmt))
+            status = 0;
+    }
+
+    // Prefixes, where snprintf() differs for 0, and binary
+    if (fmt_compile(&fmt, "{:#x}|{:#12X}|{:b}|{:#036b}|{:x}") != 5)
+        status = 0;
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        u = values[i];
+        for (b = 31, k = 0; b >= 0; b--)
+            if (k > 0 || (u >> b) & 1 || b == 0)
+                bin[k++] = (char)('0' + ((u >> b) & 1));
+        bin[k] = '\0';
+        k = (size_t)snprintf(expected, sizeof(expected), "0x%x|", u);
+        snprintf(small, sizeof(small), "0X%X", u);
+        k += (size_t)snprintf(expected + k, sizeof(expected) - k, "%12s|%s|0b", small, bin);
+        memset(expected + k, '0', 34 - strlen(bin));
+        k += 34 - strlen(bin);
+        snprintf(expected + k, sizeof(expected) - k, "%s|%x", bin, (uint32_t)-1);
+        ret = fmt_format(&fmt, str, sizeof(str), FMT_ARGS(FMT_ARG(u), FMT_ARG(u), FMT_ARG(u),
+                         FMT_ARG(u), FMT_ARG((int)-1)));
+        if (ret != (int)strlen(expected) || strcmp(str, expected) != 0 || (size_t)ret >= fmt_max_size(&fmt))
+            status = 0;
+    }
+        if(debug)
+            printf("\n%s, Result: %d", str, status);
+
+    // nbits fields are the library strings, rejections included
+    if (fmt_compile(&fmt, "[{:#b8}] [{:b16}] [{:#x32}] [{:X8}]") != 4)
+        status = 0;
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        u = values[i];
+        k = 0;
+        expected[0] = '\0';
+        ret = uint_to_binstr(bin, sizeof(bin), u, 8);
+        len = ret;
+        if (ret >= 0)
+            k += (size_t)snprintf(expected + k, sizeof(expected) - k, "[%s] ", bin);
+        ret = int_to_binstr(bin, sizeof(bin), (int32_t)u, 16);
+        len = ret < 0 ? ret : len;
+        if (ret >= 0)
+            k += (size_t)snprintf(expected + k, sizeof(expected) - k, "[%s] ", bin + 2);
+        ret = uint_to_hexstr(bin, sizeof(bin), u, 32);
+        len = ret < 0 ? ret : len;
+        if (ret >= 0) {
+            to_lower(bin + 2, ret - 2);
+            k += (size_t)snprintf(expected + k, sizeof(expected) - k, "[%s] ", bin);
+        }
+        ret = uint_to_hexstr(bin, sizeof(bin), u, 8);
+        len = ret < 0 ? ret : len;
+        if (ret >= 0)
+            k += (size_t)snprintf(expected + k, sizeof(expected) - k, "[%s]", bin + 2);
+
+        ret = fmt_format(&fmt, str, sizeof(str), FMT_ARGS(FMT_ARG(u), FMT_ARG((int32_t)u),
+                         FMT_ARG(u), FMT_ARG(u)));
+        if ((len < 0) != (ret < 0) || (ret >= 0 && strcmp(str, expected) != 0)
+            || (ret < 0 && str[0] != '\0'))
+            status = 0;
+        if(debug)
+            printf("\n%#x : %s", u, ret < 0 ? "rejected" : str);
+    }
+
+    // Invalid formats and arguments
+    for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+        if (fmt_compile(&fmt, invalid[i]) != -1)
+            status = 0;
+    memset(expected, 'a', 300);
+    expected[300] = '\0';
+    if (fmt_compile(&fmt, expected) != -1 || fmt_compile(&fmt, NULL) != -1)
+        status = 0;
+    if (fmt_compile(&fmt, "no fields") != 0 || fmt_format(&fmt, str, sizeof(str), NULL, 0) != 9)
+        status = 0;
+    fmt_compile(&fmt, "{:x16} {}");
+    if (fmt_format(&fmt, str, sizeof(str), FMT_ARGS(FMT_ARG(5u))) != -1
+        || fmt_format(&fmt, str, sizeof(str), FMT_ARGS(FMT_ARG(5), FMT_ARG(5))) != -1
+        || fmt_format(&fmt, str, sizeof(str), FMT_ARGS(FMT_ARG(5u), FMT_ARG(5))) != 6)
+        status = 0;
+
+    // Buffers smaller than fmt_max_size()
+    if (fmt_format(&fmt, small, 6, FMT_ARGS(FMT_ARG(5u), FMT_ARG(5))) != -1 || small[0] != '\0'
+        || fmt_format(&fmt, str, 7, FMT_ARGS(FMT_ARG(5u), FMT_ARG(5))) != 6
+        || strcmp(str, "0005 5") != 0)
+        status = 0;
+
+    // Into an arena
+    fmt_arena_init(&arena);
+    if (fmt_format_arena(&fmt, &arena, FMT_ARGS(FMT_ARG(0xABu), FMT_ARG(-7))) != 7
+        || memcmp(fmt_arena_last(&arena).data, "00ab -7", 7) != 0
+        || fmt_format_arena(&fmt, &arena, FMT_ARGS(FMT_ARG(-1), FMT_ARG(1))) != -1
+        || arena.pos != 7)
+        status = 0;
+    fmt_arena_free(&arena);
+        if(debug)
+            printf("\nInvalid formats and arguments, Result: %d", status);
+
+    return status;
+}
@@ -0,0 +1,156 @@
+#ifndef FMT_COMPILED_
+#define FMT_COMPILED_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fmt_arena.h"
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file fmt_compiled.h
+ * @brief Format strings parsed once, then formatted with the binary, hex
+ *        and decimal kernels of the library
+ *
+ * A format is text with replacement fields, "{{" and "}}" for braces :
+ *   {}  or {:d}      decimal, '-' for a negative int
+ *   {:x} {:X} {:b}   hex (lower / upper case) or binary, no leading zeros,
+ *                    an int as its 32 bit two's complement
+ *   {:x32} {:b8}     nbits digits, exactly as uint_to_hexstr() and
+ *                    uint_to_binstr() / int_to_binstr() write them
+ * A field may start with '#' for the "0x" / "0b" prefix, and give a width
+ * after it, a leading '0' padding with zeros instead of spaces, e.g.
+ * "reg={:#010x} flags={:#b8}". The width counts the prefix and is not
+ * allowed with nbits.
+ *
+ * fmt_compile() checks the format and computes the longest output of every
+ * field, so a program compiles its formats once at start up and sizes its
+ * buffers with fmt_max_size(). Arguments are tagged uint32_t or int32_t by
+ * FMT_ARG() from their C type, and any other type does not compile. The tags
+ * are checked against the fields on each call : a missing argument or an int
+ * for a hex nbits field (uint_to_hexstr() has no signed form) returns -1.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#define FMT_MAX_FIELDS 16       // Replacement fields of one format
+#define FMT_MAX_LITERAL 256     // Characters outside the fields
+#define FMT_MAX_WIDTH 64
+
+typedef enum {
+    FMT_ARG_UINT,
+    FMT_ARG_INT
+} fmt_arg_type_t;
+
+typedef struct {
+    fmt_arg_type_t type;
+    uint32_t value;             // Bits of the int32_t for FMT_ARG_INT
+} fmt_arg_t;
+
+typedef struct {
+    uint16_t literal;           // Literal text before the field, offset in text
+    uint16_t literal_len;
+    char conv;                  // 'd', 'x', 'X', 'b', or 0 for the text after the last field
+    uint8_t alt;                // '#' given
+    uint8_t zero;               // '0' padding
+    uint8_t width;
+    uint8_t nbits;              // 0 unless given
+    uint16_t max_len;           // Longest output of the field
+} fmt_field_t;
+
+typedef struct {
+    char text[FMT_MAX_LITERAL];
+    fmt_field_t field[FMT_MAX_FIELDS + 1];
+    int nfields;
+    size_t max_len;             // Longest output, without the '\0'
+} fmt_compiled_t;
+
+static inline fmt_arg_t fmt_arg_uint(uint32_t value) {
+    fmt_arg_t arg = { FMT_ARG_UINT, value };
+
+    return arg;
+}
+
+static inline fmt_arg_t fmt_arg_int(int32_t value) {
+    fmt_arg_t arg = { FMT_ARG_INT, (uint32_t)value };
+
+    return arg;
+}
+
+// Argument tagged by its type, integers of 32 bits or less only
+#define FMT_ARG(x) _Generic((x), \
+    unsigned char: fmt_arg_uint, unsigned short: fmt_arg_uint, unsigned int: fmt_arg_uint, \
+    char: fmt_arg_int, signed char: fmt_arg_int, short: fmt_arg_int, int: fmt_arg_int)(x)
+
+// Argument list and count of fmt_format(), e.g. FMT_ARGS(FMT_ARG(reg), FMT_ARG(flags))
+#define FMT_ARGS(...) \
+    (const fmt_arg_t[]){ __VA_ARGS__ }, sizeof((const fmt_arg_t[]){ __VA_ARGS__ }) / sizeof(fmt_arg_t)
+
+/**
+ *   @brief  Parses and checks a format
+ *
+ *   @param  fmt : Destination of the compiled format
+ *   @param  format : Format, see the file description
+ *
+ *   @return int : Number of fields, -1 for an invalid format
+ */
+int fmt_compile(fmt_compiled_t *fmt, const char *format);
+
+/**
+ *   @brief  Size of a buffer which holds any output of fmt, '\0' included
+ */
+size_t fmt_max_size(const fmt_compiled_t *fmt);
+
+/**
+ *   @brief  Formats the arguments
+ *
+ *   @param  fmt : Compiled format
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  args : Arguments, one per field
+ *   @param  nargs : Number of arguments
+ *
+ *   @return int : Length of the string, -1 if the arguments do not match the
+ *                 fields, a value is rejected by its nbits, or str is too small
+ *                 (str is then an empty string)
+ */
+int fmt_format(const fmt_compiled_t *fmt, char *str, size_t size,
+               const fmt_arg_t *args, size_t nargs);
+
+/**
+ *   @brief  Formats the arguments at the end of an arena
+ *
+ *   @return int : Characters appended, -1 (and nothing appended) as for
+ *                 fmt_format() or out of memory
+ */
+int fmt_format_arena(const fmt_compiled_t *fmt, fmt_arena_t *arena,
+                     const fmt_arg_t *args, size_t nargs);
+
+/**
+ *   @brief  Test function to test the fmt_compile() and fmt_format() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Fields against snprintf() and the library functions
+ *   - Widths, prefixes, padding, escaped braces
+ *   - Invalid formats, argument count and type mismatches
+ *   - Outputs never longer than fmt_max_size(), small buffers
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_fmt_compiled(int debug);
+
+#endif /* FMT_COMPILED_ */
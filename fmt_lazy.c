@@ -0,0 +1,383 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file fmt_lazy.c
+ * @brief Deferred formatting : handles which keep a value and its format,
+ *        rendered only when a sink consumes them
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bit_operations.h"
+#include "fmt_lazy.h"
+
+
+/**
+ *   @brief  Hexdump handle of a copy of the bytes, made in arena
+ *
+ *   The copy lives until the arena is reset or freed. It must not be made
+ *   between fmt_arena_begin() and fmt_arena_end(), which may move the bytes.
+ *
+ *   @return lazy_fmt_t : The handle, LAZY_NONE if out of memory
+ */
+lazy_fmt_t lazy_hexdump_copy(fmt_arena_t *arena, const void *loc, size_t nbytes) {
+    lazy_fmt_t h = { LAZY_NONE, 0, 0, NULL, 0 };
+
+    if (nbytes > INT32_MAX || (loc == NULL && nbytes > 0))
+        return h;
+    if (fmt_arena_append(arena, (const char *)loc, nbytes) < 0)
+        return h;
+    return lazy_hexdump(fmt_arena_last(arena).data, nbytes);
+}
+
+
+/**
+ *   @brief  Longest string a handle renders to, without the '\0'
+ */
+size_t lazy_max_len(const lazy_fmt_t *h) {
+    size_t rows;
+
+    switch (h->kind) {
+    case LAZY_BINSTR:
+    case LAZY_INT_BINSTR:
+        return 2 + (size_t)h->nbits;
+    case LAZY_HEXSTR:
+        return 2 + ((size_t)h->nbits + 3) / 4;
+    case LAZY_DECSTR:
+    case LAZY_INT_DECSTR:
+        return 11;                                  // "-2147483648"
+    case LAZY_HEXDUMP:
+        if (h->nbytes == 0)
+            return 0;
+        rows = (h->nbytes + HEXDUMP_BYTES_PER_LINE - 1) / HEXDUMP_BYTES_PER_LINE;
+        return rows * (hexdump_line_length(hexdump_offset_digits(h->nbytes)) + 1) - 1;
+    default:
+        return 0;
+    }
+}
+
+
+/**
+ *   @brief  Renders a handle as its function would
+ *
+ *   @param  h : Handle
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *
+ *   @return int : Length of the string, -1 if the function rejects the value
+ *                 or str is too small (str is then an empty string)
+ */
+int lazy_render(const lazy_fmt_t *h, char *str, size_t size) {
+    char tmp[2 + UINT8_MAX + 1];                    // Longest binstr, 255 bits
+    size_t len;
+    int ret;
+
+    if (str == NULL || size == 0)
+        return -1;
+
+    // The conversions trust size to hold their string, so they write to tmp
+    switch (h->kind) {
+    case LAZY_BINSTR:
+        ret = uint_to_binstr(tmp, sizeof(tmp), h->value, h->nbits);
+        break;
+    case LAZY_INT_BINSTR:
+        ret = int_to_binstr(tmp, sizeof(tmp), (int32_t)h->value, h->nbits);
+        break;
+    case LAZY_HEXSTR:
+        ret = uint_to_hexstr(tmp, sizeof(tmp), h->value, h->nbits);
+        break;
+    case LAZY_DECSTR:
+        ret = uint_to_decstr(tmp, sizeof(tmp), h->value, h->nbits);
+        break;
+    case LAZY_INT_DECSTR:
+        ret = int_to_decstr(tmp, sizeof(tmp), (int32_t)h->value, h->nbits);
+        break;
+    case LAZY_HEXDUMP:
+        len = lazy_max_len(h);
+        if (len >= size || len > INT32_MAX || (h->loc == NULL && h->nbytes > 0)) {
+            str[0] = '\0';
+            return -1;
+        }
+        if (h->nbytes == 0) {
+            str[0] = '\0';
+            return 0;
+        }
+        hexdump(str, size, h->loc, h->nbytes);
+        return str[0] == '\0' ? -1 : (int)len;
+    default:
+        ret = -1;
+        break;
+    }
+
+    if (ret < 0 || (size_t)ret >= size) {
+        str[0] = '\0';
+        return -1;
+    }
+    memcpy(str, tmp, (size_t)ret + 1);
+    return ret;
+}
+
+
+/**
+ *   @brief  Renders a handle at the end of an arena
+ *
+ *   @return int : Characters appended, -1 (and nothing appended) if the
+ *                 function rejects the value or out of memory
+ */
+int lazy_render_arena(const lazy_fmt_t *h, fmt_arena_t *arena) {
+    switch (h->kind) {
+    case LAZY_BINSTR:
+        return fmt_arena_binstr(arena, h->value, h->nbits);
+    case LAZY_INT_BINSTR:
+        return fmt_arena_int_binstr(arena, (int32_t)h->value, h->nbits);
+    case LAZY_HEXSTR:
+        return fmt_arena_hexstr(arena, h->value, h->nbits);
+    case LAZY_DECSTR:
+        return fmt_arena_decstr(arena, h->value, h->nbits);
+    case LAZY_INT_DECSTR:
+        return fmt_arena_int_decstr(arena, (int32_t)h->value, h->nbits);
+    case LAZY_HEXDUMP:
+        if (h->loc == NULL && h->nbytes > 0)
+            return -1;
+        return fmt_arena_hexdump(arena, h->loc, h->nbytes);
+    default:
+        return -1;
+    }
+}
+
+
+/**
+ *   @brief  Prepares an empty queue
+ */
+void lazy_queue_init(lazy_queue_t *q) {
+    q->head = 0;
+    q->count = 0;
+    q->dropped = 0;
+}
+
+
+/**
+ *   @brief  Adds a labelled handle to a queue
+ *
+ *   @return int ( 0 = Success, -1 = Queue full, the entry is dropped )
+ */
+int lazy_queue_push(lazy_queue_t *q, const char *label, lazy_fmt_t handle) {
+    lazy_entry_t *e;
+
+    if (q->count == LAZY_QUEUE_SIZE) {
+        q->dropped++;
+        return -1;
+    }
+    e = &q->entry[(q->head + q->count) % LAZY_QUEUE_SIZE];
+    e->label = label;
+    e->handle = handle;
+    q->count++;
+    return 0;
+}
+
+
+/**
+ *   @brief  Empties a queue, writing one line "<label><string>" per kept
+ *           entry ("<label>" alone if its function rejects the value)
+ *
+ *   The lines are rendered in an arena reset between entries, so flushing
+ *   allocates only for the first entry, or a hexdump longer than before.
+ *
+ *   @param  q : Queue
+ *   @param  f : Sink, NULL to drop every entry
+ *   @param  every : Keeps every n-th entry, 1 for all of them
+ *
+ *   @return long : Entries rendered, -1 if writing failed
+ */
+long lazy_queue_flush(lazy_queue_t *q, FILE *f, size_t every) {
+    const lazy_entry_t *e;
+    fmt_arena_t arena;
+    fmt_slice_t line;
+    long rendered = 0;
+    int failed = 0;
+    size_t i;
+
+    if (every == 0)
+        every = 1;
+    fmt_arena_init(&arena);
+
+    for (i = 0; f != NULL && i < q->count; i += every) {
+        e = &q->entry[(q->head + i) % LAZY_QUEUE_SIZE];
+        fmt_arena_reset(&arena);
+        fmt_arena_begin(&arena);
+        if (e->label != NULL)
+            fmt_arena_append(&arena, e->label, strlen(e->label));
+        lazy_render_arena(&e->handle, &arena);
+        fmt_arena_append(&arena, "\n", 1);
+        line = fmt_arena_end(&arena);
+        if (line.data == NULL || fwrite(line.data, 1, line.len, f) != line.len)
+            failed = 1;
+        rendered++;
+    }
+
+    fmt_arena_free(&arena);
+    q->head = 0;
+    q->count = 0;
+    return failed ? -1 : rendered;
+}
+
+
+/**
+ *   @brief  Test function to test the lazy_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every handle renders as its function, rejected values included
+ *   - Referenced and copied hexdump bytes
+ *   - Queue flushed, sampled and dropped, full queue
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_fmt_lazy(int debug) {
+    const uint32_t values[] = { 0, 1, 5, 255, 0xBEEF, 0x12345678, 0x80000000u, 0xFFFFFFFFu,
+                                (uint32_t)-1000 };
+    static lazy_queue_t q;
+    char str[1024], expect[1024], lazy[1024];
+    uint8_t bytes[50];
+    fmt_arena_t arena;
+    fmt_slice_t s;
+    lazy_fmt_t h, copy;
+    FILE *f;
+    size_t i, n, len;
+    int nbits, ret, status = 1;
+
+    if(debug)
+        printf("\n Test Results for lazy formatting ");
+
+    fmt_arena_init(&arena);
+
+    // Each handle against its function, in a buffer and in an arena
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        for (nbits = 0; nbits <= 34; nbits++) {
+            const lazy_fmt_t handles[] = {
+                lazy_binstr(values[i], (uint8_t)nbits),
+                lazy_int_binstr((int32_t)values[i], (uint8_t)nbits),
+                lazy_hexstr(values[i], (uint8_t)nbits),
+                lazy_decstr(values[i], (uint8_t)nbits),
+                lazy_int_decstr((int32_t)values[i], (uint8_t)nbits)
+            };
+            const int rets[] = {
+                uint_to_binstr(str, sizeof(str), values[i], (uint8_t)nbits),
+                int_to_binstr(str + 64, sizeof(str) - 64, (int32_t)values[i], (uint8_t)nbits),
+                uint_to_hexstr(str + 128, sizeof(str) - 128, values[i], (uint8_t)nbits),
+                uint_to_decstr(str + 192, sizeof(str) - 192, values[i], (uint8_t)nbits),
+                int_to_decstr(str + 256, sizeof(str) - 256, (int32_t)values[i], (uint8_t)nbits)
+            };
+
+            for (n = 0; n < 5; n++) {
+                ret = lazy_render(&handles[n], lazy, sizeof(lazy));
+                if (ret != rets[n] || (ret < 0 ? lazy[0] != '\0'
+                                       : strcmp(lazy, str + 64 * n) != 0
+                                         || (size_t)ret > lazy_max_len(&handles[n])))
+                    status = 0;
+                ret = lazy_render_arena(&handles[n], &arena);
+                s = fmt_arena_last(&arena);
+                if (ret != rets[n] || (ret >= 0 && (s.len != (size_t)ret
+                                                    || memcmp(s.data, str + 64 * n, s.len) != 0)))
+                    status = 0;
+            }
+        }
+    }
+    h = lazy_hexstr(0xBEEF, 16);
+    if (lazy_render(&h, lazy, 6) != -1 || lazy[0] != '\0' || lazy_render(&h, lazy, 7) != 6)
+        status = 0;
+    if(debug)
+        printf("\nValues, %zu byte handles, Result: %d", sizeof(lazy_fmt_t), status);
+
+    // A referenced hexdump shows the bytes when rendered, a copy when made
+    for (i = 0; i < sizeof(bytes); i++)
+        bytes[i] = (uint8_t)(i * 37);
+    for (n = 0; n <= sizeof(bytes); n += 7) {
+        hexdump(expect, sizeof(expect), bytes, n);
+        h = lazy_hexdump(bytes, n);
+        len = lazy_max_len(&h);
+        ret = lazy_render(&h, lazy, sizeof(lazy));
+        if (ret != (int)strlen(expect) || len != strlen(expect) || strcmp(lazy, expect) != 0)
+            status = 0;
+        if (n > 0 && lazy_render(&h, lazy, len) != -1)
+            status = 0;
+    }
+    hexdump(expect, sizeof(expect), bytes, sizeof(bytes));
+    h = lazy_hexdump(bytes, sizeof(bytes));
+    copy = lazy_hexdump_copy(&arena, bytes, sizeof(bytes));
+    bytes[0] ^= 0xFF;
+    hexdump(str, sizeof(str), bytes, sizeof(bytes));
+    if (copy.kind != LAZY_HEXDUMP || lazy_render(&copy, lazy, sizeof(lazy)) < 0
+        || strcmp(lazy, expect) != 0)
+        status = 0;
+    if (lazy_render(&h, lazy, sizeof(lazy)) < 0 || strcmp(lazy, str) != 0)
+        status = 0;
+    h = lazy_hexdump(NULL, 4);
+    if (lazy_render(&h, lazy, sizeof(lazy)) != -1 || lazy_render_arena(&h, &arena) != -1)
+        status = 0;
+    if(debug)
+        printf("\nHexdumps, Result: %d", status);
+
+    // Queue : all entries, every 10th, none, and the overflow
+    f = tmpfile();
+    if (f == NULL)
+        status = 0;
+    lazy_queue_init(&q);
+    for (i = 0; i < LAZY_QUEUE_SIZE; i++)
+        if (lazy_queue_push(&q, "v=", lazy_binstr((uint32_t)i, 12)) != 0)
+            status = 0;
+    if (lazy_queue_push(&q, "v=", lazy_binstr(0, 12)) != -1 || q.dropped != 1)
+        status = 0;
+    if (f != NULL) {
+        if (lazy_queue_flush(&q, f, 1) != LAZY_QUEUE_SIZE || q.count != 0)
+            status = 0;
+        lazy_queue_push(&q, "dump\n", copy);
+        lazy_queue_push(&q, "bad ", lazy_hexstr(0x100, 8));
+        if (lazy_queue_flush(&q, f, 1) != 2)
+            status = 0;
+        rewind(f);
+        for (i = 0; i < LAZY_QUEUE_SIZE; i++) {
+            uint_to_binstr(str, sizeof(str), (uint32_t)i, 12);
+            if (fgets(lazy, sizeof(lazy), f) == NULL || strncmp(lazy, "v=", 2) != 0
+                || strncmp(lazy + 2, str, strlen(str)) != 0)
+                status = 0;
+        }
+        len = fread(lazy, 1, sizeof(lazy) - 1, f);
+        lazy[len] = '\0';
+        snprintf(str, sizeof(str), "dump\n%s\nbad \n", expect);
+        if (strcmp(lazy, str) != 0)
+            status = 0;
+        fclose(f);
+    }
+    for (i = 0; i < 100; i++)
+        lazy_queue_push(&q, NULL, lazy_decstr((uint32_t)i, 32));
+    f = tmpfile();
+    if (f == NULL || lazy_queue_flush(&q, f, 10) != 10 || ftell(f) != 2 + 9 * 3)
+        status = 0;
+    if (f != NULL)
+        fclose(f);
+    for (i = 0; i < 100; i++)
+        lazy_queue_push(&q, NULL, lazy_decstr((uint32_t)i, 32));
+    if (lazy_queue_flush(&q, NULL, 1) != 0 || q.count != 0)
+        status = 0;
+    if(debug)
+        printf("\nQueue, Result: %d", status);
+
+    fmt_arena_free(&arena);
+    return status;
+}
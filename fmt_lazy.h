@@ -0,0 +1,182 @@
+#ifndef FMT_LAZY_
+#define FMT_LAZY_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "fmt_arena.h"
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file fmt_lazy.h
+ * @brief Deferred formatting : handles which keep a value and its format,
+ *        rendered only when a sink consumes them
+ *
+ * A handle is the raw value and nbits of a conversion, or the address and
+ * length of a hexdump, so making one is a few stores (the lazy_*()
+ * functions are inline). It renders into exactly the string the library
+ * function would have written.
+ *
+ * A hexdump handle refers to the caller's memory, which must then stay
+ * unchanged until the handle is rendered. lazy_hexdump_copy() copies the
+ * bytes into an arena instead, for memory about to be reused.
+ *
+ * lazy_queue_t holds labelled handles for a log sink : pushing copies the
+ * handle, and lazy_queue_flush() renders what is kept (every n-th entry when
+ * sampling) and drops the rest without formatting it.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#define LAZY_QUEUE_SIZE 256     // Entries of a queue
+
+typedef enum {
+    LAZY_NONE,                  // Failed copy, renders as an error
+    LAZY_BINSTR,
+    LAZY_INT_BINSTR,
+    LAZY_HEXSTR,
+    LAZY_DECSTR,
+    LAZY_INT_DECSTR,
+    LAZY_HEXDUMP
+} lazy_kind_t;
+
+typedef struct {
+    uint8_t kind;
+    uint8_t nbits;
+    uint32_t value;             // Bits of the int32_t for the signed kinds
+    const void *loc;            // Hexdump bytes
+    size_t nbytes;
+} lazy_fmt_t;
+
+static inline lazy_fmt_t lazy_value(lazy_kind_t kind, uint32_t value, uint8_t nbits) {
+    lazy_fmt_t h = { (uint8_t)kind, nbits, value, NULL, 0 };
+
+    return h;
+}
+
+/**
+ *   @brief  Handles of uint_to_binstr(), int_to_binstr(), uint_to_hexstr(),
+ *           uint_to_decstr(), int_to_decstr() and hexdump()
+ */
+static inline lazy_fmt_t lazy_binstr(uint32_t num, uint8_t nbits) {
+    return lazy_value(LAZY_BINSTR, num, nbits);
+}
+
+static inline lazy_fmt_t lazy_int_binstr(int32_t num, uint8_t nbits) {
+    return lazy_value(LAZY_INT_BINSTR, (uint32_t)num, nbits);
+}
+
+static inline lazy_fmt_t lazy_hexstr(uint32_t num, uint8_t nbits) {
+    return lazy_value(LAZY_HEXSTR, num, nbits);
+}
+
+static inline lazy_fmt_t lazy_decstr(uint32_t num, uint8_t nbits) {
+    return lazy_value(LAZY_DECSTR, num, nbits);
+}
+
+static inline lazy_fmt_t lazy_int_decstr(int32_t num, uint8_t nbits) {
+    return lazy_value(LAZY_INT_DECSTR, (uint32_t)num, nbits);
+}
+
+static inline lazy_fmt_t lazy_hexdump(const void *loc, size_t nbytes) {
+    lazy_fmt_t h = { LAZY_HEXDUMP, 0, 0, loc, nbytes };
+
+    return h;
+}
+
+/**
+ *   @brief  Hexdump handle of a copy of the bytes, made in arena
+ *
+ *   @return lazy_fmt_t : The handle, LAZY_NONE if out of memory
+ */
+lazy_fmt_t lazy_hexdump_copy(fmt_arena_t *arena, const void *loc, size_t nbytes);
+
+/**
+ *   @brief  Longest string a handle renders to, without the '\0'
+ */
+size_t lazy_max_len(const lazy_fmt_t *h);
+
+/**
+ *   @brief  Renders a handle as its function would
+ *
+ *   @param  h : Handle
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *
+ *   @return int : Length of the string, -1 if the function rejects the value
+ *                 or str is too small (str is then an empty string)
+ */
+int lazy_render(const lazy_fmt_t *h, char *str, size_t size);
+
+/**
+ *   @brief  Renders a handle at the end of an arena
+ *
+ *   @return int : Characters appended, -1 (and nothing appended) if the
+ *                 function rejects the value or out of memory
+ */
+int lazy_render_arena(const lazy_fmt_t *h, fmt_arena_t *arena);
+
+typedef struct {
+    const char *label;          // Text before the rendered handle, not copied
+    lazy_fmt_t handle;
+} lazy_entry_t;
+
+typedef struct {
+    lazy_entry_t entry[LAZY_QUEUE_SIZE];
+    size_t head;                // Oldest entry
+    size_t count;
+    uint64_t dropped;           // Pushes refused as the queue was full
+} lazy_queue_t;
+
+/**
+ *   @brief  Prepares an empty queue
+ */
+void lazy_queue_init(lazy_queue_t *q);
+
+/**
+ *   @brief  Adds a labelled handle to a queue
+ *
+ *   @return int ( 0 = Success, -1 = Queue full, the entry is dropped )
+ */
+int lazy_queue_push(lazy_queue_t *q, const char *label, lazy_fmt_t handle);
+
+/**
+ *   @brief  Empties a queue, writing one line "<label><string>" per kept
+ *           entry ("<label>" alone if its function rejects the value)
+ *
+ *   @param  q : Queue
+ *   @param  f : Sink, NULL to drop every entry
+ *   @param  every : Keeps every n-th entry, 1 for all of them
+ *
+ *   @return long : Entries rendered, -1 if writing failed
+ */
+long lazy_queue_flush(lazy_queue_t *q, FILE *f, size_t every);
+
+/**
+ *   @brief  Test function to test the lazy_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every handle renders as its function, rejected values included
+ *   - Referenced and copied hexdump bytes
+ *   - Queue flushed, sampled and dropped, full queue
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_fmt_lazy(int debug);
+
+#endif /* FMT_LAZY_ */
@@ -0,0 +1,840 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_file.c
+ * @brief Pipelined hexdump of whole files
+ *
+ * The file is cut in chunks of HEXDUMP_FILE_CHUNK bytes which are formatted
+ * in order through one hexdump_ctx_t, so the text is the same whichever
+ * pipeline produced it.
+ *
+ * - Sync    : read, format and write one chunk after the other
+ * - Threads : a reader thread fills two input buffers and a writer thread
+ *             drains two output buffers while the caller's thread formats
+ * - io_uring: four slots of registered input/output buffers; reads for the
+ *             next chunks and the write of the previous chunk are in flight
+ *             while a chunk is formatted. Writes are issued one at a time so
+ *             the text stays in order on pipes.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+
+#include "bit_operations.h"
+#include "hexdump_stream.h"
+#include "hexdump_file.h"
+
+// Longest line hexdump_ctx_feed() writes : 16 offset digits and a '\n'
+#define HEXDUMP_FILE_LINE_MAX (2 + 16 + 2 + 3 * HEXDUMP_BYTES_PER_LINE + 1)
+
+// Text of one chunk, plus the short last line and the '\0'
+#define HEXDUMP_FILE_OUT \
+    ((HEXDUMP_FILE_CHUNK / HEXDUMP_BYTES_PER_LINE + 1) * HEXDUMP_FILE_LINE_MAX + 1)
+
+
+// ************************ Helper Functions  ************************************
+
+/**
+ *   @brief  Bytes left to read from a regular file, so the offset column is
+ *           sized as hexdump() sizes it
+ *
+ *   @return uint64_t : Bytes from the file position to the end, 0 if unknown
+ *                      (pipe, socket ...)
+ */
+static uint64_t bytes_left(int fd) {
+    struct stat st;
+    off_t pos;
+
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+        return 0;
+    pos = lseek(fd, 0, SEEK_CUR);
+    if (pos < 0 || pos > st.st_size)
+        return 0;
+    return (uint64_t)(st.st_size - pos);
+}
+
+/**
+ *   @brief  Reads until len bytes were read or the end of the file
+ *
+ *   @return long : Bytes read, -1 on error
+ */
+static long read_full(int fd, char *buf, size_t len) {
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < len) {
+        n = read(fd, buf + done, len - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            break;
+        done += (size_t)n;
+    }
+    return (long)done;
+}
+
+/**
+ *   @brief  Writes all len bytes
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+static int write_full(int fd, const char *buf, size_t len) {
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < len) {
+        n = write(fd, buf + done, len - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ *   @brief  Formats one chunk, the last chunk also gets the short last line
+ *
+ *   @return size_t : Characters written to out
+ */
+static size_t format_chunk(hexdump_ctx_t *ctx, const char *in, size_t n,
+                           char *out, int last) {
+    size_t consumed;
+    int k, tail;
+
+    k = hexdump_ctx_feed(ctx, out, HEXDUMP_FILE_OUT, in, n, &consumed);
+    if (k < 0)
+        k = 0;
+    if (last) {
+        tail = hexdump_ctx_finish(ctx, out + k, HEXDUMP_FILE_OUT - (size_t)k);
+        if (tail > 0)
+            k += tail;
+    }
+    return (size_t)k;
+}
+
+
+// ************************ Synchronous  ************************************
+
+static int dump_sync(int in_fd, int out_fd) {
+    char *in = malloc(HEXDUMP_FILE_CHUNK);
+    char *out = malloc(HEXDUMP_FILE_OUT);
+    hexdump_ctx_t ctx;
+    long n;
+    int ret = HEXDUMP_FILE_SYNC;
+
+    if (in == NULL || out == NULL)
+        ret = -1;
+
+    hexdump_ctx_init(&ctx, 0, bytes_left(in_fd), 0);
+    while (ret >= 0) {
+        n = read_full(in_fd, in, HEXDUMP_FILE_CHUNK);
+        if (n < 0) {
+            ret = -1;
+            break;
+        }
+        if (write_full(out_fd, out, format_chunk(&ctx, in, (size_t)n, out,
+                                                 n < HEXDUMP_FILE_CHUNK)) < 0)
+            ret = -1;
+        if (n < HEXDUMP_FILE_CHUNK)
+            break;
+    }
+
+    free(in);
+    free(out);
+    return ret;
+}
+
+
+// ************************ Threads  ************************************
+
+// Two buffers handed from a producer to a consumer thread
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    char *buf[2];
+    size_t len[2];
+    unsigned head;      // Buffers filled by the producer
+    unsigned tail;      // Buffers drained by the consumer
+    int done;           // Producer has published its last buffer
+    int error;          // Either side failed, everyone stops
+} double_buffer_t;
+
+typedef struct {
+    double_buffer_t *in;
+    double_buffer_t *out;
+    int fd;
+} pipeline_thread_t;
+
+static void double_buffer_free(double_buffer_t *db) {
+    free(db->buf[0]);
+    free(db->buf[1]);
+    pthread_mutex_destroy(&db->lock);
+    pthread_cond_destroy(&db->cond);
+}
+
+/**
+ *   @brief  Returns 0, or -1 with nothing left to free
+ */
+static int double_buffer_init(double_buffer_t *db, size_t size) {
+    memset(db, 0, sizeof(*db));
+    pthread_mutex_init(&db->lock, NULL);
+    pthread_cond_init(&db->cond, NULL);
+    db->buf[0] = malloc(size);
+    db->buf[1] = malloc(size);
+    if (db->buf[0] == NULL || db->buf[1] == NULL) {
+        double_buffer_free(db);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ *   @brief  Waits for an empty buffer, returns its index or -1 on error
+ */
+static int double_buffer_empty(double_buffer_t *db) {
+    int slot;
+
+    pthread_mutex_lock(&db->lock);
+    while (db->head - db->tail == 2 && !db->error)
+        pthread_cond_wait(&db->cond, &db->lock);
+    slot = db->error ? -1 : (int)(db->head % 2);
+    pthread_mutex_unlock(&db->lock);
+    return slot;
+}
+
+/**
+ *   @brief  Waits for a filled buffer, returns its index or -1 once the
+ *           producer is done or on error
+ */
+static int double_buffer_full(double_buffer_t *db) {
+    int slot;
+
+    pthread_mutex_lock(&db->lock);
+    while (db->head == db->tail && !db->done && !db->error)
+        pthread_cond_wait(&db->cond, &db->lock);
+    slot = (db->error || db->head == db->tail) ? -1 : (int)(db->tail % 2);
+    pthread_mutex_unlock(&db->lock);
+    return slot;
+}
+
+static void double_buffer_signal(double_buffer_t *db, unsigned *counter,
+                                 int *flag) {
+    pthread_mutex_lock(&db->lock);
+    if (counter != NULL)
+        (*counter)++;
+    if (flag != NULL)
+        *flag = 1;
+    pthread_cond_broadcast(&db->cond);
+    pthread_mutex_unlock(&db->lock);
+}
+
+static void *reader_thread(void *arg) {
+    pipeline_thread_t *t = arg;
+    long n;
+    int slot;
+
+    while ((slot = double_buffer_empty(t->in)) >= 0) {
+        n = read_full(t->fd, t->in->buf[slot], HEXDUMP_FILE_CHUNK);
+        if (n < 0) {
+            double_buffer_signal(t->in, NULL, &t->in->error);
+            break;
+        }
+        t->in->len[slot] = (size_t)n;
+        double_buffer_signal(t->in, &t->in->head, NULL);
+        if (n < HEXDUMP_FILE_CHUNK)
+            break;
+    }
+    double_buffer_signal(t->in, NULL, &t->in->done);
+    return NULL;
+}
+
+static void *writer_thread(void *arg) {
+    pipeline_thread_t *t = arg;
+    int slot;
+
+    while ((slot = double_buffer_full(t->out)) >= 0) {
+        if (write_full(t->fd, t->out->buf[slot], t->out->len[slot]) < 0) {
+            double_buffer_signal(t->out, NULL, &t->out->error);
+            break;
+        }
+        double_buffer_signal(t->out, &t->out->tail, NULL);
+    }
+    return NULL;
+}
+
+static int dump_threads(int in_fd, int out_fd) {
+    double_buffer_t in, out;
+    pipeline_thread_t reader = { &in, &out, in_fd };
+    pipeline_thread_t writer = { &in, &out, out_fd };
+    pthread_t reader_id, writer_id;
+    hexdump_ctx_t ctx;
+    int s, o, last = 0, ret = HEXDUMP_FILE_THREADS;
+
+    if (double_buffer_init(&in, HEXDUMP_FILE_CHUNK) < 0)
+        return -1;
+    if (double_buffer_init(&out, HEXDUMP_FILE_OUT) < 0) {
+        double_buffer_free(&in);
+        return -1;
+    }
+
+    // The writer first : if either thread can't start nothing was read yet,
+    // so the caller can still dump synchronously
+    if (pthread_create(&writer_id, NULL, writer_thread, &writer) != 0) {
+        ret = -2;
+    } else if (pthread_create(&reader_id, NULL, reader_thread, &reader) != 0) {
+        double_buffer_signal(&out, NULL, &out.error);
+        pthread_join(writer_id, NULL);
+        ret = -2;
+    }
+    if (ret == -2) {
+        double_buffer_free(&in);
+        double_buffer_free(&out);
+        return -2;
+    }
+
+    hexdump_ctx_init(&ctx, 0, bytes_left(in_fd), 0);
+    while (!last && (s = double_buffer_full(&in)) >= 0) {
+        last = in.len[s] < HEXDUMP_FILE_CHUNK;
+        o = double_buffer_empty(&out);
+        if (o < 0)
+            break;
+        out.len[o] = format_chunk(&ctx, in.buf[s], in.len[s], out.buf[o], last);
+        double_buffer_signal(&in, &in.tail, NULL);
+        double_buffer_signal(&out, &out.head, NULL);
+    }
+
+    // Stop the reader if the writer failed, let the writer drain otherwise
+    if (!last)
+        double_buffer_signal(&in, NULL, &in.error);
+    double_buffer_signal(&out, NULL, &out.done);
+    pthread_join(reader_id, NULL);
+    pthread_join(writer_id, NULL);
+
+    if (in.error || out.error || !last)
+        ret = -1;
+
+    double_buffer_free(&in);
+    double_buffer_free(&out);
+    return ret;
+}
+
+
+// ************************ io_uring  ************************************
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+
+#define URING_SLOTS 4
+#define URING_WRITE_FLAG 0x100
+
+enum { SLOT_FREE, SLOT_READING, SLOT_READ, SLOT_FORMATTED, SLOT_WRITING };
+
+typedef struct {
+    int fd;
+    unsigned entries;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+    unsigned to_submit;
+} uring_t;
+
+typedef struct {
+    int state;
+    uint64_t seq;           // Chunk number
+    size_t want;            // Bytes of the chunk
+    size_t got;             // Bytes read so far
+    size_t out_len;         // Characters of formatted text
+    size_t written;         // Characters written so far
+    char *in;
+    char *out;
+} uring_slot_t;
+
+static void uring_free(uring_t *ring) {
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != NULL && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sq_ring != NULL && ring->sq_ring != MAP_FAILED)
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    if (ring->fd >= 0)
+        close(ring->fd);
+}
+
+static int uring_init(uring_t *ring, unsigned entries) {
+    struct io_uring_params p;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&p, 0, sizeof(p));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd < 0)
+        return -1;
+
+    ring->entries = p.sq_entries;
+    ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+            ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED)
+        return -1;
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        ring->cq_ring = ring->sq_ring;
+    else
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED)
+        return -1;
+
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+        return -1;
+
+    ring->sq_head = (unsigned *)((char *)ring->sq_ring + p.sq_off.head);
+    ring->sq_tail = (unsigned *)((char *)ring->sq_ring + p.sq_off.tail);
+    ring->sq_mask = (unsigned *)((char *)ring->sq_ring + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)((char *)ring->sq_ring + p.sq_off.array);
+    ring->cq_head = (unsigned *)((char *)ring->cq_ring + p.cq_off.head);
+    ring->cq_tail = (unsigned *)((char *)ring->cq_ring + p.cq_off.tail);
+    ring->cq_mask = (unsigned *)((char *)ring->cq_ring + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ring + p.cq_off.cqes);
+    return 0;
+}
+
+/**
+ *   @brief  Queues one read or write, submitted by the next uring_enter()
+ */
+static void uring_queue(uring_t *ring, int opcode, int fd, void *buf,
+                        size_t len, uint64_t offset, int buf_index,
+                        uint64_t user_data) {
+    unsigned tail = *ring->sq_tail;
+    unsigned idx = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (uint8_t)opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = (uint32_t)len;
+    sqe->off = offset;
+    sqe->buf_index = (uint16_t)(buf_index < 0 ? 0 : buf_index);
+    sqe->user_data = user_data;
+
+    ring->sq_array[idx] = idx;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+}
+
+static int uring_enter(uring_t *ring, unsigned wait) {
+    int ret;
+
+    do {
+        ret = (int)syscall(__NR_io_uring_enter, ring->fd, ring->to_submit, wait,
+                           wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0)
+        return -1;
+    ring->to_submit -= (unsigned)ret;
+    return 0;
+}
+
+static int dump_uring(int in_fd, int out_fd) {
+    uring_t ring;
+    uring_slot_t slots[URING_SLOTS];
+    struct iovec iov[2 * URING_SLOTS];
+    struct io_uring_cqe *cqe;
+    struct stat st;
+    hexdump_ctx_t ctx;
+    uint64_t nchunks, next_read = 0, next_format = 0, next_write = 0;
+    unsigned head, inflight = 0;
+    int fixed, i, s, writing = 0, ret = HEXDUMP_FILE_URING;
+
+    // Chunks are read at their file offset, so the size must be known
+    if (fstat(in_fd, &st) < 0 || !S_ISREG(st.st_mode))
+        return -2;
+    if (uring_init(&ring, 2 * URING_SLOTS) < 0) {
+        uring_free(&ring);
+        return -2;
+    }
+
+    memset(slots, 0, sizeof(slots));
+    for (i = 0; i < URING_SLOTS; i++) {
+        slots[i].in = malloc(HEXDUMP_FILE_CHUNK);
+        slots[i].out = malloc(HEXDUMP_FILE_OUT);
+        if (slots[i].in == NULL || slots[i].out == NULL)
+            ret = -1;
+        iov[i].iov_base = slots[i].in;
+        iov[i].iov_len = HEXDUMP_FILE_CHUNK;
+        iov[URING_SLOTS + i].iov_base = slots[i].out;
+        iov[URING_SLOTS + i].iov_len = HEXDUMP_FILE_OUT;
+    }
+
+    // Registered buffers are pinned once instead of on every request;
+    // without them (e.g. memlock limit) plain reads and writes are used
+    fixed = ret >= 0 && syscall(__NR_io_uring_register, ring.fd,
+                                IORING_REGISTER_BUFFERS, iov, 2 * URING_SLOTS) == 0;
+
+    nchunks = ((uint64_t)st.st_size + HEXDUMP_FILE_CHUNK - 1) / HEXDUMP_FILE_CHUNK;
+    hexdump_ctx_init(&ctx, 0, (uint64_t)st.st_size, 0);
+
+    while (ret >= 0 && next_write < nchunks) {
+        // Start reading chunks into free slots
+        while (next_read < nchunks && next_read < next_write + URING_SLOTS) {
+            uring_slot_t *slot = &slots[next_read % URING_SLOTS];
+            uint64_t offset = next_read * HEXDUMP_FILE_CHUNK;
+
+            slot->state = SLOT_READING;
+            slot->seq = next_read;
+            slot->want = (uint64_t)st.st_size - offset < HEXDUMP_FILE_CHUNK
+                         ? (size_t)((uint64_t)st.st_size - offset) : HEXDUMP_FILE_CHUNK;
+            slot->got = 0;
+            uring_queue(&ring, fixed ? IORING_OP_READ_FIXED : IORING_OP_READ, in_fd,
+                        slot->in, slot->want, offset,
+                        fixed ? (int)(next_read % URING_SLOTS) : -1,
+                        next_read % URING_SLOTS);
+            inflight++;
+            next_read++;
+        }
+
+        // Format every chunk which is read, in file order
+        while (next_format < next_read
+               && slots[next_format % URING_SLOTS].state == SLOT_READ) {
+            uring_slot_t *slot = &slots[next_format % URING_SLOTS];
+
+            slot->out_len = format_chunk(&ctx, slot->in, slot->got, slot->out,
+                                         next_format == nchunks - 1);
+            slot->written = 0;
+            slot->state = SLOT_FORMATTED;
+            next_format++;
+        }
+
+        // One write in flight at a time keeps the text in order
+        s = (int)(next_write % URING_SLOTS);
+        if (!writing && slots[s].state == SLOT_FORMATTED) {
+            slots[s].state = SLOT_WRITING;
+            uring_queue(&ring, fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE, out_fd,
+                        slots[s].out, slots[s].out_len, (uint64_t)-1,
+                        fixed ? URING_SLOTS + s : -1, (uint64_t)s | URING_WRITE_FLAG);
+            inflight++;
+            writing = 1;
+        }
+
+        if (inflight == 0)
+            break;
+        if (uring_enter(&ring, 1) < 0) {
+            ret = -1;
+            break;
+        }
+
+        head = *ring.cq_head;
+        while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+            cqe = &ring.cqes[head & *ring.cq_mask];
+            s = (int)(cqe->user_data & (URING_WRITE_FLAG - 1));
+            inflight--;
+
+            if (cqe->res <= 0) {
+                ret = -1;
+            }
+            else if (cqe->user_data & URING_WRITE_FLAG) {
+                slots[s].written += (size_t)cqe->res;
+                if (slots[s].written < slots[s].out_len) {
+                    // Short write, send the rest
+                    uring_queue(&ring, IORING_OP_WRITE, out_fd,
+                                slots[s].out + slots[s].written,
+                                slots[s].out_len - slots[s].written,
+                                (uint64_t)-1, -1, cqe->user_data);
+                    inflight++;
+                }
+                else {
+                    slots[s].state = SLOT_FREE;
+                    writing = 0;
+                    next_write++;
+                }
+            }
+            else {
+                slots[s].got += (size_t)cqe->res;
+                if (slots[s].got < slots[s].want) {
+                    // Short read, read the rest
+                    uring_queue(&ring, IORING_OP_READ, in_fd,
+                                slots[s].in + slots[s].got,
+                                slots[s].want - slots[s].got,
+                                slots[s].seq * HEXDUMP_FILE_CHUNK + slots[s].got,
+                                -1, cqe->user_data);
+                    inflight++;
+                }
+                else {
+                    slots[s].state = SLOT_READ;
+                }
+            }
+            head++;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    // Reap whatever is still in flight before the buffers go away
+    while (inflight > 0 && uring_enter(&ring, 1) == 0) {
+        head = *ring.cq_head;
+        while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+            inflight--;
+            head++;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    uring_free(&ring);
+    for (i = 0; i < URING_SLOTS; i++) {
+        free(slots[i].in);
+        free(slots[i].out);
+    }
+    return ret;
+}
+
+#else
+
+static int dump_uring(int in_fd, int out_fd) {
+    (void)in_fd;
+    (void)out_fd;
+    return -2;
+}
+
+#endif
+
+
+/**
+ *   @brief  Writes the hexdump of everything readable from in_fd to out_fd
+ *
+ *   The text is the same as hexdump_ctx_feed() produces for the whole input,
+ *   every line ending with '\n'. A mode which is not available falls back to
+ *   the next simpler one.
+ *
+ *   @param  in_fd : File to be dumped
+ *   @param  out_fd : Where the text is written
+ *   @param  mode : Pipeline to use
+ *
+ *   @return int : Mode which was used, -1 on a read or write error
+ */
+int hexdump_file(int in_fd, int out_fd, hexdump_file_mode_t mode) {
+    int ret;
+
+    if (in_fd < 0 || out_fd < 0)
+        return -1;
+
+    if (mode == HEXDUMP_FILE_URING || mode == HEXDUMP_FILE_AUTO) {
+        // -2 : io_uring unavailable or the input is not a regular file
+        ret = dump_uring(in_fd, out_fd);
+        if (ret != -2)
+            return ret;
+        mode = HEXDUMP_FILE_THREADS;
+    }
+
+    if (mode == HEXDUMP_FILE_THREADS) {
+        // -2 : the threads could not be started
+        ret = dump_threads(in_fd, out_fd);
+        if (ret != -2)
+            return ret;
+    }
+
+    return dump_sync(in_fd, out_fd);
+}
+
+
+/**
+ *   @brief  Dumps the file at path to the standard output
+ *
+ *   @param  path : File to be dumped
+ *   @param  mode : Pipeline to use
+ *
+ *   @return int : Mode which was used, -1 on failure
+ */
+int hexdump_file_path(const char *path, hexdump_file_mode_t mode) {
+    int fd = open(path, O_RDONLY);
+    int ret;
+
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    ret = hexdump_file(fd, STDOUT_FILENO, mode);
+    close(fd);
+    return ret;
+}
+
+
+/**
+ *   @brief  Dumps the file at path to /dev/null with every mode and prints
+ *           the throughput of each in MB/s
+ *
+ *   @param  path : File to be dumped
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int hexdump_file_bench(const char *path) {
+    const char *names[] = { "sync", "threads", "io_uring" };
+    struct timespec start, end;
+    struct stat st;
+    double seconds;
+    int mode, used, in_fd, out_fd;
+
+    in_fd = open(path, O_RDONLY);
+    out_fd = open("/dev/null", O_WRONLY);
+    if (in_fd < 0 || out_fd < 0 || fstat(in_fd, &st) < 0) {
+        perror(path);
+        return -1;
+    }
+
+    printf("File: %s, Bytes: %lld\n", path, (long long)st.st_size);
+    for (mode = HEXDUMP_FILE_SYNC; mode <= HEXDUMP_FILE_URING; mode++) {
+        lseek(in_fd, 0, SEEK_SET);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        used = hexdump_file(in_fd, out_fd, (hexdump_file_mode_t)mode);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        seconds = (double)(end.tv_sec - start.tv_sec)
+                  + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+        if (used < 0)
+            printf("%-9s: failed\n", names[mode]);
+        else if (used != mode)
+            printf("%-9s: unavailable, ran %s\n", names[mode], names[used]);
+        else
+            printf("%-9s: %8.1f MB/s\n", names[mode],
+                   (double)st.st_size / 1e6 / (seconds > 0 ? seconds : 1e-9));
+    }
+
+    close(in_fd);
+    close(out_fd);
+    return 0;
+}
+
+
+/**
+ *   @brief  Test function to test hexdump_file() function with test cases
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every mode produces the same text as hexdump() of the whole file
+ *   - Empty file
+ *   - Invalid file descriptor
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_file(int debug) {
+    char in_path[] = "/tmp/hexdump_file_in_XXXXXX";
+    char out_path[] = "/tmp/hexdump_file_out_XXXXXX";
+    size_t nbytes = 3 * HEXDUMP_FILE_CHUNK + 1003, expected_len = 0;
+    size_t size = (nbytes / HEXDUMP_BYTES_PER_LINE + 2) * HEXDUMP_FILE_LINE_MAX;
+    uint8_t *data = malloc(nbytes);
+    char *expected = malloc(size);
+    char *text = malloc(size);
+    int in_fd = mkstemp(in_path);
+    int out_fd = mkstemp(out_path);
+    int mode, ret, status = 1;
+    long n;
+    size_t i;
+
+    if(debug)
+        printf("\n Test Results for pipelined file hexdump ");
+
+    if (data == NULL || expected == NULL || text == NULL || in_fd < 0 || out_fd < 0)
+        status = 0;
+
+    for (i = 0; status && i < nbytes; i++)
+        data[i] = (uint8_t)(i * 131 + (i >> 9));
+    if (status && write_full(in_fd, (const char *)data, nbytes) < 0)
+        status = 0;
+
+    // Reference text, hexdump() of the whole file : more than 64 KB, so one
+    // offset width of 5 digits on every line
+    if (status) {
+        hexdump(expected, size, data, nbytes);
+        strcat(expected, "\n");
+        expected_len = strlen(expected);
+    }
+
+    // Valid Input Test, every mode gives the same text
+    for (mode = HEXDUMP_FILE_SYNC; status && mode <= HEXDUMP_FILE_AUTO; mode++) {
+        lseek(in_fd, 0, SEEK_SET);
+        lseek(out_fd, 0, SEEK_SET);
+        if (ftruncate(out_fd, 0) < 0)
+            status = 0;
+        ret = hexdump_file(in_fd, out_fd, (hexdump_file_mode_t)mode);
+        lseek(out_fd, 0, SEEK_SET);
+        n = read_full(out_fd, text, size);
+        if(debug)
+            printf("\nMode: %d, Used: %d, Characters: %ld", mode, ret, n);
+        if (ret < 0 || n != (long)expected_len || memcmp(text, expected, expected_len) != 0)
+            status = 0;
+    }
+
+    // Empty file gives no text
+    for (mode = HEXDUMP_FILE_SYNC; status && mode <= HEXDUMP_FILE_URING; mode++) {
+        if (ftruncate(in_fd, 0) < 0 || ftruncate(out_fd, 0) < 0)
+            status = 0;
+        lseek(in_fd, 0, SEEK_SET);
+        lseek(out_fd, 0, SEEK_SET);
+        ret = hexdump_file(in_fd, out_fd, (hexdump_file_mode_t)mode);
+        if(debug)
+            printf("\nEmpty file, Mode: %d, Used: %d", mode, ret);
+        if (ret < 0 || lseek(out_fd, 0, SEEK_END) != 0)
+            status = 0;
+    }
+
+    // Invalid file descriptor
+    ret = hexdump_file(-1, out_fd, HEXDUMP_FILE_SYNC);
+        if(debug)
+            printf("\nInvalid descriptor: %d", ret);
+        if(ret != -1)
+            status = 0;
+
+    if (in_fd >= 0) {
+        close(in_fd);
+        unlink(in_path);
+    }
+    if (out_fd >= 0) {
+        close(out_fd);
+        unlink(out_path);
+    }
+    free(data);
+    free(expected);
+    free(text);
+    return status;
+}
@@ -0,0 +1,92 @@
+#ifndef HEXDUMP_FILE_
+#define HEXDUMP_FILE_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_file.h
+ * @brief Pipelined hexdump of whole files
+ *
+ * Reading a chunk, formatting it and writing the text are overlapped so the
+ * disk and the CPU are busy at the same time. On Linux the pipeline runs on
+ * io_uring with registered buffers; where io_uring is not available a reader
+ * and a writer thread exchange double buffers with the formatting thread.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+// Bytes read per chunk, a multiple of 16 so chunks never split a line
+#define HEXDUMP_FILE_CHUNK (64 * 1024)
+
+typedef enum {
+    HEXDUMP_FILE_SYNC,      // read -> format -> write, one after the other
+    HEXDUMP_FILE_THREADS,   // Reader and writer threads with double buffers
+    HEXDUMP_FILE_URING,     // io_uring with registered buffers
+    HEXDUMP_FILE_AUTO       // io_uring if available, else threads
+} hexdump_file_mode_t;
+
+/**
+ *   @brief  Writes the hexdump of everything readable from in_fd to out_fd
+ *
+ *   The text of a regular file is the same as hexdump() of the whole file,
+ *   every line ending with '\n', so the offset column keeps one width. From
+ *   a pipe the length is unknown and the column grows past 0xFFFF. A mode
+ *   which is not available falls back to the next simpler one.
+ *
+ *   @param  in_fd : File to be dumped
+ *   @param  out_fd : Where the text is written
+ *   @param  mode : Pipeline to use
+ *
+ *   @return int : Mode which was used, -1 on a read or write error
+ */
+int hexdump_file(int in_fd, int out_fd, hexdump_file_mode_t mode);
+
+/**
+ *   @brief  Dumps the file at path to the standard output
+ *
+ *   @param  path : File to be dumped
+ *   @param  mode : Pipeline to use
+ *
+ *   @return int : Mode which was used, -1 on failure
+ */
+int hexdump_file_path(const char *path, hexdump_file_mode_t mode);
+
+/**
+ *   @brief  Dumps the file at path to /dev/null with every mode and prints
+ *           the throughput of each in MB/s
+ *
+ *   @param  path : File to be dumped
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int hexdump_file_bench(const char *path);
+
+/**
+ *   @brief  Test function to test hexdump_file() function with test cases
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every mode produces the same text as hexdump() of the whole file
+ *   - Empty file
+ *   - Invalid file descriptor
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_file(int debug);
+
+#endif /* HEXDUMP_FILE_ */
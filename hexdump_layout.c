@@ -0,0 +1,95 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_layout.c
+ * @brief Tests of the compile time hexdump layouts
+ *
+ * The formatters themselves are generated in hexdump_layout.h so each user
+ * gets its own specialised copy.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bit_operations.h"
+#include "hexdump_layout.h"
+
+// Big endian 16 bit words, 8 bytes per line, no gutter
+HEXDUMP_LAYOUT_DEFINE(hexdump_words16be, 8, 2, 0, 2, 0)
+
+
+/**
+ *   @brief  Test function to test the generated layouts
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Classic layout matches hexdump()
+ *   - Little endian word groups and the gutter, full and short lines
+ *   - Segmentation Faults Check
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_layout(int debug) {
+    size_t size = 1024;
+    char str[size];
+    char expected[size];
+    uint8_t region[40];
+    int i;
+
+    if(debug)
+        printf("\n Test Results for compile time hexdump layouts ");
+
+    for (i = 0; i < (int)sizeof(region); i++)
+        region[i] = (uint8_t)('A' + i);
+
+    // Classic layout is the layout of hexdump()
+    hexdump_classic_dump(str, size, region, sizeof(region));
+    hexdump(expected, size, region, sizeof(region));
+        if(debug)
+            printf("\nClassic:\n%s", str);
+        if(strcmp(str, expected) != 0)
+            return 0;
+
+    // 32 bytes of little endian words, short second line
+    hexdump_words32le_dump(str, size, region, sizeof(region));
+        if(debug)
+            printf("\nWords 32 LE:\n%s", str);
+        if(strlen(str) != 2 * hexdump_words32le_line_length() + 1)
+            return 0;
+        if(strncmp(str, "0x00000000  44434241 48474645 ", 30) != 0)
+            return 0;
+        if(strstr(str, "|ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`|\n0x00000020  64636261 68676665 ") == NULL)
+            return 0;
+        if(strstr(str, "|abcdefgh                        |") == NULL)
+            return 0;
+
+    // Big endian words with a partial last group
+    hexdump_words16be_dump(str, size, region, 11);
+        if(debug)
+            printf("\nWords 16 BE:\n%s", str);
+        if(strcmp(str, "0x00  4142 4344 4546 4748 \n0x08  494A 4B             ") != 0)
+            return 0;
+
+    // String too small for the whole dump
+    hexdump_words32le_dump(str, 100, region, sizeof(region));
+        if(debug)
+            printf("\nString Size: %d, Result: %s", 100, str);
+        if(str[0] != '\0')
+            return 0;
+
+    return 1;
+}
@@ -0,0 +1,204 @@
+#ifndef HEXDUMP_LAYOUT_
+#define HEXDUMP_LAYOUT_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_layout.h
+ * @brief Hexdump formatters whose layout is fixed at compile time
+ *
+ * HEXDUMP_LAYOUT_DEFINE() generates a line formatter and a dump function for
+ * one layout: bytes per line, group size (1, 2, 4 or 8 bytes), byte order of
+ * a group, width of the offset column and the ASCII gutter. The layout is
+ * passed to always inlined helpers as constants, so each generated formatter
+ * is fully unrolled and a full line is formatted without branches.
+ *
+ *   Layout of a line :
+ *   "0x<offset>  <group> <group> ... <group> [ |<ascii>|]"
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#define HEXDUMP_LAYOUT_INLINE static inline __attribute__((always_inline))
+
+static const char hexdump_layout_hex[] = "0123456789ABCDEF";
+
+/**
+ *   @brief  Length of one line of a layout, not including the '\n' or '\0'
+ */
+HEXDUMP_LAYOUT_INLINE size_t hexdump_layout_line_length(const int cols,
+        const int group, const int offset_digits, const int gutter) {
+    return 2 + (size_t)offset_digits + 2 + (size_t)(cols / group) * (2 * group + 1)
+           + (gutter ? (size_t)(2 + cols + 1) : 0);
+}
+
+/**
+ *   @brief  Formats one line of a layout, a short line is padded with spaces
+ *
+ *   @param  str : Destination, at least one line length
+ *   @param  offset : Offset printed in the offset column
+ *   @param  pc : Bytes of this line
+ *   @param  n : Number of bytes in this line (1 - cols)
+ *
+ *   @return int : Number of characters written
+ */
+HEXDUMP_LAYOUT_INLINE int hexdump_layout_line(char *str, uint64_t offset,
+        const uint8_t *pc, size_t n, const int cols, const int group,
+        const int little_endian, const int offset_digits, const int gutter) {
+    int k = 0, d, g, b, src;
+
+    str[k++] = '0';
+    str[k++] = 'x';
+    for (d = offset_digits - 1; d >= 0; d--)
+        str[k++] = hexdump_layout_hex[(offset >> (4 * d)) & 0xF];
+    str[k++] = ' ';
+    str[k++] = ' ';
+
+    if (n == (size_t)cols) {
+        // Full line, every loop bound is a constant
+        for (g = 0; g < cols; g += group) {
+            for (b = 0; b < group; b++) {
+                src = g + (little_endian ? group - 1 - b : b);
+                str[k++] = hexdump_layout_hex[pc[src] >> 4];
+                str[k++] = hexdump_layout_hex[pc[src] & 0xF];
+            }
+            str[k++] = ' ';
+        }
+        if (gutter) {
+            str[k++] = ' ';
+            str[k++] = '|';
+            for (b = 0; b < cols; b++)
+                str[k++] = (pc[b] >= 0x20 && pc[b] < 0x7F) ? (char)pc[b] : '.';
+            str[k++] = '|';
+        }
+        return k;
+    }
+
+    // Short (last) line, bytes past n are printed as spaces
+    for (g = 0; g < cols; g += group) {
+        for (b = 0; b < group; b++) {
+            src = g + (little_endian ? group - 1 - b : b);
+            str[k++] = ((size_t)src < n) ? hexdump_layout_hex[pc[src] >> 4] : ' ';
+            str[k++] = ((size_t)src < n) ? hexdump_layout_hex[pc[src] & 0xF] : ' ';
+        }
+        str[k++] = ' ';
+    }
+    if (gutter) {
+        str[k++] = ' ';
+        str[k++] = '|';
+        for (b = 0; b < cols; b++) {
+            if ((size_t)b >= n)
+                str[k++] = ' ';
+            else
+                str[k++] = (pc[b] >= 0x20 && pc[b] < 0x7F) ? (char)pc[b] : '.';
+        }
+        str[k++] = '|';
+    }
+    return k;
+}
+
+/**
+ *   @brief  Dump of nbytes at loc in one layout, same conventions as hexdump()
+ *
+ *   @return Character Pointer, the empty string if str is too small
+ */
+HEXDUMP_LAYOUT_INLINE char *hexdump_layout_dump(char *str, size_t size,
+        const void *loc, size_t nbytes, const int cols, const int group,
+        const int little_endian, const int offset_digits, const int gutter) {
+    const uint8_t *pc = (const uint8_t *)loc;
+    size_t line_length = hexdump_layout_line_length(cols, group, offset_digits, gutter);
+    size_t rows = (nbytes + (size_t)cols - 1) / (size_t)cols;
+    size_t i, k = 0;
+
+    // Segmentation Fault Check
+    if (size <= 0)
+        return str;
+
+    if (nbytes <= 0 || rows * (line_length + 1) > size) {
+        str[0] = '\0';
+        return str;
+    }
+
+    for (i = 0; i + (size_t)cols <= nbytes; i += (size_t)cols) {
+        k += (size_t)hexdump_layout_line(str + k, i, pc + i, (size_t)cols, cols,
+                                         group, little_endian, offset_digits, gutter);
+        str[k++] = '\n';
+    }
+    if (i < nbytes) {
+        k += (size_t)hexdump_layout_line(str + k, i, pc + i, nbytes - i, cols,
+                                         group, little_endian, offset_digits, gutter);
+        str[k++] = '\n';
+    }
+
+    // No newline after the last line
+    str[k - 1] = '\0';
+    return str;
+}
+
+/**
+ *   @brief  Generates name_line_length(), name_line() and name_dump() for one
+ *           layout
+ *
+ *   @param  name : Prefix of the generated functions
+ *   @param  cols : Bytes per line
+ *   @param  group : Bytes per group, 1, 2, 4 or 8
+ *   @param  little_endian : 1 to print each group as a little endian word
+ *   @param  offset_digits : Width of the offset column in hex digits
+ *   @param  gutter : 1 to append the ASCII gutter
+ */
+#define HEXDUMP_LAYOUT_DEFINE(name, cols, group, little_endian, offset_digits, gutter) \
+    _Static_assert((group) == 1 || (group) == 2 || (group) == 4 || (group) == 8,     \
+                   #name ": group must be 1, 2, 4 or 8 bytes");                      \
+    _Static_assert((cols) > 0 && (cols) % (group) == 0,                              \
+                   #name ": cols must be a multiple of group");                      \
+    _Static_assert((offset_digits) > 0 && (offset_digits) <= 16,                     \
+                   #name ": offset_digits must be 1 - 16");                          \
+    static inline size_t name##_line_length(void) {                                   \
+        return hexdump_layout_line_length(cols, group, offset_digits, gutter);       \
+    }                                                                                 \
+    static inline int name##_line(char *str, uint64_t offset, const uint8_t *pc,     \
+                                  size_t n) {                                         \
+        return hexdump_layout_line(str, offset, pc, n, cols, group, little_endian,   \
+                                   offset_digits, gutter);                            \
+    }                                                                                 \
+    static inline char *name##_dump(char *str, size_t size, const void *loc,         \
+                                    size_t nbytes) {                                  \
+        return hexdump_layout_dump(str, size, loc, nbytes, cols, group,               \
+                                   little_endian, offset_digits, gutter);             \
+    }
+
+// Layout of hexdump() for dumps under 64 KB : 16 single bytes per line
+HEXDUMP_LAYOUT_DEFINE(hexdump_classic, 16, 1, 0, 4, 0)
+
+// 32 bytes per line as little endian 32 bit words, with the ASCII gutter
+HEXDUMP_LAYOUT_DEFINE(hexdump_words32le, 32, 4, 1, 8, 1)
+
+/**
+ *   @brief  Test function to test the generated layouts
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Classic layout matches hexdump()
+ *   - Little endian word groups and the gutter, full and short lines
+ *   - Segmentation Faults Check
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_layout(int debug);
+
+#endif /* HEXDUMP_LAYOUT_ */
@@ -0,0 +1,440 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_parse.c
+ * @brief Streaming parser which turns hexdump() text back into bytes
+ *
+ * Lines are found with memchr() and decoded in place; only a line split
+ * across two chunks is copied into the parser. The 48 characters of hex
+ * columns of a full line are decoded 16 pairs at a time with SSSE3 shuffles
+ * when cpu_dispatch.h allows them, falling back to a lookup table otherwise.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HEXDUMP_PARSE_X86
+#endif
+
+#include "bit_operations.h"
+#include "cpu_dispatch.h"
+#include "hexdump_parse.h"
+
+
+// Value + 1 of each hex character, 0 for any other character
+static const uint8_t hex_value[256] = {
+    ['0'] = 1,  ['1'] = 2,  ['2'] = 3,  ['3'] = 4,  ['4'] = 5,
+    ['5'] = 6,  ['6'] = 7,  ['7'] = 8,  ['8'] = 9,  ['9'] = 10,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+};
+
+
+#ifdef HEXDUMP_PARSE_X86
+// Shuffles gathering the high digit, low digit and separator of each of the
+// 16 "XX " columns out of the three 16 byte blocks of a line
+static const int8_t column_shuffle[3][3][16] = {
+    {   // High digits
+        { 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13 },
+    },
+    {   // Low digits
+        { 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14 },
+    },
+    {   // Separators
+        { 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15 },
+    },
+};
+
+/**
+ *   @brief  Gathers one kind of character (high digit, low digit or
+ *           separator) of the 16 columns into a vector
+ */
+__attribute__((target("ssse3")))
+static __m128i gather_columns(__m128i v0, __m128i v1, __m128i v2, int kind) {
+    __m128i a = _mm_shuffle_epi8(v0, _mm_loadu_si128((const __m128i *)column_shuffle[kind][0]));
+    __m128i b = _mm_shuffle_epi8(v1, _mm_loadu_si128((const __m128i *)column_shuffle[kind][1]));
+    __m128i c = _mm_shuffle_epi8(v2, _mm_loadu_si128((const __m128i *)column_shuffle[kind][2]));
+    return _mm_or_si128(_mm_or_si128(a, b), c);
+}
+
+/**
+ *   @brief  Converts 16 hex characters to their values
+ *
+ *   @param  c : Hex characters
+ *   @param  valid : Set to 0xFF in each lane holding a hex character
+ *
+ *   @return Vector of digit values
+ */
+__attribute__((target("ssse3")))
+static __m128i hex_digits(__m128i c, __m128i *valid) {
+    __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i l = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+
+    *valid = _mm_or_si128(is_digit, is_alpha);
+    return _mm_or_si128(_mm_and_si128(is_digit, d),
+                        _mm_and_si128(is_alpha, _mm_add_epi8(l, _mm_set1_epi8(10))));
+}
+
+/**
+ *   @brief  Decodes the 48 characters of hex columns of a full line
+ *
+ *   @param  s : First hex column of the line
+ *   @param  out : Destination of the 16 bytes
+ *
+ *   @return int ( 1 = Decoded, 0 = Not a full well formed line )
+ */
+__attribute__((target("ssse3")))
+static int decode_row_ssse3(const char *s, uint8_t *out) {
+    __m128i v0 = _mm_loadu_si128((const __m128i *)s);
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(s + 16));
+    __m128i v2 = _mm_loadu_si128((const __m128i *)(s + 32));
+    __m128i hi_valid, lo_valid, hi, lo, sep;
+
+    hi = hex_digits(gather_columns(v0, v1, v2, 0), &hi_valid);
+    lo = hex_digits(gather_columns(v0, v1, v2, 1), &lo_valid);
+    sep = _mm_cmpeq_epi8(gather_columns(v0, v1, v2, 2), _mm_set1_epi8(' '));
+
+    if (_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(hi_valid, lo_valid), sep)) != 0xFFFF)
+        return 0;
+
+    // Digits are below 16, so a 16 bit shift never carries into the next byte
+    _mm_storeu_si128((__m128i *)out, _mm_or_si128(_mm_slli_epi16(hi, 4), lo));
+    return 1;
+}
+#endif
+
+
+/**
+ *   @brief  No vector decoder, every line goes to the scalar parser
+ */
+static int decode_row_none(const char *s, uint8_t *out) {
+    (void)s;
+    (void)out;
+    return 0;
+}
+
+typedef int (*decode_row_fn)(const char *s, uint8_t *out);
+
+static cpu_point_t decode_row_point = CPU_POINT("hexdump_parse", decode_row_none,
+                                                CPU_X86(decode_row_ssse3), NULL, NULL);
+CPU_DISPATCH_REGISTER(decode_row_point)
+
+
+/**
+ *   @brief  Decodes the 48 characters of hex columns of a full line with the
+ *           routine of the CPU level
+ *
+ *   @return int ( 1 = Decoded, 0 = Use the scalar parser )
+ */
+static int decode_row(const char *s, uint8_t *out) {
+    return ((decode_row_fn)cpu_resolve(&decode_row_point))(s, out);
+}
+
+
+/**
+ *   @brief  Parses one line (without its '\n') and checks its offset follows
+ *           the previous line
+ *
+ *   @return int : Number of bytes decoded, -1 for a malformed line
+ */
+static int parse_line(hexdump_parser_t *parser, const char *line, size_t len,
+                      uint8_t *out) {
+    uint64_t offset = 0;
+    size_t pos, h;
+    int n, hi, lo, v;
+
+    if (len > 0 && line[len - 1] == '\r')
+        len--;
+
+    // Blank lines between dumps are skipped
+    if (len == 0)
+        return 0;
+
+    parser->line_no++;
+
+    // Only the last line of a dump may be short
+    if (parser->ended)
+        return -1;
+
+    if (len < 4 || line[0] != '0' || line[1] != 'x')
+        return -1;
+
+    // Offset column
+    for (pos = 2; pos < len && line[pos] != ' '; pos++) {
+        v = hex_value[(uint8_t)line[pos]];
+        if (v == 0 || pos - 2 >= 16)
+            return -1;
+        offset = (offset << 4) | (uint64_t)(v - 1);
+    }
+
+    // 2 Spaces between Address and Buffer Values
+    if (pos == 2 || pos + 1 >= len || line[pos + 1] != ' ')
+        return -1;
+    h = pos + 2;
+
+    if (parser->started && offset != parser->next_offset)
+        return -1;
+
+    if (len >= h + 3 * HEXDUMP_BYTES_PER_LINE && decode_row(line + h, out)) {
+        n = HEXDUMP_BYTES_PER_LINE;
+    }
+    else {
+        for (n = 0; n < HEXDUMP_BYTES_PER_LINE; n++) {
+            pos = h + 3 * n;
+            if (pos >= len || line[pos] == ' ')
+                break;
+            if (pos + 1 >= len)
+                return -1;
+
+            hi = hex_value[(uint8_t)line[pos]];
+            lo = hex_value[(uint8_t)line[pos + 1]];
+            if (hi == 0 || lo == 0)
+                return -1;
+            if (pos + 2 < len && line[pos + 2] != ' ')
+                return -1;
+            out[n] = (uint8_t)(((hi - 1) << 4) | (lo - 1));
+        }
+
+        // Padding of a short line, anything after the hex columns is the gutter
+        for (pos = h + 3 * n; pos < len && pos < h + 3 * HEXDUMP_BYTES_PER_LINE; pos++) {
+            if (line[pos] != ' ')
+                return -1;
+        }
+    }
+
+    if (n == 0)
+        return -1;
+
+    parser->started = 1;
+    parser->next_offset = offset + (uint64_t)n;
+    if (n < HEXDUMP_BYTES_PER_LINE)
+        parser->ended = 1;
+
+    return n;
+}
+
+
+/**
+ *   @brief  Prepares a parser for a new dump
+ *
+ *   @param  parser : Parser to be initialised
+ */
+void hexdump_parse_init(hexdump_parser_t *parser) {
+    memset(parser, 0, sizeof(*parser));
+}
+
+
+/**
+ *   @brief  Parses a chunk of hexdump text into bytes
+ *
+ *   Every complete line of text is decoded into out. Parsing stops early when
+ *   out has no room for another 16 bytes; *consumed tells how much of text was
+ *   used so the caller can call again with the rest. A trailing partial line
+ *   is kept in the parser and completed by the next chunk.
+ *
+ *   @param  parser : An initialised parser
+ *   @param  text : Chunk of hexdump text
+ *   @param  len : Number of characters in text
+ *   @param  consumed : Set to the number of characters of text used
+ *   @param  out : Destination of the decoded bytes
+ *   @param  out_size : Bytes available at out
+ *   @param  produced : Set to the number of bytes written to out
+ *
+ *   @return int ( 0 = Success, -1 = Malformed or non contiguous line )
+ */
+int hexdump_parse(hexdump_parser_t *parser, const char *text, size_t len,
+                  size_t *consumed, uint8_t *out, size_t out_size,
+                  size_t *produced) {
+    const char *nl;
+    size_t take;
+    int n;
+
+    *consumed = 0;
+    *produced = 0;
+
+    while (*consumed < len && out_size - *produced >= HEXDUMP_BYTES_PER_LINE) {
+        nl = memchr(text + *consumed, '\n', len - *consumed);
+        take = (nl == NULL) ? len - *consumed : (size_t)(nl - (text + *consumed));
+
+        // Lines split across chunks go through the carry buffer
+        if (nl == NULL || parser->carry_length > 0) {
+            if (parser->carry_length + take > HEXDUMP_PARSE_MAX_LINE)
+                return -1;
+            memcpy(parser->carry + parser->carry_length, text + *consumed, take);
+            parser->carry_length += take;
+            *consumed += take;
+            if (nl == NULL)
+                break;
+
+            n = parse_line(parser, parser->carry, parser->carry_length,
+                           out + *produced);
+            parser->carry_length = 0;
+        }
+        else {
+            n = parse_line(parser, text + *consumed, take, out + *produced);
+            *consumed += take;
+        }
+
+        if (n < 0)
+            return -1;
+
+        // The '\n'
+        *consumed += 1;
+        *produced += (size_t)n;
+    }
+
+    return 0;
+}
+
+
+/**
+ *   @brief  Parses the last line, which hexdump() does not end with '\n'
+ *
+ *   @param  parser : An initialised parser
+ *   @param  out : Destination of the decoded bytes, at least 16 bytes
+ *   @param  out_size : Bytes available at out
+ *   @param  produced : Set to the number of bytes written to out
+ *
+ *   @return int ( 0 = Success, -1 = Malformed line )
+ */
+int hexdump_parse_finish(hexdump_parser_t *parser, uint8_t *out,
+                         size_t out_size, size_t *produced) {
+    int n;
+
+    *produced = 0;
+    if (parser->carry_length == 0)
+        return 0;
+
+    if (out_size < HEXDUMP_BYTES_PER_LINE)
+        return -1;
+
+    n = parse_line(parser, parser->carry, parser->carry_length, out);
+    parser->carry_length = 0;
+    if (n < 0)
+        return -1;
+
+    *produced = (size_t)n;
+    return 0;
+}
+
+
+/**
+ *   @brief  Test function to test the hexdump_parse*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Round trip of hexdump() output fed in small chunks
+ *   - Lines followed by an ASCII gutter
+ *   - Non contiguous offsets and malformed hex pairs
+ *   - Output buffer too small for a whole chunk
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_parse(int debug) {
+    size_t size = 1024;
+    char str[size];
+    uint8_t region[90], out[128];
+    hexdump_parser_t parser;
+    size_t len, pos, consumed, produced, total, step;
+    int ret, i, k;
+
+    if(debug)
+        printf("\n Test Results for parsing hexdump text back to bytes ");
+
+    for (i = 0; i < (int)sizeof(region); i++)
+        region[i] = (uint8_t)(i * 37 + 11);
+
+    // Valid Input Test, round trip fed 7 characters at a time
+    hexdump(str, size, region, sizeof(region));
+    len = strlen(str);
+    hexdump_parse_init(&parser);
+    total = 0;
+    ret = 0;
+    for (pos = 0; pos < len && ret == 0; pos += consumed) {
+        step = (len - pos < 7) ? len - pos : 7;
+        ret = hexdump_parse(&parser, str + pos, step, &consumed,
+                            out + total, sizeof(out) - total, &produced);
+        total += produced;
+    }
+    if (ret == 0)
+        ret = hexdump_parse_finish(&parser, out + total, sizeof(out) - total, &produced);
+    total += produced;
+        if(debug)
+            printf("\nRound trip: %d, Bytes: %ld", ret, total);
+        if(ret != 0 || total != sizeof(region) || memcmp(out, region, total) != 0)
+            return 0;
+
+    // Valid Input Test, lines with the ASCII gutter
+    k = 0;
+    for (i = 0; i < (int)sizeof(region); i += HEXDUMP_BYTES_PER_LINE) {
+        k += hexdump_line(str + k, (uint64_t)i, HEXDUMP_OFFSET_DIGITS, region + i,
+                          (sizeof(region) - i < 16) ? sizeof(region) - i : 16);
+        k += hexdump_gutter(str + k, region + i,
+                            (sizeof(region) - i < 16) ? sizeof(region) - i : 16);
+        str[k++] = '\n';
+    }
+    str[k] = '\0';
+    hexdump_parse_init(&parser);
+    ret = hexdump_parse(&parser, str, (size_t)k, &consumed, out, sizeof(out), &produced);
+        if(debug)
+            printf("\nGutter: %d, Bytes: %ld\n%s", ret, produced, str);
+        if(ret != 0 || consumed != (size_t)k || produced != sizeof(region)
+           || memcmp(out, region, produced) != 0)
+            return 0;
+
+    // Invalid Input Test, second line does not follow the first
+    hexdump(str, size, region, sizeof(region));
+    str[hexdump_line_length(HEXDUMP_OFFSET_DIGITS) + 1 + 4] = '2';
+    hexdump_parse_init(&parser);
+    ret = hexdump_parse(&parser, str, strlen(str), &consumed, out, sizeof(out), &produced);
+        if(debug)
+            printf("\nNon contiguous offset: %d, Line: %ld", ret, parser.line_no);
+        if(ret != -1 || parser.line_no != 2)
+            return 0;
+
+    // Invalid Input Test, bad hex pair
+    hexdump(str, size, region, sizeof(region));
+    str[9] = 'G';
+    hexdump_parse_init(&parser);
+    ret = hexdump_parse(&parser, str, strlen(str), &consumed, out, sizeof(out), &produced);
+        if(debug)
+            printf("\nMalformed hex pair: %d", ret);
+        if(ret != -1)
+            return 0;
+
+    // Output with room for a single line, the caller resumes from consumed
+    hexdump(str, size, region, sizeof(region));
+    hexdump_parse_init(&parser);
+    ret = hexdump_parse(&parser, str, strlen(str), &consumed, out, 20, &produced);
+        if(debug)
+            printf("\nSmall output: %d, Consumed: %ld, Bytes: %ld", ret, consumed, produced);
+        if(ret != 0 || produced != 16
+           || consumed != hexdump_line_length(HEXDUMP_OFFSET_DIGITS) + 1)
+            return 0;
+
+    return 1;
+}
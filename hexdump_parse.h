@@ -0,0 +1,101 @@
+#ifndef HEXDUMP_PARSE_
+#define HEXDUMP_PARSE_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_parse.h
+ * @brief Streaming parser which turns hexdump() text back into bytes
+ *
+ * Accepts the layout hexdump() emits ("0x<offset>  XX XX ... XX ", short last
+ * line padded with spaces), with or without the ASCII gutter produced by
+ * hexdump_gutter(). Text may be fed in chunks of any size; only a partial
+ * line is carried between calls, so memory use is constant.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+// Longest line the parser carries between two chunks
+#define HEXDUMP_PARSE_MAX_LINE 256
+
+typedef struct {
+    uint64_t next_offset;               // Offset expected on the next line
+    int started;                        // A line has been parsed
+    int ended;                          // A short (last) line has been parsed
+    size_t line_no;                     // Lines seen, for error reporting
+    size_t carry_length;                // Bytes of a partial line in carry
+    char carry[HEXDUMP_PARSE_MAX_LINE]; // Partial line from the last chunk
+} hexdump_parser_t;
+
+/**
+ *   @brief  Prepares a parser for a new dump
+ *
+ *   @param  parser : Parser to be initialised
+ */
+void hexdump_parse_init(hexdump_parser_t *parser);
+
+/**
+ *   @brief  Parses a chunk of hexdump text into bytes
+ *
+ *   Every complete line of text is decoded into out. Parsing stops early when
+ *   out has no room for another 16 bytes; *consumed tells how much of text was
+ *   used so the caller can call again with the rest. A trailing partial line
+ *   is kept in the parser and completed by the next chunk.
+ *
+ *   @param  parser : An initialised parser
+ *   @param  text : Chunk of hexdump text
+ *   @param  len : Number of characters in text
+ *   @param  consumed : Set to the number of characters of text used
+ *   @param  out : Destination of the decoded bytes
+ *   @param  out_size : Bytes available at out
+ *   @param  produced : Set to the number of bytes written to out
+ *
+ *   @return int ( 0 = Success, -1 = Malformed or non contiguous line )
+ */
+int hexdump_parse(hexdump_parser_t *parser, const char *text, size_t len,
+                  size_t *consumed, uint8_t *out, size_t out_size,
+                  size_t *produced);
+
+/**
+ *   @brief  Parses the last line, which hexdump() does not end with '\n'
+ *
+ *   @param  parser : An initialised parser
+ *   @param  out : Destination of the decoded bytes, at least 16 bytes
+ *   @param  out_size : Bytes available at out
+ *   @param  produced : Set to the number of bytes written to out
+ *
+ *   @return int ( 0 = Success, -1 = Malformed line )
+ */
+int hexdump_parse_finish(hexdump_parser_t *parser, uint8_t *out,
+                         size_t out_size, size_t *produced);
+
+/**
+ *   @brief  Test function to test the hexdump_parse*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Round trip of hexdump() output fed in small chunks
+ *   - Lines followed by an ASCII gutter
+ *   - Non contiguous offsets and malformed hex pairs
+ *   - Output buffer too small for a whole chunk
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_parse(int debug);
+
+#endif /* HEXDUMP_PARSE_ */
@@ -0,0 +1,352 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_proc.c
+ * @brief Hexdump of the memory of a running process
+ *
+ * Regions are gathered into batches of up to HEXDUMP_PROC_IOV remote iovecs
+ * and HEXDUMP_PROC_BATCH bytes, so small regions cost a fraction of a system
+ * call each. process_vm_readv() stops at the first page it cannot read; the
+ * bytes before it are dumped, that one page is skipped and the next batch
+ * starts right after it.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#include "bit_operations.h"
+#include "hexdump_stream.h"
+#include "hexdump_proc.h"
+
+// Text produced per hexdump_ctx_feed() call
+#define HEXDUMP_PROC_TEXT (256 * 1024)
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    char perms[8];
+    char path[256];
+} region_t;
+
+typedef struct {
+    FILE *out;
+    char *text;
+    hexdump_ctx_t ctx;
+    int open;               // A run of contiguous bytes is being dumped
+} proc_dump_t;
+
+
+/**
+ *   @brief  Reads the readable regions of a process which overlap
+ *           [start, end), clamped to that range
+ *
+ *   @return long : Number of regions, -1 if the maps file cannot be read
+ */
+static long read_maps(pid_t pid, uint64_t start, uint64_t end,
+                      region_t **regions) {
+    char path[64], line[512];
+    region_t r, *grown;
+    unsigned long long lo, hi;
+    long count = 0, capacity = 0;
+    FILE *maps;
+
+    snprintf(path, sizeof(path), "/proc/%d/maps", (int)pid);
+    maps = fopen(path, "r");
+    if (maps == NULL)
+        return -1;
+
+    *regions = NULL;
+    while (fgets(line, sizeof(line), maps) != NULL) {
+        memset(&r, 0, sizeof(r));
+        if (sscanf(line, "%llx-%llx %7s %*s %*s %*s %255[^\n]", &lo, &hi,
+                   r.perms, r.path) < 3)
+            continue;
+        r.start = lo < start ? start : lo;
+        r.end = (end != 0 && hi > end) ? end : hi;
+        if (r.perms[0] != 'r' || r.start >= r.end)
+            continue;
+
+        if (count == capacity) {
+            capacity = capacity ? 2 * capacity : 64;
+            grown = realloc(*regions, (size_t)capacity * sizeof(region_t));
+            if (grown == NULL) {
+                count = -1;
+                break;
+            }
+            *regions = grown;
+        }
+        (*regions)[count++] = r;
+    }
+
+    fclose(maps);
+    return count;
+}
+
+
+/**
+ *   @brief  Writes the last line of the current run
+ */
+static void close_run(proc_dump_t *d) {
+    int k;
+
+    if (!d->open)
+        return;
+    k = hexdump_ctx_finish(&d->ctx, d->text, HEXDUMP_PROC_TEXT);
+    if (k > 0)
+        fwrite(d->text, 1, (size_t)k, d->out);
+    d->open = 0;
+}
+
+
+/**
+ *   @brief  Dumps n bytes read from address addr of the process
+ */
+static void emit(proc_dump_t *d, uint64_t addr, const uint8_t *pc, size_t n) {
+    size_t consumed;
+    int k;
+
+    if (!d->open) {
+        hexdump_ctx_init(&d->ctx, addr, 0, 0);
+        d->open = 1;
+    }
+    while (n > 0) {
+        k = hexdump_ctx_feed(&d->ctx, d->text, HEXDUMP_PROC_TEXT, pc, n, &consumed);
+        if (k > 0)
+            fwrite(d->text, 1, (size_t)k, d->out);
+        pc += consumed;
+        n -= consumed;
+    }
+}
+
+
+/**
+ *   @brief  Dumps the readable memory of a process between start and end
+ *
+ *   Every readable region starts with a line like the one in the maps file,
+ *   followed by its dump. Pages which cannot be read are skipped and the dump
+ *   resumes at the next readable page.
+ *
+ *   @param  pid : Process to be dumped
+ *   @param  out : Where the text is written
+ *   @param  start : Lowest address to dump
+ *   @param  end : Address past the last byte to dump, 0 for no limit
+ *   @param  skipped : Set to the number of bytes which could not be read,
+ *                     may be NULL
+ *
+ *   @return long long : Number of bytes dumped, -1 on failure
+ */
+long long hexdump_proc(pid_t pid, FILE *out, uint64_t start, uint64_t end,
+                       uint64_t *skipped) {
+    struct iovec local, remote[HEXDUMP_PROC_IOV];
+    region_t *regions;
+    proc_dump_t d;
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t addr, a, next, lost = 0;
+    long count, r, rr, header = -1;
+    long long dumped = 0;
+    ssize_t got;
+    size_t total, len, take, left;
+    uint8_t *buf, *p;
+    int n, i;
+
+    if (skipped != NULL)
+        *skipped = 0;
+
+    count = read_maps(pid, start, end, &regions);
+    if (count < 0)
+        return -1;
+
+    memset(&d, 0, sizeof(d));
+    d.out = out;
+    d.text = malloc(HEXDUMP_PROC_TEXT);
+    buf = malloc(HEXDUMP_PROC_BATCH);
+    if (d.text == NULL || buf == NULL)
+        dumped = -1;
+
+    r = 0;
+    addr = count > 0 ? regions[0].start : 0;
+    while (dumped >= 0 && r < count) {
+        // Gather the next batch from (r, addr) on
+        n = 0;
+        total = 0;
+        rr = r;
+        a = addr;
+        while (rr < count && n < HEXDUMP_PROC_IOV && total < HEXDUMP_PROC_BATCH) {
+            len = (size_t)(regions[rr].end - a);
+            if (len > HEXDUMP_PROC_BATCH - total)
+                len = HEXDUMP_PROC_BATCH - total;
+            remote[n].iov_base = (void *)(uintptr_t)a;
+            remote[n].iov_len = len;
+            n++;
+            total += len;
+            a += len;
+            if (a == regions[rr].end && ++rr < count)
+                a = regions[rr].start;
+        }
+
+        local.iov_base = buf;
+        local.iov_len = total;
+        got = process_vm_readv(pid, &local, 1, remote, (unsigned long)n, 0);
+        if (got < 0 && errno != EFAULT) {
+            // Process went away or may not be read at all
+            dumped = -1;
+            break;
+        }
+        if (got < 0)
+            got = 0;
+
+        // Dump what was read, region by region
+        p = buf;
+        left = (size_t)got;
+        for (i = 0; i < n && left > 0; i++) {
+            take = remote[i].iov_len < left ? remote[i].iov_len : left;
+            if (header != r) {
+                close_run(&d);
+                fprintf(out, "%llx-%llx %s %s\n", (unsigned long long)regions[r].start,
+                        (unsigned long long)regions[r].end, regions[r].perms,
+                        regions[r].path);
+                header = r;
+            }
+            emit(&d, addr, p, take);
+            p += take;
+            left -= take;
+            addr += take;
+            dumped += (long long)take;
+            if (addr == regions[r].end) {
+                close_run(&d);
+                if (++r < count)
+                    addr = regions[r].start;
+            }
+        }
+
+        // addr is the first byte which could not be read, skip its page
+        if ((size_t)got < total && r < count) {
+            close_run(&d);
+            next = (addr & ~(page - 1)) + page;
+            if (next > regions[r].end)
+                next = regions[r].end;
+            lost += next - addr;
+            addr = next;
+            if (addr == regions[r].end && ++r < count)
+                addr = regions[r].start;
+        }
+    }
+
+    close_run(&d);
+    if (skipped != NULL)
+        *skipped = lost;
+    free(d.text);
+    free(buf);
+    free(regions);
+    return dumped;
+}
+
+
+/**
+ *   @brief  Test function to test hexdump_proc() function with test cases
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Dump of a mapping of this process at its real address
+ *   - Pages of a readable mapping which fault are skipped
+ *   - Process which does not exist
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_proc(int debug) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    char path[] = "/tmp/hexdump_proc_XXXXXX";
+    char *text = NULL, *expected = NULL, *body;
+    size_t text_len = 0, consumed, k;
+    uint64_t skipped;
+    long long ret;
+    hexdump_ctx_t ctx;
+    uint8_t *mem, *file_mem;
+    FILE *out;
+    int fd, status = 1;
+    size_t i;
+
+    if(debug)
+        printf("\n Test Results for live process memory hexdump ");
+
+    // Valid Input Test, two pages of this process at their real address
+    mem = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return 0;
+    for (i = 0; i < 2 * page; i++)
+        mem[i] = (uint8_t)(i * 13 + 5);
+
+    out = open_memstream(&text, &text_len);
+    ret = hexdump_proc(getpid(), out, (uint64_t)(uintptr_t)mem,
+                       (uint64_t)(uintptr_t)mem + 2 * page, &skipped);
+    fclose(out);
+
+    expected = malloc(2 * page * 5);
+    hexdump_ctx_init(&ctx, (uint64_t)(uintptr_t)mem, 0, 0);
+    k = (size_t)hexdump_ctx_feed(&ctx, expected, 2 * page * 5, mem, 2 * page, &consumed);
+    k += (size_t)hexdump_ctx_finish(&ctx, expected + k, 2 * page * 5 - k);
+    body = strchr(text, '\n');
+        if(debug)
+            printf("\nBytes: %lld, Skipped: %lu\n%.200s", ret, (unsigned long)skipped, text);
+        if(ret != (long long)(2 * page) || skipped != 0 || body == NULL
+           || strcmp(body + 1, expected) != 0)
+            status = 0;
+    free(text);
+    free(expected);
+    munmap(mem, 2 * page);
+
+    // Readable mapping whose last two pages are past the end of the file
+    fd = mkstemp(path);
+    if (fd < 0 || ftruncate(fd, (off_t)page) < 0)
+        return 0;
+    file_mem = mmap(NULL, 3 * page, PROT_READ, MAP_SHARED, fd, 0);
+    if (file_mem == MAP_FAILED)
+        status = 0;
+    else {
+        out = open_memstream(&text, &text_len);
+        ret = hexdump_proc(getpid(), out, (uint64_t)(uintptr_t)file_mem,
+                           (uint64_t)(uintptr_t)file_mem + 3 * page, &skipped);
+        fclose(out);
+            if(debug)
+                printf("\nFaulting pages, Bytes: %lld, Skipped: %lu", ret, (unsigned long)skipped);
+            if(ret != (long long)page || skipped != 2 * page)
+                status = 0;
+        free(text);
+        munmap(file_mem, 3 * page);
+    }
+    close(fd);
+    unlink(path);
+
+    // Invalid Input Test, no such process
+    out = open_memstream(&text, &text_len);
+    ret = hexdump_proc((pid_t)0x7FFFFFFF, out, 0, 0, NULL);
+    fclose(out);
+    free(text);
+        if(debug)
+            printf("\nNo such process: %lld", ret);
+        if(ret != -1)
+            status = 0;
+
+    return status;
+}
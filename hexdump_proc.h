@@ -0,0 +1,73 @@
+#ifndef HEXDUMP_PROC_
+#define HEXDUMP_PROC_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_proc.h
+ * @brief Hexdump of the memory of a running process
+ *
+ * The readable regions listed in /proc/<pid>/maps are copied with
+ * process_vm_readv(), many regions per call, and dumped with their virtual
+ * addresses in the offset column. The process is neither stopped nor
+ * attached with ptrace.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+// Bytes copied from the process per process_vm_readv() call
+#define HEXDUMP_PROC_BATCH (1024 * 1024)
+
+// Regions gathered per process_vm_readv() call
+#define HEXDUMP_PROC_IOV 64
+
+/**
+ *   @brief  Dumps the readable memory of a process between start and end
+ *
+ *   Every readable region starts with a line like the one in the maps file,
+ *   followed by its dump. Pages which cannot be read are skipped and the dump
+ *   resumes at the next readable page.
+ *
+ *   @param  pid : Process to be dumped
+ *   @param  out : Where the text is written
+ *   @param  start : Lowest address to dump
+ *   @param  end : Address past the last byte to dump, 0 for no limit
+ *   @param  skipped : Set to the number of bytes which could not be read,
+ *                     may be NULL
+ *
+ *   @return long long : Number of bytes dumped, -1 on failure
+ */
+long long hexdump_proc(pid_t pid, FILE *out, uint64_t start, uint64_t end,
+                       uint64_t *skipped);
+
+/**
+ *   @brief  Test function to test hexdump_proc() function with test cases
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Dump of a mapping of this process at its real address
+ *   - Pages of a readable mapping which fault are skipped
+ *   - Process which does not exist
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_proc(int debug);
+
+#endif /* HEXDUMP_PROC_ */
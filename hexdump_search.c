@@ -0,0 +1,457 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_search.c
+ * @brief Search for a byte pattern and print each hit as a hexdump excerpt
+ *
+ * Each byte of a pattern is a (value, mask) pair, so exact bytes, wildcard
+ * nibbles and arbitrary bit masks go through the same test:
+ * (byte & mask) == value. The vector filter applies that test to the first
+ * and last compared bytes of 32 candidate positions at once and only the
+ * positions passing both are verified byte by byte. cpu_dispatch.h decides
+ * whether the filter runs.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HEXDUMP_SEARCH_X86
+#endif
+
+#include "bit_operations.h"
+#include "cpu_dispatch.h"
+#include "hexdump_search.h"
+
+
+// ************************ Helper Functions  ************************************
+
+/**
+ *   @brief  Value of a hex character, -1 for any other character
+ */
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/**
+ *   @brief  Checks the whole pattern at data
+ *
+ *   @return int ( 1 = Match, 0 = No match )
+ */
+static int match_at(const hexdump_pattern_t *pattern, const uint8_t *data) {
+    size_t i;
+
+    for (i = 0; i < pattern->len; i++) {
+        if ((data[i] & pattern->mask[i]) != pattern->value[i])
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ *   @brief  Byte at a time search, memchr() skips ahead when the first
+ *           compared byte is exact
+ */
+static size_t find_scalar(const hexdump_pattern_t *pattern, const uint8_t *data,
+                          size_t nbytes, size_t from) {
+    const uint8_t *q;
+    size_t s, last_start;
+
+    if (nbytes < pattern->len)
+        return nbytes;
+    last_start = nbytes - pattern->len;
+
+    for (s = from; s <= last_start; s++) {
+        if (pattern->mask[pattern->first] == 0xFF) {
+            q = memchr(data + s + pattern->first, pattern->value[pattern->first],
+                       last_start - s + 1);
+            if (q == NULL)
+                return nbytes;
+            s = (size_t)(q - data) - pattern->first;
+        }
+        if (match_at(pattern, data + s))
+            return s;
+    }
+    return nbytes;
+}
+
+#ifdef HEXDUMP_SEARCH_X86
+/**
+ *   @brief  Filters 32 candidate positions at a time on the first and last
+ *           compared byte, then verifies the survivors
+ */
+__attribute__((target("avx2")))
+static size_t find_avx2(const hexdump_pattern_t *pattern, const uint8_t *data,
+                        size_t nbytes, size_t from) {
+    __m256i first_value = _mm256_set1_epi8((char)pattern->value[pattern->first]);
+    __m256i first_mask = _mm256_set1_epi8((char)pattern->mask[pattern->first]);
+    __m256i last_value = _mm256_set1_epi8((char)pattern->value[pattern->last]);
+    __m256i last_mask = _mm256_set1_epi8((char)pattern->mask[pattern->last]);
+    __m256i a, b, eq;
+    size_t s = from, last_start;
+    uint32_t bits;
+
+    if (nbytes < pattern->len)
+        return nbytes;
+    last_start = nbytes - pattern->len;
+
+    // Every one of the 32 positions is a possible start of the pattern
+    while (s + 31 <= last_start) {
+        a = _mm256_loadu_si256((const __m256i *)(data + s + pattern->first));
+        b = _mm256_loadu_si256((const __m256i *)(data + s + pattern->last));
+        eq = _mm256_and_si256(
+                _mm256_cmpeq_epi8(_mm256_and_si256(a, first_mask), first_value),
+                _mm256_cmpeq_epi8(_mm256_and_si256(b, last_mask), last_value));
+
+        bits = (uint32_t)_mm256_movemask_epi8(eq);
+        while (bits != 0) {
+            if (match_at(pattern, data + s + (size_t)__builtin_ctz(bits)))
+                return s + (size_t)__builtin_ctz(bits);
+            bits &= bits - 1;
+        }
+        s += 32;
+    }
+
+    for (; s <= last_start; s++) {
+        if (match_at(pattern, data + s))
+            return s;
+    }
+    return nbytes;
+}
+#endif
+
+typedef size_t (*find_fn)(const hexdump_pattern_t *pattern, const uint8_t *data,
+                          size_t nbytes, size_t from);
+
+static cpu_point_t find_point = CPU_POINT("hexdump_search_find", find_scalar, NULL,
+                                          CPU_X86(find_avx2), NULL);
+CPU_DISPATCH_REGISTER(find_point)
+
+
+/**
+ *   @brief  Compiles a pattern written as hex byte pairs
+ *
+ *   @param  pattern : Pattern to be compiled
+ *   @param  text : Pattern as text, see the file description
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pattern )
+ */
+int hexdump_search_compile(hexdump_pattern_t *pattern, const char *text) {
+    int hi, lo, mhi, mlo;
+    uint8_t value, mask;
+    size_t i;
+
+    memset(pattern, 0, sizeof(*pattern));
+
+    while (*text != '\0') {
+        if (*text == ' ' || *text == '\t') {
+            text++;
+            continue;
+        }
+        if (text[1] == '\0' || pattern->len == HEXDUMP_SEARCH_MAX)
+            return -1;
+
+        // Two hex digits, '?' is a wildcard nibble
+        hi = (text[0] == '?') ? 0 : hex_nibble(text[0]);
+        lo = (text[1] == '?') ? 0 : hex_nibble(text[1]);
+        if (hi < 0 || lo < 0)
+            return -1;
+        value = (uint8_t)((hi << 4) | lo);
+        mask = (uint8_t)(((text[0] == '?') ? 0x00 : 0xF0) | ((text[1] == '?') ? 0x00 : 0x0F));
+        text += 2;
+
+        // Optional "/MM" bit mask
+        if (*text == '/') {
+            mhi = hex_nibble(text[1]);
+            mlo = (mhi < 0) ? -1 : hex_nibble(text[2]);
+            if (mhi < 0 || mlo < 0)
+                return -1;
+            mask &= (uint8_t)((mhi << 4) | mlo);
+            text += 3;
+        }
+
+        pattern->value[pattern->len] = value & mask;
+        pattern->mask[pattern->len] = mask;
+        pattern->len++;
+    }
+
+    if (pattern->len == 0)
+        return -1;
+
+    // Anchor bytes for the vector filter
+    for (i = 0; i < pattern->len && pattern->mask[i] == 0; i++)
+        ;
+    pattern->first = (i < pattern->len) ? i : 0;
+    for (i = pattern->len; i > 0 && pattern->mask[i - 1] == 0; i--)
+        ;
+    pattern->last = (i > 0) ? i - 1 : 0;
+
+    return 0;
+}
+
+
+/**
+ *   @brief  Finds the first occurrence of a pattern at or after from
+ *
+ *   @param  pattern : A compiled pattern
+ *   @param  data : Bytes to be searched
+ *   @param  nbytes : Number of bytes at data
+ *   @param  from : Offset where the search starts
+ *
+ *   @return size_t : Offset of the occurrence, nbytes if there is none
+ */
+size_t hexdump_search_find(const hexdump_pattern_t *pattern, const uint8_t *data,
+                           size_t nbytes, size_t from) {
+    return ((find_fn)cpu_resolve(&find_point))(pattern, data, nbytes, from);
+}
+
+
+/**
+ *   @brief  Hexdump of the rows holding a hit and of context rows around it
+ *
+ *   @param  str : char array where the excerpt is stored
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  data : Bytes which were searched
+ *   @param  nbytes : Number of bytes at data
+ *   @param  hit : Offset of the hit
+ *   @param  len : Length of the hit
+ *   @param  context : Rows printed before and after the hit
+ *
+ *   @return int : Number of characters written, -1 if str is too small
+ */
+int hexdump_search_excerpt(char *str, size_t size, const uint8_t *data,
+                           size_t nbytes, size_t hit, size_t len, int context) {
+    int digits = hexdump_offset_digits(nbytes);
+    size_t rows = (nbytes + HEXDUMP_BYTES_PER_LINE - 1) / HEXDUMP_BYTES_PER_LINE;
+    size_t first_row, last_row, row, offset, n, k = 0;
+
+    // Segmentation Fault Check
+    if (size <= 0)
+        return -1;
+    str[0] = '\0';
+
+    if (len == 0 || hit + len > nbytes || context < 0)
+        return -1;
+
+    first_row = hit / HEXDUMP_BYTES_PER_LINE;
+    first_row = (first_row > (size_t)context) ? first_row - (size_t)context : 0;
+    last_row = (hit + len - 1) / HEXDUMP_BYTES_PER_LINE + (size_t)context;
+    if (last_row >= rows)
+        last_row = rows - 1;
+
+    if ((last_row - first_row + 1) * (hexdump_line_length(digits) + 1) + 1 > size)
+        return -1;
+
+    for (row = first_row; row <= last_row; row++) {
+        offset = row * HEXDUMP_BYTES_PER_LINE;
+        n = nbytes - offset;
+        if (n > HEXDUMP_BYTES_PER_LINE)
+            n = HEXDUMP_BYTES_PER_LINE;
+        k += (size_t)hexdump_line(str + k, offset, digits, data + offset, n);
+        str[k++] = '\n';
+    }
+    str[k] = '\0';
+    return (int)k;
+}
+
+
+/**
+ *   @brief  Prints every occurrence of a pattern in a file with context rows
+ *
+ *   @param  path : File to be searched, it is mapped in memory
+ *   @param  text : Pattern as text
+ *   @param  context : Rows printed before and after each hit
+ *   @param  out : Where the excerpts are written
+ *
+ *   @return long : Number of hits, -1 on failure
+ */
+long hexdump_search_file(const char *path, const char *text, int context, FILE *out) {
+    hexdump_pattern_t pattern;
+    struct stat st;
+    const uint8_t *data;
+    size_t nbytes, hit, size;
+    char *str;
+    long hits = 0;
+    int fd;
+
+    if (context < 0 || hexdump_search_compile(&pattern, text) < 0)
+        return -1;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    nbytes = (size_t)st.st_size;
+    if (nbytes == 0) {
+        close(fd);
+        return 0;
+    }
+
+    data = mmap(NULL, nbytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return -1;
+    madvise((void *)data, nbytes, MADV_SEQUENTIAL);
+
+    size = ((size_t)(2 * context + 2) + pattern.len / HEXDUMP_BYTES_PER_LINE + 1)
+           * (hexdump_line_length(hexdump_offset_digits(nbytes)) + 1) + 1;
+    str = malloc(size);
+    if (str == NULL) {
+        munmap((void *)data, nbytes);
+        return -1;
+    }
+
+    for (hit = hexdump_search_find(&pattern, data, nbytes, 0); hit < nbytes;
+         hit = hexdump_search_find(&pattern, data, nbytes, hit + 1)) {
+        hexdump_search_excerpt(str, size, data, nbytes, hit, pattern.len, context);
+        fprintf(out, "match at 0x%llX\n%s\n", (unsigned long long)hit, str);
+        hits++;
+    }
+
+    free(str);
+    munmap((void *)data, nbytes);
+    return hits;
+}
+
+
+/**
+ *   @brief  Test function to test the hexdump_search_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Invalid patterns
+ *   - Exact, wildcard and masked patterns, hits close to the end of the data
+ *   - Vector and scalar search agree on every hit
+ *   - Excerpt with context rows
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_search(int debug) {
+    const char *patterns[] = { "DE AD BE EF", "DEAD??EF", "?? AD", "80/C0 ?? 0?",
+                               "3?", "??", "EF" };
+    const char *invalid[] = { "", "D", "DE AG", "DE/G0", "DE A" };
+    size_t nbytes = 4096, size = 1024;
+    char str[size];
+    uint8_t *data = malloc(nbytes);
+    hexdump_pattern_t pattern;
+    uint32_t seed = 12345;
+    size_t i, p, a, b, hits;
+    int ret;
+
+    if(debug)
+        printf("\n Test Results for byte pattern search ");
+    if (data == NULL)
+        return 0;
+
+    for (i = 0; i < nbytes; i++) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+    memcpy(data + 100, "\xDE\xAD\xBE\xEF", 4);
+    memcpy(data + 2000, "\xDE\xAD\x00\xEF", 4);
+    memcpy(data + nbytes - 4, "\xDE\xAD\xBE\xEF", 4);
+
+    // Invalid Input Test
+    for (p = 0; p < sizeof(invalid) / sizeof(invalid[0]); p++) {
+        ret = hexdump_search_compile(&pattern, invalid[p]);
+        if(debug)
+            printf("\nPattern: \"%s\", Compile: %d", invalid[p], ret);
+        if(ret != -1) {
+            free(data);
+            return 0;
+        }
+    }
+
+    // Exact pattern, the last hit ends on the last byte
+    hexdump_search_compile(&pattern, "DE AD BE EF");
+    a = hexdump_search_find(&pattern, data, nbytes, 0);
+    b = hexdump_search_find(&pattern, data, nbytes, a + 1);
+        if(debug)
+            printf("\nDE AD BE EF at: %ld, %ld", a, b);
+        if(a != 100 || b != nbytes - 4
+           || hexdump_search_find(&pattern, data, nbytes, b + 1) != nbytes) {
+            free(data);
+            return 0;
+        }
+
+    // Wildcard byte finds the third copy too
+    hexdump_search_compile(&pattern, "DE AD ?? EF");
+        if(hexdump_search_find(&pattern, data, nbytes, 101) != 2000) {
+            free(data);
+            return 0;
+        }
+
+    // Vector and scalar search give the same hits
+    for (p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+        hexdump_search_compile(&pattern, patterns[p]);
+        hits = 0;
+        a = b = 0;
+        while (a < nbytes || b < nbytes) {
+            a = hexdump_search_find(&pattern, data, nbytes, a);
+            b = find_scalar(&pattern, data, nbytes, b);
+            if (a != b) {
+                free(data);
+                return 0;
+            }
+            if (a < nbytes) {
+                hits++;
+                a++;
+                b++;
+            }
+        }
+        if(debug)
+            printf("\nPattern: \"%s\", Hits: %ld", patterns[p], hits);
+    }
+
+    // Excerpt of the hit at 100 with one row of context each side
+    ret = hexdump_search_excerpt(str, size, data, nbytes, 100, 4, 1);
+        if(debug)
+            printf("\nExcerpt: %d\n%s", ret, str);
+        if(ret != 3 * 57 || strncmp(str, "0x0050  ", 8) != 0
+           || strstr(str, "\n0x0060  ") == NULL || strstr(str, "DE AD BE EF") == NULL
+           || strstr(str, "\n0x0070  ") == NULL) {
+            free(data);
+            return 0;
+        }
+
+    // Hit on the last row, context stops at the end of the data
+    ret = hexdump_search_excerpt(str, size, data, nbytes, nbytes - 4, 4, 2);
+        if(debug)
+            printf("\nExcerpt at the end: %d", ret);
+        if(ret != 3 * 57) {
+            free(data);
+            return 0;
+        }
+
+    free(data);
+    return 1;
+}
@@ -0,0 +1,112 @@
+#ifndef HEXDUMP_SEARCH_
+#define HEXDUMP_SEARCH_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_search.h
+ * @brief Search for a byte pattern and print each hit as a hexdump excerpt
+ *
+ * A pattern is written as hex byte pairs, e.g. "DE AD ?? 4? 80/C0":
+ *   - "4?" : '?' is a wildcard nibble
+ *   - "??" : any byte
+ *   - "80/C0" : byte & 0xC0 must be 0x80, the mask selects the bits compared
+ *
+ * Candidates are found by testing the first and the last compared byte of
+ * the pattern 32 positions at a time with AVX2, then verified in full.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#define HEXDUMP_SEARCH_MAX 64   // Longest pattern in bytes
+
+typedef struct {
+    uint8_t value[HEXDUMP_SEARCH_MAX];  // Expected bits of each byte
+    uint8_t mask[HEXDUMP_SEARCH_MAX];   // Bits of each byte which are compared
+    size_t len;                         // Bytes in the pattern
+    size_t first;                       // First byte with a non zero mask
+    size_t last;                        // Last byte with a non zero mask
+} hexdump_pattern_t;
+
+/**
+ *   @brief  Compiles a pattern written as hex byte pairs
+ *
+ *   @param  pattern : Pattern to be compiled
+ *   @param  text : Pattern as text, see the file description
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pattern )
+ */
+int hexdump_search_compile(hexdump_pattern_t *pattern, const char *text);
+
+/**
+ *   @brief  Finds the first occurrence of a pattern at or after from
+ *
+ *   @param  pattern : A compiled pattern
+ *   @param  data : Bytes to be searched
+ *   @param  nbytes : Number of bytes at data
+ *   @param  from : Offset where the search starts
+ *
+ *   @return size_t : Offset of the occurrence, nbytes if there is none
+ */
+size_t hexdump_search_find(const hexdump_pattern_t *pattern, const uint8_t *data,
+                           size_t nbytes, size_t from);
+
+/**
+ *   @brief  Hexdump of the rows holding a hit and of context rows around it
+ *
+ *   @param  str : char array where the excerpt is stored
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  data : Bytes which were searched
+ *   @param  nbytes : Number of bytes at data
+ *   @param  hit : Offset of the hit
+ *   @param  len : Length of the hit
+ *   @param  context : Rows printed before and after the hit
+ *
+ *   @return int : Number of characters written, -1 if str is too small
+ */
+int hexdump_search_excerpt(char *str, size_t size, const uint8_t *data,
+                           size_t nbytes, size_t hit, size_t len, int context);
+
+/**
+ *   @brief  Prints every occurrence of a pattern in a file with context rows
+ *
+ *   @param  path : File to be searched, it is mapped in memory
+ *   @param  text : Pattern as text
+ *   @param  context : Rows printed before and after each hit
+ *   @param  out : Where the excerpts are written
+ *
+ *   @return long : Number of hits, -1 on failure
+ */
+long hexdump_search_file(const char *path, const char *text, int context, FILE *out);
+
+/**
+ *   @brief  Test function to test the hexdump_search_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Invalid patterns
+ *   - Exact, wildcard and masked patterns, hits close to the end of the data
+ *   - Vector and scalar search agree on every hit
+ *   - Excerpt with context rows
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_search(int debug);
+
+#endif /* HEXDUMP_SEARCH_ */
@@ -0,0 +1,324 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_stream.c
+ * @brief Resumable hexdump of data which arrives a piece at a time
+ *
+ * Full lines are formatted straight from the caller's piece; only the bytes
+ * of a line split between two pieces are copied into the context. The offset
+ * column is sized once from the expected length of the stream, as hexdump()
+ * sizes it from nbytes, and only grows if the stream turns out longer.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_operations.h"
+#include "hexdump_stream.h"
+
+
+/**
+ *   @brief  Width of the offset column for a line starting at offset, at
+ *           least digits
+ */
+static int offset_digits(uint64_t offset, int digits) {
+
+    while (digits < 16 && (offset >> (4 * digits)) != 0)
+        digits++;
+    return digits;
+}
+
+
+/**
+ *   @brief  Formats one line followed by '\n' if it fits in str
+ *
+ *   @return int : Number of characters written, 0 if the line does not fit
+ *           together with the terminal '\0'
+ */
+static int emit_line(hexdump_ctx_t *ctx, char *str, size_t room,
+                     const uint8_t *pc, size_t n) {
+    int digits = offset_digits(ctx->offset, ctx->digits);
+    size_t len = hexdump_line_length(digits) + 1;
+    uint8_t swapped[HEXDUMP_BYTES_PER_LINE];
+    int k;
+
+    if (ctx->gutter)
+        len += HEXDUMP_GUTTER_LENGTH;
+    if (len + 1 > room)
+        return 0;
+
+    if (ctx->swap != BIT_SWAP_NONE) {
+        bit_swap(ctx->swap, swapped, pc, n);
+        pc = swapped;
+    }
+
+    k = hexdump_line(str, ctx->offset, digits, pc, n);
+    if (ctx->gutter)
+        k += hexdump_gutter(str + k, pc, n);
+    str[k++] = '\n';
+
+    ctx->offset += n;
+    return k;
+}
+
+
+/**
+ *   @brief  Prepares a context for a new stream
+ *
+ *   @param  ctx : Context to be initialised
+ *   @param  offset : Offset printed for the first byte of the stream
+ *   @param  total : Bytes the stream is expected to have, 0 if unknown
+ *   @param  gutter : 1 to append the ASCII gutter to every line
+ */
+void hexdump_ctx_init(hexdump_ctx_t *ctx, uint64_t offset, uint64_t total, int gutter) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->offset = offset;
+    ctx->gutter = gutter;
+
+    // Width of the offset of the last line, as hexdump() of total bytes
+    ctx->digits = HEXDUMP_OFFSET_DIGITS;
+    if (total > 0)
+        ctx->digits = offset_digits(offset + ((total - 1) & ~(uint64_t)(HEXDUMP_BYTES_PER_LINE - 1)),
+                                    HEXDUMP_OFFSET_DIGITS);
+}
+
+
+/**
+ *   @brief  Dumps the lines completed by the next piece of the stream
+ *
+ *   Lines are written to str as long as they fit, followed by a '\0'. If str
+ *   fills up, *consumed tells how much of loc was used and the caller feeds
+ *   the rest again. At most 15 bytes are held back in the context.
+ *
+ *   @param  ctx : An initialised context
+ *   @param  str : char array where the lines are stored
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  loc : Next piece of the stream
+ *   @param  nbytes : Number of bytes at loc
+ *   @param  consumed : Set to the number of bytes of loc used
+ *
+ *   @return int : Number of characters written, -1 on failure
+ */
+int hexdump_ctx_feed(hexdump_ctx_t *ctx, char *str, size_t size,
+                     const void *loc, size_t nbytes, size_t *consumed) {
+    const uint8_t *pc = (const uint8_t *)loc;
+    size_t used = 0, k = 0, take;
+    int n;
+
+    *consumed = 0;
+
+    // Segmentation Fault Check
+    if (size <= 0)
+        return -1;
+    str[0] = '\0';
+
+    // Complete the line held back from the previous piece
+    if (ctx->pending > 0) {
+        take = HEXDUMP_BYTES_PER_LINE - ctx->pending;
+        if (take > nbytes)
+            take = nbytes;
+        memcpy(ctx->line + ctx->pending, pc, take);
+
+        if (ctx->pending + take == HEXDUMP_BYTES_PER_LINE) {
+            n = emit_line(ctx, str, size, ctx->line, HEXDUMP_BYTES_PER_LINE);
+            if (n == 0)
+                return 0;
+            k += (size_t)n;
+            ctx->pending = 0;
+        }
+        else {
+            ctx->pending += take;
+        }
+        used = take;
+    }
+
+    // Full lines straight from the piece
+    while (nbytes - used >= HEXDUMP_BYTES_PER_LINE) {
+        n = emit_line(ctx, str + k, size - k, pc + used, HEXDUMP_BYTES_PER_LINE);
+        if (n == 0)
+            break;
+        k += (size_t)n;
+        used += HEXDUMP_BYTES_PER_LINE;
+    }
+
+    // Hold back the start of the next line once every full line is out
+    if (nbytes - used < HEXDUMP_BYTES_PER_LINE && ctx->pending == 0) {
+        memcpy(ctx->line, pc + used, nbytes - used);
+        ctx->pending = nbytes - used;
+        used = nbytes;
+    }
+
+    str[k] = '\0';
+    *consumed = used;
+    return (int)k;
+}
+
+
+/**
+ *   @brief  Dumps the last, short line of the stream
+ *
+ *   @param  ctx : An initialised context
+ *   @param  str : char array where the line is stored
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *
+ *   @return int : Number of characters written, -1 if str is too small
+ */
+int hexdump_ctx_finish(hexdump_ctx_t *ctx, char *str, size_t size) {
+    int n;
+
+    // Segmentation Fault Check
+    if (size <= 0)
+        return -1;
+    str[0] = '\0';
+
+    if (ctx->pending == 0)
+        return 0;
+
+    n = emit_line(ctx, str, size, ctx->line, ctx->pending);
+    if (n == 0)
+        return -1;
+
+    str[n] = '\0';
+    ctx->pending = 0;
+    return n;
+}
+
+
+/**
+ *   @brief  Streams 70000 bytes in packets of 1000 and compares the text with
+ *           hexdump() of the whole buffer
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+static int long_stream(int debug) {
+    const size_t nbytes = 70000, size = 70000 / 16 * 64;
+    uint8_t *data = malloc(nbytes);
+    char *str = malloc(size), *expected = malloc(size);
+    hexdump_ctx_t ctx;
+    size_t pos, k = 0, consumed, n;
+    int ret, status = 1;
+
+    if (data == NULL || str == NULL || expected == NULL)
+        status = 0;
+    for (pos = 0; status && pos < nbytes; pos++)
+        data[pos] = (uint8_t)(pos * 13 + (pos >> 8));
+
+    hexdump_ctx_init(&ctx, 0, nbytes, 0);
+    for (pos = 0; status && pos < nbytes; pos += n) {
+        n = nbytes - pos < 1000 ? nbytes - pos : 1000;
+        ret = hexdump_ctx_feed(&ctx, str + k, size - k, data + pos, n, &consumed);
+        if (ret < 0 || consumed != n)
+            status = 0;
+        k += (size_t)ret;
+    }
+    if (status) {
+        ret = hexdump_ctx_finish(&ctx, str + k, size - k);
+        hexdump(expected, size, data, nbytes);
+        strcat(expected, "\n");
+        if (ret < 0 || strcmp(str, expected) != 0)
+            status = 0;
+    }
+        if(debug)
+            printf("\nLong stream: %zu bytes, Result: %d", nbytes, status);
+
+    free(data);
+    free(str);
+    free(expected);
+    return status;
+}
+
+
+/**
+ *   @brief  Test function to test the hexdump_ctx_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Stream fed in uneven packets matches hexdump() of the whole buffer
+ *   - Stream of more than 64 KB keeps the offset width of hexdump()
+ *   - ASCII gutter and a non zero starting offset
+ *   - Output buffer with room for a single line
+ *   - Segmentation Faults Check
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_stream(int debug) {
+    size_t size = 1024;
+    char str[size];
+    char expected[size];
+    uint8_t region[90];
+    const size_t packets[] = { 5, 20, 3, 40, 22 };
+    hexdump_ctx_t ctx;
+    size_t pos = 0, k = 0, consumed, p;
+    int ret, i;
+
+    if(debug)
+        printf("\n Test Results for resumable hexdump context ");
+
+    for (i = 0; i < (int)sizeof(region); i++)
+        region[i] = (uint8_t)(i * 7);
+
+    // Valid Input Test, packets of uneven size
+    hexdump_ctx_init(&ctx, 0, sizeof(region), 0);
+    for (p = 0; p < sizeof(packets) / sizeof(packets[0]); p++) {
+        ret = hexdump_ctx_feed(&ctx, str + k, size - k, region + pos, packets[p], &consumed);
+        if (ret < 0 || consumed != packets[p])
+            return 0;
+        k += (size_t)ret;
+        pos += packets[p];
+    }
+    ret = hexdump_ctx_finish(&ctx, str + k, size - k);
+    hexdump(expected, size, region, sizeof(region));
+    strcat(expected, "\n");
+        if(debug)
+            printf("\nPackets: %d\n%s", ret, str);
+        if(ret < 0 || strcmp(str, expected) != 0)
+            return 0;
+
+    // More than 64 KB, every line as wide as hexdump() prints it
+    if (!long_stream(debug))
+        return 0;
+
+    // Gutter and a starting offset past 16 bits
+    hexdump_ctx_init(&ctx, 0x10000, 0, 1);
+    ret = hexdump_ctx_feed(&ctx, str, size, "To achieve great things", 23, &consumed);
+    k = (size_t)ret;
+    ret = hexdump_ctx_finish(&ctx, str + k, size - k);
+        if(debug)
+            printf("\nGutter: %d\n%s", ret, str);
+        if(ret < 0 || strncmp(str, "0x10000  54 6F ", 15) != 0
+           || strstr(str, "|To achieve great|\n0x10010  ") == NULL
+           || strstr(str, "| things         |\n") == NULL)
+            return 0;
+
+    // Room for a single line, the rest of the piece is fed again
+    hexdump_ctx_init(&ctx, 0, 0, 0);
+    ret = hexdump_ctx_feed(&ctx, str, 60, region, sizeof(region), &consumed);
+        if(debug)
+            printf("\nSmall output: %d, Consumed: %ld", ret, consumed);
+        if(ret != 57 || consumed != 16)
+            return 0;
+
+    // InValid String Size - Segmentation/Bus Fault Test
+    ret = hexdump_ctx_feed(&ctx, str, 0, region, sizeof(region), &consumed);
+        if(debug)
+            printf("\nString Size: %d, Result: %d", 0, ret);
+        if(ret != -1 || consumed != 0)
+            return 0;
+
+    return 1;
+}
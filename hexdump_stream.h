@@ -0,0 +1,104 @@
+#ifndef HEXDUMP_STREAM_
+#define HEXDUMP_STREAM_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bit_swap.h"
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_stream.h
+ * @brief Resumable hexdump of data which arrives a piece at a time
+ *
+ * A context carries the running offset and the bytes of a line which is not
+ * complete yet, so a stream fed in packets of any size is dumped exactly as
+ * if it had been one buffer. Only completed lines are emitted, each ending
+ * with '\n'.
+ *
+ * Given the length of the stream up front, every line has the offset width
+ * hexdump() would print for it. Without one the width grows past 4 digits
+ * only once the offset needs it, so a long stream gets wider lines past
+ * 0xFFFF.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+typedef struct {
+    uint64_t offset;            // Offset of the first byte in line
+    uint8_t line[16];           // Bytes of the line not completed yet
+    size_t pending;             // Number of bytes in line
+    int digits;                 // Narrowest width of the offset column
+    int gutter;                 // Append the ASCII gutter to every line
+    bit_swap_t swap;            // Applied to every line, BIT_SWAP_NONE after init
+} hexdump_ctx_t;
+
+/**
+ *   @brief  Prepares a context for a new stream
+ *
+ *   @param  ctx : Context to be initialised
+ *   @param  offset : Offset printed for the first byte of the stream
+ *   @param  total : Bytes the stream is expected to have, 0 if unknown
+ *   @param  gutter : 1 to append the ASCII gutter to every line
+ */
+void hexdump_ctx_init(hexdump_ctx_t *ctx, uint64_t offset, uint64_t total, int gutter);
+
+/**
+ *   @brief  Dumps the lines completed by the next piece of the stream
+ *
+ *   Lines are written to str as long as they fit, followed by a '\0'. If str
+ *   fills up, *consumed tells how much of loc was used and the caller feeds
+ *   the rest again. At most 15 bytes are held back in the context.
+ *
+ *   @param  ctx : An initialised context
+ *   @param  str : char array where the lines are stored
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  loc : Next piece of the stream
+ *   @param  nbytes : Number of bytes at loc
+ *   @param  consumed : Set to the number of bytes of loc used
+ *
+ *   @return int : Number of characters written, -1 on failure
+ */
+int hexdump_ctx_feed(hexdump_ctx_t *ctx, char *str, size_t size,
+                     const void *loc, size_t nbytes, size_t *consumed);
+
+/**
+ *   @brief  Dumps the last, short line of the stream
+ *
+ *   @param  ctx : An initialised context
+ *   @param  str : char array where the line is stored
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *
+ *   @return int : Number of characters written, -1 if str is too small
+ */
+int hexdump_ctx_finish(hexdump_ctx_t *ctx, char *str, size_t size);
+
+/**
+ *   @brief  Test function to test the hexdump_ctx_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Stream fed in uneven packets matches hexdump() of the whole buffer
+ *   - Stream of more than 64 KB keeps the offset width of hexdump()
+ *   - ASCII gutter and a non zero starting offset
+ *   - Output buffer with room for a single line
+ *   - Segmentation Faults Check
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_stream(int debug);
+
+#endif /* HEXDUMP_STREAM_ */
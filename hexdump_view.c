@@ -0,0 +1,231 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_view.c
+ * @brief A live hexdump view of a memory region which is re-rendered
+ * incrementally
+ *
+ * Every row of a dump is a fixed width line, so row r of the text always
+ * starts at r * (line length + 1). The 16 bytes behind each row are kept as
+ * the row's fingerprint; comparing them is two 64 bit loads, and only rows
+ * whose bytes differ are formatted again.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_operations.h"
+#include "hexdump_view.h"
+
+
+/**
+ *   @brief  Compares the bytes of a row against its snapshot
+ *
+ *   @param  a : Snapshot of the row
+ *   @param  b : Current bytes of the row
+ *   @param  n : Number of bytes in the row
+ *
+ *   @return int ( 1 = Row changed, 0 = Unchanged )
+ */
+static int row_changed(const uint8_t *a, const uint8_t *b, size_t n) {
+    uint64_t a0, a1, b0, b1;
+
+    // Short last row
+    if (n != HEXDUMP_BYTES_PER_LINE)
+        return memcmp(a, b, n) != 0;
+
+    // Full rows are compared as two 64 bit words
+    memcpy(&a0, a, 8);
+    memcpy(&a1, a + 8, 8);
+    memcpy(&b0, b, 8);
+    memcpy(&b1, b + 8, 8);
+    return ((a0 ^ b0) | (a1 ^ b1)) != 0;
+}
+
+
+/**
+ *   @brief  Renders the initial dump of a region into str
+ *
+ *   str receives exactly what hexdump(str, size, loc, nbytes) would produce.
+ *
+ *   @param  view : View to be initialised
+ *   @param  str : char array where the dump is rendered
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  loc : Address in memory of the region to watch
+ *   @param  nbytes : Number of bytes in the region
+ *
+ *   @return int ( 0 = Success, -1 = Failure, str set to the empty string )
+ */
+int hexdump_view_init(hexdump_view_t *view, char *str, size_t size,
+                      const void *loc, size_t nbytes) {
+
+    memset(view, 0, sizeof(*view));
+
+    // Segmentation Fault Check
+    if (size <= 0)
+        return -1;
+
+    hexdump(str, size, loc, nbytes);
+    if (str[0] == '\0')
+        return -1;
+
+    view->str = str;
+    view->size = size;
+    view->loc = (const uint8_t *)loc;
+    view->nbytes = nbytes;
+    view->nrows = (nbytes + HEXDUMP_BYTES_PER_LINE - 1) / HEXDUMP_BYTES_PER_LINE;
+    view->offset_digits = hexdump_offset_digits(nbytes);
+    view->line_length = hexdump_line_length(view->offset_digits) + 1;
+
+    view->snapshot = malloc(nbytes);
+    view->changed_rows = malloc(view->nrows * sizeof(size_t));
+    if (view->snapshot == NULL || view->changed_rows == NULL) {
+        hexdump_view_free(view);
+        str[0] = '\0';
+        return -1;
+    }
+    memcpy(view->snapshot, view->loc, nbytes);
+
+    return 0;
+}
+
+
+/**
+ *   @brief  Re-renders the rows of the region which changed since the last
+ *           render
+ *
+ *   The indices of the rows which were patched are left in view->changed_rows
+ *   in ascending order.
+ *
+ *   @param  view : An initialised view
+ *
+ *   @return int : Number of rows which changed, -1 on failure
+ */
+int hexdump_view_refresh(hexdump_view_t *view) {
+    size_t row, offset, n;
+
+    if (view->snapshot == NULL)
+        return -1;
+
+    view->nchanged = 0;
+    for (row = 0; row < view->nrows; row++) {
+        offset = row * HEXDUMP_BYTES_PER_LINE;
+        n = view->nbytes - offset;
+        if (n > HEXDUMP_BYTES_PER_LINE)
+            n = HEXDUMP_BYTES_PER_LINE;
+
+        if (!row_changed(view->snapshot + offset, view->loc + offset, n))
+            continue;
+
+        // Render from the snapshot so the text always matches the
+        // fingerprint, even if the region changes again meanwhile
+        memcpy(view->snapshot + offset, view->loc + offset, n);
+        hexdump_line(view->str + row * view->line_length, offset,
+                     view->offset_digits, view->snapshot + offset, n);
+        view->changed_rows[view->nchanged++] = row;
+    }
+
+    return (int)view->nchanged;
+}
+
+
+/**
+ *   @brief  Releases the memory held by a view, str is left untouched
+ *
+ *   @param  view : An initialised view
+ */
+void hexdump_view_free(hexdump_view_t *view) {
+    free(view->snapshot);
+    free(view->changed_rows);
+    view->snapshot = NULL;
+    view->changed_rows = NULL;
+    view->nchanged = 0;
+}
+
+
+/**
+ *   @brief  Test function to test the hexdump_view_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Initial render matches hexdump()
+ *   - Refresh with no change, with changes on several rows and on a short
+ *     last row
+ *   - Segmentation Faults Check
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_view(int debug) {
+    size_t size = 1024;
+    char str[size];
+    char expected[size];
+    uint8_t region[90];
+    hexdump_view_t view;
+    int ret, i;
+
+    if(debug)
+        printf("\n Test Results for incremental hexdump view ");
+
+    for (i = 0; i < (int)sizeof(region); i++)
+        region[i] = (uint8_t)i;
+
+    // Valid Input Test, initial render is the same text as hexdump()
+    ret = hexdump_view_init(&view, str, size, region, sizeof(region));
+    hexdump(expected, size, region, sizeof(region));
+        if(debug)
+            printf("\nInit: %d, Rows: %ld\n%s", ret, view.nrows, str);
+        if(ret != 0 || strcmp(str, expected) != 0)
+            return 0;
+
+    // No change, nothing is re-rendered
+    ret = hexdump_view_refresh(&view);
+        if(debug)
+            printf("\nRefresh without changes: %d", ret);
+        if(ret != 0)
+            return 0;
+
+    // Bytes on rows 1 and 3 and on the short last row change
+    region[17] = 0xAB;
+    region[60] = 0xCD;
+    region[89] = 0xEF;
+    ret = hexdump_view_refresh(&view);
+    hexdump(expected, size, region, sizeof(region));
+        if(debug)
+            printf("\nRefresh with changes: %d\n%s", ret, str);
+        if(ret != 3 || view.changed_rows[0] != 1 || view.changed_rows[1] != 3
+           || view.changed_rows[2] != 5 || strcmp(str, expected) != 0)
+            return 0;
+
+    hexdump_view_free(&view);
+
+    // InValid String Size - Segmentation/Bus Fault Test
+    ret = hexdump_view_init(&view, str, 0, region, sizeof(region));
+        if(debug)
+            printf("\nString Size: %d, Init: %d", 0, ret);
+        if(ret != -1 || hexdump_view_refresh(&view) != -1)
+            return 0;
+
+    // String too small for the whole dump
+    ret = hexdump_view_init(&view, str, 100, region, sizeof(region));
+        if(debug)
+            printf("\nString Size: %d, Init: %d", 100, ret);
+        if(ret != -1 || str[0] != '\0')
+            return 0;
+
+    return 1;
+}
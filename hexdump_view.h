@@ -0,0 +1,97 @@
+#ifndef HEXDUMP_VIEW_
+#define HEXDUMP_VIEW_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file hexdump_view.h
+ * @brief A live hexdump view of a memory region which is re-rendered
+ * incrementally
+ *
+ * The view keeps the text rendered by hexdump() together with a snapshot of
+ * the 16 bytes behind every row. A refresh compares each row against its
+ * snapshot and re-formats only the rows that changed, patching them in place
+ * since every line of a dump has the same width.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+typedef struct {
+    char *str;                // Rendered dump, same text as hexdump()
+    size_t size;              // Bytes available at str
+    const uint8_t *loc;       // Region being watched
+    size_t nbytes;            // Size of the region
+    size_t nrows;             // Number of 16 byte rows
+    int offset_digits;        // Width of the offset column
+    size_t line_length;       // Characters per row including the '\n'
+    uint8_t *snapshot;        // Bytes of each row as last rendered
+    size_t *changed_rows;     // Rows re-rendered by the last refresh
+    size_t nchanged;          // Number of entries in changed_rows
+} hexdump_view_t;
+
+/**
+ *   @brief  Renders the initial dump of a region into str
+ *
+ *   str receives exactly what hexdump(str, size, loc, nbytes) would produce.
+ *
+ *   @param  view : View to be initialised
+ *   @param  str : char array where the dump is rendered
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  loc : Address in memory of the region to watch
+ *   @param  nbytes : Number of bytes in the region
+ *
+ *   @return int ( 0 = Success, -1 = Failure, str set to the empty string )
+ */
+int hexdump_view_init(hexdump_view_t *view, char *str, size_t size,
+                      const void *loc, size_t nbytes);
+
+/**
+ *   @brief  Re-renders the rows of the region which changed since the last
+ *           render
+ *
+ *   The indices of the rows which were patched are left in view->changed_rows
+ *   in ascending order.
+ *
+ *   @param  view : An initialised view
+ *
+ *   @return int : Number of rows which changed, -1 on failure
+ */
+int hexdump_view_refresh(hexdump_view_t *view);
+
+/**
+ *   @brief  Releases the memory held by a view, str is left untouched
+ *
+ *   @param  view : An initialised view
+ */
+void hexdump_view_free(hexdump_view_t *view);
+
+/**
+ *   @brief  Test function to test the hexdump_view_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Initial render matches hexdump()
+ *   - Refresh with no change, with changes on several rows and on a short
+ *     last row
+ *   - Segmentation Faults Check
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_hexdump_view(int debug);
+
+#endif /* HEXDUMP_VIEW_ */
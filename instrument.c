@@ -0,0 +1,336 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file instrument.c
+ * @brief Call counters and latency histograms of the bit_operations.h
+ *        functions, compiled in with -DBIT_INSTRUMENT (make INSTRUMENT=1)
+ *
+ * A thread gets its block on its first recorded call and links it into a
+ * list which is never shortened, so the counts of exited threads stay. The
+ * owner updates its counters with relaxed loads and stores (plain mov / add,
+ * no lock prefix), the readers load them relaxed.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define INSTRUMENT_X86
+#endif
+
+#include "bit_operations.h"
+#include "instrument.h"
+
+typedef struct instr_thread {
+    instr_stats_t stats[INSTR_COUNT];
+    struct instr_thread *next;
+} __attribute__((aligned(64))) instr_thread_t;
+
+static const char *instr_names[INSTR_COUNT] = {
+    "uint_to_binstr", "int_to_binstr", "uint_to_hexstr", "uint_to_decstr",
+    "int_to_decstr", "uint_to_decstr_batch", "twiggle_bit", "grab_three_bits", "hexdump",
+};
+
+static __thread instr_thread_t *instr_self;
+static instr_thread_t *instr_threads;
+static pthread_mutex_t instr_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Single writer increment, no locked read-modify-write
+#define INSTR_ADD(counter, v) \
+    __atomic_store_n(&(counter), __atomic_load_n(&(counter), __ATOMIC_RELAXED) + (v), __ATOMIC_RELAXED)
+#define INSTR_LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
+/**
+ *   @brief  log2 bucket of a value : its bit width, capped at the last bucket
+ */
+static inline int instr_bucket(uint64_t v) {
+    int width = v == 0 ? 0 : 64 - __builtin_clzll(v);
+
+    return width < INSTR_BUCKETS ? width : INSTR_BUCKETS - 1;
+}
+
+/**
+ *   @brief  Block of the calling thread, allocated on its first call
+ */
+static instr_thread_t *instr_thread(void) {
+    instr_thread_t *t = aligned_alloc(64, sizeof(instr_thread_t));
+
+    if (t == NULL)
+        return NULL;
+    memset(t, 0, sizeof(*t));
+    pthread_mutex_lock(&instr_lock);
+    t->next = instr_threads;
+    __atomic_store_n(&instr_threads, t, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&instr_lock);
+    instr_self = t;
+    return t;
+}
+
+
+/**
+ *   @brief  Whether the functions were compiled with BIT_INSTRUMENT
+ */
+int instr_enabled(void) {
+#ifdef BIT_INSTRUMENT
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+
+/**
+ *   @brief  Name of an instrumented function
+ */
+const char *instr_name(instr_func_t func) {
+    if (func < 0 || func >= INSTR_COUNT)
+        return "";
+    return instr_names[func];
+}
+
+
+/**
+ *   @brief  Time stamp counter
+ */
+uint64_t instr_now(void) {
+#ifdef INSTRUMENT_X86
+    return __rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+
+/**
+ *   @brief  Records one call of func, made by the calling thread
+ *
+ *   @param  func : Function called
+ *   @param  size : Its nbits, bit, count or nbytes argument
+ *   @param  error : Non zero if it returned an error
+ *   @param  start : instr_now() at the call
+ */
+void instr_record(instr_func_t func, uint64_t size, int error, uint64_t start) {
+    uint64_t cycles = instr_now() - start;
+    instr_thread_t *t = instr_self;
+    instr_stats_t *s;
+
+    if (t == NULL && (t = instr_thread()) == NULL)
+        return;
+    s = &t->stats[func];
+    INSTR_ADD(s->calls, 1);
+    INSTR_ADD(s->errors, error != 0);
+    INSTR_ADD(s->cycles, cycles);
+    INSTR_ADD(s->latency[instr_bucket(cycles)], 1);
+    INSTR_ADD(s->size[instr_bucket(size)], 1);
+}
+
+
+/**
+ *   @brief  Sums the counters of every thread
+ *
+ *   Counts of calls in progress on other threads may be caught half way.
+ *
+ *   @param  stats : Destination of INSTR_COUNT statistics
+ */
+void instr_snapshot(instr_stats_t stats[INSTR_COUNT]) {
+    instr_thread_t *t;
+    int f, b;
+
+    memset(stats, 0, INSTR_COUNT * sizeof(instr_stats_t));
+    for (t = __atomic_load_n(&instr_threads, __ATOMIC_ACQUIRE); t != NULL; t = t->next) {
+        for (f = 0; f < INSTR_COUNT; f++) {
+            stats[f].calls += INSTR_LOAD(t->stats[f].calls);
+            stats[f].errors += INSTR_LOAD(t->stats[f].errors);
+            stats[f].cycles += INSTR_LOAD(t->stats[f].cycles);
+            for (b = 0; b < INSTR_BUCKETS; b++) {
+                stats[f].latency[b] += INSTR_LOAD(t->stats[f].latency[b]);
+                stats[f].size[b] += INSTR_LOAD(t->stats[f].size[b]);
+            }
+        }
+    }
+}
+
+
+/**
+ *   @brief  Zeroes the counters of every thread
+ */
+void instr_reset(void) {
+    instr_thread_t *t;
+    int f, b;
+
+    for (t = __atomic_load_n(&instr_threads, __ATOMIC_ACQUIRE); t != NULL; t = t->next) {
+        for (f = 0; f < INSTR_COUNT; f++) {
+            __atomic_store_n(&t->stats[f].calls, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&t->stats[f].errors, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&t->stats[f].cycles, 0, __ATOMIC_RELAXED);
+            for (b = 0; b < INSTR_BUCKETS; b++) {
+                __atomic_store_n(&t->stats[f].latency[b], 0, __ATOMIC_RELAXED);
+                __atomic_store_n(&t->stats[f].size[b], 0, __ATOMIC_RELAXED);
+            }
+        }
+    }
+}
+
+
+/**
+ *   @brief  Upper bound (2^k cycles) of the bucket holding percentile pct
+ */
+static uint64_t latency_percentile(const instr_stats_t *s, int pct) {
+    uint64_t seen = 0, rank = (s->calls * (uint64_t)pct + 99) / 100;
+    int b;
+
+    for (b = 0; b < INSTR_BUCKETS; b++) {
+        seen += s->latency[b];
+        if (seen >= rank && seen > 0)
+            return 1ULL << b;
+    }
+    return 1ULL << (INSTR_BUCKETS - 1);
+}
+
+
+/**
+ *   @brief  Prints calls, errors, mean cycles and the latency percentiles of
+ *           every function called since the last reset
+ */
+void instr_print(FILE *f) {
+    instr_stats_t stats[INSTR_COUNT];
+    int i;
+
+    if (!instr_enabled()) {
+        fprintf(f, "Instrumentation not compiled in (make INSTRUMENT=1)\n");
+        return;
+    }
+    instr_snapshot(stats);
+    fprintf(f, "%-22s %10s %8s %10s %10s %10s\n", "function", "calls", "errors",
+            "cycles", "p50 <", "p99 <");
+    for (i = 0; i < INSTR_COUNT; i++) {
+        if (stats[i].calls == 0)
+            continue;
+        fprintf(f, "%-22s %10llu %8llu %10.1f %10llu %10llu\n", instr_names[i],
+                (unsigned long long)stats[i].calls, (unsigned long long)stats[i].errors,
+                (double)stats[i].cycles / (double)stats[i].calls,
+                (unsigned long long)latency_percentile(&stats[i], 50),
+                (unsigned long long)latency_percentile(&stats[i], 99));
+    }
+}
+
+
+static void *thread_calls(void *arg) {
+    int i;
+
+    // start_bit 31 is out of range : every call is an error
+    for (i = 0; i < 1000; i++)
+        grab_three_bits((uint32_t)i, 31);
+    return arg;
+}
+
+/**
+ *   @brief  Test function to test the instr_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Calls, error returns and size buckets of known calls
+ *   - Histograms hold every call
+ *   - Counts of several threads add up, reset clears them
+ *   - Compiled out : nothing is recorded
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_instrument(int debug) {
+    instr_stats_t stats[INSTR_COUNT];
+    const int on = instr_enabled();
+    uint64_t sum, start;
+    char str[1024];
+    uint8_t buf[100] = {0};
+    pthread_t threads[2];
+    uint32_t acc = 0;
+    int i, b, status = 1;
+
+    if(debug)
+        printf("\n Test Results for instrumentation (compiled in: %d) ", on);
+
+    instr_reset();
+    for (i = 0; i < 10; i++)
+        uint_to_binstr(str, i < 8 ? sizeof(str) : 0, 5, 8);
+    for (i = 0; i < 3; i++)
+        hexdump(str, sizeof(str), buf, sizeof(buf));
+    // 0xFFFFFFFF from a valid call is not an error, bit 32 is
+    twiggle_bit(0xFFFFFFFE, 0, SET);
+    twiggle_bit(0, 32, SET);
+    instr_snapshot(stats);
+
+    if (stats[INSTR_UINT_TO_BINSTR].calls != (on ? 10u : 0u)
+        || stats[INSTR_UINT_TO_BINSTR].errors != (on ? 2u : 0u)
+        || stats[INSTR_UINT_TO_BINSTR].size[4] != (on ? 10u : 0u)     // nbits 8
+        || stats[INSTR_HEXDUMP].calls != (on ? 3u : 0u)
+        || stats[INSTR_HEXDUMP].errors != 0
+        || stats[INSTR_HEXDUMP].size[7] != (on ? 3u : 0u)             // 100 bytes
+        || stats[INSTR_TWIGGLE_BIT].calls != (on ? 2u : 0u)
+        || stats[INSTR_TWIGGLE_BIT].errors != (on ? 1u : 0u))
+        status = 0;
+    for (i = 0; i < INSTR_COUNT; i++) {
+        for (sum = 0, b = 0; b < INSTR_BUCKETS; b++)
+            sum += stats[i].latency[b];
+        if (sum != stats[i].calls || (stats[i].calls > 0 && stats[i].cycles == 0))
+            status = 0;
+    }
+    if(debug)
+        printf("\nCalls and errors: %llu / %llu, Result: %d",
+               (unsigned long long)stats[INSTR_UINT_TO_BINSTR].calls,
+               (unsigned long long)stats[INSTR_UINT_TO_BINSTR].errors, status);
+
+    // Two threads of 1000 failing calls each
+    for (i = 0; i < 2; i++)
+        if (pthread_create(&threads[i], NULL, thread_calls, NULL) != 0)
+            status = 0;
+    for (i = 0; i < 2; i++)
+        pthread_join(threads[i], NULL);
+    instr_snapshot(stats);
+    if (stats[INSTR_GRAB_THREE_BITS].calls != (on ? 2000u : 0u)
+        || stats[INSTR_GRAB_THREE_BITS].errors != stats[INSTR_GRAB_THREE_BITS].calls
+        || stats[INSTR_UINT_TO_BINSTR].calls != (on ? 10u : 0u))
+        status = 0;
+
+    instr_reset();
+    instr_snapshot(stats);
+    for (i = 0; i < INSTR_COUNT; i++)
+        if (stats[i].calls != 0 || stats[i].latency[0] != 0)
+            status = 0;
+    if(debug)
+        printf("\nThreads and reset, Result: %d", status);
+
+    if (instr_bucket(0) != 0 || instr_bucket(1) != 1 || instr_bucket(32) != 6
+        || instr_bucket(UINT64_MAX) != INSTR_BUCKETS - 1 || instr_name(INSTR_COUNT)[0] != '\0')
+        status = 0;
+
+    // Cost of a call, for the record
+    start = instr_now();
+    for (i = 0; i < 1000000; i++)
+        acc += twiggle_bit((uint32_t)i, i & 31, TOGGLE);
+    if(debug)
+        printf("\ntwiggle_bit: %.1f cycles per call (%u)",
+               (double)(instr_now() - start) / 1000000, acc & 1);
+    instr_reset();
+
+    return status;
+}
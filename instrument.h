@@ -0,0 +1,132 @@
+#ifndef INSTRUMENT_
+#define INSTRUMENT_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file instrument.h
+ * @brief Call counters and latency histograms of the bit_operations.h
+ *        functions, compiled in with -DBIT_INSTRUMENT (make INSTRUMENT=1)
+ *
+ * Every instrumented call records, for its function
+ *   - the call, and the error return if it failed
+ *   - its size argument (nbits, bit, start_bit, count or nbytes) in a log2
+ *     histogram : bucket k holds values of bit width k
+ *   - its time stamp counter cycles, in a log2 histogram the same way
+ * Each thread writes only its own cache line aligned block, with plain
+ * stores, so recording costs two rdtsc and a few adds. instr_snapshot()
+ * adds up the blocks of every thread, including threads which have exited.
+ *
+ * Without BIT_INSTRUMENT the functions are not wrapped at all, and the API
+ * below reports nothing.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+// Definition of an instrumented function : with BIT_INSTRUMENT the body
+// gets another name and a wrapper which records the call takes its place
+#ifdef BIT_INSTRUMENT
+#define INSTRUMENTED(name) name##_uninstrumented
+#else
+#define INSTRUMENTED(name) name
+#endif
+
+#define INSTR_BUCKETS 32    // log2 buckets, the last one takes everything larger
+
+typedef enum {
+    INSTR_UINT_TO_BINSTR,
+    INSTR_INT_TO_BINSTR,
+    INSTR_UINT_TO_HEXSTR,
+    INSTR_UINT_TO_DECSTR,
+    INSTR_INT_TO_DECSTR,
+    INSTR_UINT_TO_DECSTR_BATCH,
+    INSTR_TWIGGLE_BIT,
+    INSTR_GRAB_THREE_BITS,
+    INSTR_HEXDUMP,
+    INSTR_COUNT
+} instr_func_t;
+
+typedef struct {
+    uint64_t calls;
+    uint64_t errors;
+    uint64_t cycles;                    // Total
+    uint64_t latency[INSTR_BUCKETS];    // Calls by log2 of their cycles
+    uint64_t size[INSTR_BUCKETS];       // Calls by log2 of their size argument
+} __attribute__((aligned(64))) instr_stats_t;
+
+/**
+ *   @brief  Whether the functions were compiled with BIT_INSTRUMENT
+ */
+int instr_enabled(void);
+
+/**
+ *   @brief  Name of an instrumented function
+ */
+const char *instr_name(instr_func_t func);
+
+/**
+ *   @brief  Time stamp counter
+ */
+uint64_t instr_now(void);
+
+/**
+ *   @brief  Records one call of func, made by the calling thread
+ *
+ *   @param  func : Function called
+ *   @param  size : Its nbits, bit, count or nbytes argument
+ *   @param  error : Non zero if it returned an error
+ *   @param  start : instr_now() at the call
+ */
+void instr_record(instr_func_t func, uint64_t size, int error, uint64_t start);
+
+/**
+ *   @brief  Sums the counters of every thread
+ *
+ *   Counts of calls in progress on other threads may be caught half way.
+ *
+ *   @param  stats : Destination of INSTR_COUNT statistics
+ */
+void instr_snapshot(instr_stats_t stats[INSTR_COUNT]);
+
+/**
+ *   @brief  Zeroes the counters of every thread
+ */
+void instr_reset(void);
+
+/**
+ *   @brief  Prints calls, errors, mean cycles and the latency percentiles of
+ *           every function called since the last reset
+ */
+void instr_print(FILE *f);
+
+/**
+ *   @brief  Test function to test the instr_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Calls, error returns and size buckets of known calls
+ *   - Histograms hold every call
+ *   - Counts of several threads add up, reset clears them
+ *   - Compiled out : nothing is recorded
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_instrument(int debug);
+
+#endif /* INSTRUMENT_ */
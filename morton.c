@@ -0,0 +1,404 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file morton.c
+ * @brief Morton keys of arrays of points
+ *
+ * Each array function has a PDEP / PEXT kernel, compiled for BMI2 whatever
+ * the compiler flags and picked by cpu_dispatch.h at the avx2 level, and a
+ * magic number kernel.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define MORTON_X86
+#define MORTON_BMI2(kernel) kernel
+#else
+#define MORTON_BMI2(kernel) NULL
+#endif
+
+#include "bit_operations.h"
+#include "cpu_dispatch.h"
+#include "morton.h"
+
+
+static void encode2_magic(uint64_t *keys, const uint32_t *x, const uint32_t *y, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        keys[i] = morton_spread2(x[i]) | (morton_spread2(y[i]) << 1);
+}
+
+static void decode2_magic(uint32_t *x, uint32_t *y, const uint64_t *keys, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        x[i] = (uint32_t)morton_compact2(keys[i]);
+        y[i] = (uint32_t)morton_compact2(keys[i] >> 1);
+    }
+}
+
+static void encode3_magic(uint64_t *keys, const uint32_t *x, const uint32_t *y,
+                          const uint32_t *z, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        keys[i] = morton_spread3(x[i]) | (morton_spread3(y[i]) << 1) | (morton_spread3(z[i]) << 2);
+}
+
+static void decode3_magic(uint32_t *x, uint32_t *y, uint32_t *z, const uint64_t *keys, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        x[i] = (uint32_t)morton_compact3(keys[i]);
+        y[i] = (uint32_t)morton_compact3(keys[i] >> 1);
+        z[i] = (uint32_t)morton_compact3(keys[i] >> 2);
+    }
+}
+
+#ifdef MORTON_X86
+__attribute__((target("bmi2")))
+static void encode2_bmi2(uint64_t *keys, const uint32_t *x, const uint32_t *y, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        keys[i] = _pdep_u64(x[i], MORTON2_MASK_X64) | _pdep_u64(y[i], MORTON2_MASK_Y64);
+}
+
+__attribute__((target("bmi2")))
+static void decode2_bmi2(uint32_t *x, uint32_t *y, const uint64_t *keys, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        x[i] = (uint32_t)_pext_u64(keys[i], MORTON2_MASK_X64);
+        y[i] = (uint32_t)_pext_u64(keys[i], MORTON2_MASK_Y64);
+    }
+}
+
+__attribute__((target("bmi2")))
+static void encode3_bmi2(uint64_t *keys, const uint32_t *x, const uint32_t *y,
+                         const uint32_t *z, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        keys[i] = _pdep_u64(x[i], MORTON3_MASK_X64) | _pdep_u64(y[i], MORTON3_MASK_Y64)
+                  | _pdep_u64(z[i], MORTON3_MASK_Z64);
+}
+
+__attribute__((target("bmi2")))
+static void decode3_bmi2(uint32_t *x, uint32_t *y, uint32_t *z, const uint64_t *keys, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        x[i] = (uint32_t)_pext_u64(keys[i], MORTON3_MASK_X64);
+        y[i] = (uint32_t)_pext_u64(keys[i], MORTON3_MASK_Y64);
+        z[i] = (uint32_t)_pext_u64(keys[i], MORTON3_MASK_Z64);
+    }
+}
+#endif
+
+/**
+ *   @brief  1 if the CPU has PDEP / PEXT
+ */
+static int has_bmi2(void) {
+#ifdef MORTON_X86
+    static int bmi2 = -1;
+
+    if (bmi2 < 0)
+        bmi2 = __builtin_cpu_supports("bmi2") ? 1 : 0;
+    return bmi2;
+#else
+    return 0;
+#endif
+}
+
+typedef void (*encode2_fn)(uint64_t *keys, const uint32_t *x, const uint32_t *y, size_t n);
+typedef void (*decode2_fn)(uint32_t *x, uint32_t *y, const uint64_t *keys, size_t n);
+typedef void (*encode3_fn)(uint64_t *keys, const uint32_t *x, const uint32_t *y,
+                           const uint32_t *z, size_t n);
+typedef void (*decode3_fn)(uint32_t *x, uint32_t *y, uint32_t *z, const uint64_t *keys, size_t n);
+
+static cpu_point_t encode2_point = CPU_POINT("morton2_encode64_array", encode2_magic, NULL,
+                                             MORTON_BMI2(encode2_bmi2), NULL);
+static cpu_point_t decode2_point = CPU_POINT("morton2_decode64_array", decode2_magic, NULL,
+                                             MORTON_BMI2(decode2_bmi2), NULL);
+static cpu_point_t encode3_point = CPU_POINT("morton3_encode64_array", encode3_magic, NULL,
+                                             MORTON_BMI2(encode3_bmi2), NULL);
+static cpu_point_t decode3_point = CPU_POINT("morton3_decode64_array", decode3_magic, NULL,
+                                             MORTON_BMI2(decode3_bmi2), NULL);
+CPU_DISPATCH_REGISTER(encode2_point)
+CPU_DISPATCH_REGISTER(decode2_point)
+CPU_DISPATCH_REGISTER(encode3_point)
+CPU_DISPATCH_REGISTER(decode3_point)
+
+
+/**
+ *   @brief  2-D keys of n points
+ *
+ *   @param  keys : Destination of n keys
+ *   @param  x : n x coordinates
+ *   @param  y : n y coordinates
+ *   @param  n : Number of points
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pointer )
+ */
+int morton2_encode64_array(uint64_t *keys, const uint32_t *x, const uint32_t *y, size_t n) {
+    if (n > 0 && (keys == NULL || x == NULL || y == NULL))
+        return -1;
+    ((encode2_fn)cpu_resolve(&encode2_point))(keys, x, y, n);
+    return 0;
+}
+
+/**
+ *   @brief  Coordinates of n 2-D keys
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pointer )
+ */
+int morton2_decode64_array(uint32_t *x, uint32_t *y, const uint64_t *keys, size_t n) {
+    if (n > 0 && (keys == NULL || x == NULL || y == NULL))
+        return -1;
+    ((decode2_fn)cpu_resolve(&decode2_point))(x, y, keys, n);
+    return 0;
+}
+
+/**
+ *   @brief  3-D keys of n points, 21 bit coordinates
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pointer )
+ */
+int morton3_encode64_array(uint64_t *keys, const uint32_t *x, const uint32_t *y,
+                           const uint32_t *z, size_t n) {
+    if (n > 0 && (keys == NULL || x == NULL || y == NULL || z == NULL))
+        return -1;
+    ((encode3_fn)cpu_resolve(&encode3_point))(keys, x, y, z, n);
+    return 0;
+}
+
+/**
+ *   @brief  Coordinates of n 3-D keys
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pointer )
+ */
+int morton3_decode64_array(uint32_t *x, uint32_t *y, uint32_t *z,
+                           const uint64_t *keys, size_t n) {
+    if (n > 0 && (keys == NULL || x == NULL || y == NULL || z == NULL))
+        return -1;
+    ((decode3_fn)cpu_resolve(&decode3_point))(x, y, z, keys, n);
+    return 0;
+}
+
+
+/**
+ *   @brief  Key built one bit at a time, as a set_bit() loop would
+ *
+ *   @param  c : Coordinates
+ *   @param  dims : Number of coordinates, 2 or 3
+ *   @param  bits : Bits taken from each coordinate
+ */
+static uint64_t interleave_loop(const uint32_t *c, int dims, int bits) {
+    uint64_t key = 0;
+    int i, d;
+
+    for (i = 0; i < bits; i++)
+        for (d = 0; d < dims; d++)
+            key |= (uint64_t)((c[d] >> i) & 1) << (dims * i + d);
+    return key;
+}
+
+
+/**
+ *   @brief  Prints the time per 2-D and 3-D key of a bit by bit loop, the
+ *           magic number shifts, PDEP and the array functions
+ *
+ *   @param  count : Number of keys built by each method
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int morton_bench(size_t count) {
+    const char *names[] = { "loop", "magic", "pdep", "array" };
+    uint32_t *c = malloc(3 * count * sizeof(uint32_t));
+    uint64_t *keys = malloc(count * sizeof(uint64_t));
+    uint32_t xyz[3], seed = 39;
+    struct timespec start, end;
+    uint64_t sink = 0;
+    int dims, method;
+    size_t i;
+    double ns;
+
+    if (c == NULL || keys == NULL || count == 0) {
+        free(c);
+        free(keys);
+        return -1;
+    }
+    for (i = 0; i < 3 * count; i++) {
+        seed = seed * 1103515245u + 12345u;
+        c[i] = seed;
+    }
+
+    for (dims = 2; dims <= 3; dims++) {
+        for (method = 0; method < 4; method++) {
+            if (method == 2 && !has_bmi2())
+                continue;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if (method == 0) {
+                for (i = 0; i < count; i++) {
+                    xyz[0] = c[i];
+                    xyz[1] = c[count + i];
+                    xyz[2] = c[2 * count + i];
+                    keys[i] = interleave_loop(xyz, dims, dims == 2 ? 32 : 21);
+                }
+            }
+            else if (method == 1 && dims == 2)
+                encode2_magic(keys, c, c + count, count);
+            else if (method == 1)
+                encode3_magic(keys, c, c + count, c + 2 * count, count);
+#ifdef MORTON_X86
+            else if (method == 2 && dims == 2)
+                encode2_bmi2(keys, c, c + count, count);
+            else if (method == 2)
+                encode3_bmi2(keys, c, c + count, c + 2 * count, count);
+#endif
+            else if (dims == 2)
+                morton2_encode64_array(keys, c, c + count, count);
+            else
+                morton3_encode64_array(keys, c, c + count, c + 2 * count, count);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+
+            sink += keys[count / 2];
+            ns = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+            printf("%d-D %-6s: %6.2f ns/key\n", dims, names[method], ns / (double)count);
+        }
+    }
+
+    free(c);
+    free(keys);
+    return sink == 0 ? -1 : 0;
+}
+
+
+/**
+ *   @brief  Test function to test the morton*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every key width against a bit by bit loop, all ones and single bits
+ *   - Magic number and PDEP / PEXT kernels agree
+ *   - Decode of an encode gives back the coordinates
+ *   - Arrays, and invalid pointers
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_morton(int debug) {
+    enum { N = 200 };
+    uint32_t x[N], y[N], z[N], dx[N], dy[N], dz[N], c[3];
+    uint64_t keys[N], keys2[N];
+    uint32_t seed = 1729, k32, a, b, d;
+    uint16_t a16, b16;
+    int i, status = 1;
+
+    if(debug)
+        printf("\n Test Results for Morton keys ");
+
+    x[0] = y[0] = z[0] = 0;
+    x[1] = y[1] = z[1] = UINT32_MAX;
+    for (i = 2; i < 34; i++) {
+        x[i] = 1u << (i - 2);
+        y[i] = 0;
+        z[i] = 1u << ((i + 5) % 32);
+    }
+    for (; i < N; i++) {
+        seed = seed * 1103515245u + 12345u;
+        x[i] = seed;
+        seed = seed * 1103515245u + 12345u;
+        y[i] = seed;
+        seed = seed * 1103515245u + 12345u;
+        z[i] = seed;
+    }
+
+    // Single keys against the bit by bit loop
+    for (i = 0; i < N; i++) {
+        c[0] = x[i];
+        c[1] = y[i];
+        c[2] = z[i];
+
+        k32 = morton2_encode32((uint16_t)x[i], (uint16_t)y[i]);
+        morton2_decode32(k32, &a16, &b16);
+        if (k32 != (uint32_t)interleave_loop(c, 2, 16) || a16 != (uint16_t)x[i] || b16 != (uint16_t)y[i])
+            status = 0;
+
+        keys[i] = morton2_encode64(x[i], y[i]);
+        morton2_decode64(keys[i], &a, &b);
+        if (keys[i] != interleave_loop(c, 2, 32) || a != x[i] || b != y[i])
+            status = 0;
+
+        k32 = morton3_encode32(x[i], y[i], z[i]);
+        morton3_decode32(k32, &a, &b, &d);
+        if (k32 != (uint32_t)interleave_loop(c, 3, 10)
+            || a != (x[i] & 0x3FF) || b != (y[i] & 0x3FF) || d != (z[i] & 0x3FF))
+            status = 0;
+
+        keys[i] = morton3_encode64(x[i], y[i], z[i]);
+        morton3_decode64(keys[i], &a, &b, &d);
+        if (keys[i] != interleave_loop(c, 3, 21)
+            || a != (x[i] & 0x1FFFFF) || b != (y[i] & 0x1FFFFF) || d != (z[i] & 0x1FFFFF))
+            status = 0;
+    }
+        if(debug)
+            printf("\nSingle keys: %d, Result: %d", N, status);
+
+    // Arrays, both kernels
+    morton2_encode64_array(keys, x, y, N);
+    encode2_magic(keys2, x, y, N);
+    morton2_decode64_array(dx, dy, keys, N);
+    if (memcmp(keys, keys2, sizeof(keys)) != 0 || memcmp(dx, x, sizeof(x)) != 0
+        || memcmp(dy, y, sizeof(y)) != 0)
+        status = 0;
+    decode2_magic(dx, dy, keys, N);
+    if (memcmp(dx, x, sizeof(x)) != 0 || memcmp(dy, y, sizeof(y)) != 0)
+        status = 0;
+
+    morton3_encode64_array(keys, x, y, z, N);
+    encode3_magic(keys2, x, y, z, N);
+    morton3_decode64_array(dx, dy, dz, keys, N);
+    if (memcmp(keys, keys2, sizeof(keys)) != 0)
+        status = 0;
+    decode3_magic(x, y, z, keys, N);
+    for (i = 0; i < N; i++)
+        if (dx[i] != x[i] || dy[i] != y[i] || dz[i] != z[i] || x[i] > 0x1FFFFF)
+            status = 0;
+#ifdef MORTON_X86
+    if (has_bmi2()) {
+        encode2_bmi2(keys2, x, y, N);
+        encode2_magic(keys, x, y, N);
+        if (memcmp(keys, keys2, sizeof(keys)) != 0)
+            status = 0;
+    }
+#endif
+        if(debug)
+            printf("\nArrays: %d, BMI2: %d, Result: %d", N, has_bmi2(), status);
+
+    // Invalid pointers
+    if (morton2_encode64_array(NULL, x, y, N) != -1 || morton3_decode64_array(dx, dy, NULL, keys, N) != -1)
+        status = 0;
+
+    return status;
+}
@@ -0,0 +1,252 @@
+#ifndef MORTON_
+#define MORTON_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file morton.h
+ * @brief Morton (Z-order) keys, interleaving the bits of 2 or 3 coordinates
+ *
+ * Bit i of x goes to bit 2i (2-D) or 3i (3-D) of the key, y and z follow one
+ * and two bits above. Functions are named after the width of the key :
+ *   - morton2_*32 : 2-D, 16 bit coordinates, 32 bit key
+ *   - morton2_*64 : 2-D, 32 bit coordinates, 64 bit key
+ *   - morton3_*32 : 3-D, 10 bit coordinates, 32 bit key
+ *   - morton3_*64 : 3-D, 21 bit coordinates, 64 bit key
+ * Higher coordinate bits are ignored.
+ *
+ * The single key functions are inline and use PDEP / PEXT when the compiler
+ * targets BMI2 (-mbmi2 or a -march which has it), magic number shifts
+ * otherwise. The array functions pick BMI2 at run time.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#define MORTON_INLINE static inline __attribute__((always_inline))
+
+// Key bits of x, y and z
+#define MORTON2_MASK_X64 0x5555555555555555ULL
+#define MORTON2_MASK_Y64 0xAAAAAAAAAAAAAAAAULL
+#define MORTON3_MASK_X64 0x1249249249249249ULL
+#define MORTON3_MASK_Y64 0x2492492492492492ULL
+#define MORTON3_MASK_Z64 0x4924924924924924ULL
+#define MORTON3_MASK_X32 0x09249249u
+#define MORTON3_MASK_Y32 0x12492492u
+#define MORTON3_MASK_Z32 0x24924924u
+
+// ************************ Magic number shifts  ************************************
+
+/**
+ *   @brief  Moves bit i of the low 32 bits of x to bit 2i
+ */
+MORTON_INLINE uint64_t morton_spread2(uint64_t x) {
+    x &= 0xFFFFFFFFULL;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x << 2)) & 0x3333333333333333ULL;
+    x = (x | (x << 1)) & 0x5555555555555555ULL;
+    return x;
+}
+
+/**
+ *   @brief  Moves bit 2i of x to bit i, the inverse of morton_spread2()
+ */
+MORTON_INLINE uint64_t morton_compact2(uint64_t x) {
+    x &= 0x5555555555555555ULL;
+    x = (x | (x >> 1)) & 0x3333333333333333ULL;
+    x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+    return x;
+}
+
+/**
+ *   @brief  Moves bit i of the low 21 bits of x to bit 3i
+ */
+MORTON_INLINE uint64_t morton_spread3(uint64_t x) {
+    x &= 0x1FFFFFULL;
+    x = (x | (x << 32)) & 0x001F00000000FFFFULL;
+    x = (x | (x << 16)) & 0x001F0000FF0000FFULL;
+    x = (x | (x << 8)) & 0x100F00F00F00F00FULL;
+    x = (x | (x << 4)) & 0x10C30C30C30C30C3ULL;
+    x = (x | (x << 2)) & 0x1249249249249249ULL;
+    return x;
+}
+
+/**
+ *   @brief  Moves bit 3i of x to bit i, the inverse of morton_spread3()
+ */
+MORTON_INLINE uint64_t morton_compact3(uint64_t x) {
+    x &= 0x1249249249249249ULL;
+    x = (x | (x >> 2)) & 0x10C30C30C30C30C3ULL;
+    x = (x | (x >> 4)) & 0x100F00F00F00F00FULL;
+    x = (x | (x >> 8)) & 0x001F0000FF0000FFULL;
+    x = (x | (x >> 16)) & 0x001F00000000FFFFULL;
+    x = (x | (x >> 32)) & 0x00000000001FFFFFULL;
+    return x;
+}
+
+// ************************ Single keys  ************************************
+
+MORTON_INLINE uint32_t morton2_encode32(uint16_t x, uint16_t y) {
+#ifdef __BMI2__
+    return _pdep_u32(x, (uint32_t)MORTON2_MASK_X64) | _pdep_u32(y, (uint32_t)MORTON2_MASK_Y64);
+#else
+    return (uint32_t)(morton_spread2(x) | (morton_spread2(y) << 1));
+#endif
+}
+
+MORTON_INLINE void morton2_decode32(uint32_t key, uint16_t *x, uint16_t *y) {
+#ifdef __BMI2__
+    *x = (uint16_t)_pext_u32(key, (uint32_t)MORTON2_MASK_X64);
+    *y = (uint16_t)_pext_u32(key, (uint32_t)MORTON2_MASK_Y64);
+#else
+    *x = (uint16_t)morton_compact2(key);
+    *y = (uint16_t)morton_compact2(key >> 1);
+#endif
+}
+
+MORTON_INLINE uint64_t morton2_encode64(uint32_t x, uint32_t y) {
+#ifdef __BMI2__
+    return _pdep_u64(x, MORTON2_MASK_X64) | _pdep_u64(y, MORTON2_MASK_Y64);
+#else
+    return morton_spread2(x) | (morton_spread2(y) << 1);
+#endif
+}
+
+MORTON_INLINE void morton2_decode64(uint64_t key, uint32_t *x, uint32_t *y) {
+#ifdef __BMI2__
+    *x = (uint32_t)_pext_u64(key, MORTON2_MASK_X64);
+    *y = (uint32_t)_pext_u64(key, MORTON2_MASK_Y64);
+#else
+    *x = (uint32_t)morton_compact2(key);
+    *y = (uint32_t)morton_compact2(key >> 1);
+#endif
+}
+
+MORTON_INLINE uint32_t morton3_encode32(uint32_t x, uint32_t y, uint32_t z) {
+#ifdef __BMI2__
+    return _pdep_u32(x, MORTON3_MASK_X32) | _pdep_u32(y, MORTON3_MASK_Y32)
+           | _pdep_u32(z, MORTON3_MASK_Z32);
+#else
+    return (uint32_t)(morton_spread3(x & 0x3FF) | (morton_spread3(y & 0x3FF) << 1)
+                      | (morton_spread3(z & 0x3FF) << 2));
+#endif
+}
+
+MORTON_INLINE void morton3_decode32(uint32_t key, uint32_t *x, uint32_t *y, uint32_t *z) {
+#ifdef __BMI2__
+    *x = _pext_u32(key, MORTON3_MASK_X32);
+    *y = _pext_u32(key, MORTON3_MASK_Y32);
+    *z = _pext_u32(key, MORTON3_MASK_Z32);
+#else
+    *x = (uint32_t)morton_compact3(key & MORTON3_MASK_X32);
+    *y = (uint32_t)morton_compact3((key >> 1) & MORTON3_MASK_X32);
+    *z = (uint32_t)morton_compact3((key >> 2) & MORTON3_MASK_X32);
+#endif
+}
+
+MORTON_INLINE uint64_t morton3_encode64(uint32_t x, uint32_t y, uint32_t z) {
+#ifdef __BMI2__
+    return _pdep_u64(x, MORTON3_MASK_X64) | _pdep_u64(y, MORTON3_MASK_Y64)
+           | _pdep_u64(z, MORTON3_MASK_Z64);
+#else
+    return morton_spread3(x) | (morton_spread3(y) << 1) | (morton_spread3(z) << 2);
+#endif
+}
+
+MORTON_INLINE void morton3_decode64(uint64_t key, uint32_t *x, uint32_t *y, uint32_t *z) {
+#ifdef __BMI2__
+    *x = (uint32_t)_pext_u64(key, MORTON3_MASK_X64);
+    *y = (uint32_t)_pext_u64(key, MORTON3_MASK_Y64);
+    *z = (uint32_t)_pext_u64(key, MORTON3_MASK_Z64);
+#else
+    *x = (uint32_t)morton_compact3(key);
+    *y = (uint32_t)morton_compact3(key >> 1);
+    *z = (uint32_t)morton_compact3(key >> 2);
+#endif
+}
+
+// ************************ Arrays  ************************************
+
+/**
+ *   @brief  2-D keys of n points
+ *
+ *   @param  keys : Destination of n keys
+ *   @param  x : n x coordinates
+ *   @param  y : n y coordinates
+ *   @param  n : Number of points
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pointer )
+ */
+int morton2_encode64_array(uint64_t *keys, const uint32_t *x, const uint32_t *y, size_t n);
+
+/**
+ *   @brief  Coordinates of n 2-D keys
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pointer )
+ */
+int morton2_decode64_array(uint32_t *x, uint32_t *y, const uint64_t *keys, size_t n);
+
+/**
+ *   @brief  3-D keys of n points, 21 bit coordinates
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pointer )
+ */
+int morton3_encode64_array(uint64_t *keys, const uint32_t *x, const uint32_t *y,
+                           const uint32_t *z, size_t n);
+
+/**
+ *   @brief  Coordinates of n 3-D keys
+ *
+ *   @return int ( 0 = Success, -1 = Invalid pointer )
+ */
+int morton3_decode64_array(uint32_t *x, uint32_t *y, uint32_t *z,
+                           const uint64_t *keys, size_t n);
+
+/**
+ *   @brief  Prints the time per 2-D and 3-D key of a bit by bit loop, the
+ *           magic number shifts, PDEP and the array functions
+ *
+ *   @param  count : Number of keys built by each method
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int morton_bench(size_t count);
+
+/**
+ *   @brief  Test function to test the morton*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every key width against a bit by bit loop, all ones and single bits
+ *   - Magic number and PDEP / PEXT kernels agree
+ *   - Decode of an encode gives back the coordinates
+ *   - Arrays, and invalid pointers
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_morton(int debug);
+
+#endif /* MORTON_ */
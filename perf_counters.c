@@ -0,0 +1,241 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file perf_counters.c
+ * @brief Hardware performance counters of the calling thread (perf_event_open)
+ *
+ * The counters run from perf_counters_open() on; start and stop read them
+ * and keep the difference, so no ioctl is needed around a measurement.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perf_counters.h"
+
+typedef struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} perf_desc_t;
+
+#define CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const perf_desc_t perf_desc[PERF_COUNTER_COUNT] = {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "l1d_misses", PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D) },
+    { "llc_misses", PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL) },
+    { "dtlb_misses", PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB) },
+    { "page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+};
+
+/**
+ *   @brief  Reads value, time enabled and time running of a counter
+ */
+static int read_counter(int fd, uint64_t v[3]) {
+    return read(fd, v, 3 * sizeof(uint64_t)) == (ssize_t)(3 * sizeof(uint64_t)) ? 0 : -1;
+}
+
+
+/**
+ *   @brief  Name of a counter, as used in the JSON report of the benchmarks
+ */
+const char *perf_counter_name(perf_counter_t counter) {
+    if (counter < 0 || counter >= PERF_COUNTER_COUNT)
+        return "";
+    return perf_desc[counter].name;
+}
+
+
+/**
+ *   @brief  Opens every counter the kernel permits for the calling thread
+ *
+ *   @param  pc : Counters
+ *
+ *   @return int : Number of counters opened, 0 if none is permitted
+ */
+int perf_counters_open(perf_counters_t *pc) {
+    struct perf_event_attr attr;
+    int i;
+
+    memset(pc, 0, sizeof(*pc));
+    for (i = 0; i < PERF_COUNTER_COUNT; i++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perf_desc[i].type;
+        attr.config = perf_desc[i].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // ENOENT, EACCES, EOPNOTSUPP ... : the counter is left out
+        pc->fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (pc->fd[i] >= 0)
+            pc->opened++;
+    }
+    return pc->opened;
+}
+
+
+/**
+ *   @brief  Starts counting / reads the counts since perf_counters_start()
+ *
+ *   @param  pc : Opened counters
+ *   @param  counts : Destination of PERF_COUNTER_COUNT counts, scaled for
+ *                    multiplexing, 0 for an unavailable counter
+ *
+ *   @return unsigned : Bit mask (1 << perf_counter_t) of the counters
+ *                      available in counts
+ */
+void perf_counters_start(perf_counters_t *pc) {
+    uint64_t v[3];
+    int i;
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (pc->fd[i] < 0 || read_counter(pc->fd[i], v) < 0)
+            continue;
+        pc->start[i] = v[0];
+        pc->enabled[i] = v[1];
+        pc->running[i] = v[2];
+    }
+}
+
+unsigned perf_counters_stop(perf_counters_t *pc, uint64_t counts[PERF_COUNTER_COUNT]) {
+    uint64_t v[3], value, enabled, running;
+    unsigned mask = 0;
+    int i;
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++) {
+        counts[i] = 0;
+        if (pc->fd[i] < 0 || read_counter(pc->fd[i], v) < 0)
+            continue;
+        value = v[0] - pc->start[i];
+        enabled = v[1] - pc->enabled[i];
+        running = v[2] - pc->running[i];
+
+        // Never on the PMU during the measurement
+        if (running == 0)
+            continue;
+        if (running < enabled)
+            value = (uint64_t)((double)value * (double)enabled / (double)running);
+        counts[i] = value;
+        mask |= 1u << i;
+    }
+    return mask;
+}
+
+
+/**
+ *   @brief  Closes the counters
+ */
+void perf_counters_close(perf_counters_t *pc) {
+    int i;
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (pc->fd[i] >= 0)
+            close(pc->fd[i]);
+        pc->fd[i] = -1;
+    }
+    pc->opened = 0;
+}
+
+
+/**
+ *   @brief  Test function to test the perf_counters_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Opening never fails, and unavailable counters read as 0
+ *   - Counts grow with the work done between start and stop
+ *   - Page faults of touching fresh pages are counted when permitted
+ *   - Closing twice
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_perf_counters(int debug) {
+    uint64_t small[PERF_COUNTER_COUNT], large[PERF_COUNTER_COUNT];
+    const size_t pages = 256, page = 4096;
+    volatile uint64_t acc = 0;
+    unsigned mask_small, mask_large;
+    perf_counters_t pc;
+    uint8_t *mem;
+    int opened, i, status = 1;
+    size_t k;
+
+    if(debug)
+        printf("\n Test Results for performance counters ");
+
+    opened = perf_counters_open(&pc);
+    if (opened < 0 || opened > PERF_COUNTER_COUNT)
+        status = 0;
+    if(debug) {
+        printf("\nCounters opened: %d", opened);
+        for (i = 0; i < PERF_COUNTER_COUNT; i++)
+            printf(" %s:%s", perf_counter_name((perf_counter_t)i), pc.fd[i] >= 0 ? "yes" : "no");
+    }
+
+    // Some work, then 100 times as much
+    perf_counters_start(&pc);
+    for (k = 0; k < 10000; k++)
+        acc += k * k;
+    mask_small = perf_counters_stop(&pc, small);
+
+    perf_counters_start(&pc);
+    for (k = 0; k < 1000000; k++)
+        acc += k * k;
+    mask_large = perf_counters_stop(&pc, large);
+
+    for (i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (!(mask_small & (1u << i)) && small[i] != 0)
+            status = 0;
+        if (i == PERF_INSTRUCTIONS && (mask_small & mask_large & (1u << i))
+            && large[i] < 10 * small[i])
+            status = 0;
+    }
+    if ((mask_small | mask_large) >> PERF_COUNTER_COUNT)
+        status = 0;
+
+    // Touching fresh pages faults once per page, mmap as malloc may hand
+    // out pages touched before
+    mem = mmap(NULL, pages * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    perf_counters_start(&pc);
+    for (k = 0; mem != MAP_FAILED && k < pages; k++)
+        mem[k * page] = (uint8_t)k;
+    mask_large = perf_counters_stop(&pc, large);
+    if (mem == MAP_FAILED || ((mask_large & (1u << PERF_PAGE_FAULTS)) && large[PERF_PAGE_FAULTS] == 0))
+        status = 0;
+    if (mem != MAP_FAILED)
+        munmap(mem, pages * page);
+    if(debug)
+        printf("\nPage faults: %llu, Result: %d", (unsigned long long)large[PERF_PAGE_FAULTS], status);
+
+    perf_counters_close(&pc);
+    perf_counters_close(&pc);
+    if (pc.opened != 0 || perf_counter_name(PERF_COUNTER_COUNT)[0] != '\0'
+        || strcmp(perf_counter_name(PERF_CYCLES), "cycles") != 0)
+        status = 0;
+
+    return status;
+}
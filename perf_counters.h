@@ -0,0 +1,99 @@
+#ifndef PERF_COUNTERS_
+#define PERF_COUNTERS_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file perf_counters.h
+ * @brief Hardware performance counters of the calling thread (perf_event_open)
+ *
+ * Each counter is opened on its own, user space only, so whatever the
+ * kernel permits is counted and the rest is reported as unavailable: under
+ * perf_event_paranoid 3, in most containers and in VMs without a virtual
+ * PMU, nothing but the page faults. Counts are scaled when the kernel
+ * multiplexes more counters than the PMU has.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+typedef enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,        // L1 data cache read misses
+    PERF_LLC_MISSES,        // Last level cache read misses
+    PERF_DTLB_MISSES,       // Data TLB read misses
+    PERF_PAGE_FAULTS,       // Software counter, usually permitted
+    PERF_COUNTER_COUNT
+} perf_counter_t;
+
+typedef struct {
+    int fd[PERF_COUNTER_COUNT];         // -1 when not permitted
+    int opened;                         // Number of counters open
+    uint64_t start[PERF_COUNTER_COUNT];
+    uint64_t enabled[PERF_COUNTER_COUNT];
+    uint64_t running[PERF_COUNTER_COUNT];
+} perf_counters_t;
+
+/**
+ *   @brief  Name of a counter, as used in the JSON report of the benchmarks
+ */
+const char *perf_counter_name(perf_counter_t counter);
+
+/**
+ *   @brief  Opens every counter the kernel permits for the calling thread
+ *
+ *   @param  pc : Counters
+ *
+ *   @return int : Number of counters opened, 0 if none is permitted
+ */
+int perf_counters_open(perf_counters_t *pc);
+
+/**
+ *   @brief  Starts counting / reads the counts since perf_counters_start()
+ *
+ *   @param  pc : Opened counters
+ *   @param  counts : Destination of PERF_COUNTER_COUNT counts, scaled for
+ *                    multiplexing, 0 for an unavailable counter
+ *
+ *   @return unsigned : Bit mask (1 << perf_counter_t) of the counters
+ *                      available in counts
+ */
+void perf_counters_start(perf_counters_t *pc);
+unsigned perf_counters_stop(perf_counters_t *pc, uint64_t counts[PERF_COUNTER_COUNT]);
+
+/**
+ *   @brief  Closes the counters
+ */
+void perf_counters_close(perf_counters_t *pc);
+
+/**
+ *   @brief  Test function to test the perf_counters_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Opening never fails, and unavailable counters read as 0
+ *   - Counts grow with the work done between start and stop
+ *   - Page faults of touching fresh pages are counted when permitted
+ *   - Closing twice
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_perf_counters(int debug);
+
+#endif /* PERF_COUNTERS_ */
@@ -0,0 +1,361 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file radix_pow2.c
+ * @brief Formatters for base 4, octal and base 32
+ *
+ * Each formatter is the engine of radix_pow2.h with its bits per digit fixed.
+ * Binary and hex digits, and the hex columns of hexdump lines, also have
+ * SIMD kernels : every bit or nibble gets a byte lane (PSHUFB), which is
+ * compared against its bit or looked up in the digit table.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RADIX_POW2_X86
+#endif
+
+#include "bit_operations.h"
+#include "cpu_dispatch.h"
+#include "radix_pow2.h"
+
+
+int uint_to_quatstr(char *str, size_t size, uint32_t num, uint8_t nbits) {
+    return radix_pow2_format(str, size, num, nbits, 2);
+}
+
+int uint_to_octstr(char *str, size_t size, uint32_t num, uint8_t nbits) {
+    return radix_pow2_format(str, size, num, nbits, 3);
+}
+
+int uint_to_b32str(char *str, size_t size, uint32_t num, uint8_t nbits) {
+    return radix_pow2_format(str, size, num, nbits, 5);
+}
+
+
+/**
+ *   @brief  Returns the length of the base 2^bits_per_digit representation of
+ *           an unsigned uint32_t integer stored in str
+ *
+ *   Picks the kernel of the base at run time, for callers which only know
+ *   the base then.
+ *
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  num : Integer to be converted
+ *   @param  nbits : It is the number of bits of the input, num must fit in it
+ *   @param  bits_per_digit : 1 - 5
+ *
+ *   @return int : Length of the string, -1 on failure
+ */
+int uint_to_radixstr(char *str, size_t size, uint32_t num, uint8_t nbits,
+                     int bits_per_digit) {
+    switch (bits_per_digit) {
+    case 1:
+        return radix_pow2_format(str, size, num, nbits, 1);
+    case 2:
+        return radix_pow2_format(str, size, num, nbits, 2);
+    case 3:
+        return radix_pow2_format(str, size, num, nbits, 3);
+    case 4:
+        return radix_pow2_format(str, size, num, nbits, 4);
+    case 5:
+        return radix_pow2_format(str, size, num, nbits, 5);
+    default:
+        if (size > 0)
+            str[0] = '\0';
+        return -1;
+    }
+}
+
+
+// ************************ Binary and hex kernels  ************************************
+
+static void write_bin_scalar(char *str, uint32_t num, int width) {
+    radix_pow2_write(str, num, width, 1);
+}
+
+static void write_hex_scalar(char *str, uint32_t num, int width) {
+    radix_pow2_write(str, num, width, 4);
+}
+
+static void hex_bytes_scalar(char *str, const uint8_t *pc) {
+    int i;
+
+    for (i = 0; i < HEXDUMP_BYTES_PER_LINE; i++) {
+        str[3 * i] = radix_pow2_digit[pc[i] >> 4];
+        str[3 * i + 1] = radix_pow2_digit[pc[i] & 0xF];
+        str[3 * i + 2] = ' ';
+    }
+}
+
+/**
+ *   @brief  Writes width digits from the 32 (binary) or 8 (hex) digits of a
+ *           kernel, '0's first when width is larger
+ */
+static void write_digits(char *str, const char *digits, int all, int width) {
+    if (width >= all) {
+        memset(str, '0', (size_t)(width - all));
+        memcpy(str + width - all, digits, (size_t)all);
+    }
+    else if (width > 0)
+        memcpy(str, digits + all - width, (size_t)width);
+}
+
+#ifdef RADIX_POW2_X86
+/**
+ *   @brief  Binary digit j (most significant first) is bit 7 - j % 8 of
+ *           byte 3 - j / 8 of num
+ */
+__attribute__((target("ssse3")))
+static void write_bin_ssse3(char *str, uint32_t num, int width) {
+    const __m128i bits = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1,
+                                       (char)0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i v = _mm_cvtsi32_si128((int)num);
+    __m128i hi, lo;
+    char digits[32];
+
+    hi = _mm_shuffle_epi8(v, _mm_setr_epi8(3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2));
+    lo = _mm_shuffle_epi8(v, _mm_setr_epi8(1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0));
+    // A set bit compares to -1, and '0' - -1 is '1'
+    hi = _mm_sub_epi8(zero, _mm_cmpeq_epi8(_mm_and_si128(hi, bits), bits));
+    lo = _mm_sub_epi8(zero, _mm_cmpeq_epi8(_mm_and_si128(lo, bits), bits));
+    _mm_storeu_si128((__m128i *)digits, hi);
+    _mm_storeu_si128((__m128i *)(digits + 16), lo);
+    write_digits(str, digits, 32, width);
+}
+
+__attribute__((target("avx2")))
+static void write_bin_avx2(char *str, uint32_t num, int width) {
+    const __m256i bits = _mm256_set1_epi64x((long long)0x0102040810204080ULL);
+    const __m256i index = _mm256_setr_epi8(3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2,
+                                           1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32((int)num), index);
+    char digits[32];
+
+    v = _mm256_sub_epi8(_mm256_set1_epi8('0'), _mm256_cmpeq_epi8(_mm256_and_si256(v, bits), bits));
+    _mm256_storeu_si256((__m256i *)digits, v);
+    write_digits(str, digits, 32, width);
+}
+
+/**
+ *   @brief  Nibbles of the byte swapped num, most significant first, looked
+ *           up in the digit table
+ */
+__attribute__((target("ssse3")))
+static void write_hex_ssse3(char *str, uint32_t num, int width) {
+    const __m128i table = _mm_loadu_si128((const __m128i *)radix_pow2_digit);
+    const __m128i low = _mm_set1_epi8(0x0F);
+    const __m128i v = _mm_cvtsi32_si128((int)__builtin_bswap32(num));
+    __m128i nibbles;
+    char digits[16];
+
+    nibbles = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(v, 4), low), _mm_and_si128(v, low));
+    _mm_storeu_si128((__m128i *)digits, _mm_shuffle_epi8(table, nibbles));
+    write_digits(str, digits, 8, width);
+}
+
+/**
+ *   @brief  16 bytes to 32 hex digits, then spread to "XX " by three
+ *           shuffles with the spaces or'ed in
+ */
+__attribute__((target("ssse3")))
+static void hex_bytes_ssse3(char *str, const uint8_t *pc) {
+    const __m128i table = _mm_loadu_si128((const __m128i *)radix_pow2_digit);
+    const __m128i low = _mm_set1_epi8(0x0F);
+    const __m128i v = _mm_loadu_si128((const __m128i *)pc);
+    const __m128i hi = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), low));
+    const __m128i lo = _mm_shuffle_epi8(table, _mm_and_si128(v, low));
+    const __m128i a = _mm_unpacklo_epi8(hi, lo), b = _mm_unpackhi_epi8(hi, lo);
+    const char z = (char)0x80;
+    __m128i out;
+
+    out = _mm_shuffle_epi8(a, _mm_setr_epi8(0, 1, z, 2, 3, z, 4, 5, z, 6, 7, z, 8, 9, z, 10));
+    out = _mm_or_si128(out, _mm_setr_epi8(0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0));
+    _mm_storeu_si128((__m128i *)str, out);
+
+    out = _mm_or_si128(
+        _mm_shuffle_epi8(a, _mm_setr_epi8(11, z, 12, 13, z, 14, 15, z, z, z, z, z, z, z, z, z)),
+        _mm_shuffle_epi8(b, _mm_setr_epi8(z, z, z, z, z, z, z, z, 0, 1, z, 2, 3, z, 4, 5)));
+    out = _mm_or_si128(out, _mm_setr_epi8(0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0));
+    _mm_storeu_si128((__m128i *)(str + 16), out);
+
+    out = _mm_shuffle_epi8(b, _mm_setr_epi8(z, 6, 7, z, 8, 9, z, 10, 11, z, 12, 13, z, 14, 15, z));
+    out = _mm_or_si128(out, _mm_setr_epi8(' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' '));
+    _mm_storeu_si128((__m128i *)(str + 32), out);
+}
+#endif
+
+typedef void (*write_fn)(char *str, uint32_t num, int width);
+typedef void (*hex_bytes_fn)(char *str, const uint8_t *pc);
+
+static cpu_point_t write_bin_point = CPU_POINT("radix_pow2_write_bin", write_bin_scalar,
+                                               CPU_X86(write_bin_ssse3), CPU_X86(write_bin_avx2), NULL);
+static cpu_point_t write_hex_point = CPU_POINT("radix_pow2_write_hex", write_hex_scalar,
+                                               CPU_X86(write_hex_ssse3), NULL, NULL);
+static cpu_point_t hex_bytes_point = CPU_POINT("radix_pow2_hex_bytes", hex_bytes_scalar,
+                                               CPU_X86(hex_bytes_ssse3), NULL, NULL);
+CPU_DISPATCH_REGISTER(write_bin_point)
+CPU_DISPATCH_REGISTER(write_hex_point)
+CPU_DISPATCH_REGISTER(hex_bytes_point)
+
+void radix_pow2_write_bin(char *str, uint32_t num, int width) {
+    ((write_fn)cpu_resolve(&write_bin_point))(str, num, width);
+}
+
+void radix_pow2_write_hex(char *str, uint32_t num, int width) {
+    ((write_fn)cpu_resolve(&write_hex_point))(str, num, width);
+}
+
+void radix_pow2_hex_bytes(char *str, const uint8_t *pc) {
+    ((hex_bytes_fn)cpu_resolve(&hex_bytes_point))(str, pc);
+}
+
+
+/**
+ *   @brief  Reference conversion with / and %, to check the engine against
+ */
+static int reference(char *str, uint32_t num, uint8_t nbits, int k) {
+    int width = (nbits + k - 1) / k, i;
+
+    str[0] = '0';
+    str[1] = radix_pow2_prefix[k];
+    for (i = width + 1; i >= 2; i--) {
+        str[i] = radix_pow2_digit[num % (1u << k)];
+        num /= (1u << k);
+    }
+    str[width + 2] = '\0';
+    return width + 2;
+}
+
+
+/**
+ *   @brief  Test function to test the base 2^k formatters
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every base against a reference using / and %, nbits not a multiple of
+ *     the bits per digit
+ *   - Numbers which do not fit in nbits and strings which are too small
+ *   - Invalid bits per digit
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_radix_pow2(int debug) {
+    const uint32_t nums[] = { 0, 1, 5, 31, 32, 255, 4096, 0x12345678, UINT32_MAX };
+    const uint8_t widths[] = { 7, 8, 16, 31, 32, 40 };
+    char str[128], expected[128];
+    uint8_t bytes[16];
+    size_t i, w;
+    int k, ret, len;
+
+    if(debug)
+        printf("\n Test Results for base 2^k formatting ");
+
+    // Valid Check Input, every base against the reference
+    for (k = 1; k <= 5; k++) {
+        for (i = 0; i < sizeof(nums) / sizeof(nums[0]); i++) {
+            for (w = 0; w < sizeof(widths); w++) {
+                if (widths[w] < 32 && (nums[i] >> widths[w]) != 0)
+                    continue;
+                ret = uint_to_radixstr(str, sizeof(str), nums[i], widths[w], k);
+                len = reference(expected, nums[i], widths[w], k);
+                if (ret != len || strcmp(str, expected) != 0) {
+                    if(debug)
+                        printf("\nBits per digit: %d, Num: %u, nbits: %d, String: %s",
+                               k, nums[i], widths[w], str);
+                    return 0;
+                }
+            }
+        }
+    }
+
+    // Binary and hex kernels of the CPU level against the engine, widths
+    // below and above the 32 bits of num
+    for (i = 0; i < sizeof(nums) / sizeof(nums[0]); i++) {
+        for (len = 0; len <= 40; len++) {
+            memset(str, '#', sizeof(str));
+            memset(expected, '#', sizeof(expected));
+            radix_pow2_write_bin(str, nums[i], len);
+            radix_pow2_write(expected, nums[i], len, 1);
+            if (memcmp(str, expected, 48) != 0)
+                return 0;
+            radix_pow2_write_hex(str, nums[i], len / 4);
+            radix_pow2_write(expected, nums[i], len / 4, 4);
+            if (memcmp(str, expected, 48) != 0)
+                return 0;
+        }
+    }
+    for (i = 0; i < 16; i++)
+        bytes[i] = (uint8_t)(nums[i % 9] * 37u + i * 0x11u);
+    radix_pow2_hex_bytes(str, bytes);
+    hex_bytes_scalar(expected, bytes);
+        if(debug)
+            printf("\nHex columns: %.48s", str);
+        if(memcmp(str, expected, 48) != 0)
+            return 0;
+
+    // Specialised kernels
+    ret = uint_to_octstr(str, sizeof(str), 0755, 9);
+        if(debug)
+            printf("\nOctal: %s, Length: %d", str, ret);
+        if(ret != 5 || strcmp(str, "0o755") != 0)
+            return 0;
+
+    ret = uint_to_quatstr(str, sizeof(str), 27, 8);
+        if(debug)
+            printf("\nBase 4: %s, Length: %d", str, ret);
+        if(ret != 6 || strcmp(str, "0q0123") != 0)
+            return 0;
+
+    ret = uint_to_b32str(str, sizeof(str), UINT32_MAX, 32);
+        if(debug)
+            printf("\nBase 32: %s, Length: %d", str, ret);
+        if(ret != 9 || strcmp(str, "0v3VVVVVV") != 0)
+            return 0;
+
+    // Invalid Check Input, does not fit in nbits
+    ret = uint_to_octstr(str, sizeof(str), 512, 9);
+        if(debug)
+            printf("\nString Size: %ld, Num: %d, nbits: %d, Length: %d", sizeof(str), 512, 9, ret);
+        if(ret != -1 || str[0] != '\0')
+            return 0;
+
+    // Invalid Check Input, no room for the '\0'
+    ret = uint_to_b32str(str, 4, 31, 10);
+        if(debug)
+            printf("\nString Size: %d, Num: %d, nbits: %d, Length: %d", 4, 31, 10, ret);
+        if(ret != -1 || str[0] != '\0')
+            return 0;
+
+    ret = uint_to_quatstr(str, sizeof(str), 1, 0);
+        if(ret != -1)
+            return 0;
+
+    // Invalid bits per digit
+    ret = uint_to_radixstr(str, sizeof(str), 1, 8, 6);
+        if(debug)
+            printf("\nBits per digit: %d, Length: %d", 6, ret);
+        if(ret != -1 || str[0] != '\0')
+            return 0;
+
+    return 1;
+}
@@ -0,0 +1,191 @@
+#ifndef RADIX_POW2_
+#define RADIX_POW2_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bit_count.h"
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file radix_pow2.h
+ * @brief Formatting of integers in a base which is a power of two
+ *
+ * One engine handles 1 to 5 bits per digit : binary, base 4, octal, hex and
+ * base 32. Digit counts come from count leading zeros and digits are taken
+ * out with a shift and a mask, never with / or %. The bits per digit are
+ * passed to always inlined helpers as constants, so every base gets its own
+ * kernel with the shift, the mask and the rounding folded in.
+ *
+ *   Layout of a string, as for uint_to_binstr() and uint_to_hexstr() :
+ *   "0<prefix><digits>" with the digits padded with '0's to fill nbits
+ *
+ *   Bits per digit : 1 "0b", 2 "0q", 3 "0o", 4 "0x", 5 "0v"
+ *   Base 32 digits are 0-9 and A-V, extending the hex digits.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#define RADIX_POW2_INLINE static inline __attribute__((always_inline))
+
+static const char radix_pow2_digit[] = "0123456789ABCDEFGHIJKLMNOPQRSTUV";
+static const char radix_pow2_prefix[] = "?bqoxv";
+
+/**
+ *   @brief  Number of significant bits of num, 0 for 0
+ */
+RADIX_POW2_INLINE int radix_pow2_bits(uint32_t num) {
+    return bit_width32(num);
+}
+
+/**
+ *   @brief  Number of digits of num in base 2^k, 0 for 0
+ */
+RADIX_POW2_INLINE int radix_pow2_digits(uint32_t num, const int k) {
+    return (radix_pow2_bits(num) + k - 1) / k;
+}
+
+/**
+ *   @brief  Writes the lowest width digits of num in base 2^k, most
+ *           significant first. Neither a prefix nor a '\0' is written.
+ */
+RADIX_POW2_INLINE void radix_pow2_write(char *str, uint32_t num, int width,
+                                        const int k) {
+    int i;
+
+    for (i = width - 1; i >= 0; i--) {
+        str[i] = radix_pow2_digit[num & ((1u << k) - 1)];
+        num >>= k;
+    }
+}
+
+/**
+ *   @brief  Formats num in base 2^k with a prefix, padded to the digits of
+ *           nbits bits
+ *
+ *   @return int : Length of the string, -1 if num does not fit in nbits or str
+ *                 is too small (str is then an empty string)
+ */
+RADIX_POW2_INLINE int radix_pow2_format(char *str, size_t size, uint32_t num,
+                                        uint8_t nbits, const int k) {
+    int width;
+
+    if (size <= 0)
+        return -1;
+    str[0] = '\0';
+
+    width = (nbits + k - 1) / k;
+    if (nbits <= 0 || radix_pow2_bits(num) > nbits || (size_t)width + 3 > size)
+        return -1;
+
+    str[0] = '0';
+    str[1] = radix_pow2_prefix[k];
+    radix_pow2_write(str + 2, num, width, k);
+    str[width + 2] = '\0';
+    return width + 2;
+}
+
+/**
+ *   @brief  radix_pow2_write() for binary / hex, with the SIMD kernel of the
+ *           CPU level (cpu_dispatch.h). Digits past the 32 bits of num are
+ *           '0's.
+ *
+ *   @param  str : Destination of width digits, no '\0' is written
+ *   @param  num : Integer to be converted
+ *   @param  width : Number of digits
+ */
+void radix_pow2_write_bin(char *str, uint32_t num, int width);
+void radix_pow2_write_hex(char *str, uint32_t num, int width);
+
+/**
+ *   @brief  Hex columns of a full hexdump line : "XX " for each of 16 bytes,
+ *           48 characters and no '\0', with the SIMD kernel of the CPU level
+ */
+void radix_pow2_hex_bytes(char *str, const uint8_t *pc);
+
+/**
+ *   @brief  Returns the length of the base 4 representation of an unsigned
+ *           uint32_t integer stored in str, "0q..."
+ *
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  num : Integer to be converted
+ *   @param  nbits : It is the number of bits of the input, num must fit in it
+ *
+ *   @return int : Length of the string, -1 on failure
+ */
+int uint_to_quatstr(char *str, size_t size, uint32_t num, uint8_t nbits);
+
+/**
+ *   @brief  Returns the length of the octal representation of an unsigned
+ *           uint32_t integer stored in str, "0o..."
+ *
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  num : Integer to be converted
+ *   @param  nbits : It is the number of bits of the input, num must fit in it
+ *
+ *   @return int : Length of the string, -1 on failure
+ */
+int uint_to_octstr(char *str, size_t size, uint32_t num, uint8_t nbits);
+
+/**
+ *   @brief  Returns the length of the base 32 representation of an unsigned
+ *           uint32_t integer stored in str, "0v..."
+ *
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  num : Integer to be converted
+ *   @param  nbits : It is the number of bits of the input, num must fit in it
+ *
+ *   @return int : Length of the string, -1 on failure
+ */
+int uint_to_b32str(char *str, size_t size, uint32_t num, uint8_t nbits);
+
+/**
+ *   @brief  Returns the length of the base 2^bits_per_digit representation of
+ *           an unsigned uint32_t integer stored in str
+ *
+ *   Picks the kernel of the base at run time, for callers which only know
+ *   the base then.
+ *
+ *   @param  str : Pointer to a char data set
+ *   @param  size : char array Instantiated of at 'size' bytes
+ *   @param  num : Integer to be converted
+ *   @param  nbits : It is the number of bits of the input, num must fit in it
+ *   @param  bits_per_digit : 1 - 5
+ *
+ *   @return int : Length of the string, -1 on failure
+ */
+int uint_to_radixstr(char *str, size_t size, uint32_t num, uint8_t nbits,
+                     int bits_per_digit);
+
+/**
+ *   @brief  Test function to test the base 2^k formatters
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every base against a reference using / and %, nbits not a multiple of
+ *     the bits per digit
+ *   - Numbers which do not fit in nbits and strings which are too small
+ *   - Invalid bits per digit
+ *   - SIMD binary, hex and hex column kernels against the engine
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_radix_pow2(int debug);
+
+#endif /* RADIX_POW2_ */
@@ -0,0 +1,1153 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file roaring.c
+ * @brief Compressed bitmap of 32 bit values (roaring bitmap)
+ *
+ * Set operations work container by container. Run containers are expanded
+ * to an array or a bitmap first, so every pair of operands is array/array,
+ * array/bitmap or bitmap/bitmap. Bitmap/bitmap combines 1024 words with
+ * AVX-512 or AVX2 (scalar otherwise, see cpu_dispatch.h) and counts the
+ * result with bit_popcount_array(). A result of ROARING_ARRAY_MAX values or
+ * less is stored as an array.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ROARING_X86
+#endif
+
+#include "bit_operations.h"
+#include "bit_count.h"
+#include "cpu_dispatch.h"
+#include "roaring.h"
+
+enum { ROARING_ARRAY = 1, ROARING_BITMAP = 2, ROARING_RUN = 3 };
+enum { OP_OR, OP_AND, OP_ANDNOT };
+
+#define ROARING_MAGIC 0x314D4252u   // "RBM1"
+#define BITMAP_BYTES (ROARING_BITMAP_WORDS * sizeof(uint64_t))
+
+typedef struct {
+    uint32_t magic;
+    uint32_t count;
+} roaring_header_t;
+
+typedef struct {
+    uint16_t key;
+    uint8_t type;
+    uint8_t zero;
+    uint32_t cardinality;
+    uint32_t n;
+    uint32_t offset;
+} roaring_desc_t;
+
+
+// ************************ Containers  ************************************
+
+/**
+ *   @brief  Bytes of the payload of a container
+ */
+static size_t payload_bytes(const roaring_container_t *c) {
+    if (c->type == ROARING_BITMAP)
+        return BITMAP_BYTES;
+    return (size_t)c->n * (c->type == ROARING_RUN ? 4 : 2);
+}
+
+static void container_release(roaring_container_t *c) {
+    if (c->owned)
+        free(c->data);
+    c->data = NULL;
+    c->owned = 0;
+}
+
+/**
+ *   @brief  Makes data of a container its own, copying it out of a view
+ */
+static int container_own(roaring_container_t *c) {
+    size_t bytes = payload_bytes(c);
+    void *data;
+
+    if (c->owned)
+        return 0;
+    data = malloc(bytes ? bytes : 1);
+    if (data == NULL)
+        return -1;
+    memcpy(data, c->data, bytes);
+    c->data = data;
+    c->owned = 1;
+    c->capacity = c->type == ROARING_BITMAP ? ROARING_BITMAP_WORDS : c->n;
+    return 0;
+}
+
+static int container_copy(roaring_container_t *dst, const roaring_container_t *src) {
+    *dst = *src;
+    dst->owned = 0;
+    return container_own(dst);
+}
+
+/**
+ *   @brief  Sets values start to start + len - 1 of a bitmap
+ */
+static void words_set_range(uint64_t *words, uint32_t start, uint32_t len) {
+    uint32_t end = start + len, first = start / 64, last = (end - 1) / 64, w;
+    uint64_t lo = ~0ULL << (start % 64), hi = ~0ULL >> (63 - (end - 1) % 64);
+
+    if (first == last) {
+        words[first] |= lo & hi;
+        return;
+    }
+    words[first] |= lo;
+    for (w = first + 1; w < last; w++)
+        words[w] = ~0ULL;
+    words[last] |= hi;
+}
+
+static int container_to_bitmap(roaring_container_t *c) {
+    uint64_t *words = calloc(ROARING_BITMAP_WORDS, sizeof(uint64_t));
+    const uint16_t *v = (const uint16_t *)c->data;
+    uint32_t i;
+
+    if (words == NULL)
+        return -1;
+    if (c->type == ROARING_ARRAY)
+        for (i = 0; i < c->n; i++)
+            words[v[i] >> 6] |= 1ULL << (v[i] & 63);
+    else if (c->type == ROARING_RUN)
+        for (i = 0; i < c->n; i++)
+            words_set_range(words, v[2 * i], (uint32_t)v[2 * i + 1] + 1);
+    else
+        memcpy(words, c->data, BITMAP_BYTES);
+
+    container_release(c);
+    c->type = ROARING_BITMAP;
+    c->data = words;
+    c->owned = 1;
+    c->n = c->capacity = ROARING_BITMAP_WORDS;
+    return 0;
+}
+
+static int container_to_array(roaring_container_t *c) {
+    uint16_t *values = malloc(c->cardinality ? c->cardinality * sizeof(uint16_t) : 1);
+    const uint16_t *runs = (const uint16_t *)c->data;
+    const uint64_t *words = (const uint64_t *)c->data;
+    uint32_t i, n = 0, v;
+    uint64_t w;
+
+    if (values == NULL)
+        return -1;
+    if (c->type == ROARING_BITMAP) {
+        for (i = 0; i < ROARING_BITMAP_WORDS; i++)
+            for (w = words[i]; w != 0; w &= w - 1)
+                values[n++] = (uint16_t)(i * 64 + (uint32_t)__builtin_ctzll(w));
+    }
+    else if (c->type == ROARING_RUN) {
+        for (i = 0; i < c->n; i++)
+            for (v = runs[2 * i]; v <= (uint32_t)runs[2 * i] + runs[2 * i + 1]; v++)
+                values[n++] = (uint16_t)v;
+    }
+    else
+        memcpy(values, c->data, c->n * sizeof(uint16_t));
+
+    container_release(c);
+    c->type = ROARING_ARRAY;
+    c->data = values;
+    c->owned = 1;
+    c->n = c->capacity = c->cardinality;
+    return 0;
+}
+
+/**
+ *   @brief  Turns a run container into an array or a bitmap
+ */
+static int container_expand(roaring_container_t *c) {
+    if (c->type != ROARING_RUN)
+        return 0;
+    return c->cardinality <= ROARING_ARRAY_MAX ? container_to_array(c) : container_to_bitmap(c);
+}
+
+/**
+ *   @brief  Index of the first array value >= low
+ */
+static uint32_t array_lower_bound(const uint16_t *v, uint32_t n, uint16_t low) {
+    uint32_t lo = 0, hi = n, mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (v[mid] < low)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static int container_test(const roaring_container_t *c, uint16_t low) {
+    const uint16_t *v = (const uint16_t *)c->data;
+    uint32_t lo = 0, hi = c->n, mid, i;
+
+    if (c->type == ROARING_BITMAP)
+        return (int)((((const uint64_t *)c->data)[low >> 6] >> (low & 63)) & 1);
+    if (c->type == ROARING_ARRAY) {
+        i = array_lower_bound(v, c->n, low);
+        return i < c->n && v[i] == low;
+    }
+
+    // Last run starting at or before low
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (v[2 * mid] <= low)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo > 0 && low <= (uint32_t)v[2 * (lo - 1)] + v[2 * (lo - 1) + 1];
+}
+
+/**
+ *   @brief  Adds a value to a container
+ *
+ *   @return int : 1 if added, 0 if already there, -1 if out of memory
+ */
+static int container_add(roaring_container_t *c, uint16_t low) {
+    uint16_t *v, *grown;
+    uint64_t *words;
+    uint32_t i;
+
+    if (container_test(c, low))
+        return 0;
+    if (container_expand(c) < 0 || container_own(c) < 0)
+        return -1;
+    if (c->type == ROARING_ARRAY && c->cardinality >= ROARING_ARRAY_MAX
+        && container_to_bitmap(c) < 0)
+        return -1;
+
+    if (c->type == ROARING_ARRAY) {
+        if (c->n == c->capacity) {
+            grown = realloc(c->data, (c->capacity ? 2 * c->capacity : 4) * sizeof(uint16_t));
+            if (grown == NULL)
+                return -1;
+            c->data = grown;
+            c->capacity = c->capacity ? 2 * c->capacity : 4;
+        }
+        v = (uint16_t *)c->data;
+        i = array_lower_bound(v, c->n, low);
+        memmove(v + i + 1, v + i, (c->n - i) * sizeof(uint16_t));
+        v[i] = low;
+        c->n++;
+    }
+    else {
+        words = (uint64_t *)c->data;
+        words[low >> 6] |= 1ULL << (low & 63);
+    }
+    c->cardinality++;
+    return 1;
+}
+
+/**
+ *   @brief  Removes a value from a container
+ *
+ *   @return int : 1 if removed, 0 if it was not there, -1 if out of memory
+ */
+static int container_remove(roaring_container_t *c, uint16_t low) {
+    uint16_t *v;
+    uint64_t *words;
+    uint32_t i;
+
+    if (!container_test(c, low))
+        return 0;
+    if (container_expand(c) < 0 || container_own(c) < 0)
+        return -1;
+
+    if (c->type == ROARING_ARRAY) {
+        v = (uint16_t *)c->data;
+        i = array_lower_bound(v, c->n, low);
+        memmove(v + i, v + i + 1, (c->n - i - 1) * sizeof(uint16_t));
+        c->n--;
+        c->cardinality--;
+        return 1;
+    }
+
+    words = (uint64_t *)c->data;
+    words[low >> 6] &= ~(1ULL << (low & 63));
+    c->cardinality--;
+    if (c->cardinality <= ROARING_ARRAY_MAX && container_to_array(c) < 0)
+        return -1;
+    return 1;
+}
+
+
+// ************************ Bitmap container operations  ************************************
+
+static void words_op_scalar(uint64_t *dst, const uint64_t *a, const uint64_t *b, int op) {
+    int i;
+
+    for (i = 0; i < ROARING_BITMAP_WORDS; i++)
+        dst[i] = op == OP_OR ? a[i] | b[i] : op == OP_AND ? a[i] & b[i] : a[i] & ~b[i];
+}
+
+#ifdef ROARING_X86
+__attribute__((target("avx2")))
+static void words_op_avx2(uint64_t *dst, const uint64_t *a, const uint64_t *b, int op) {
+    __m256i va, vb;
+    int i;
+
+    for (i = 0; i < ROARING_BITMAP_WORDS; i += 4) {
+        va = _mm256_loadu_si256((const __m256i *)(a + i));
+        vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        if (op == OP_OR)
+            va = _mm256_or_si256(va, vb);
+        else if (op == OP_AND)
+            va = _mm256_and_si256(va, vb);
+        else
+            va = _mm256_andnot_si256(vb, va);
+        _mm256_storeu_si256((__m256i *)(dst + i), va);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void words_op_avx512(uint64_t *dst, const uint64_t *a, const uint64_t *b, int op) {
+    __m512i va, vb;
+    int i;
+
+    for (i = 0; i < ROARING_BITMAP_WORDS; i += 8) {
+        va = _mm512_loadu_si512(a + i);
+        vb = _mm512_loadu_si512(b + i);
+        if (op == OP_OR)
+            va = _mm512_or_si512(va, vb);
+        else if (op == OP_AND)
+            va = _mm512_and_si512(va, vb);
+        else
+            va = _mm512_andnot_si512(vb, va);
+        _mm512_storeu_si512(dst + i, va);
+    }
+}
+#endif
+
+typedef void (*words_op_fn)(uint64_t *dst, const uint64_t *a, const uint64_t *b, int op);
+
+static cpu_point_t words_op_point = CPU_POINT("roaring_or/and/andnot", words_op_scalar, NULL,
+                                              CPU_X86(words_op_avx2), CPU_X86(words_op_avx512));
+CPU_DISPATCH_REGISTER(words_op_point)
+
+/**
+ *   @brief  Combines two bitmap containers word by word, dst may be a
+ */
+static void words_op(uint64_t *dst, const uint64_t *a, const uint64_t *b, int op) {
+    ((words_op_fn)cpu_resolve(&words_op_point))(dst, a, b, op);
+}
+
+/**
+ *   @brief  Stores a bitmap result as an array if it is small enough
+ */
+static int bitmap_result(roaring_container_t *out) {
+    out->cardinality = (uint32_t)bit_popcount_array(out->data, BITMAP_BYTES);
+    if (out->cardinality <= ROARING_ARRAY_MAX)
+        return container_to_array(out);
+    return 0;
+}
+
+/**
+ *   @brief  Combines two array or bitmap containers into out
+ */
+static int container_op(roaring_container_t *out, const roaring_container_t *a,
+                        const roaring_container_t *b, int op) {
+    const uint16_t *va = (const uint16_t *)a->data, *vb = (const uint16_t *)b->data;
+    uint32_t i = 0, j = 0, n = 0;
+    uint16_t *values;
+    uint64_t *words;
+
+    memset(out, 0, sizeof(*out));
+    out->key = a->key;
+
+    // A bitmap result
+    if ((a->type == ROARING_BITMAP && op != OP_AND)
+        || (op == OP_OR && (b->type == ROARING_BITMAP || a->cardinality + b->cardinality > ROARING_ARRAY_MAX))
+        || (a->type == ROARING_BITMAP && b->type == ROARING_BITMAP)) {
+        if (container_copy(out, a) < 0 || container_to_bitmap(out) < 0)
+            return -1;
+        words = (uint64_t *)out->data;
+        if (b->type == ROARING_BITMAP)
+            words_op(words, words, (const uint64_t *)b->data, op);
+        else if (op == OP_OR)
+            for (j = 0; j < b->n; j++)
+                words[vb[j] >> 6] |= 1ULL << (vb[j] & 63);
+        else
+            for (j = 0; j < b->n; j++)
+                words[vb[j] >> 6] &= ~(1ULL << (vb[j] & 63));
+        return bitmap_result(out);
+    }
+
+    // An array result, at most the values of a and b
+    values = malloc((a->cardinality + (op == OP_OR ? b->cardinality : 0) + 1) * sizeof(uint16_t));
+    if (values == NULL)
+        return -1;
+
+    if (a->type == ROARING_ARRAY && b->type == ROARING_BITMAP) {
+        // AND / ANDNOT of an array with a bitmap
+        for (i = 0; i < a->n; i++)
+            if (container_test(b, va[i]) == (op == OP_AND))
+                values[n++] = va[i];
+    }
+    else if (a->type == ROARING_BITMAP) {
+        // AND of a bitmap with an array
+        for (j = 0; j < b->n; j++)
+            if (container_test(a, vb[j]))
+                values[n++] = vb[j];
+    }
+    else {
+        // Merge of two sorted arrays
+        while (i < a->n || j < b->n) {
+            if (j == b->n || (i < a->n && va[i] < vb[j])) {
+                if (op != OP_AND)
+                    values[n++] = va[i];
+                i++;
+            }
+            else if (i == a->n || vb[j] < va[i]) {
+                if (op == OP_OR)
+                    values[n++] = vb[j];
+                j++;
+            }
+            else {
+                if (op != OP_ANDNOT)
+                    values[n++] = va[i];
+                i++;
+                j++;
+            }
+        }
+    }
+
+    out->type = ROARING_ARRAY;
+    out->owned = 1;
+    out->data = values;
+    out->n = out->cardinality = n;
+    out->capacity = a->cardinality + (op == OP_OR ? b->cardinality : 0) + 1;
+    return 0;
+}
+
+
+// ************************ Bitmaps  ************************************
+
+/**
+ *   @brief  Index of the container of key, or -(insertion point) - 1
+ */
+static long find_key(const roaring_t *r, uint16_t key) {
+    long lo = 0, hi = (long)r->count - 1, mid;
+
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (r->containers[mid].key < key)
+            lo = mid + 1;
+        else if (r->containers[mid].key > key)
+            hi = mid - 1;
+        else
+            return mid;
+    }
+    return -lo - 1;
+}
+
+/**
+ *   @brief  Appends or inserts a container at index i
+ */
+static int insert_container(roaring_t *r, uint32_t i, const roaring_container_t *c) {
+    roaring_container_t *grown;
+
+    if (r->count == r->capacity) {
+        grown = realloc(r->containers, (r->capacity ? 2 * r->capacity : 8) * sizeof(*grown));
+        if (grown == NULL)
+            return -1;
+        r->containers = grown;
+        r->capacity = r->capacity ? 2 * r->capacity : 8;
+    }
+    memmove(r->containers + i + 1, r->containers + i, (r->count - i) * sizeof(*grown));
+    r->containers[i] = *c;
+    r->count++;
+    return 0;
+}
+
+static void remove_container(roaring_t *r, uint32_t i) {
+    container_release(&r->containers[i]);
+    memmove(r->containers + i, r->containers + i + 1,
+            (r->count - i - 1) * sizeof(roaring_container_t));
+    r->count--;
+}
+
+
+/**
+ *   @brief  Prepares an empty bitmap
+ */
+void roaring_init(roaring_t *r) {
+    memset(r, 0, sizeof(*r));
+}
+
+
+/**
+ *   @brief  Frees the containers and unmaps a mapped file
+ */
+void roaring_free(roaring_t *r) {
+    uint32_t i;
+
+    for (i = 0; i < r->count; i++)
+        container_release(&r->containers[i]);
+    free(r->containers);
+    if (r->map != NULL)
+        munmap(r->map, r->map_len);
+    roaring_init(r);
+}
+
+
+/**
+ *   @brief  Adds, removes or flips a value
+ *
+ *   @param  r : An initialised bitmap
+ *   @param  value : Value to be changed
+ *
+ *   @return int ( 0 = Success, -1 = Out of memory )
+ */
+int roaring_set(roaring_t *r, uint32_t value) {
+    roaring_container_t c;
+    long i = find_key(r, (uint16_t)(value >> 16));
+
+    if (i < 0) {
+        memset(&c, 0, sizeof(c));
+        c.key = (uint16_t)(value >> 16);
+        c.type = ROARING_ARRAY;
+        c.owned = 1;
+        i = -i - 1;
+        if (insert_container(r, (uint32_t)i, &c) < 0)
+            return -1;
+    }
+    return container_add(&r->containers[i], (uint16_t)value) < 0 ? -1 : 0;
+}
+
+int roaring_clear(roaring_t *r, uint32_t value) {
+    long i = find_key(r, (uint16_t)(value >> 16));
+
+    if (i < 0)
+        return 0;
+    if (container_remove(&r->containers[i], (uint16_t)value) < 0)
+        return -1;
+    if (r->containers[i].cardinality == 0)
+        remove_container(r, (uint32_t)i);
+    return 0;
+}
+
+int roaring_toggle(roaring_t *r, uint32_t value) {
+    return roaring_test(r, value) ? roaring_clear(r, value) : roaring_set(r, value);
+}
+
+
+/**
+ *   @brief  Checks for a value
+ *
+ *   @return int : 1 if value is in the bitmap, else 0
+ */
+int roaring_test(const roaring_t *r, uint32_t value) {
+    long i = find_key(r, (uint16_t)(value >> 16));
+
+    return i >= 0 && container_test(&r->containers[i], (uint16_t)value);
+}
+
+
+/**
+ *   @brief  Number of values in the bitmap
+ */
+uint64_t roaring_cardinality(const roaring_t *r) {
+    uint64_t total = 0;
+    uint32_t i;
+
+    for (i = 0; i < r->count; i++)
+        total += r->containers[i].cardinality;
+    return total;
+}
+
+
+/**
+ *   @brief  Combines two bitmaps container by container
+ */
+static int roaring_op(roaring_t *dst, const roaring_t *a, const roaring_t *b, int op) {
+    roaring_container_t out, ta, tb;
+    const roaring_container_t *ca, *cb;
+    uint32_t i = 0, j = 0;
+    int ret = 0;
+
+    roaring_free(dst);
+    while (ret == 0 && (i < a->count || (op == OP_OR && j < b->count))) {
+        ca = i < a->count ? &a->containers[i] : NULL;
+        cb = j < b->count ? &b->containers[j] : NULL;
+
+        // Key in only one of the bitmaps
+        if (cb == NULL || (ca != NULL && ca->key < cb->key)) {
+            i++;
+            if (op != OP_AND)
+                ret = container_copy(&out, ca) < 0 ? -1 : insert_container(dst, dst->count, &out);
+            continue;
+        }
+        if (ca == NULL || cb->key < ca->key) {
+            j++;
+            if (op == OP_OR)
+                ret = container_copy(&out, cb) < 0 ? -1 : insert_container(dst, dst->count, &out);
+            continue;
+        }
+        i++;
+        j++;
+
+        // Runs are expanded into temporary copies
+        ta = *ca;
+        tb = *cb;
+        ta.owned = tb.owned = 0;
+        if (container_expand(&ta) < 0 || container_expand(&tb) < 0
+            || container_op(&out, &ta, &tb, op) < 0)
+            ret = -1;
+        else if (out.cardinality == 0)
+            container_release(&out);
+        else
+            ret = insert_container(dst, dst->count, &out);
+        container_release(&ta);
+        container_release(&tb);
+    }
+
+    if (ret < 0)
+        roaring_free(dst);
+    return ret;
+}
+
+/**
+ *   @brief  Union, intersection and difference (a and not b) of two bitmaps
+ *
+ *   @param  dst : Bitmap which is replaced by the result, neither a nor b
+ *   @param  a : First operand
+ *   @param  b : Second operand
+ *
+ *   @return int ( 0 = Success, -1 = Out of memory )
+ */
+int roaring_or(roaring_t *dst, const roaring_t *a, const roaring_t *b) {
+    return roaring_op(dst, a, b, OP_OR);
+}
+
+int roaring_and(roaring_t *dst, const roaring_t *a, const roaring_t *b) {
+    return roaring_op(dst, a, b, OP_AND);
+}
+
+int roaring_andnot(roaring_t *dst, const roaring_t *a, const roaring_t *b) {
+    return roaring_op(dst, a, b, OP_ANDNOT);
+}
+
+
+/**
+ *   @brief  Number of runs of consecutive values in a container
+ */
+static uint32_t count_runs(const roaring_container_t *c) {
+    const uint16_t *v = (const uint16_t *)c->data;
+    const uint64_t *words = (const uint64_t *)c->data;
+    uint32_t runs = 0, i;
+    uint64_t carry = 0;
+
+    if (c->type == ROARING_RUN)
+        return c->n;
+    if (c->type == ROARING_ARRAY) {
+        for (i = 0; i < c->n; i++)
+            runs += (i == 0 || v[i] != v[i - 1] + 1);
+        return runs;
+    }
+    // A run starts at every set bit whose lower neighbour is clear
+    for (i = 0; i < ROARING_BITMAP_WORDS; i++) {
+        runs += (uint32_t)bit_popcount64(words[i] & ~((words[i] << 1) | carry));
+        carry = words[i] >> 63;
+    }
+    return runs;
+}
+
+
+/**
+ *   @brief  Turns every container which is smaller as runs into a run
+ *           container
+ *
+ *   @return int : Number of run containers, -1 if out of memory
+ */
+int roaring_optimize(roaring_t *r) {
+    roaring_container_t *c;
+    uint32_t i, runs, k, v, start;
+    uint16_t *pairs;
+    int total = 0;
+
+    for (i = 0; i < r->count; i++) {
+        c = &r->containers[i];
+        if (c->type == ROARING_RUN) {
+            total++;
+            continue;
+        }
+        runs = count_runs(c);
+        if ((size_t)runs * 4 >= payload_bytes(c))
+            continue;
+
+        pairs = malloc(runs * 4);
+        if (pairs == NULL)
+            return -1;
+        k = 0;
+        start = 0x10000;
+        for (v = 0; v <= 0x10000; v++) {
+            // Walk the values, closing a run at the first missing one
+            if (v < 0x10000 && container_test(c, (uint16_t)v)) {
+                if (start == 0x10000)
+                    start = v;
+            }
+            else if (start != 0x10000) {
+                pairs[2 * k] = (uint16_t)start;
+                pairs[2 * k + 1] = (uint16_t)(v - 1 - start);
+                k++;
+                start = 0x10000;
+            }
+        }
+
+        container_release(c);
+        c->type = ROARING_RUN;
+        c->owned = 1;
+        c->data = pairs;
+        c->n = c->capacity = runs;
+        total++;
+    }
+    return total;
+}
+
+
+/**
+ *   @brief  Bytes of memory used by the bitmap, a mapped file not counted
+ */
+size_t roaring_size_in_bytes(const roaring_t *r) {
+    size_t bytes = sizeof(*r) + r->capacity * sizeof(roaring_container_t);
+    const roaring_container_t *c;
+    uint32_t i;
+
+    for (i = 0; i < r->count; i++) {
+        c = &r->containers[i];
+        if (c->owned)
+            bytes += c->type == ROARING_BITMAP ? BITMAP_BYTES
+                     : (size_t)c->capacity * (c->type == ROARING_RUN ? 4 : 2);
+    }
+    return bytes;
+}
+
+
+/**
+ *   @brief  Bytes needed by roaring_serialize()
+ */
+size_t roaring_serialized_size(const roaring_t *r) {
+    size_t bytes = sizeof(roaring_header_t) + r->count * sizeof(roaring_desc_t);
+    uint32_t i;
+
+    for (i = 0; i < r->count; i++)
+        bytes += (payload_bytes(&r->containers[i]) + 7) & ~(size_t)7;
+    return bytes;
+}
+
+
+/**
+ *   @brief  Writes the bitmap in the serialized layout
+ *
+ *   @param  r : Bitmap to be written
+ *   @param  buf : Destination, 8 byte aligned
+ *   @param  size : Bytes at buf
+ *
+ *   @return long : Bytes written, -1 if buf is too small or misaligned
+ */
+long roaring_serialize(const roaring_t *r, void *buf, size_t size) {
+    size_t total = roaring_serialized_size(r), offset, bytes;
+    roaring_header_t *header = (roaring_header_t *)buf;
+    roaring_desc_t *desc = (roaring_desc_t *)(header + 1);
+    const roaring_container_t *c;
+    uint32_t i;
+
+    if (buf == NULL || total > size || ((uintptr_t)buf & 7) != 0)
+        return -1;
+
+    memset(buf, 0, total);
+    header->magic = ROARING_MAGIC;
+    header->count = r->count;
+    offset = sizeof(*header) + r->count * sizeof(*desc);
+    for (i = 0; i < r->count; i++) {
+        c = &r->containers[i];
+        bytes = payload_bytes(c);
+        desc[i].key = c->key;
+        desc[i].type = c->type;
+        desc[i].cardinality = c->cardinality;
+        desc[i].n = c->n;
+        desc[i].offset = (uint32_t)offset;
+        memcpy((uint8_t *)buf + offset, c->data, bytes);
+        offset += (bytes + 7) & ~(size_t)7;
+    }
+    return (long)total;
+}
+
+
+/**
+ *   @brief  Whether the values of a container read from a buffer agree with
+ *           its cardinality : arrays strictly increasing, runs sorted, apart
+ *           and inside 16 bits, bitmaps with as many bits set
+ */
+static int container_valid(const roaring_container_t *c) {
+    const uint16_t *v = (const uint16_t *)c->data;
+    uint64_t total = 0;
+    uint32_t i, end = 0;
+
+    if (c->type == ROARING_ARRAY) {
+        for (i = 1; i < c->n; i++)
+            if (v[i] <= v[i - 1])
+                return 0;
+        return 1;
+    }
+    if (c->type == ROARING_BITMAP)
+        return bit_popcount_array(c->data, BITMAP_BYTES) == c->cardinality;
+
+    // Runs are (start, length - 1) pairs
+    for (i = 0; i < c->n; i++) {
+        if ((i > 0 && v[2 * i] <= end) || (uint32_t)v[2 * i] + v[2 * i + 1] > 65535)
+            return 0;
+        end = (uint32_t)v[2 * i] + v[2 * i + 1];
+        total += (uint64_t)v[2 * i + 1] + 1;
+    }
+    return total == c->cardinality;
+}
+
+
+/**
+ *   @brief  Uses a serialized bitmap in place
+ *
+ *   buf must stay valid and unchanged while r uses it; it is never written.
+ *   Every container is checked, values included, so a corrupted file is
+ *   refused rather than trusted by the later operations.
+ *
+ *   @param  r : Bitmap which is replaced by the view
+ *   @param  buf : Serialized bitmap, 8 byte aligned
+ *   @param  size : Bytes at buf
+ *
+ *   @return int ( 0 = Success, -1 = Not a valid serialized bitmap )
+ */
+int roaring_view(roaring_t *r, const void *buf, size_t size) {
+    const roaring_header_t *header = (const roaring_header_t *)buf;
+    const roaring_desc_t *desc = (const roaring_desc_t *)(header + 1);
+    roaring_container_t c;
+    uint32_t i;
+    int valid;
+
+    roaring_free(r);
+    if (buf == NULL || ((uintptr_t)buf & 7) != 0 || size < sizeof(*header)
+        || header->magic != ROARING_MAGIC
+        || header->count > 65536
+        || sizeof(*header) + (size_t)header->count * sizeof(*desc) > size)
+        return -1;
+
+    for (i = 0; i < header->count; i++) {
+        memset(&c, 0, sizeof(c));
+        c.key = desc[i].key;
+        c.type = desc[i].type;
+        c.cardinality = desc[i].cardinality;
+        c.n = c.capacity = desc[i].n;
+        c.data = (void *)((const uint8_t *)buf + desc[i].offset);
+
+        valid = (i == 0 || desc[i].key > desc[i - 1].key) && (desc[i].offset & 7) == 0
+                && desc[i].cardinality > 0 && desc[i].cardinality <= 65536;
+        if (c.type == ROARING_ARRAY)
+            valid = valid && c.n == c.cardinality && c.n <= ROARING_ARRAY_MAX;
+        else if (c.type == ROARING_BITMAP)
+            valid = valid && c.n == ROARING_BITMAP_WORDS;
+        else
+            valid = valid && c.type == ROARING_RUN && c.n > 0 && c.n <= 32768;
+        valid = valid && (size_t)desc[i].offset + payload_bytes(&c) <= size && container_valid(&c);
+
+        if (!valid || insert_container(r, r->count, &c) < 0) {
+            roaring_free(r);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ *   @brief  Writes a bitmap to a file / maps a file written so as a view
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int roaring_save(const roaring_t *r, const char *path) {
+    size_t size = roaring_serialized_size(r), done = 0;
+    void *buf = malloc(size);
+    ssize_t n = 0;
+    int fd, ret = -1;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (buf != NULL && fd >= 0 && roaring_serialize(r, buf, size) >= 0) {
+        while (done < size && (n = write(fd, (uint8_t *)buf + done, size - done)) > 0)
+            done += (size_t)n;
+        ret = done == size ? 0 : -1;
+    }
+    if (fd >= 0)
+        close(fd);
+    free(buf);
+    return ret;
+}
+
+int roaring_map(roaring_t *r, const char *path) {
+    struct stat st;
+    void *map;
+    int fd = open(path, O_RDONLY);
+
+    roaring_free(r);
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+
+    if (roaring_view(r, map, (size_t)st.st_size) < 0) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    r->map = map;
+    r->map_len = (size_t)st.st_size;
+    return 0;
+}
+
+
+/**
+ *   @brief  Checks a bitmap against a flat bitmap of the first universe values
+ */
+static int matches(const roaring_t *r, const uint64_t *flat, uint32_t universe) {
+    uint64_t count = 0;
+    uint32_t v;
+
+    for (v = 0; v < universe; v++) {
+        if (roaring_test(r, v) != (int)((flat[v / 64] >> (v % 64)) & 1))
+            return 0;
+        count += (flat[v / 64] >> (v % 64)) & 1;
+    }
+    return roaring_cardinality(r) == count;
+}
+
+
+/**
+ *   @brief  Test function to test the roaring_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Random set, clear and toggle against a flat bitmap, through array to
+ *     bitmap container changes both ways
+ *   - Union, intersection and difference of every pair of container types
+ *   - Serialize, view, copy on write and a mapped file
+ *   - Memory of sparse and clustered sets against a flat bitmap
+ *   - Invalid serialized data
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_roaring(int debug) {
+    const uint32_t universe = 1u << 19;     // 8 containers
+    const size_t words = universe / 64;
+    uint64_t *fa = calloc(words, 8), *fb = calloc(words, 8), *fr = calloc(words, 8);
+    char path[] = "/tmp/roaring_XXXXXX";
+    roaring_t a, b, r, view;
+    uint32_t seed = 40, v, i;
+    uint64_t *buf = NULL;
+    size_t size, flat;
+    int op, fd, status = 1;
+
+    if(debug)
+        printf("\n Test Results for compressed bitmaps ");
+
+    roaring_init(&a);
+    roaring_init(&b);
+    roaring_init(&r);
+    roaring_init(&view);
+    if (fa == NULL || fb == NULL || fr == NULL)
+        status = 0;
+
+    // a : sparse in chunk 0, dense in chunks 2 - 3, a long range in chunk 5
+    for (i = 0; status && i < 3000; i++) {
+        seed = seed * 1103515245u + 12345u;
+        v = (seed >> 8) % 65536;
+        roaring_set(&a, v);
+        fa[v / 64] |= 1ULL << (v % 64);
+    }
+    for (v = 2 * 65536; status && v < 4 * 65536; v += 3) {
+        roaring_set(&a, v);
+        fa[v / 64] |= 1ULL << (v % 64);
+    }
+    for (v = 5 * 65536 + 100; status && v < 5 * 65536 + 60000; v++) {
+        roaring_set(&a, v);
+        fa[v / 64] |= 1ULL << (v % 64);
+    }
+
+    // Random clear and toggle, dense chunk 3 drops back to an array, then a
+    // clean range in chunk 6
+    for (i = 0; status && i < 40000; i++) {
+        seed = seed * 1103515245u + 12345u;
+        v = (seed >> 8) % universe;
+        if (i % 2)
+            roaring_toggle(&a, v), fa[v / 64] ^= 1ULL << (v % 64);
+        else
+            roaring_clear(&a, v), fa[v / 64] &= ~(1ULL << (v % 64));
+    }
+    for (v = 3 * 65536; status && v < 4 * 65536; v++) {
+        if (v % 7 == 0)
+            continue;
+        roaring_clear(&a, v);
+        fa[v / 64] &= ~(1ULL << (v % 64));
+    }
+    for (v = 6 * 65536 + 5; status && v < 6 * 65536 + 30000; v++) {
+        roaring_set(&a, v);
+        fa[v / 64] |= 1ULL << (v % 64);
+    }
+    if (!matches(&a, fa, universe))
+        status = 0;
+    if(debug)
+        printf("\nSet / clear / toggle: %llu values, %u containers, Result: %d",
+               (unsigned long long)roaring_cardinality(&a), a.count, status);
+
+    // b : every other chunk dense, with runs after optimize
+    for (v = 0; status && v < universe; v++) {
+        if (((v >> 16) % 2 == 0 && v % 5 < 3) || ((v >> 16) % 3 == 1 && (v >> 10) % 4 == 0)) {
+            roaring_set(&b, v);
+            fb[v / 64] |= 1ULL << (v % 64);
+        }
+    }
+    if (roaring_optimize(&b) <= 0 || roaring_optimize(&a) <= 0
+        || !matches(&b, fb, universe) || !matches(&a, fa, universe))
+        status = 0;
+
+    // Set operations, both orders
+    for (op = 0; status && op < 6; op++) {
+        const roaring_t *x = op < 3 ? &a : &b, *y = op < 3 ? &b : &a;
+        const uint64_t *fx = op < 3 ? fa : fb, *fy = op < 3 ? fb : fa;
+
+        if (op % 3 == 0)
+            roaring_or(&r, x, y);
+        else if (op % 3 == 1)
+            roaring_and(&r, x, y);
+        else
+            roaring_andnot(&r, x, y);
+        for (i = 0; i < words; i++)
+            fr[i] = op % 3 == 0 ? fx[i] | fy[i] : op % 3 == 1 ? fx[i] & fy[i] : fx[i] & ~fy[i];
+        if (!matches(&r, fr, universe))
+            status = 0;
+        if(debug)
+            printf("\nOperation: %d, %llu values, Result: %d", op,
+                   (unsigned long long)roaring_cardinality(&r), status);
+    }
+
+    // Serialize, view and copy on write
+    size = roaring_serialized_size(&a);
+    buf = malloc(size);
+    if (status && (buf == NULL || roaring_serialize(&a, buf, size) != (long)size
+                   || roaring_view(&view, buf, size) != 0 || !matches(&view, fa, universe)))
+        status = 0;
+    if (status) {
+        roaring_toggle(&view, 5 * 65536 + 200);
+        roaring_set(&view, 7);
+        roaring_view(&r, buf, size);
+        if (!matches(&r, fa, universe) || roaring_test(&view, 5 * 65536 + 200) == roaring_test(&r, 5 * 65536 + 200))
+            status = 0;
+    }
+
+    // Mapped file
+    fd = mkstemp(path);
+    if (fd >= 0)
+        close(fd);
+    if (status && (fd < 0 || roaring_save(&b, path) != 0 || roaring_map(&r, path) != 0
+                   || !matches(&r, fb, universe)))
+        status = 0;
+    roaring_free(&r);
+    unlink(path);
+    if(debug)
+        printf("\nSerialized: %zu bytes, Result: %d", size, status);
+
+    // Invalid serialized data
+    if (buf != NULL) {
+        ((uint32_t *)buf)[0] ^= 1;
+        if (roaring_view(&r, buf, size) != -1 || roaring_view(&r, buf, 4) != -1)
+            status = 0;
+    }
+    roaring_free(&view);
+    free(buf);
+
+    // A run container whose cardinality no longer matches its runs, or whose
+    // runs overlap, is refused instead of overflowing once expanded
+    roaring_free(&b);
+    for (v = 100; v < 1100; v++)
+        roaring_set(&b, v);
+    roaring_optimize(&b);
+    size = roaring_serialized_size(&b);
+    buf = malloc(size);
+    if (buf == NULL || roaring_serialize(&b, buf, size) != (long)size
+        || ((roaring_desc_t *)((roaring_header_t *)buf + 1))->type != ROARING_RUN
+        || roaring_view(&r, buf, size) != 0)
+        status = 0;
+    if (status) {
+        ((roaring_desc_t *)((roaring_header_t *)buf + 1))->cardinality = 10;
+        if (roaring_view(&r, buf, size) != -1 || roaring_set(&r, 5) != 0
+            || roaring_cardinality(&r) != 1)
+            status = 0;
+    }
+    if(debug)
+        printf("\nCorrupted run container refused, Result: %d", status);
+
+    // Memory against a flat bitmap of 2^32 bits : 10000 values spread over
+    // the whole space, and 5 million in one range
+    roaring_free(&a);
+    for (i = 0; i < 10000; i++) {
+        seed = seed * 1103515245u + 12345u;
+        roaring_set(&a, seed);
+    }
+    flat = (size_t)1 << 29;
+    if (roaring_size_in_bytes(&a) * 100 > flat)
+        status = 0;
+    if(debug)
+        printf("\nSparse: %llu values in %zu bytes, flat bitmap %zu bytes",
+               (unsigned long long)roaring_cardinality(&a), roaring_size_in_bytes(&a), flat);
+
+    roaring_free(&b);
+    for (v = 1000000; v < 6000000; v++)
+        if (roaring_set(&b, v) < 0)
+            break;
+    roaring_optimize(&b);
+    if (roaring_cardinality(&b) != 5000000 || roaring_size_in_bytes(&b) * 100000 > flat)
+        status = 0;
+    if(debug)
+        printf("\nClustered: %llu values in %zu bytes", (unsigned long long)roaring_cardinality(&b),
+               roaring_size_in_bytes(&b));
+
+    roaring_free(&a);
+    roaring_free(&b);
+    roaring_free(&r);
+    roaring_free(&view);
+    free(buf);
+    free(fa);
+    free(fb);
+    free(fr);
+    return status;
+}
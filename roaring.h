@@ -0,0 +1,179 @@
+#ifndef ROARING_
+#define ROARING_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file roaring.h
+ * @brief Compressed bitmap of 32 bit values (roaring bitmap)
+ *
+ * The 32 bit space is cut into 65536 chunks of 65536 values, keyed by the
+ * high 16 bits. Only chunks holding a value get a container, which is one of
+ *   - array  : sorted low 16 bits, up to ROARING_ARRAY_MAX values
+ *   - bitmap : 65536 bits, for more values than that
+ *   - run    : (start, length - 1) pairs, made by roaring_optimize() when
+ *              they take less memory than the other two
+ * so a sparse set costs about 2 bytes per value and a long range a few bytes.
+ *
+ *   Serialized layout, little endian, every payload 8 byte aligned :
+ *   "RBM1" | count (32 bit) | count x { key 16, type 8, 0, cardinality 32,
+ *                                        elements 32, offset 32 } | payloads
+ *
+ * A serialized bitmap, e.g. a file mapped with roaring_map(), is used in
+ * place. Containers of such a view are copied only when they are modified.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#define ROARING_ARRAY_MAX 4096      // Largest array container
+#define ROARING_BITMAP_WORDS 1024   // 64 bit words of a bitmap container
+
+typedef struct {
+    uint16_t key;           // High 16 bits of the values
+    uint8_t type;           // Array, bitmap or run
+    uint8_t owned;          // data was allocated here, not part of a view
+    uint32_t cardinality;   // Number of values
+    uint32_t n;             // Values, runs or words at data
+    uint32_t capacity;      // Elements allocated at data
+    void *data;
+} roaring_container_t;
+
+typedef struct {
+    roaring_container_t *containers;    // Sorted by key
+    uint32_t count;
+    uint32_t capacity;
+    void *map;                          // File mapped by roaring_map()
+    size_t map_len;
+} roaring_t;
+
+/**
+ *   @brief  Prepares an empty bitmap
+ */
+void roaring_init(roaring_t *r);
+
+/**
+ *   @brief  Frees the containers and unmaps a mapped file
+ */
+void roaring_free(roaring_t *r);
+
+/**
+ *   @brief  Adds, removes or flips a value
+ *
+ *   @param  r : An initialised bitmap
+ *   @param  value : Value to be changed
+ *
+ *   @return int ( 0 = Success, -1 = Out of memory )
+ */
+int roaring_set(roaring_t *r, uint32_t value);
+int roaring_clear(roaring_t *r, uint32_t value);
+int roaring_toggle(roaring_t *r, uint32_t value);
+
+/**
+ *   @brief  Checks for a value
+ *
+ *   @return int : 1 if value is in the bitmap, else 0
+ */
+int roaring_test(const roaring_t *r, uint32_t value);
+
+/**
+ *   @brief  Number of values in the bitmap
+ */
+uint64_t roaring_cardinality(const roaring_t *r);
+
+/**
+ *   @brief  Union, intersection and difference (a and not b) of two bitmaps
+ *
+ *   @param  dst : Bitmap which is replaced by the result, neither a nor b
+ *   @param  a : First operand
+ *   @param  b : Second operand
+ *
+ *   @return int ( 0 = Success, -1 = Out of memory )
+ */
+int roaring_or(roaring_t *dst, const roaring_t *a, const roaring_t *b);
+int roaring_and(roaring_t *dst, const roaring_t *a, const roaring_t *b);
+int roaring_andnot(roaring_t *dst, const roaring_t *a, const roaring_t *b);
+
+/**
+ *   @brief  Turns every container which is smaller as runs into a run
+ *           container
+ *
+ *   @return int : Number of run containers, -1 if out of memory
+ */
+int roaring_optimize(roaring_t *r);
+
+/**
+ *   @brief  Bytes of memory used by the bitmap, a mapped file not counted
+ */
+size_t roaring_size_in_bytes(const roaring_t *r);
+
+/**
+ *   @brief  Bytes needed by roaring_serialize()
+ */
+size_t roaring_serialized_size(const roaring_t *r);
+
+/**
+ *   @brief  Writes the bitmap in the serialized layout
+ *
+ *   @param  r : Bitmap to be written
+ *   @param  buf : Destination, 8 byte aligned
+ *   @param  size : Bytes at buf
+ *
+ *   @return long : Bytes written, -1 if buf is too small or misaligned
+ */
+long roaring_serialize(const roaring_t *r, void *buf, size_t size);
+
+/**
+ *   @brief  Uses a serialized bitmap in place
+ *
+ *   buf must stay valid and unchanged while r uses it; it is never written.
+ *   Every container is checked, values included, so a corrupted file is
+ *   refused rather than trusted by the later operations.
+ *
+ *   @param  r : Bitmap which is replaced by the view
+ *   @param  buf : Serialized bitmap, 8 byte aligned
+ *   @param  size : Bytes at buf
+ *
+ *   @return int ( 0 = Success, -1 = Not a valid serialized bitmap )
+ */
+int roaring_view(roaring_t *r, const void *buf, size_t size);
+
+/**
+ *   @brief  Writes a bitmap to a file / maps a file written so as a view
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int roaring_save(const roaring_t *r, const char *path);
+int roaring_map(roaring_t *r, const char *path);
+
+/**
+ *   @brief  Test function to test the roaring_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Random set, clear and toggle against a flat bitmap, through array to
+ *     bitmap container changes both ways
+ *   - Union, intersection and difference of every pair of container types
+ *   - Serialize, view, copy on write and a mapped file
+ *   - Memory of sparse and clustered sets against a flat bitmap
+ *   - Invalid serialized data, runs which disagree with their cardinality
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_roaring(int debug);
+
+#endif /* ROARING_ */
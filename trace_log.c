@@ -0,0 +1,737 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file trace_log.c
+ * @brief Binary trace log : raw values recorded by the hot path, formatted
+ *        offline into the strings of the library
+ *
+ * Every thread owns a single producer / single consumer ring : the thread
+ * moves head, trace_flush() moves tail under trace_lock, so recording is a
+ * clock read, two memcpy() and a release store. A record which does not fit
+ * before the end of the ring is preceded by a TRACE_PAD filler up to the
+ * end, so records are never split; the filler is written to the file and
+ * skipped by the decoder. Sizes are rounded to 16 bytes, which leaves room
+ * for a filler header wherever a record ends.
+ *
+ * A ring is freed once its thread has exited and its records are flushed.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bit_operations.h"
+#include "fmt_lazy.h"
+#include "trace_log.h"
+
+#define TRACE_MAGIC "BITTRACE"
+#define TRACE_VERSION 1
+#define TRACE_ORDER 0x01020304u  // Reads differently on the other byte order
+
+// Header and bytes, rounded to 16
+#define TRACE_RECORD_BYTES(n) (sizeof(trace_record_t) + (((size_t)(n) + 15) & ~(size_t)15))
+
+_Static_assert(sizeof(trace_record_t) == 16, "trace_record_t is written as 16 bytes");
+_Static_assert((TRACE_RING_BYTES & (TRACE_RING_BYTES - 1)) == 0, "TRACE_RING_BYTES is a power of two");
+_Static_assert(TRACE_RECORD_BYTES(TRACE_MAX_BYTES) <= TRACE_RING_BYTES, "a hexdump fits in a ring");
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t order;
+} trace_header_t;
+
+typedef struct trace_ring {
+    _Alignas(64) _Atomic uint64_t head;     // Moved by the owner thread
+    _Atomic uint64_t dropped;
+    atomic_int retired;                     // Owner thread has exited
+    struct trace_ring *next;
+    _Alignas(64) _Atomic uint64_t tail;     // Moved by trace_flush()
+    _Alignas(64) uint8_t buf[TRACE_RING_BYTES];
+} trace_ring_t;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static trace_ring_t *rings;                 // Every ring, under trace_lock
+static FILE *trace_file;                    // Under trace_lock
+static atomic_int trace_on;
+static uint64_t dropped_freed;              // Of the freed rings, under trace_lock
+
+static pthread_once_t ring_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;              // Retires the ring at thread exit
+static _Thread_local trace_ring_t *own_ring;
+
+
+static void ring_retire(void *ring) {
+    atomic_store(&((trace_ring_t *)ring)->retired, 1);
+}
+
+static void ring_key_create(void) {
+    pthread_key_create(&ring_key, ring_retire);
+}
+
+
+/**
+ *   @brief  Ring of the calling thread, made by its first record
+ */
+static trace_ring_t *ring_get(void) {
+    trace_ring_t *r = own_ring;
+
+    if (r != NULL)
+        return r;
+
+    pthread_once(&ring_once, ring_key_create);
+    r = aligned_alloc(64, sizeof(*r));
+    if (r == NULL)
+        return NULL;
+    memset(r, 0, sizeof(*r));
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->dropped, 0);
+    atomic_init(&r->retired, 0);
+    if (pthread_setspecific(ring_key, r) != 0) {
+        free(r);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&trace_lock);
+    r->next = rings;
+    rings = r;
+    pthread_mutex_unlock(&trace_lock);
+    own_ring = r;
+    return r;
+}
+
+
+/**
+ *   @brief  Copies a record and its bytes into the ring of the calling thread
+ *
+ *   @return int ( 0 = Success, -1 = Not open or ring full )
+ */
+static int ring_put(trace_record_t *rec, const void *payload, size_t n) {
+    const size_t need = TRACE_RECORD_BYTES(n);
+    trace_record_t pad = { 0, 0, 0, TRACE_PAD, 0 };
+    struct timespec ts;
+    trace_ring_t *r;
+    uint64_t head;
+    size_t off, fill;
+
+    if (!atomic_load_explicit(&trace_on, memory_order_relaxed))
+        return -1;
+    r = ring_get();
+    if (r == NULL)
+        return -1;
+
+    head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    off = head & (TRACE_RING_BYTES - 1);
+    fill = TRACE_RING_BYTES - off >= need ? 0 : TRACE_RING_BYTES - off;
+    if (head + fill + need - atomic_load_explicit(&r->tail, memory_order_acquire) > TRACE_RING_BYTES) {
+        atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+        return -1;
+    }
+
+    if (fill > 0) {
+        pad.value = (uint32_t)fill;
+        memcpy(r->buf + off, &pad, sizeof(pad));
+        off = 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    rec->timestamp = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+    memcpy(r->buf + off, rec, sizeof(*rec));
+    if (n > 0)
+        memcpy(r->buf + off + sizeof(*rec), payload, n);
+    atomic_store_explicit(&r->head, head + fill + need, memory_order_release);
+    return 0;
+}
+
+
+/**
+ *   @brief  Writes the records of every ring to f, or drops them for NULL,
+ *           and frees the rings of exited threads. Called under trace_lock.
+ *
+ *   @return long : Bytes taken from the rings, -1 if writing failed
+ */
+static long rings_drain(FILE *f) {
+    trace_ring_t **p = &rings, *r;
+    uint64_t head, tail;
+    size_t off, len;
+    long bytes = 0;
+    int failed = 0;
+
+    while ((r = *p) != NULL) {
+        head = atomic_load_explicit(&r->head, memory_order_acquire);
+        tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        while (tail < head) {
+            off = tail & (TRACE_RING_BYTES - 1);
+            len = head - tail < TRACE_RING_BYTES - off ? head - tail : TRACE_RING_BYTES - off;
+            if (f != NULL && fwrite(r->buf + off, 1, len, f) != len)
+                failed = 1;
+            tail += len;
+            bytes += (long)len;
+        }
+        atomic_store_explicit(&r->tail, tail, memory_order_release);
+
+        // The owner is gone, so head is final
+        if (atomic_load(&r->retired) && atomic_load(&r->head) == tail) {
+            *p = r->next;
+            dropped_freed += atomic_load(&r->dropped);
+            free(r);
+        }
+        else
+            p = &r->next;
+    }
+
+    if (f != NULL && fflush(f) != 0)
+        failed = 1;
+    return failed ? -1 : bytes;
+}
+
+
+/**
+ *   @brief  Starts tracing to a new file, records still in the rings from
+ *           before are dropped
+ *
+ *   @param  path : Trace file, truncated
+ *
+ *   @return int ( 0 = Success, -1 = Failure or already open )
+ */
+int trace_open(const char *path) {
+    trace_header_t header = { TRACE_MAGIC, TRACE_VERSION, TRACE_ORDER };
+    FILE *f;
+
+    pthread_mutex_lock(&trace_lock);
+    if (trace_file != NULL) {
+        pthread_mutex_unlock(&trace_lock);
+        return -1;
+    }
+    f = fopen(path, "wb");
+    if (f == NULL || fwrite(&header, sizeof(header), 1, f) != 1) {
+        if (f != NULL)
+            fclose(f);
+        pthread_mutex_unlock(&trace_lock);
+        return -1;
+    }
+    rings_drain(NULL);
+    trace_file = f;
+    atomic_store(&trace_on, 1);
+    pthread_mutex_unlock(&trace_lock);
+    return 0;
+}
+
+
+/**
+ *   @brief  Appends the records of every thread to the file
+ *
+ *   @return long : Bytes written, -1 if not open or writing failed
+ */
+long trace_flush(void) {
+    long ret = -1;
+
+    pthread_mutex_lock(&trace_lock);
+    if (trace_file != NULL)
+        ret = rings_drain(trace_file);
+    pthread_mutex_unlock(&trace_lock);
+    return ret;
+}
+
+
+/**
+ *   @brief  Flushes and closes the file, later records are refused
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int trace_close(void) {
+    int ret = -1;
+
+    pthread_mutex_lock(&trace_lock);
+    atomic_store(&trace_on, 0);
+    if (trace_file != NULL) {
+        ret = rings_drain(trace_file) < 0 ? -1 : 0;
+        if (fclose(trace_file) != 0)
+            ret = -1;
+        trace_file = NULL;
+    }
+    pthread_mutex_unlock(&trace_lock);
+    return ret;
+}
+
+
+static int trace_value(uint16_t id, lazy_kind_t kind, uint32_t num, uint8_t nbits) {
+    trace_record_t rec = { 0, num, id, (uint8_t)kind, nbits };
+
+    return ring_put(&rec, NULL, 0);
+}
+
+
+/**
+ *   @brief  Records a uint_to_binstr(), int_to_binstr(), uint_to_hexstr(),
+ *           uint_to_decstr() or int_to_decstr() call
+ *
+ *   @param  id : Caller's format id, written to the decoded line
+ *   @param  num : Integer to be converted
+ *   @param  nbits : It is the number of bits of the input
+ *
+ *   @return int ( 0 = Success, -1 = Not open or ring full )
+ */
+int trace_binstr(uint16_t id, uint32_t num, uint8_t nbits) {
+    return trace_value(id, LAZY_BINSTR, num, nbits);
+}
+
+int trace_int_binstr(uint16_t id, int32_t num, uint8_t nbits) {
+    return trace_value(id, LAZY_INT_BINSTR, (uint32_t)num, nbits);
+}
+
+int trace_hexstr(uint16_t id, uint32_t num, uint8_t nbits) {
+    return trace_value(id, LAZY_HEXSTR, num, nbits);
+}
+
+int trace_decstr(uint16_t id, uint32_t num, uint8_t nbits) {
+    return trace_value(id, LAZY_DECSTR, num, nbits);
+}
+
+int trace_int_decstr(uint16_t id, int32_t num, uint8_t nbits) {
+    return trace_value(id, LAZY_INT_DECSTR, (uint32_t)num, nbits);
+}
+
+
+/**
+ *   @brief  Records a hexdump() call, copying the bytes
+ *
+ *   @return int ( 0 = Success, -1 = Not open, ring full or more than
+ *                 TRACE_MAX_BYTES )
+ */
+int trace_hexdump(uint16_t id, const void *loc, size_t nbytes) {
+    trace_record_t rec = { 0, (uint32_t)nbytes, id, LAZY_HEXDUMP, 0 };
+
+    if (nbytes > TRACE_MAX_BYTES || (loc == NULL && nbytes > 0))
+        return -1;
+    return ring_put(&rec, loc, nbytes);
+}
+
+
+/**
+ *   @brief  Records refused since the program started, as their ring was full
+ */
+uint64_t trace_dropped(void) {
+    const trace_ring_t *r;
+    uint64_t dropped;
+
+    pthread_mutex_lock(&trace_lock);
+    dropped = dropped_freed;
+    for (r = rings; r != NULL; r = r->next)
+        dropped += atomic_load_explicit(&r->dropped, memory_order_relaxed);
+    pthread_mutex_unlock(&trace_lock);
+    return dropped;
+}
+
+
+/**
+ *   @brief  Checks the header of a trace file
+ *
+ *   @return int ( 0 = Success, -1 = Not a trace file of this byte order )
+ */
+int trace_read_header(FILE *in) {
+    trace_header_t header;
+
+    if (fread(&header, sizeof(header), 1, in) != 1
+        || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != TRACE_VERSION || header.order != TRACE_ORDER)
+        return -1;
+    return 0;
+}
+
+
+/**
+ *   @brief  Reads the next record, skipping the fillers
+ *
+ *   @param  in : Trace file, after trace_read_header()
+ *   @param  rec : Record read
+ *   @param  payload : TRACE_MAX_BYTES bytes, the hexdump bytes
+ *
+ *   @return int ( 1 = Record, 0 = End of file, -1 = Truncated or invalid )
+ */
+int trace_read(FILE *in, trace_record_t *rec, uint8_t *payload) {
+    uint8_t skip[16];
+    size_t got, n;
+
+    for (;;) {
+        got = fread(rec, 1, sizeof(*rec), in);
+        if (got == 0 && feof(in))
+            return 0;
+        if (got != sizeof(*rec))
+            return -1;
+
+        if (rec->kind == TRACE_PAD) {
+            if (rec->value < sizeof(*rec) || rec->value > TRACE_RING_BYTES || rec->value % 16 != 0)
+                return -1;
+            for (n = rec->value - sizeof(*rec); n > 0; n -= got) {
+                got = fread(payload, 1, n < TRACE_MAX_BYTES ? n : TRACE_MAX_BYTES, in);
+                if (got == 0)
+                    return -1;
+            }
+            continue;
+        }
+
+        if (rec->kind < LAZY_BINSTR || rec->kind > LAZY_HEXDUMP)
+            return -1;
+        if (rec->kind == LAZY_HEXDUMP) {
+            n = TRACE_RECORD_BYTES(rec->value) - sizeof(*rec) - rec->value;
+            if (rec->value > TRACE_MAX_BYTES || fread(payload, 1, rec->value, in) != rec->value
+                || fread(skip, 1, n, in) != n)
+                return -1;
+        }
+        return 1;
+    }
+}
+
+
+/**
+ *   @brief  Appends the string of a record to an arena
+ *
+ *   @return int : Characters appended, -1 (and nothing appended) if the
+ *                 function rejects the value, or out of memory
+ */
+int trace_render(const trace_record_t *rec, const uint8_t *payload, fmt_arena_t *arena) {
+    lazy_fmt_t h;
+
+    if (rec->kind == LAZY_HEXDUMP)
+        h = lazy_hexdump(payload, rec->value);
+    else if (rec->kind >= LAZY_BINSTR && rec->kind < LAZY_HEXDUMP)
+        h = lazy_value((lazy_kind_t)rec->kind, rec->value, rec->nbits);
+    else
+        return -1;
+    return lazy_render_arena(&h, arena);
+}
+
+
+/**
+ *   @brief  Writes the lines of a trace file
+ *
+ *   @return long : Records decoded, -1 for an invalid file or write error
+ */
+long trace_decode(FILE *in, FILE *out) {
+    static uint8_t payload[TRACE_MAX_BYTES];
+    trace_record_t rec;
+    fmt_arena_t arena;
+    fmt_slice_t line;
+    char prefix[32];
+    long count = 0;
+    int ret;
+
+    if (trace_read_header(in) < 0)
+        return -1;
+
+    fmt_arena_init(&arena);
+    while ((ret = trace_read(in, &rec, payload)) > 0) {
+        fmt_arena_reset(&arena);
+        fmt_arena_begin(&arena);
+        fmt_arena_append(&arena, prefix, (size_t)snprintf(prefix, sizeof(prefix), "%llu %u ",
+                                                          (unsigned long long)rec.timestamp, rec.id));
+        trace_render(&rec, payload, &arena);
+        fmt_arena_append(&arena, "\n", 1);
+        line = fmt_arena_end(&arena);
+        if (line.data == NULL || fwrite(line.data, 1, line.len, out) != line.len) {
+            ret = -1;
+            break;
+        }
+        count++;
+    }
+    fmt_arena_free(&arena);
+    return ret < 0 ? -1 : count;
+}
+
+
+/**
+ *   @brief  Decodes the trace file at path to stdout
+ *
+ *   @return long : Records decoded, -1 on failure
+ */
+long trace_decode_path(const char *path) {
+    FILE *in = fopen(path, "rb");
+    long ret;
+
+    if (in == NULL) {
+        perror(path);
+        return -1;
+    }
+    ret = trace_decode(in, stdout);
+    if (ret < 0)
+        fprintf(stderr, "%s: not a valid trace file\n", path);
+    fclose(in);
+    return ret;
+}
+
+
+#define TEST_THREADS 4
+#define TEST_RECORDS 20000
+
+static uint8_t test_ok[TEST_THREADS][TEST_RECORDS];    // Record accepted
+static atomic_int test_done;
+
+/**
+ *   @brief  k-th record of thread t in the threaded test
+ */
+static void test_record(int t, int k, trace_record_t *rec, uint8_t *payload) {
+    int i;
+
+    rec->id = (uint16_t)t;
+    rec->kind = (uint8_t)(LAZY_BINSTR + k % 6);
+    rec->nbits = (uint8_t)(k % 34);
+    rec->value = (uint32_t)k * 2654435761u ^ (uint32_t)t;
+    if (rec->kind == LAZY_HEXDUMP) {
+        rec->nbits = 0;
+        rec->value = (uint32_t)(k * 7 % 97);
+        for (i = 0; i < (int)rec->value; i++)
+            payload[i] = (uint8_t)(t * 31 + k + i);
+    }
+}
+
+static int test_trace(const trace_record_t *rec, const uint8_t *payload) {
+    switch (rec->kind) {
+    case LAZY_BINSTR:
+        return trace_binstr(rec->id, rec->value, rec->nbits);
+    case LAZY_INT_BINSTR:
+        return trace_int_binstr(rec->id, (int32_t)rec->value, rec->nbits);
+    case LAZY_HEXSTR:
+        return trace_hexstr(rec->id, rec->value, rec->nbits);
+    case LAZY_DECSTR:
+        return trace_decstr(rec->id, rec->value, rec->nbits);
+    case LAZY_INT_DECSTR:
+        return trace_int_decstr(rec->id, (int32_t)rec->value, rec->nbits);
+    default:
+        return trace_hexdump(rec->id, payload, rec->value);
+    }
+}
+
+static void *test_producer(void *arg) {
+    int t = (int)(intptr_t)arg, k;
+    uint8_t payload[128];
+    trace_record_t rec;
+
+    for (k = 0; k < TEST_RECORDS; k++) {
+        test_record(t, k, &rec, payload);
+        test_ok[t][k] = test_trace(&rec, payload) == 0;
+    }
+    return NULL;
+}
+
+static void *test_flusher(void *arg) {
+    (void)arg;
+    while (!atomic_load(&test_done))
+        trace_flush();
+    return NULL;
+}
+
+
+/**
+ *   @brief  Test function to test the trace_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Threads tracing while the file is flushed, no record lost or reordered
+ *     except the dropped ones
+ *   - Every record decodes to the string of its function
+ *   - Ring wrap around, full ring, refused records
+ *   - Invalid and truncated files
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_trace_log(int debug) {
+    static uint8_t payload[TRACE_MAX_BYTES], expect_payload[TRACE_MAX_BYTES];
+    char path[] = "/tmp/bit_trace_XXXXXX";
+    char str[8192], line[256];
+    pthread_t producer[TEST_THREADS], flusher;
+    trace_record_t rec, expect;
+    int next[TEST_THREADS] = { 0 };
+    long accepted = 0, decoded = 0, bytes;
+    uint64_t dropped;
+    fmt_arena_t arena;
+    fmt_slice_t s;
+    FILE *in, *out;
+    int fd, t, k, n, ret, status = 1;
+
+    if(debug)
+        printf("\n Test Results for the trace log ");
+
+    fd = mkstemp(path);
+    if (fd < 0)
+        return 0;
+    close(fd);
+    fmt_arena_init(&arena);
+
+    // Refused when closed or too long, full ring, wrap around
+    if (trace_binstr(0, 1, 8) != -1 || trace_flush() != -1)
+        status = 0;
+    if (trace_open(path) != 0 || trace_open(path) != -1)
+        status = 0;
+    memset(payload, 0xA5, sizeof(payload));
+    if (trace_hexdump(0, payload, TRACE_MAX_BYTES + 1) != -1 || trace_hexdump(0, NULL, 1) != -1)
+        status = 0;
+    dropped = trace_dropped();
+    for (n = 0; trace_hexdump(1, payload, TRACE_MAX_BYTES) == 0; n++)
+        ;
+    if (n != TRACE_RING_BYTES / (int)TRACE_RECORD_BYTES(TRACE_MAX_BYTES) || trace_dropped() != dropped + 1)
+        status = 0;
+    bytes = trace_flush();
+    if (bytes != n * (long)TRACE_RECORD_BYTES(TRACE_MAX_BYTES))
+        status = 0;
+    for (k = 0; k < 3 * n; k++)
+        if (trace_hexdump(1, payload, TRACE_MAX_BYTES) != 0 || trace_flush() < 0)
+            status = 0;
+    if (trace_close() != 0 || trace_close() != -1 || trace_binstr(0, 1, 8) != -1)
+        status = 0;
+    in = fopen(path, "rb");
+    if (in == NULL || trace_read_header(in) != 0)
+        status = 0;
+    for (k = 0; in != NULL && (ret = trace_read(in, &rec, expect_payload)) == 1; k++)
+        if (rec.kind != LAZY_HEXDUMP || rec.value != TRACE_MAX_BYTES
+            || memcmp(expect_payload, payload, TRACE_MAX_BYTES) != 0)
+            status = 0;
+    if (k != 4 * n || ret != 0)
+        status = 0;
+    if (in != NULL)
+        fclose(in);
+    if(debug)
+        printf("\n%d records in a ring, Result: %d", n, status);
+
+    // Threads tracing while another one flushes
+    if (trace_open(path) != 0)
+        status = 0;
+    dropped = trace_dropped();
+    atomic_store(&test_done, 0);
+    pthread_create(&flusher, NULL, test_flusher, NULL);
+    for (t = 0; t < TEST_THREADS; t++)
+        pthread_create(&producer[t], NULL, test_producer, (void *)(intptr_t)t);
+    for (t = 0; t < TEST_THREADS; t++)
+        pthread_join(producer[t], NULL);
+    atomic_store(&test_done, 1);
+    pthread_join(flusher, NULL);
+    if (trace_close() != 0)
+        status = 0;
+    for (t = 0; t < TEST_THREADS; t++)
+        for (k = 0; k < TEST_RECORDS; k++)
+            accepted += test_ok[t][k];
+    if (trace_dropped() - dropped != (uint64_t)(TEST_THREADS * TEST_RECORDS - accepted))
+        status = 0;
+
+    // Each thread's accepted records in order, rendered as the library does
+    in = fopen(path, "rb");
+    if (in == NULL || trace_read_header(in) != 0)
+        status = 0;
+    while (in != NULL && (ret = trace_read(in, &rec, payload)) == 1) {
+        t = rec.id;
+        if (t >= TEST_THREADS) {
+            status = 0;
+            break;
+        }
+        while (next[t] < TEST_RECORDS && !test_ok[t][next[t]])
+            next[t]++;
+        if (next[t] == TEST_RECORDS) {
+            status = 0;
+            break;
+        }
+        test_record(t, next[t]++, &expect, expect_payload);
+        if (rec.kind != expect.kind || rec.value != expect.value || rec.nbits != expect.nbits
+            || (rec.kind == LAZY_HEXDUMP && memcmp(payload, expect_payload, rec.value) != 0))
+            status = 0;
+
+        switch (rec.kind) {
+        case LAZY_BINSTR:
+            n = uint_to_binstr(str, sizeof(str), rec.value, rec.nbits);
+            break;
+        case LAZY_INT_BINSTR:
+            n = int_to_binstr(str, sizeof(str), (int32_t)rec.value, rec.nbits);
+            break;
+        case LAZY_HEXSTR:
+            n = uint_to_hexstr(str, sizeof(str), rec.value, rec.nbits);
+            break;
+        case LAZY_DECSTR:
+            n = uint_to_decstr(str, sizeof(str), rec.value, rec.nbits);
+            break;
+        case LAZY_INT_DECSTR:
+            n = int_to_decstr(str, sizeof(str), (int32_t)rec.value, rec.nbits);
+            break;
+        default:
+            hexdump(str, sizeof(str), payload, rec.value);
+            n = (int)strlen(str);
+            break;
+        }
+        ret = trace_render(&rec, payload, &arena);
+        s = fmt_arena_last(&arena);
+        if (ret != (n < 0 ? -1 : n) || (ret >= 0 && memcmp(s.data, str, s.len) != 0))
+            status = 0;
+        decoded++;
+    }
+    if (ret != 0 || decoded != accepted)
+        status = 0;
+    if (in != NULL)
+        fclose(in);
+    if(debug)
+        printf("\n%ld of %d records, %ld dropped, Result: %d", decoded,
+               TEST_THREADS * TEST_RECORDS, TEST_THREADS * TEST_RECORDS - accepted, status);
+
+    // Text lines of the decoder
+    if (trace_open(path) != 0 || trace_hexstr(7, 0xBEEF, 16) != 0
+        || trace_int_binstr(8, -2, 4) != 0 || trace_hexstr(9, 0x100, 8) != 0 || trace_close() != 0)
+        status = 0;
+    in = fopen(path, "rb");
+    out = tmpfile();
+    if (in == NULL || out == NULL || trace_decode(in, out) != 3)
+        status = 0;
+    if (out != NULL) {
+        rewind(out);
+        if (fgets(line, sizeof(line), out) == NULL || strstr(line, " 7 0xBEEF\n") == NULL
+            || fgets(line, sizeof(line), out) == NULL || strstr(line, " 8 0b1110\n") == NULL
+            || fgets(line, sizeof(line), out) == NULL || strstr(line, " 9 \n") == NULL)
+            status = 0;
+        fclose(out);
+    }
+
+    // Truncated file, other file
+    if (in != NULL) {
+        rewind(in);
+        n = (int)fread(str, 1, sizeof(str), in);
+        fclose(in);
+        for (k = 0; k < 2; k++) {
+            if (k == 1)
+                str[0] ^= 1;
+            in = tmpfile();
+            out = tmpfile();
+            if (in == NULL || out == NULL)
+                status = 0;
+            else {
+                fwrite(str, 1, (size_t)n - (k == 0), in);
+                rewind(in);
+                if (trace_decode(in, out) != -1)
+                    status = 0;
+            }
+            if (in != NULL)
+                fclose(in);
+            if (out != NULL)
+                fclose(out);
+        }
+    }
+    if(debug)
+        printf("\nDecoder, Result: %d", status);
+
+    fmt_arena_free(&arena);
+    unlink(path);
+    return status;
+}
@@ -0,0 +1,171 @@
+#ifndef TRACE_LOG_
+#define TRACE_LOG_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "fmt_arena.h"
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file trace_log.h
+ * @brief Binary trace log : raw values recorded by the hot path, formatted
+ *        offline into the strings of the library
+ *
+ * A record is a 16 byte header (timestamp, value, the caller's format id,
+ * the conversion and its nbits) followed, for a hexdump, by the bytes. The
+ * trace_*() functions copy it into a ring buffer of the calling thread,
+ * with no lock and no formatting; a full ring drops the record and counts
+ * it. trace_flush() appends what the rings hold to the file opened by
+ * trace_open(), so one thread (or a timer) writes the file while the others
+ * keep tracing.
+ *
+ * The file is decoded elsewhere with trace_decode(), or ./bit_operations
+ * -T <file>, one line "<timestamp> <id> <string>" per record, the string
+ * exactly as uint_to_binstr(), int_to_binstr(), uint_to_hexstr(),
+ * uint_to_decstr(), int_to_decstr() or hexdump() would have written it.
+ * Records are in the byte order of the machine which traced them; the
+ * decoder rejects a file of the other order.
+ *
+ * Each thread's records are in the order it traced them, the threads are
+ * interleaved by flush. Timestamps are CLOCK_MONOTONIC nanoseconds. A
+ * record made while trace_close() runs may be lost.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#define TRACE_RING_BYTES 65536  // Ring of each thread, a power of two
+#define TRACE_MAX_BYTES 4096    // Longest hexdump of one record
+#define TRACE_PAD 0xFF          // Kind of the filler at the end of a ring
+
+typedef struct {
+    uint64_t timestamp;         // CLOCK_MONOTONIC, ns
+    uint32_t value;             // Number, or hexdump bytes which follow
+    uint16_t id;                // Caller's format id, e.g. a log site
+    uint8_t kind;               // lazy_kind_t, or TRACE_PAD
+    uint8_t nbits;
+} trace_record_t;
+
+/**
+ *   @brief  Starts tracing to a new file, records still in the rings from
+ *           before are dropped
+ *
+ *   @param  path : Trace file, truncated
+ *
+ *   @return int ( 0 = Success, -1 = Failure or already open )
+ */
+int trace_open(const char *path);
+
+/**
+ *   @brief  Appends the records of every thread to the file
+ *
+ *   @return long : Bytes written, -1 if not open or writing failed
+ */
+long trace_flush(void);
+
+/**
+ *   @brief  Flushes and closes the file, later records are refused
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int trace_close(void);
+
+/**
+ *   @brief  Records a uint_to_binstr(), int_to_binstr(), uint_to_hexstr(),
+ *           uint_to_decstr() or int_to_decstr() call
+ *
+ *   @param  id : Caller's format id, written to the decoded line
+ *   @param  num : Integer to be converted
+ *   @param  nbits : It is the number of bits of the input
+ *
+ *   @return int ( 0 = Success, -1 = Not open or ring full )
+ */
+int trace_binstr(uint16_t id, uint32_t num, uint8_t nbits);
+int trace_int_binstr(uint16_t id, int32_t num, uint8_t nbits);
+int trace_hexstr(uint16_t id, uint32_t num, uint8_t nbits);
+int trace_decstr(uint16_t id, uint32_t num, uint8_t nbits);
+int trace_int_decstr(uint16_t id, int32_t num, uint8_t nbits);
+
+/**
+ *   @brief  Records a hexdump() call, copying the bytes
+ *
+ *   @return int ( 0 = Success, -1 = Not open, ring full or more than
+ *                 TRACE_MAX_BYTES )
+ */
+int trace_hexdump(uint16_t id, const void *loc, size_t nbytes);
+
+/**
+ *   @brief  Records refused since the program started, as their ring was full
+ */
+uint64_t trace_dropped(void);
+
+/**
+ *   @brief  Checks the header of a trace file
+ *
+ *   @return int ( 0 = Success, -1 = Not a trace file of this byte order )
+ */
+int trace_read_header(FILE *in);
+
+/**
+ *   @brief  Reads the next record, skipping the fillers
+ *
+ *   @param  in : Trace file, after trace_read_header()
+ *   @param  rec : Record read
+ *   @param  payload : TRACE_MAX_BYTES bytes, the hexdump bytes
+ *
+ *   @return int ( 1 = Record, 0 = End of file, -1 = Truncated or invalid )
+ */
+int trace_read(FILE *in, trace_record_t *rec, uint8_t *payload);
+
+/**
+ *   @brief  Appends the string of a record to an arena
+ *
+ *   @return int : Characters appended, -1 (and nothing appended) if the
+ *                 function rejects the value, or out of memory
+ */
+int trace_render(const trace_record_t *rec, const uint8_t *payload, fmt_arena_t *arena);
+
+/**
+ *   @brief  Writes the lines of a trace file
+ *
+ *   @return long : Records decoded, -1 for an invalid file or write error
+ */
+long trace_decode(FILE *in, FILE *out);
+
+/**
+ *   @brief  Decodes the trace file at path to stdout
+ *
+ *   @return long : Records decoded, -1 on failure
+ */
+long trace_decode_path(const char *path);
+
+/**
+ *   @brief  Test function to test the trace_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Threads tracing while the file is flushed, no record lost or reordered
+ *     except the dropped ones
+ *   - Every record decodes to the string of its function
+ *   - Ring wrap around, full ring, refused records
+ *   - Invalid and truncated files
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_trace_log(int debug);
+
+#endif /* TRACE_LOG_ */
@@ -0,0 +1,581 @@
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file work_pool.c
+ * @brief Work stealing thread pool shared by the bulk functions of the
+ *        library
+ *
+ * A job is a range of task numbers. Each thread has a slot holding the
+ * tasks [lo, hi) it has left, packed in one 64 bit word : the owner takes lo
+ * with a compare and swap, a thief takes the upper half of a slot the same
+ * way and keeps all but one of those tasks in its own, empty, slot. As a
+ * slot only ever holds tasks nobody has taken, a stale value can never match
+ * again and no ABA tag is needed. A thread leaves the job once every slot is
+ * empty; the caller then waits for the workers still running a task.
+ *
+ * Workers sleep on a condition variable between jobs. They join a job under
+ * the pool lock and only while it is active, so none of them can see a job
+ * the caller has returned from.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bit_operations.h"
+#include "bit_count.h"
+#include "bit_swap.h"
+#include "work_pool.h"
+
+#define SLOT(lo, hi) ((uint64_t)(lo) | (uint64_t)(hi) << 32)
+#define SLOT_LO(s) ((uint32_t)(s))
+#define SLOT_HI(s) ((uint32_t)((s) >> 32))
+#define NO_TASK UINT32_MAX
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t tasks;    // [lo, hi) left to this thread
+} work_slot_t;
+
+static struct {
+    pthread_mutex_t lock;                   // Everything but the slots and counters
+    pthread_cond_t wake;                    // A job or stop for the workers
+    pthread_cond_t idle;                    // Last worker left the job
+    pthread_t thread[WORK_POOL_MAX_THREADS];
+    int nthreads;                           // Configured, 0 until first used
+    int started;                            // Workers running, the caller not included
+    int stop;
+    uint64_t generation;                    // Jobs posted
+    int active;                             // Workers may join the current job
+    int busy;                               // Workers in the current job
+
+    work_fn_t fn;
+    void *ctx;
+    size_t count;
+    size_t grain;
+    uint32_t ntasks;
+    _Atomic int participants;               // Threads which ran a task
+    work_slot_t slot[WORK_POOL_MAX_THREADS];
+} pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+static pthread_mutex_t run_lock = PTHREAD_MUTEX_INITIALIZER;   // One job at a time
+
+
+/**
+ *   @brief  Takes the next task of a thread's own slot
+ */
+static uint32_t slot_pop(work_slot_t *slot) {
+    uint64_t s = atomic_load_explicit(&slot->tasks, memory_order_acquire);
+
+    while (SLOT_LO(s) < SLOT_HI(s)) {
+        if (atomic_compare_exchange_weak_explicit(&slot->tasks, &s, SLOT(SLOT_LO(s) + 1, SLOT_HI(s)),
+                                                  memory_order_acq_rel, memory_order_acquire))
+            return SLOT_LO(s);
+    }
+    return NO_TASK;
+}
+
+
+/**
+ *   @brief  Takes the upper half of another slot, runs its first task next
+ *           and leaves the rest in the thief's own slot
+ */
+static uint32_t slot_steal(int self, int nslots) {
+    uint32_t lo, hi, take;
+    uint64_t s;
+    int i, v;
+
+    for (i = 1; i < nslots; i++) {
+        v = (self + i) % nslots;
+        s = atomic_load_explicit(&pool.slot[v].tasks, memory_order_acquire);
+        while ((lo = SLOT_LO(s)) < (hi = SLOT_HI(s))) {
+            take = (hi - lo + 1) / 2;
+            if (atomic_compare_exchange_weak_explicit(&pool.slot[v].tasks, &s, SLOT(lo, hi - take),
+                                                      memory_order_acq_rel, memory_order_acquire)) {
+                atomic_store_explicit(&pool.slot[self].tasks, SLOT(hi - take + 1, hi),
+                                      memory_order_release);
+                return hi - take;
+            }
+        }
+    }
+    return NO_TASK;
+}
+
+
+/**
+ *   @brief  Runs tasks of the current job until no slot has any left
+ */
+static void participate(int self, int nslots) {
+    uint32_t task;
+    size_t begin, end;
+    int ran = 0;
+
+    for (;;) {
+        task = slot_pop(&pool.slot[self]);
+        if (task == NO_TASK)
+            task = slot_steal(self, nslots);
+        if (task == NO_TASK)
+            break;
+        begin = (size_t)task * pool.grain;
+        end = begin + pool.grain < pool.count ? begin + pool.grain : pool.count;
+        pool.fn(pool.ctx, begin, end);
+        ran = 1;
+    }
+    if (ran)
+        atomic_fetch_add_explicit(&pool.participants, 1, memory_order_relaxed);
+}
+
+
+static void *worker(void *arg) {
+    int self = (int)(intptr_t)arg, nslots;
+    uint64_t seen;
+
+    pthread_mutex_lock(&pool.lock);
+    seen = pool.generation;
+    for (;;) {
+        while (!pool.stop && pool.generation == seen)
+            pthread_cond_wait(&pool.wake, &pool.lock);
+        if (pool.stop)
+            break;
+        seen = pool.generation;
+        if (!pool.active)
+            continue;
+
+        pool.busy++;
+        nslots = pool.started + 1;
+        pthread_mutex_unlock(&pool.lock);
+        participate(self, nslots);
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.busy == 0)
+            pthread_cond_signal(&pool.idle);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+
+/**
+ *   @brief  Thread count from BIT_OPS_THREADS or the online CPUs
+ */
+static int default_threads(void) {
+    const char *env = getenv("BIT_OPS_THREADS");
+    long n;
+
+    if (env != NULL && env[0] != '\0') {
+        n = atol(env);
+        if (n >= 1)
+            return n > WORK_POOL_MAX_THREADS ? WORK_POOL_MAX_THREADS : (int)n;
+        fprintf(stderr, "BIT_OPS_THREADS: invalid count \"%s\", using the CPUs\n", env);
+    }
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1)
+        return 1;
+    return n > WORK_POOL_MAX_THREADS ? WORK_POOL_MAX_THREADS : (int)n;
+}
+
+
+/**
+ *   @brief  Stops and joins the workers, called with run_lock held
+ */
+static void stop_workers(void) {
+    int i, started;
+
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = 1;
+    started = pool.started;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+
+    for (i = 0; i < started; i++)
+        pthread_join(pool.thread[i], NULL);
+
+    pthread_mutex_lock(&pool.lock);
+    pool.started = 0;
+    pool.stop = 0;
+    pthread_mutex_unlock(&pool.lock);
+}
+
+
+/**
+ *   @brief  Sets the number of threads, the calling one included
+ *
+ *   @param  nthreads : 1 to WORK_POOL_MAX_THREADS, 0 for BIT_OPS_THREADS or
+ *                      the number of online CPUs
+ *
+ *   @return int : Number of threads used from now on
+ */
+int work_pool_set_threads(int nthreads) {
+    if (nthreads <= 0)
+        nthreads = default_threads();
+    if (nthreads > WORK_POOL_MAX_THREADS)
+        nthreads = WORK_POOL_MAX_THREADS;
+
+    pthread_mutex_lock(&run_lock);
+    if (pool.started != nthreads - 1)
+        stop_workers();
+    pool.nthreads = nthreads;
+    pthread_mutex_unlock(&run_lock);
+    return nthreads;
+}
+
+
+/**
+ *   @brief  Number of threads a job may use
+ */
+int work_pool_threads(void) {
+    int n;
+
+    pthread_mutex_lock(&run_lock);
+    if (pool.nthreads == 0)
+        pool.nthreads = default_threads();
+    n = pool.nthreads;
+    pthread_mutex_unlock(&run_lock);
+    return n;
+}
+
+
+/**
+ *   @brief  Items per task for items of item_bytes of input and output
+ */
+size_t work_pool_grain(size_t item_bytes) {
+    if (item_bytes == 0 || item_bytes >= WORK_POOL_TASK_BYTES)
+        return 1;
+    return WORK_POOL_TASK_BYTES / item_bytes;
+}
+
+
+/**
+ *   @brief  Runs fn over items [0, count) and returns when all are done
+ *
+ *   @param  fn : Called with disjoint ranges covering every item once
+ *   @param  ctx : Passed to fn
+ *   @param  count : Number of items
+ *   @param  grain : Items per task, 0 for 1
+ *
+ *   @return int : Number of threads which ran tasks (1 when run inline)
+ */
+int work_pool_run(work_fn_t fn, void *ctx, size_t count, size_t grain) {
+    size_t ntasks;
+    int nslots, i, ret;
+
+    if (grain == 0)
+        grain = 1;
+    if (count == 0)
+        return 1;
+    ntasks = (count - 1) / grain + 1;
+
+    // Small, nested or concurrent jobs
+    if (ntasks == 1 || ntasks >= NO_TASK || pthread_mutex_trylock(&run_lock) != 0) {
+        fn(ctx, 0, count);
+        return 1;
+    }
+    if (pool.nthreads == 0)
+        pool.nthreads = default_threads();
+    if (pool.nthreads == 1) {
+        pthread_mutex_unlock(&run_lock);
+        fn(ctx, 0, count);
+        return 1;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.started < pool.nthreads - 1
+           && pthread_create(&pool.thread[pool.started], NULL, worker,
+                             (void *)(intptr_t)(pool.started + 1)) == 0)
+        pool.started++;
+    nslots = pool.started + 1;
+
+    // Contiguous blocks, so a thread works on neighbouring memory
+    pool.fn = fn;
+    pool.ctx = ctx;
+    pool.count = count;
+    pool.grain = grain;
+    pool.ntasks = (uint32_t)ntasks;
+    atomic_store(&pool.participants, 0);
+    for (i = 0; i < nslots; i++)
+        atomic_store(&pool.slot[i].tasks, SLOT(ntasks * (size_t)i / (size_t)nslots,
+                                               ntasks * (size_t)(i + 1) / (size_t)nslots));
+    pool.active = 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+
+    participate(0, nslots);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.busy > 0)
+        pthread_cond_wait(&pool.idle, &pool.lock);
+    pool.active = 0;
+    ret = atomic_load(&pool.participants);
+    pthread_mutex_unlock(&pool.lock);
+
+    pthread_mutex_unlock(&run_lock);
+    return ret;
+}
+
+
+/**
+ *   @brief  Stops and joins the workers, the next run starts them again
+ */
+void work_pool_shutdown(void) {
+    pthread_mutex_lock(&run_lock);
+    stop_workers();
+    pthread_mutex_unlock(&run_lock);
+}
+
+
+/**
+ *   @brief  Prints the throughput of the pooled functions for 1, 2, 4 ...
+ *           threads up to work_pool_threads()
+ *
+ *   @param  mbytes : Size of the input in MB
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int work_pool_bench(size_t mbytes) {
+    const char *names[] = { "hexdump", "decstr_batch", "bit_swap", "popcount" };
+    size_t nbytes = mbytes * 1024 * 1024, count = nbytes / sizeof(uint32_t), i;
+    size_t dump_size = (nbytes / HEXDUMP_BYTES_PER_LINE + 1) * (hexdump_line_length(16) + 1);
+    uint8_t *data = malloc(nbytes), *swapped = malloc(nbytes);
+    char *text = malloc(dump_size > count * 11 ? dump_size : count * 11);
+    int max_threads = work_pool_threads(), threads, method;
+    struct timespec start, end;
+    uint64_t sink = 0;
+    double ns;
+
+    if (data == NULL || swapped == NULL || text == NULL || nbytes == 0) {
+        free(data);
+        free(swapped);
+        free(text);
+        return -1;
+    }
+    for (i = 0; i < nbytes; i++)
+        data[i] = (uint8_t)(i * 2654435761u >> 24);
+
+    printf("%-12s %8s %10s\n", "function", "threads", "MB/s");
+    for (method = 0; method < 4; method++) {
+        for (threads = 1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+            work_pool_set_threads(threads);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if (method == 0)
+                sink += (uint8_t)hexdump(text, dump_size, data, nbytes)[nbytes];
+            else if (method == 1)
+                sink += (uint64_t)uint_to_decstr_batch(text, count * 11, (const uint32_t *)data,
+                                                       count, 32, ' ');
+            else if (method == 2)
+                sink += (uint64_t)bit_swap(BIT_SWAP_BITS32, swapped, data, nbytes) + swapped[nbytes / 2];
+            else
+                sink += bit_popcount_array(data, nbytes);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+
+            ns = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+            printf("%-12s %8d %10.1f\n", names[method], threads, (double)nbytes / ns * 1e3);
+            if (threads == max_threads)
+                break;
+        }
+    }
+    work_pool_set_threads(max_threads);
+
+    free(data);
+    free(swapped);
+    free(text);
+    return sink == 0 ? -1 : 0;
+}
+
+
+typedef struct {
+    _Atomic uint8_t *runs;      // Times each item was run
+    size_t slow;                // Items below this one are slow
+    int nested;                 // Runs a job from inside the tasks
+} test_job_t;
+
+static void test_fn(void *ctx, size_t begin, size_t end) {
+    test_job_t *job = ctx;
+    volatile size_t spin;
+    size_t i;
+
+    for (i = begin; i < end; i++) {
+        atomic_fetch_add(&job->runs[i], 1);
+        if (i < job->slow)
+            for (spin = 0; spin < 2000; spin++)
+                ;
+    }
+    if (job->nested) {
+        test_job_t inner = { job->runs + begin, 0, 0 };
+
+        // Runs inline, as this thread's job is still running
+        if (work_pool_run(test_fn, &inner, end - begin, 1) != 1)
+            atomic_fetch_add(&job->runs[begin], 100);
+    }
+}
+
+static void *test_concurrent(void *arg) {
+    test_job_t *job = arg;
+
+    work_pool_run(test_fn, job, 100000, 100);
+    return NULL;
+}
+
+/**
+ *   @brief  Whether every item of a job was run exactly times
+ */
+static int test_runs(_Atomic uint8_t *runs, size_t count, int times) {
+    size_t i;
+    int ok = 1;
+
+    for (i = 0; i < count; i++) {
+        if (atomic_load(&runs[i]) != times)
+            ok = 0;
+        atomic_store(&runs[i], 0);
+    }
+    return ok;
+}
+
+
+/**
+ *   @brief  Test function to test the work_pool_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every item run once for any count and grain, uneven tasks
+ *   - Small jobs inline, nested and concurrent runs
+ *   - Pooled hexdump(), uint_to_decstr_batch(), bit_swap() and
+ *     bit_popcount_array() against one thread
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_work_pool(int debug) {
+    const size_t counts[] = { 1, 2, 7, 100, 4097, 100000 };
+    const size_t grains[] = { 0, 1, 3, 64, 1000, 200000 };
+    const int threads[] = { 1, 2, 3, 4, 8 };
+    const size_t nbytes = 3 * 1024 * 1024 + 13, count = nbytes / sizeof(uint32_t);
+    size_t dump_size = (nbytes / HEXDUMP_BYTES_PER_LINE + 1) * (hexdump_line_length(16) + 1);
+    _Atomic uint8_t *runs = calloc(100000, sizeof(*runs));
+    uint8_t *data = malloc(nbytes), *one = malloc(nbytes), *many = malloc(nbytes);
+    char *text_one = malloc(dump_size), *text_many = malloc(dump_size);
+    int default_count = work_pool_threads(), t, ret, len_one, len_many, status = 1;
+    test_job_t job = { NULL, 0, 0 };
+    uint64_t pop_one, pop_many;
+    pthread_t other;
+    size_t c, g, i;
+
+    if(debug)
+        printf("\n Test Results for the work stealing pool ");
+
+    if (runs == NULL || data == NULL || one == NULL || many == NULL
+        || text_one == NULL || text_many == NULL) {
+        free((void *)runs);
+        free(data);
+        free(one);
+        free(many);
+        free(text_one);
+        free(text_many);
+        return 0;
+    }
+    job.runs = runs;
+
+    // Every item once, whatever the split
+    for (t = 0; t < (int)(sizeof(threads) / sizeof(threads[0])); t++) {
+        if (work_pool_set_threads(threads[t]) != threads[t] || work_pool_threads() != threads[t])
+            status = 0;
+        for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+            for (g = 0; g < sizeof(grains) / sizeof(grains[0]); g++) {
+                ret = work_pool_run(test_fn, &job, counts[c], grains[g]);
+                if (ret < 1 || ret > threads[t] || !test_runs(runs, counts[c], 1))
+                    status = 0;
+            }
+        }
+    }
+    if (work_pool_run(test_fn, &job, 0, 1) != 1)
+        status = 0;
+    if(debug)
+        printf("\nSplits, Result: %d", status);
+
+    // Slow tasks at the start are stolen, one task and nesting run inline
+    work_pool_set_threads(4);
+    job.slow = 20000;
+    ret = work_pool_run(test_fn, &job, 100000, 10);
+    if (!test_runs(runs, 100000, 1))
+        status = 0;
+    if(debug)
+        printf("\nUneven tasks on %d threads, Result: %d", ret, status);
+    job.slow = 0;
+    if (work_pool_run(test_fn, &job, 5000, 5000) != 1 || !test_runs(runs, 5000, 1))
+        status = 0;
+    job.nested = 1;
+    work_pool_run(test_fn, &job, 10000, 100);
+    if (!test_runs(runs, 10000, 2))
+        status = 0;
+    job.nested = 0;
+    if (pthread_create(&other, NULL, test_concurrent, &job) == 0) {
+        work_pool_run(test_fn, &job, 100000, 100);
+        pthread_join(other, NULL);
+        if (!test_runs(runs, 100000, 2))
+            status = 0;
+    }
+    work_pool_shutdown();
+    if (work_pool_run(test_fn, &job, 100000, 100) < 1 || !test_runs(runs, 100000, 1))
+        status = 0;
+    if(debug)
+        printf("\nInline, nested, concurrent, Result: %d", status);
+
+    // Library functions on one thread and on several
+    for (i = 0; i < nbytes; i++)
+        data[i] = (uint8_t)(i * 2654435761u >> 24);
+    for (t = 1; t <= 4; t += 3) {
+        work_pool_set_threads(t);
+        hexdump(t == 1 ? text_one : text_many, dump_size, data, nbytes);
+        if (bit_swap(BIT_SWAP_BITS32, t == 1 ? one : many, data, nbytes) != 0)
+            status = 0;
+    }
+    if (strcmp(text_one, text_many) != 0 || memcmp(one, many, nbytes) != 0)
+        status = 0;
+    memcpy(many, data, nbytes);
+    if (bit_swap(BIT_SWAP_BITS32, many, many, nbytes) != 0 || memcmp(one, many, nbytes) != 0)
+        status = 0;
+    c = (nbytes + HEXDUMP_BYTES_PER_LINE - 1) / HEXDUMP_BYTES_PER_LINE
+        * (hexdump_line_length(hexdump_offset_digits(nbytes)) + 1);
+    if (strlen(hexdump(text_many, c, data, nbytes)) != c - 1 || hexdump(text_many, c - 1, data, nbytes)[0] != '\0')
+        status = 0;
+
+    work_pool_set_threads(1);
+    len_one = uint_to_decstr_batch(text_one, dump_size, (const uint32_t *)data, count, 32, ',');
+    pop_one = bit_popcount_array(data + 1, nbytes - 1);
+    work_pool_set_threads(4);
+    len_many = uint_to_decstr_batch(text_many, dump_size, (const uint32_t *)data, count, 32, ',');
+    pop_many = bit_popcount_array(data + 1, nbytes - 1);
+    if (len_one <= 0 || len_one != len_many || strcmp(text_one, text_many) != 0 || pop_one != pop_many)
+        status = 0;
+    if (uint_to_decstr_batch(text_many, (size_t)len_one, (const uint32_t *)data, count, 32, ',') != -1
+        || text_many[0] != '\0'
+        || uint_to_decstr_batch(text_many, dump_size, (const uint32_t *)data, count, 24, ',') != -1)
+        status = 0;
+    if(debug)
+        printf("\nLibrary functions, %d characters, %llu bits set, Result: %d", len_many,
+               (unsigned long long)pop_many, status);
+
+    work_pool_set_threads(default_count);
+    free((void *)runs);
+    free(data);
+    free(one);
+    free(many);
+    free(text_one);
+    free(text_many);
+    return status;
+}
@@ -0,0 +1,117 @@
+#ifndef WORK_POOL_
+#define WORK_POOL_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+* Copyright (C) 2020 by Arpit Savarkar
+* Redistribution, modification or use of this software in source or binary
+* forms is permitted as long as the files maintain this copyright. Users are
+* permitted to modify this and use it to learn about the field of embedded
+* software. Arpit Savarkar and the University of Colorado are not liable for
+* any misuse of this material.
+*
+******************************************************************************/
+/**
+ * @file work_pool.h
+ * @brief Work stealing thread pool shared by the bulk functions of the
+ *        library
+ *
+ * work_pool_run() splits items [0, count) into tasks of grain items, about
+ * WORK_POOL_TASK_BYTES of input and output each, and runs them on the
+ * calling thread and the workers. Each thread starts with a contiguous block
+ * of tasks and, once it is out of work, steals half of the block another
+ * thread has left. A single task runs on the calling thread without waking
+ * anyone, so small inputs never pay for the pool.
+ *
+ * hexdump(), uint_to_decstr_batch(), bit_swap() and bit_popcount_array()
+ * use it for large inputs. Their tasks write disjoint parts of the output,
+ * so a freshly allocated output buffer has its pages first touched, and
+ * placed on the NUMA node, by the thread which fills them.
+ *
+ * The thread count is the number of online CPUs, BIT_OPS_THREADS=<n> in the
+ * environment, or work_pool_set_threads(). Workers start on the first run.
+ * One job runs at a time; a run from inside a task, or while another
+ * thread's job runs, is done on the calling thread alone.
+ *
+ * @author Arpit Savarkar
+ * @date August 27 2020
+ * @version 1.0
+
+*/
+
+#define WORK_POOL_MAX_THREADS 256
+#define WORK_POOL_TASK_BYTES (256 * 1024)  // Input and output of a task, about an L2 cache
+
+/**
+ *   @brief  Runs items [begin, end) of a job, one or more whole tasks :
+ *           begin is a multiple of the grain
+ */
+typedef void (*work_fn_t)(void *ctx, size_t begin, size_t end);
+
+/**
+ *   @brief  Sets the number of threads, the calling one included
+ *
+ *   @param  nthreads : 1 to WORK_POOL_MAX_THREADS, 0 for BIT_OPS_THREADS or
+ *                      the number of online CPUs
+ *
+ *   @return int : Number of threads used from now on
+ */
+int work_pool_set_threads(int nthreads);
+
+/**
+ *   @brief  Number of threads a job may use
+ */
+int work_pool_threads(void);
+
+/**
+ *   @brief  Items per task for items of item_bytes of input and output
+ */
+size_t work_pool_grain(size_t item_bytes);
+
+/**
+ *   @brief  Runs fn over items [0, count) and returns when all are done
+ *
+ *   @param  fn : Called with disjoint ranges covering every item once, the
+ *                whole range at once when run inline
+ *   @param  ctx : Passed to fn
+ *   @param  count : Number of items
+ *   @param  grain : Items per task, 0 for 1
+ *
+ *   @return int : Number of threads which ran tasks (1 when run inline)
+ */
+int work_pool_run(work_fn_t fn, void *ctx, size_t count, size_t grain);
+
+/**
+ *   @brief  Stops and joins the workers, the next run starts them again
+ */
+void work_pool_shutdown(void);
+
+/**
+ *   @brief  Prints the throughput of the pooled functions for 1, 2, 4 ...
+ *           threads up to work_pool_threads()
+ *
+ *   @param  mbytes : Size of the input in MB
+ *
+ *   @return int ( 0 = Success, -1 = Failure )
+ */
+int work_pool_bench(size_t mbytes);
+
+/**
+ *   @brief  Test function to test the work_pool_*() functions
+ *
+ *   Returns status as integer "1" if all test cases return successful, else "0"
+ *   Test Cases include
+ *   - Every item run once for any count and grain, uneven tasks
+ *   - Small jobs inline, nested and concurrent runs
+ *   - Pooled hexdump(), uint_to_decstr_batch(), bit_swap() and
+ *     bit_popcount_array() against one thread
+ *
+ *   @param debug : To Print Debug Status
+ *
+ *   @return Integer ( 1 = Success, 0 = Failure )
+ */
+int test_work_pool(int debug);
+
+#endif /* WORK_POOL_ */